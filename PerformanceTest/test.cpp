@@ -842,6 +842,97 @@ void TestPerformanceLinqWhere() {
 	Console::WriteLine((long)sw.ElapsedMilliseconds);
 }
 
+void TestPerformanceLinqQuery() {
+	System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
+	for (int j = 0; j < 1000; j++) {
+		lst.Add(j);
+	}
+
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	sw.Start();
+	long cnt = 0;
+
+	for (long i = 0; i < 100000; i++) {
+		List<int> filtered = System::Linq::From(lst).Where([](int x) { return x > 500; }).ToList();
+		cnt += filtered.Count;
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	cnt = 0;
+
+	for (long i = 0; i < 100000; i++) {
+		cnt += System::Linq::From(lst).Where([](int x) { return x > 500; }).Select([](int x) { return x * 2; }).Sum();
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// hand written loop for reference
+	sw.Restart();
+	cnt = 0;
+
+	for (long i = 0; i < 100000; i++) {
+		int sum = 0;
+		for (int j = 0; j < lst.Count; j++) {
+			int x = lst[j];
+			if (x > 500)
+				sum += x * 2;
+		}
+		cnt += sum;
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+}
+
+void TestPerformanceParallelLinq() {
+	System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
+	for (int j = 0; j < 10000000; j++) {
+		lst.Add(j);
+	}
+
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	sw.Start();
+	long cnt = 0;
+
+	for (long i = 0; i < 10; i++) {
+		cnt += System::Linq::From(lst).Where([](int x) { return x % 3 == 0; }).Select([](int x) { return (long)x; }).Sum();
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	cnt = 0;
+
+	for (long i = 0; i < 10; i++) {
+		cnt += lst.AsParallel().Where([](int x) { return x % 3 == 0; }).Select([](int x) { return (long)x; }).Sum();
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	cnt = 0;
+
+	for (long i = 0; i < 10; i++) {
+		List<int> filtered = lst.AsParallel().AsOrdered().Where([](int x) { return x % 3 == 0; }).ToList();
+		cnt += filtered.Count;
+	}
+
+	sw.Stop();
+	Console::WriteLine(cnt);
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+}
+
 void TestPerformanceLinqOrderBy() {
 	System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
 	for (int j = 0; j < 1000; j++) {
@@ -864,6 +955,522 @@ void TestPerformanceLinqOrderBy() {
 	Console::WriteLine((long)sw.ElapsedMilliseconds);
 }
 
+void TestPerformanceSort() {
+	System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
+	std::vector<int> vec;
+	for (int j = 0; j < 10000000; j++) {
+		int val = (int)(((long)j * 2654435761) & 0x7FFFFFFF);
+		lst.Add(val);
+		vec.push_back(val);
+	}
+
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	sw.Start();
+	std::sort(vec.begin(), vec.end());
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	lst.Sort();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	lst.Sort([](int a, int b) { return a < b ? 1 : (a > b ? -1 : 0); });
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	System::Collections::Generic::List<string> strs = new System::Collections::Generic::List<string>();
+	for (int j = 0; j < 1000000; j++) {
+		strs.Add(string((int)(((long)j * 2654435761) & 0x7FFFFFFF)));
+	}
+
+	sw.Restart();
+	strs.Sort();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+}
+
+void TestPerformanceAggregates() {
+	System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
+	System::Collections::Generic::Array<double> arr(10000000);
+	for (int j = 0; j < 10000000; j++) {
+		lst.Add((int)(((long)j * 2654435761) & 0xFF));
+		arr[j] = j * 0.25;
+	}
+
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	for (int r = 0; r < 3; r++) {
+		sw.Restart();
+		long sum = 0;
+		int max = lst[0];
+		for (int j = 0; j < 10000000; j++) {
+			sum += lst[j];
+			if (lst[j] > max)
+				max = lst[j];
+		}
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		sum += lst.Sum();
+		max += lst.Max();
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		double dsum = arr.Sum() + arr.Min() + arr.Max();
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		max += lst.Max<int>([](int x) { return x; });
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+		if (sum == 0 || dsum == 0 || max == 0)
+			Console::WriteLine(u"unexpected");
+	}
+}
+
+void TestPerformanceListAddRange() {
+	System::Collections::Generic::Array<int> arr(10000000);
+	for (int j = 0; j < 10000000; j++)
+		arr[j] = j;
+
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	for (int r = 0; r < 3; r++) {
+		sw.Restart();
+		System::Collections::Generic::List<int> lst = new System::Collections::Generic::List<int>();
+		for (int j = 0; j < 10000000; j++)
+			lst.Add(arr[j]);
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		System::Collections::Generic::List<int> lst2 = new System::Collections::Generic::List<int>();
+		lst2.AddRange(arr);
+		lst2.InsertRange(0, arr);
+		lst2.RemoveRange(0, 10000000);
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+	}
+}
+
+void TestPerformanceLinkedList() {
+	System::Collections::Generic::LinkedList<int> lst = new System::Collections::Generic::LinkedList<int>();
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	sw.Start();
+	for (int j = 0; j < 1000000; j++)
+		lst.AddLast(j);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	for (int r = 0; r < 3; r++) {
+		long sum = 0;
+		sw.Restart();
+		for (System::Collections::Generic::LinkedListNode<int> node = lst.First; node != null; node = node.Next)
+			sum += node.Value;
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		for (int val : lst)
+			sum += val;
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		// LRU: move the last node to the front
+		sw.Restart();
+		for (int j = 0; j < 1000000; j++) {
+			int val = lst.Last->Value;
+			lst.RemoveLast();
+			lst.AddFirst(val);
+		}
+		sw.Stop();
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+		if (sum == 0)
+			Console::WriteLine(u"unexpected");
+	}
+}
+
+void TestPerformanceHashSet() {
+	System::Collections::Generic::Dictionary<int, bool> dic = new System::Collections::Generic::Dictionary<int, bool>();
+	System::Collections::Generic::HashSet<int> set = new System::Collections::Generic::HashSet<int>();
+	System::Collections::Generic::HashSet<int> dense(0, 1999999);
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+
+	sw.Start();
+	for (int i = 0; i < 1000000; i++)
+		dic[(int)(((long)i * 2654435761) % 2000000)] = true;
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int i = 0; i < 1000000; i++)
+		set.Add((int)(((long)i * 2654435761) % 2000000));
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int i = 0; i < 1000000; i++)
+		dense.Add((int)(((long)i * 2654435761) % 2000000));
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	int found = 0;
+	sw.Restart();
+	for (int i = 0; i < 2000000; i++)
+		found += dic.Contains(i);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int i = 0; i < 2000000; i++)
+		found += set.Contains(i);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	System::Collections::Generic::HashSet<int> other(0, 1999999);
+	for (int i = 0; i < 2000000; i += 3)
+		other.Add(i);
+	sw.Restart();
+	for (int r = 0; r < 100; r++) {
+		dense.UnionWith(other);
+		dense.IntersectWith(other);
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine(found + dense.Count);
+}
+
+void TestPerformanceSortedDictionary() {
+	System::Collections::Generic::SortedDictionary<int, int> tree = new System::Collections::Generic::SortedDictionary<int, int>();
+	System::Collections::Generic::Dictionary<int, int> dic = new System::Collections::Generic::Dictionary<int, int>();
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+
+	sw.Start();
+	for (int i = 0; i < 1000000; i++)
+		tree[(int)(((long)i * 2654435761) % 2000000)] = i;
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	for (int i = 0; i < 1000000; i++)
+		dic[(int)(((long)i * 2654435761) % 2000000)] = i;
+
+	// range scans: sorted snapshot of the Dictionary against the B+tree
+	long sum = 0;
+	sw.Restart();
+	for (int r = 0; r < 10; r++) {
+		System::Collections::Generic::List<int> keys(1000000);
+		for (auto kv : dic)
+			keys.Add(kv.Key);
+		keys.Sort();
+		for (int k : keys) {
+			if (k >= r * 1000 && k < r * 1000 + 2000)
+				sum += k;
+		}
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int r = 0; r < 10000; r++) {
+		for (auto e : tree.Range(r * 100, r * 100 + 1999))
+			sum += e.Value;
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// bulk load of sorted input
+	System::Collections::Generic::Array<int> keys(1000000), values(1000000);
+	for (int i = 0; i < 1000000; i++) {
+		keys[i] = i * 2;
+		values[i] = i;
+	}
+	sw.Restart();
+	tree.BulkLoad(keys, values);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine(sum + tree.Count);
+}
+
+void TestPerformancePriorityQueue() {
+	System::Collections::Generic::PriorityQueue<int, int> q = new System::Collections::Generic::PriorityQueue<int, int>();
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+
+	long sum = 0;
+	sw.Start();
+	for (int i = 0; i < 1000000; i++)
+		q.Enqueue(i, (int)(((long)i * 2654435761) % 2000000));
+	while (q.Count > 0)
+		sum += q.Dequeue();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// top 100 of 1M: sorting the whole list against a bounded queue
+	System::Collections::Generic::List<int> lst(1000000);
+	for (int i = 0; i < 1000000; i++)
+		lst.Add((int)(((long)i * 2654435761) % 2000000));
+	sw.Restart();
+	System::Collections::Generic::List<int> sorted(0);
+	sorted.AddRange(lst);
+	sorted.Sort();
+	for (int i = 0; i < 100; i++)
+		sum += sorted[999999 - i];
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	System::Collections::Generic::PriorityQueue<int, int> top = new System::Collections::Generic::PriorityQueue<int, int>();
+	top.MaxCount = 100;
+	for (int v : lst)
+		top.Enqueue(v, v);
+	while (top.Count > 0)
+		sum += top.Dequeue();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine(sum);
+}
+
+void TestPerformanceQueue() {
+	System::Collections::Generic::Queue<int> q = new System::Collections::Generic::Queue<int>();
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+
+	// a working set of 1000 items, a steady stream through the ring buffer
+	long sum = 0;
+	sw.Start();
+	for (int i = 0; i < 1000; i++)
+		q.Enqueue(i);
+	for (int i = 0; i < 10000000; i++) {
+		q.Enqueue(i);
+		sum += q.Dequeue();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	int batch[256];
+	for (int i = 0; i < 256; i++)
+		batch[i] = i;
+	sw.Restart();
+	for (int i = 0; i < 100000; i++) {
+		q.EnqueueRange(batch, 256);
+		sum += q.DequeueRange(batch, 256);
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine(sum);
+}
+
+void TestPerformanceColumnList() {
+	System::Collections::Generic::List<Tuple<int, double>> tuples(1000000);
+	System::Collections::Generic::ColumnList<int, double> columns(1000000);
+	for (int i = 0; i < 1000000; i++) {
+		tuples.Add(Tuple<int, double>(i, (i % 1000) * 0.25));
+		columns.Add(i, (i % 1000) * 0.25);
+	}
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+
+	// a scan of one field: a pointer per row against one contiguous column
+	double sum = 0;
+	sw.Start();
+	for (int r = 0; r < 10; r++) {
+		for (auto const& t : tuples)
+			sum += t.GetItem2();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int r = 0; r < 10; r++)
+		sum += columns.Sum<1>();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	int found = 0;
+	for (int r = 0; r < 10; r++)
+		found += columns.CountWhere<1>([](double price) { return price > 200; });
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine((long)sum + found);
+}
+
+void TestPerformanceArrayAllocation() {
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	double sum = 0;
+
+	// 4M doubles: the zeroing constructor against allocation only
+	sw.Start();
+	for (int r = 0; r < 100; r++) {
+		System::Collections::Generic::Array<double> arr(4000000);
+		arr[r] = r;
+		sum += arr[r];
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int r = 0; r < 100; r++) {
+		System::Collections::Generic::Array<double> arr = System::Collections::Generic::Array<double>::CreateUninitialized(4000000);
+		arr[r] = r;
+		sum += arr[r];
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	for (int r = 0; r < 100; r++) {
+		System::Collections::Generic::Array<double> arr = System::Collections::Generic::Array<double>::CreateAligned(4000000, 64, false);
+		arr[r] = r;
+		sum += arr[r];
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine((long)sum);
+}
+
+void TestPerformanceImmutable() {
+	const int n = 100000;
+	System::Collections::Generic::Dictionary<int, int> dic = new System::Collections::Generic::Dictionary<int, int>();
+	System::Collections::Immutable::ImmutableDictionary<int, int> imm = new System::Collections::Immutable::ImmutableDictionary<int, int>();
+	System::Collections::Immutable::ImmutableDictionary<int, int>::Builder builder = imm.ToBuilder();
+	for (int i = 0; i < n; i++) {
+		dic[i] = i;
+		builder.SetItem(i, i);
+	}
+	imm = builder.ToImmutable();
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	long sum = 0;
+
+	// a new version per update: 100 copies of a Dictionary against 100000 path copies of the trie
+	sw.Start();
+	for (int r = 0; r < 100; r++) {
+		System::Collections::Generic::Dictionary<int, int> copy = new System::Collections::Generic::Dictionary<int, int>();
+		for (auto const& kvp : dic)
+			copy[kvp.Key] = kvp.Value;
+		copy[r] = -r;
+		sum += copy[r];
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	sw.Restart();
+	System::Collections::Immutable::ImmutableDictionary<int, int> version = imm;
+	for (int i = 0; i < n; i++)
+		version = version.SetItem(i, -i);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	sum += version[n - 1] + imm[n - 1];
+
+	// a builder edits the nodes it already copied in place
+	sw.Restart();
+	System::Collections::Immutable::ImmutableDictionary<int, int>::Builder batch = imm.ToBuilder();
+	for (int i = 0; i < n; i++)
+		batch.SetItem(i, -i);
+	version = batch.ToImmutable();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	System::Collections::Immutable::ImmutableList<int> list = new System::Collections::Immutable::ImmutableList<int>();
+	for (int i = 0; i < n; i++)
+		list = list.Add(i);
+	sw.Restart();
+	for (int i = 0; i < n; i++)
+		list = list.SetItem((i * 7919) % n, i);
+	for (int i = 0; i < 1000; i++)
+		list = list.Insert(i * 97, i).RemoveAt(i * 89);
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	for (int value : list)
+		sum += value;
+	Console::WriteLine(sum + version[n - 1]);
+}
+
+#ifdef SYSTEM_COROUTINES
+System::Threading::Tasks::LazyTask<int> NextValue(int i) {
+	co_return i & 1;
+}
+
+System::Threading::Tasks::Task<long> AwaitLoop(int n) {
+	long sum = 0;
+	for (int i = 0; i < n; i++)
+		sum += co_await NextValue(i);
+	co_return sum;
+}
+#endif
+
+void TestPerformanceTasks() {
+	using namespace System::Threading::Tasks;
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	Task<>::Run([]() {}).Wait();
+
+	// a long chain of continuations, each one runs inline on the worker that completed the previous one
+	sw.Start();
+	TaskCompletionSource<int> start = new TaskCompletionSource<int>();
+	Task<int> chain = start.Task;
+	for (int i = 0; i < 100000; i++)
+		chain = chain.ContinueWith([](Task<int> const& a) { return (int)a.Result + 1; });
+	start.SetResult(0);
+	Console::WriteLine((int)chain.Result);
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// fan out and join
+	sw.Restart();
+	System::Collections::Generic::Array<Task<int>> tasks(100000);
+	for (int i = 0; i < 100000; i++)
+		tasks[i] = Task<>::Run([i]() { return i & 1; });
+	System::Collections::Generic::Array<int> results = Task<>::WhenAll(tasks).Result;
+	Console::WriteLine(results.Length);
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// completed tasks neither queue nor block
+	sw.Restart();
+	long sum = 0;
+	for (int i = 0; i < 1000000; i++)
+		sum += (int)Task<>::FromResult(i).Result;
+	sw.Stop();
+	Console::WriteLine(sum);
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+#ifdef SYSTEM_COROUTINES
+	// nested lazy coroutines hand control to each other directly, one pooled frame per call
+	sw.Restart();
+	Console::WriteLine((long)AwaitLoop(1000000).Result);
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+#endif
+}
+
+void TestPerformanceParallel() {
+	using namespace System::Threading::Tasks;
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	const int n = 10000000;
+	System::Collections::Generic::Array<double> data(n);
+	Parallel::For(0, 1000, [](int) {});
+
+	sw.Start();
+	for (int i = 0; i < n; i++)
+		data[i] = std::sqrt((double)i);
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// guided chunks: a few large claims at the start, small ones at the end
+	sw.Restart();
+	Parallel::For(0, n, [&data](int i) { data[i] = std::sqrt((double)i); });
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// thread-local sums, one atomic add per worker instead of one per index
+	sw.Restart();
+	std::atomic<long> total{ 0 };
+	Parallel::For(0, n, []() { return (long)0; }, [](int i, long local) { return local + (i & 7); }, [&total](long local) { total += local; });
+	sw.Stop();
+	Console::WriteLine(total.load());
+	Console::WriteLine(sw.ElapsedMilliseconds);
+}
+
 void MethodWithRef(Ref<int> result) {
 	result = result + 37;
 }
@@ -962,41 +1569,126 @@ void TestPerformanceStack() {
 
 	sw.Stop();
 	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// the same pattern on std::vector as the reference
+	std::vector<int> vec;
+	long sum = 0;
+	sw.Restart();
+	for (int i = 0; i < 1000000; i++) {
+		for (int q = 0; q < 100; q++)
+			vec.push_back(q);
+		for (int j = 0; j < 100; j++) {
+			sum += vec.back();
+			vec.pop_back();
+		}
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	int batch[100];
+	for (int q = 0; q < 100; q++)
+		batch[q] = q;
+	sw.Restart();
+	for (int i = 0; i < 1000000; i++) {
+		stack.PushRange(batch, 100);
+		sum += stack.PopRange(batch, 100);
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+	Console::WriteLine(sum);
 }
 
 
 void TestPerformanceConcurrentStack() {
 	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
 	sw.Start();
-	int numThreads = 1;
 	System::Collections::Concurrent::ConcurrentStack<int> stack = new System::Collections::Concurrent::ConcurrentStack<int>();
-	//System::Collections::Generic::List<System::Threading::ManualResetEvent> lstthreads = new System::Collections::Generic::List<System::Threading::ManualResetEvent>();
 
+	for (int i = 0; i < 1000000; i++) {
+		for (int q = 0; q < 100; q++) {
+			stack.Push(q);
+		}
+		for (int j = 0; j < 100; j++) {
+			int res;
+			stack.TryPop(out(res));
+		}
+	}
 
-	for (int t = 0; t < numThreads; t++) {
-		//System::Threading::ManualResetEvent mre = new System::Threading::ManualResetEvent(false);
-		//System::Threading::ThreadPool::QueueUserWorkItem([&stack, mre]() mutable {
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
 
-			for (int i = 0; i < 1000000; i++) {
-				for (int q = 0; q < 100; q++) {
-					stack.Push(q);
-				}
-				int cnt = 0;
-				for (int j = 0; j < 100; j++) {
-					cnt += j;
-					int res;
-					stack.TryPop(out(res));
-					//stack.Pop();
-				}
+	// contended: every thread pushes and pops on the same stack
+	int numt = 8;
+	Action<> act = [&stack]() {
+		for (int j = 0; j < 100000; j++) {
+			for (int i = 0; i < 10; i++) {
+				stack.Push(i);
 			}
-			//mre.Set();
-			//});
-		//lstthreads.Add(mre);
+			for (int i = 0; i < 10; i++) {
+				int res;
+				stack.TryPop(out(res));
+			}
+		}
+	};
+	sw.Restart();
+	List<Thread> lst = new List<Thread>();
+	for (int i = 0; i < numt; i++) {
+		System::Threading::Thread t(act);
+		lst.Add(t);
+		t.Start();
 	}
-	//for (int t = 0; t < numThreads; t++) {
-	//	lstthreads[t].WaitOne();
-	//}
+	for (int i = 0; i < numt; i++) {
+		lst[i].Join();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// the same with the mutex based stack
+	System::Collections::Concurrent::LockingStack<int> ls = new System::Collections::Concurrent::LockingStack<int>();
+	Action<> lact = [&ls]() {
+		for (int j = 0; j < 100000; j++) {
+			for (int i = 0; i < 10; i++) {
+				ls.Push(i);
+			}
+			for (int i = 0; i < 10; i++) {
+				int res;
+				ls.TryPop(out(res));
+			}
+		}
+	};
+	sw.Restart();
+	List<Thread> llst = new List<Thread>();
+	for (int i = 0; i < numt; i++) {
+		System::Threading::Thread t(lact);
+		llst.Add(t);
+		t.Start();
+	}
+	for (int i = 0; i < numt; i++) {
+		llst[i].Join();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
 
+	// and in ranges of 10
+	Action<> ract = [&stack]() {
+		int range[10];
+		for (int i = 0; i < 10; i++)
+			range[i] = i;
+		for (int j = 0; j < 100000; j++) {
+			stack.PushRange(range, 10);
+			stack.TryPopRange(range, 10);
+		}
+	};
+	sw.Restart();
+	List<Thread> rlst = new List<Thread>();
+	for (int i = 0; i < numt; i++) {
+		System::Threading::Thread t(ract);
+		rlst.Add(t);
+		t.Start();
+	}
+	for (int i = 0; i < numt; i++) {
+		rlst[i].Join();
+	}
 	sw.Stop();
 	Console::WriteLine((long)sw.ElapsedMilliseconds);
 }
@@ -1039,6 +1731,209 @@ void TestPerformanceConcurrentStackBOOST() {
 */
 
 
+void TestPerformanceMPMCBoundedQueue() {
+	using namespace System::Collections::Concurrent;
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	const int producers = 4, perThread = 250000;
+
+	// producer/consumer pairs, the consumers of LockingQueue yield while it is empty
+	LockingQueue<int> lq = new LockingQueue<int>();
+	sw.Start();
+	List<Thread> threads = new List<Thread>();
+	for (int t = 0; t < producers; t++) {
+		threads.Add(Thread([lq]() mutable {
+			for (int i = 0; i < perThread; i++)
+				lq.Enqueue(i);
+			}));
+		threads.Add(Thread([lq]() mutable {
+			int value;
+			for (int i = 0; i < perThread; i++) {
+				while (!lq.TryDequeue(out(value)))
+					Thread::Yield();
+			}
+			}));
+	}
+	for (int i = 0; i < threads.Count; i++)
+		threads[i].Start();
+	for (int i = 0; i < threads.Count; i++)
+		threads[i].Join();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	MPMCBoundedQueue<int> q = new MPMCBoundedQueue<int>(1024);
+	sw.Restart();
+	List<Thread> blocking = new List<Thread>();
+	for (int t = 0; t < producers; t++) {
+		blocking.Add(Thread([q]() mutable {
+			for (int i = 0; i < perThread; i++)
+				q.Enqueue(i);
+			}));
+		blocking.Add(Thread([q]() mutable {
+			for (int i = 0; i < perThread; i++)
+				q.Dequeue();
+			}));
+	}
+	for (int i = 0; i < blocking.Count; i++)
+		blocking[i].Start();
+	for (int i = 0; i < blocking.Count; i++)
+		blocking[i].Join();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// batches of 64, one CAS per batch on each side
+	sw.Restart();
+	List<Thread> batched = new List<Thread>();
+	for (int t = 0; t < producers; t++) {
+		batched.Add(Thread([q]() mutable {
+			int batch[64];
+			for (int i = 0; i < perThread; i += 64) {
+				int n = perThread - i < 64 ? perThread - i : 64;
+				for (int j = 0; j < n; j++)
+					batch[j] = i + j;
+				q.Enqueue(batch, n);
+			}
+			}));
+		batched.Add(Thread([q]() mutable {
+			int batch[64];
+			for (int left = perThread; left > 0;) {
+				int n = q.TryDequeue(batch, left < 64 ? left : 64);
+				if (n)
+					left -= n;
+				else
+					Thread::Yield();
+			}
+			}));
+	}
+	for (int i = 0; i < batched.Count; i++)
+		batched[i].Start();
+	for (int i = 0; i < batched.Count; i++)
+		batched[i].Join();
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+}
+
+
+// a shared cache: 90% lookups, 10% updates over 64k keys, with 1 to 64 threads doing 1M operations between them
+void TestPerformanceConcurrentDictionary() {
+	using namespace System::Collections::Concurrent;
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	const int keys = 65536, operations = 1000000;
+
+	ConcurrentDictionary<int, int> cd = new ConcurrentDictionary<int, int>();
+	Dictionary<int, int> d = new Dictionary<int, int>();
+	std::mutex mut;
+	for (int k = 0; k < keys; k++) {
+		cd.TryAdd(k, k);
+		d.Add(k, k);
+	}
+
+	for (int numt = 1; numt <= 64; numt <<= 1) {
+		int perThread = operations / numt;
+
+		sw.Restart();
+		List<Thread> lst = new List<Thread>();
+		for (int t = 0; t < numt; t++) {
+			lst.Add(Thread([cd, t, perThread]() mutable {
+				int value;
+				uint x = (uint)t * 2654435761u + 1;
+				for (int i = 0; i < perThread; i++) {
+					x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+					int k = (int)(x & (keys - 1));
+					if (i % 10 == 0)
+						cd.AddOrUpdate(k, 0, [](int key, int old) { return old + 1; });
+					else
+						cd.TryGetValue(k, value);
+				}
+				}));
+		}
+		for (int i = 0; i < numt; i++)
+			lst[i].Start();
+		for (int i = 0; i < numt; i++)
+			lst[i].Join();
+		sw.Stop();
+		Console::Write(numt);
+		Console::Write(" threads ConcurrentDictionary ");
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		List<Thread> llst = new List<Thread>();
+		for (int t = 0; t < numt; t++) {
+			llst.Add(Thread([d, &mut, t, perThread]() mutable {
+				int value;
+				uint x = (uint)t * 2654435761u + 1;
+				for (int i = 0; i < perThread; i++) {
+					x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+					int k = (int)(x & (keys - 1));
+					std::lock_guard<std::mutex> lock(mut);
+					if (i % 10 == 0)
+						d[k]++;
+					else
+						d.TryGetValue(k, value);
+				}
+				}));
+		}
+		for (int i = 0; i < numt; i++)
+			llst[i].Start();
+		for (int i = 0; i < numt; i++)
+			llst[i].Join();
+		sw.Stop();
+		Console::Write(numt);
+		Console::Write(" threads Dictionary + mutex ");
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+	}
+}
+
+void TestPerformanceSpinLock() {
+	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
+	const int operations = 4000000;
+
+	// a short critical section, the case the lock is meant for
+	SpinLock lock = new SpinLock(false);
+	std::mutex mut;
+	for (int numt = 1; numt <= 16; numt <<= 1) {
+		int perThread = operations / numt;
+		int64_t counter = 0;
+
+		sw.Restart();
+		List<Thread> lst = new List<Thread>();
+		for (int t = 0; t < numt; t++) {
+			lst.Add(Thread([lock, &counter, perThread]() mutable {
+				for (int i = 0; i < perThread; i++) {
+					SpinLock::Guard guard(lock);
+					counter++;
+				}
+				}));
+		}
+		for (int i = 0; i < numt; i++)
+			lst[i].Start();
+		for (int i = 0; i < numt; i++)
+			lst[i].Join();
+		sw.Stop();
+		Console::Write(numt);
+		Console::Write(" threads SpinLock ");
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+		sw.Restart();
+		List<Thread> llst = new List<Thread>();
+		for (int t = 0; t < numt; t++) {
+			llst.Add(Thread([&mut, &counter, perThread]() mutable {
+				for (int i = 0; i < perThread; i++) {
+					std::lock_guard<std::mutex> guard(mut);
+					counter++;
+				}
+				}));
+		}
+		for (int i = 0; i < numt; i++)
+			llst[i].Start();
+		for (int i = 0; i < numt; i++)
+			llst[i].Join();
+		sw.Stop();
+		Console::Write(numt);
+		Console::Write(" threads std::mutex ");
+		Console::WriteLine((long)sw.ElapsedMilliseconds);
+	}
+}
+
 void TestPerformanceConcurrentQueue() {
 	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
 	sw.Start();
@@ -1072,6 +1967,54 @@ void TestPerformanceConcurrentQueue() {
 	sw.Stop();
 	Console::WriteLine((long)sw.ElapsedMilliseconds);
 
+	// the same with the mutex based queue
+	System::Collections::Concurrent::LockingQueue<int> lq = new System::Collections::Concurrent::LockingQueue<int>();
+	Action<> lact = [&lq]() {
+		for (int j = 0; j < 1000; j++) {
+			for (int i = 0; i < 100; i++) {
+				lq.Enqueue(i);
+			}
+			for (int i = 0; i < 100; i++) {
+				int res;
+				lq.TryDequeue(out(res));
+			}
+		}
+	};
+	sw.Restart();
+	List<Thread> llst = new List<Thread>();
+	for (int i = 0; i < numt; i++) {
+		System::Threading::Thread t(lact);
+		llst.Add(t);
+		t.Start();
+	}
+	for (int i = 0; i < numt; i++) {
+		llst[i].Join();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
+
+	// and in batches of 100
+	Action<> bact = [&q]() {
+		int batch[100];
+		for (int i = 0; i < 100; i++)
+			batch[i] = i;
+		for (int j = 0; j < 1000; j++) {
+			q.Enqueue(batch, 100);
+			q.TryDequeue(batch, 100);
+		}
+	};
+	sw.Restart();
+	List<Thread> blst = new List<Thread>();
+	for (int i = 0; i < numt; i++) {
+		System::Threading::Thread t(bact);
+		blst.Add(t);
+		t.Start();
+	}
+	for (int i = 0; i < numt; i++) {
+		blst[i].Join();
+	}
+	sw.Stop();
+	Console::WriteLine((long)sw.ElapsedMilliseconds);
 }
 
 
@@ -1104,6 +2047,34 @@ void TestPerformanceThreadPool() {
 	sw.Stop();
 	Console::WriteLine(x.load());
 	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// round trips to an idle pool: the worker is parked and has to be woken for every item
+	sw.Restart();
+	for (int i = 0; i < 200; i++) {
+		ManualResetEvent done = new ManualResetEvent();
+		System::Threading::ThreadPool::QueueUserWorkItem([done]() { done.Set(); });
+		done.WaitOne();
+	}
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
+
+	// work items that queue more work go to the deque of their worker and are stolen by idle ones
+	std::atomic<int> left{ 1 << 16 };
+	ManualResetEvent tree = new ManualResetEvent();
+	std::function<void(int)> split = [&split, &left, &tree](int n) {
+		while (n > 1) {
+			n >>= 1;
+			int half = n;
+			System::Threading::ThreadPool::QueueUserWorkItem([&split, half]() { split(half); });
+		}
+		if (left.fetch_sub(1) == 1)
+			tree.Set();
+	};
+	sw.Restart();
+	System::Threading::ThreadPool::QueueUserWorkItem([&split]() { split(1 << 16); });
+	tree.WaitOne(100000);
+	sw.Stop();
+	Console::WriteLine(sw.ElapsedMilliseconds);
 }
 
 void TestPerformanceDictionary() {
@@ -1113,6 +2084,15 @@ void TestPerformanceDictionary() {
 	}
 
 
+	// the entries are walked in place, the live object count is the same inside the loop as before it
+	ulong before = System::GC::Collect();
+	ulong inside = before;
+	for (auto& kvp : dic) {
+		inside = System::GC::Collect();
+		break;
+	}
+	Console::WriteLine((long)(inside - before));
+
 	System::Diagnostics::Stopwatch sw = new System::Diagnostics::Stopwatch();
 	sw.Start();
 	long sum = 0;
@@ -1291,6 +2271,9 @@ int main(int argc, char** argv)
 
 	
 	TestPerformanceConcurrentQueue();
+	TestPerformanceMPMCBoundedQueue();
+	TestPerformanceConcurrentDictionary();
+	TestPerformanceSpinLock();
 	TestPerformanceThreadPool();
 	return 0;
 
@@ -1306,6 +2289,21 @@ int main(int argc, char** argv)
 	return 0;
 	TestPerformanceLinqOrderBy();
 	TestPerformanceLinqWhere();
+	TestPerformanceLinqQuery();
+	TestPerformanceParallelLinq();
+	TestPerformanceSort();
+	TestPerformanceAggregates();
+	TestPerformanceListAddRange();
+	TestPerformanceLinkedList();
+	TestPerformanceHashSet();
+	TestPerformanceSortedDictionary();
+	TestPerformancePriorityQueue();
+	TestPerformanceQueue();
+	TestPerformanceColumnList();
+	TestPerformanceArrayAllocation();
+	TestPerformanceImmutable();
+	TestPerformanceTasks();
+	TestPerformanceParallel();
 
 	TestPerformanceLambda();
 	TestPerformanceIterator();
@@ -66,6 +66,42 @@
 #include <codecvt>
 #include <queue>
 #include <regex>
+#include <type_traits>
+#include <memory>
+#include <exception>
+#include <limits>
+#include <tuple>
+
+// vector kernels (Sum/Min/Max of List<T> and Array<T>): the instruction set is chosen at compile time
+// (-mavx2 or /arch:AVX2 for AVX2, SSE2 is always there on x64), other targets use the scalar loops
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define SYSTEM_SIMD_AVX2 1
+	#define SYSTEM_SIMD_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SYSTEM_SIMD_SSE2 1
+#endif
+
+// co_await on Task, ValueTask, LazyTask and ManualResetEvent needs C++20 coroutines (-std=c++20 or /std:c++20)
+#if defined(__cpp_impl_coroutine)
+#if __cpp_impl_coroutine >= 201902L
+	#include <coroutine>
+	#define SYSTEM_COROUTINES 1
+#endif
+#endif
+
+// double-width compare-and-swap for Threading::AtomicTaggedPointer: cmpxchg16b on x64, casp (-march=armv8.1-a) or
+// ldaxp/stlxp on AArch64, one 64-bit swap on 32-bit targets; other 64-bit targets fall back to a tag in the top pointer bits
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	#define SYSTEM_DWCAS_MSVC 1
+#elif defined(__GNUC__) && defined(__x86_64__)
+	#define SYSTEM_DWCAS_X64 1
+#elif defined(__GNUC__) && defined(__aarch64__)
+	#define SYSTEM_DWCAS_ARM64 1
+#elif UINTPTR_MAX == 0xffffffff
+	#define SYSTEM_DWCAS_64BIT 1
+#endif
 
 #if UINTPTR_MAX == 0xffffffff
 /* 32-bit */
@@ -106,10 +142,6 @@
 
 	#define __lzcnt32 __builtin_clz
 	#define PAUSE() yield();
-	bool InterlockedCompareExchange128(long long* Destination, long long ExchangeHigh, long long ExchangeLow, long long* ComparandResult) {
-		// TODO
-		return false;
-	}
 #elif defined __MINGW32__
 	#include <x86intrin.h>
 	#include <Winsock2.h>
@@ -124,7 +156,13 @@
 
 // x86-64 linux, most likely
 #define __lzcnt32 __builtin_clz
+#if defined(__x86_64__) || defined(__i386__)
+#define PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define PAUSE() __asm__ __volatile__("yield" ::: "memory")
+#else
 #define PAUSE() Yield();
+#endif
 
 #endif
 #endif
@@ -510,6 +548,11 @@ namespace System
 			template<class T> class System_API List;
 		}
 	}
+	namespace Linq {
+		template<class T> class ListSource;
+		template<class T> class ArraySource;
+		template<class Expr> class ParallelQuery;
+	}
 
 
 
@@ -674,6 +717,29 @@ namespace System
 		return reinterpret_cast<T*>(value);
 	}
 
+	// Base for blocks that another thread may free after the allocating thread ended, such as the nodes of lock-free
+	// containers. The pools of MPool are thread local and die with their thread, so these come from the heap instead.
+	struct Unpooled {
+		static void* operator new(size_t size) {
+			void* ret = malloc(size);
+			if (!ret)
+				throw std::bad_alloc();
+			return ret;
+		}
+
+		static void* operator new[](size_t size) {
+			return operator new(size);
+		}
+
+		static void operator delete(void* mem) noexcept {
+			free(mem);
+		}
+
+		static void operator delete[](void* mem) noexcept {
+			free(mem);
+		}
+	};
+
 
 }
 
@@ -1561,7 +1627,28 @@ namespace System {
 			return (this->od != null);
 		}
 
-
+		/// <summary>Compares two specified String objects by evaluating the numeric values of the corresponding Char objects in each string.</summary>
+		/// <param name="strA">The first string to compare.</param>
+		/// <param name="strB">The second string to compare.</param>
+		/// <returns>Less than zero if strA precedes strB, zero if they are equal, greater than zero if strA follows strB. null precedes every string.</returns>
+		static int CompareOrdinal(String const& strA, String const& strB) {
+			if (strA.od == strB.od)
+				return 0;
+			if (strA.od == nullptr)
+				return -1;
+			if (strB.od == nullptr)
+				return 1;
+			ObjectData* sda = (ObjectData*)(strA.od);
+			ObjectData* sdb = (ObjectData*)(strB.od);
+			int len = sda->Length < sdb->Length ? sda->Length : sdb->Length;
+			char16_t* ptra = (char16_t*)(((byte*)sda) + sizeof(ObjectData));
+			char16_t* ptrb = (char16_t*)(((byte*)sdb) + sizeof(ObjectData));
+			for (int i = 0; i < len; i++) {
+				if (ptra[i] != ptrb[i])
+					return (int)ptra[i] - (int)ptrb[i];
+			}
+			return sda->Length - sdb->Length;
+		}
 
 		char16_t operator[](int const index) const
 		{
@@ -2033,21 +2120,7 @@ namespace System {
 
 	bool operator<(String const & lhs, String const & rhs)
 	{
-		if (lhs == null || rhs == null)
-			return false;
-		int len = rhs.Length;
-		if (len > lhs.Length) {
-			len = lhs.Length;
-		}
-		char16_t* ptr = (char16_t*)(((byte*)lhs.od) + sizeof(String::ObjectData));
-		char16_t* ptr2 = (char16_t*)(((byte*)rhs.od) + sizeof(String::ObjectData));
-		for (int i = 0; i < len; i++) {
-			if (*ptr != *ptr2) {
-				return *ptr < *ptr2;
-			}
-		}
-
-		return false;
+		return String::CompareOrdinal(lhs, rhs) < 0;
 	}
 
 	String operator+(String&& c1, const char16_t c2)
@@ -2913,6 +2986,76 @@ namespace System {
 		}
 	};
 
+	class System_API OperationCanceledException : public Exception {
+	public:
+		class System_API ObjectData : public Exception::ObjectData {
+
+		};
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+		OperationCanceledException(){}
+
+		OperationCanceledException(std::nullptr_t const & n) : Exception(n) {
+		}
+
+		OperationCanceledException(OperationCanceledException* pValue) {
+			if (!pValue->od) {
+				ObjectData* dd = new ObjectData();
+				od = dd;
+			}
+			else {
+				od = pValue->od;
+				pValue->od = nullptr;
+			}
+			delete pValue;
+		}
+
+		OperationCanceledException(OperationCanceledException const & other) : Exception(other) { }
+
+		OperationCanceledException(OperationCanceledException&& other) noexcept : Exception(std::move(other)) { }
+
+		OperationCanceledException(Object::ObjectData* other) : Exception(other) {
+		}
+
+		OperationCanceledException& operator=(OperationCanceledException const & other) {
+			Exception::operator=(other);
+			return *this;
+		}
+
+		OperationCanceledException& operator=(std::nullptr_t const & n) {
+			Exception::operator=(n);
+			return *this;
+		}
+
+		OperationCanceledException& operator=(OperationCanceledException&& other) noexcept {
+			Exception::operator=(std::move(other));
+			return *this;
+		}
+
+		OperationCanceledException& operator=(OperationCanceledException* other) {
+			if (od == other->od)
+				return *this;
+			Release();
+			od = other->od;
+			::operator delete((void*)other);
+			return *this;
+		}
+
+		OperationCanceledException* operator->() {
+			return this;
+		}
+
+
+
+			OperationCanceledException(System::String const& str) : Exception(str) {
+
+		}
+
+		OperationCanceledException(System::String&& str) noexcept : Exception((System::String&&)str) {
+
+		}
+	};
+
 	//template<class R> R* Object::GetNewObjectData() {
 	//	R* ptr = new R();
 	//	if (!ptr)
@@ -7509,6 +7652,213 @@ template<typename IG0 = void, typename IG1 = void, typename IG2 = void, typename
 	}
 	
 	};
+
+	/// <summary>A tuple stored inline instead of on the heap: copying it copies the items, it is trivially copyable when
+	/// the items are, and its public items bind to C++17 structured bindings (auto [id, price] = t).</summary>
+	template<typename T1 = void, typename T2 = void, typename T3 = void, typename T4 = void, typename T5 = void, typename T6 = void, typename T7 = void, typename T8 = void> struct ValueTuple;
+
+	/// <summary>Creates value tuples with deduced item types: auto t = ValueTuple&lt;&gt;::Create(1, 2.5).</summary>
+	template<> struct ValueTuple<void, void, void, void, void, void, void, void> {
+		template<class... T> static ValueTuple<typename std::decay<T>::type...> Create(T&&... items) {
+			return ValueTuple<typename std::decay<T>::type...>(std::forward<T>(items)...);
+		}
+	};
+
+	template<typename T1> struct ValueTuple<T1, void, void, void, void, void, void, void> {
+		T1 Item1;
+
+		ValueTuple() : Item1() {}
+
+		ValueTuple(T1 item1) : Item1(std::move(item1)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1> ToTuple() const {
+			return Tuple<T1>(Item1);
+		}
+	};
+
+	template<typename T1, typename T2> struct ValueTuple<T1, T2, void, void, void, void, void, void> {
+		T1 Item1;
+		T2 Item2;
+
+		ValueTuple() : Item1(), Item2() {}
+
+		ValueTuple(T1 item1, T2 item2) : Item1(std::move(item1)), Item2(std::move(item2)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2> ToTuple() const {
+			return Tuple<T1, T2>(Item1, Item2);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3> struct ValueTuple<T1, T2, T3, void, void, void, void, void> {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+
+		ValueTuple() : Item1(), Item2(), Item3() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3> ToTuple() const {
+			return Tuple<T1, T2, T3>(Item1, Item2, Item3);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4> struct ValueTuple<T1, T2, T3, T4, void, void, void, void> {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+		T4 Item4;
+
+		ValueTuple() : Item1(), Item2(), Item3(), Item4() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3, T4 item4) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)), Item4(std::move(item4)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3 && Item4 == other.Item4;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3, T4> ToTuple() const {
+			return Tuple<T1, T2, T3, T4>(Item1, Item2, Item3, Item4);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5> struct ValueTuple<T1, T2, T3, T4, T5, void, void, void> {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+		T4 Item4;
+		T5 Item5;
+
+		ValueTuple() : Item1(), Item2(), Item3(), Item4(), Item5() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3, T4 item4, T5 item5) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)), Item4(std::move(item4)), Item5(std::move(item5)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3 && Item4 == other.Item4 && Item5 == other.Item5;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3, T4, T5> ToTuple() const {
+			return Tuple<T1, T2, T3, T4, T5>(Item1, Item2, Item3, Item4, Item5);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6> struct ValueTuple<T1, T2, T3, T4, T5, T6, void, void> {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+		T4 Item4;
+		T5 Item5;
+		T6 Item6;
+
+		ValueTuple() : Item1(), Item2(), Item3(), Item4(), Item5(), Item6() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3, T4 item4, T5 item5, T6 item6) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)), Item4(std::move(item4)), Item5(std::move(item5)), Item6(std::move(item6)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3 && Item4 == other.Item4 && Item5 == other.Item5 && Item6 == other.Item6;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3, T4, T5, T6> ToTuple() const {
+			return Tuple<T1, T2, T3, T4, T5, T6>(Item1, Item2, Item3, Item4, Item5, Item6);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7> struct ValueTuple<T1, T2, T3, T4, T5, T6, T7, void> {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+		T4 Item4;
+		T5 Item5;
+		T6 Item6;
+		T7 Item7;
+
+		ValueTuple() : Item1(), Item2(), Item3(), Item4(), Item5(), Item6(), Item7() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3, T4 item4, T5 item5, T6 item6, T7 item7) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)), Item4(std::move(item4)), Item5(std::move(item5)), Item6(std::move(item6)), Item7(std::move(item7)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3 && Item4 == other.Item4 && Item5 == other.Item5 && Item6 == other.Item6 && Item7 == other.Item7;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3, T4, T5, T6, T7> ToTuple() const {
+			return Tuple<T1, T2, T3, T4, T5, T6, T7>(Item1, Item2, Item3, Item4, Item5, Item6, Item7);
+		}
+	};
+
+	template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8> struct ValueTuple {
+		T1 Item1;
+		T2 Item2;
+		T3 Item3;
+		T4 Item4;
+		T5 Item5;
+		T6 Item6;
+		T7 Item7;
+		T8 Item8;
+
+		ValueTuple() : Item1(), Item2(), Item3(), Item4(), Item5(), Item6(), Item7(), Item8() {}
+
+		ValueTuple(T1 item1, T2 item2, T3 item3, T4 item4, T5 item5, T6 item6, T7 item7, T8 item8) : Item1(std::move(item1)), Item2(std::move(item2)), Item3(std::move(item3)), Item4(std::move(item4)), Item5(std::move(item5)), Item6(std::move(item6)), Item7(std::move(item7)), Item8(std::move(item8)) {}
+
+		bool operator==(ValueTuple const& other) const {
+			return Item1 == other.Item1 && Item2 == other.Item2 && Item3 == other.Item3 && Item4 == other.Item4 && Item5 == other.Item5 && Item6 == other.Item6 && Item7 == other.Item7 && Item8 == other.Item8;
+		}
+
+		bool operator!=(ValueTuple const& other) const {
+			return !(*this == other);
+		}
+
+		/// <summary>Copies the items into a reference Tuple.</summary>
+		Tuple<T1, T2, T3, T4, T5, T6, T7, T8> ToTuple() const {
+			return Tuple<T1, T2, T3, T4, T5, T6, T7, T8>(Item1, Item2, Item3, Item4, Item5, Item6, Item7, Item8);
+		}
+	};
 }
 
 
@@ -8767,6 +9117,115 @@ namespace System {
 		}
 	};
 
+	/// <summary>Contiguous elements owned by someone else (a List, an Array, a column of a ColumnList).
+	/// Stays valid until the owner reallocates its buffer.</summary>
+	template<class T> struct Span {
+		T* Pointer;
+		int Length;
+
+		Span() : Pointer(nullptr), Length(0) {}
+
+		Span(T* pointer, int length) : Pointer(pointer), Length(length) {}
+
+		T& operator[](int index) const {
+			if (index < 0 || index >= Length)
+				throw IndexOutOfRangeException();
+			return Pointer[index];
+		}
+
+		/// <summary>Forms a slice out of the current span starting at a specified index for a specified length.</summary>
+		Span<T> Slice(int start, int length) const {
+			if (start < 0 || length < 0 || start > Length - length)
+				throw ArgumentOutOfRangeException();
+			return Span<T>(Pointer + start, length);
+		}
+
+		bool IsEmpty() const {
+			return Length == 0;
+		}
+
+		T* begin() const {
+			return Pointer;
+		}
+
+		T* end() const {
+			return Pointer + Length;
+		}
+	};
+
+	/// <summary>A 2-D view of elements owned by someone else, Height rows of Width elements each. Consecutive rows are
+	/// Stride elements apart, so a view can cover a rectangle inside a larger one.</summary>
+	template<class T> struct Span2D {
+		T* Pointer;
+		int Height;
+		int Width;
+		int Stride;
+
+		Span2D() : Pointer(nullptr), Height(0), Width(0), Stride(0) {}
+
+		Span2D(T* pointer, int height, int width, int stride) : Pointer(pointer), Height(height), Width(width), Stride(stride) {}
+
+		Span2D(T* pointer, int height, int width) : Span2D(pointer, height, width, width) {}
+
+		T& operator()(int row, int column) const {
+			if ((uint)row >= (uint)Height || (uint)column >= (uint)Width)
+				throw IndexOutOfRangeException();
+			return Pointer[(size_t)row * Stride + column];
+		}
+
+		/// <summary>The elements of one row.</summary>
+		Span<T> GetRow(int row) const {
+			if ((uint)row >= (uint)Height)
+				throw ArgumentOutOfRangeException();
+			return Span<T>(Pointer + (size_t)row * Stride, Width);
+		}
+
+		/// <summary>The height x width rectangle whose top left element is at (row, column).</summary>
+		Span2D<T> Slice(int row, int column, int height, int width) const {
+			if (row < 0 || column < 0 || height < 0 || width < 0 || row > Height - height || column > Width - width)
+				throw ArgumentOutOfRangeException();
+			return Span2D<T>(Pointer + (size_t)row * Stride + column, height, width, Stride);
+		}
+
+		bool IsEmpty() const {
+			return Height == 0 || Width == 0;
+		}
+	};
+
+	/// <summary>A 3-D view of elements owned by someone else: Depth planes of Height rows of Width elements. Rows are
+	/// RowStride elements apart and planes PlaneStride elements apart.</summary>
+	template<class T> struct Span3D {
+		T* Pointer;
+		int Depth;
+		int Height;
+		int Width;
+		int RowStride;
+		int PlaneStride;
+
+		Span3D() : Pointer(nullptr), Depth(0), Height(0), Width(0), RowStride(0), PlaneStride(0) {}
+
+		Span3D(T* pointer, int depth, int height, int width, int rowStride, int planeStride) : Pointer(pointer), Depth(depth), Height(height), Width(width), RowStride(rowStride), PlaneStride(planeStride) {}
+
+		Span3D(T* pointer, int depth, int height, int width) : Span3D(pointer, depth, height, width, width, height * width) {}
+
+		T& operator()(int plane, int row, int column) const {
+			if ((uint)plane >= (uint)Depth || (uint)row >= (uint)Height || (uint)column >= (uint)Width)
+				throw IndexOutOfRangeException();
+			return Pointer[(size_t)plane * PlaneStride + (size_t)row * RowStride + column];
+		}
+
+		/// <summary>The rows of one plane.</summary>
+		Span2D<T> GetPlane(int plane) const {
+			if ((uint)plane >= (uint)Depth)
+				throw ArgumentOutOfRangeException();
+			return Span2D<T>(Pointer + (size_t)plane * PlaneStride, Height, Width, RowStride);
+		}
+
+		bool IsEmpty() const {
+			return Depth == 0 || Height == 0 || Width == 0;
+		}
+	};
+
 	namespace Collections {
 		class HashHelpers {
 		public:
@@ -9360,8 +9819,8 @@ namespace System {
 					virtual Array<T> ToArray() const;
 					virtual IEnumerable<T> Where(const Func<T, bool>& predicate) const;
 					template<class R> IEnumerable<R> Select(const Func<T, R>& selector) const;
-					template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const;
-					template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector) const;
+					template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const;
+					template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector) const;
 					template<class R> T Max(const Func<T, R>& selector) const;
 					template<class R> T Min(const Func<T, R>& selector) const;
 				};
@@ -9408,8 +9867,8 @@ namespace System {
 				Array<T> ToArray() const { return od != nullptr ? GOD()->ToArray() : nullptr; }
 				IEnumerable<T> Where(const Func<T, bool>& predicate) const { return GOD()->Where(predicate); }
 				template<class R> IEnumerable<R> Select(const Func<T, R>& selector) const { return GOD()->Select(selector); }
-				template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
-				template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector) const { return GOD()->OrderBy(keySelector); }
+				template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
+				template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector) const { return GOD()->OrderBy(keySelector); }
 				template<class R> T Max(const Func<T, R>& selector) const{ return GOD()->Max(selector); }
 				template<class R> T Min(const Func<T, R>& selector) const { return GOD()->Min(selector); }
 
@@ -9739,48 +10198,574 @@ namespace System {
 			};
 
 
-			template<class T> class System_API Array : public Object
-			{
+			// Sum, Min and Max over the contiguous buffer of a List<T> or Array<T>. int, long, float and double
+			// get vector kernels (8 or 4 lanes with AVX2, 4 or 2 lanes with SSE2) followed by a scalar loop for
+			// the elements that don't fill a whole vector; any other T uses the scalar loop only.
+			// The lanes are added up separately, so a float/double sum can differ from the one of a plain loop
+			// in the last bits.
+			class Aggregates {
 			private:
-				int32_t Get_Length() const {
-					return (int32_t)GOD()->Length;
+				// wrapping add, true if the signed result overflowed
+				static bool AddOverflows(long a, long b, long& sum) {
+					sum = (long)((ulong)a + (ulong)b);
+					return ((a ^ sum) & (b ^ sum)) < 0;
 				}
 
-				//void Set_Length(int value) {
-				////	((ArrayD<T>*)od)->Length = value;
-				//}
+				// wrapping add that keeps count of the wraps, the exact total is sum + wraps * 2^64
+				static void AddCounted(long& sum, long value, long& wraps) {
+					if (AddOverflows(sum, value, sum))
+						wraps += value < 0 ? -1 : 1;
+				}
 
 			public:
-				class System_API ObjectData : public Object::ObjectData
-				{
-				public:
-					T* arrdta;
-					ulong Length;
-
+				// the int lanes are widened to long, which can't overflow for any count
+				static long WideSum(int const* dta, int count) {
+					long ret = 0;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256i acc0 = _mm256_setzero_si256();
+					__m256i acc1 = _mm256_setzero_si256();
+					for (; i + 8 <= count; i += 8) {
+						acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm_loadu_si128((__m128i const*)(dta + i))));
+						acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm_loadu_si128((__m128i const*)(dta + i + 4))));
+					}
+					long lanes[4];
+					_mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+					ret = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif SYSTEM_SIMD_SSE2
+					__m128i acc = _mm_setzero_si128();
+					for (; i + 4 <= count; i += 4) {
+						__m128i v = _mm_loadu_si128((__m128i const*)(dta + i));
+						__m128i sign = _mm_srai_epi32(v, 31);
+						acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+						acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+					}
+					long lanes[2];
+					_mm_storeu_si128((__m128i*)lanes, acc);
+					ret = lanes[0] + lanes[1];
+#endif
+					for (; i < count; i++)
+						ret += dta[i];
+					return ret;
+				}
 
-					ObjectData() {
-						Length = 0;
-						arrdta = NULL;
+				// wraps around, overflowed is set if the exact total doesn't fit in a long. Every lane counts how often it
+				// wrapped (+1 past the top, -1 past the bottom), so values that cancel out don't overflow half way
+				static long WrappingSum(long const* dta, int count, bool& overflowed) {
+					long ret = 0;
+					long wraps = 0;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256i acc = _mm256_setzero_si256();
+					__m256i carry = _mm256_setzero_si256();
+					for (; i + 4 <= count; i += 4) {
+						__m256i v = _mm256_loadu_si256((__m256i const*)(dta + i));
+						__m256i sum = _mm256_add_epi64(acc, v);
+						// 1 where acc and v have the same sign and sum the other one, negative if v was
+						__m256i wrapped = _mm256_srli_epi64(_mm256_and_si256(_mm256_xor_si256(acc, sum), _mm256_xor_si256(v, sum)), 63);
+						__m256i down = _mm256_and_si256(wrapped, _mm256_srli_epi64(v, 63));
+						carry = _mm256_add_epi64(carry, _mm256_sub_epi64(wrapped, _mm256_add_epi64(down, down)));
+						acc = sum;
+					}
+					long lanes[4];
+					long carries[4];
+					_mm256_storeu_si256((__m256i*)lanes, acc);
+					_mm256_storeu_si256((__m256i*)carries, carry);
+					for (int l = 0; l < 4; l++) {
+						wraps += carries[l];
+						AddCounted(ret, lanes[l], wraps);
+					}
+#elif SYSTEM_SIMD_SSE2
+					__m128i acc = _mm_setzero_si128();
+					__m128i carry = _mm_setzero_si128();
+					for (; i + 2 <= count; i += 2) {
+						__m128i v = _mm_loadu_si128((__m128i const*)(dta + i));
+						__m128i sum = _mm_add_epi64(acc, v);
+						__m128i wrapped = _mm_srli_epi64(_mm_and_si128(_mm_xor_si128(acc, sum), _mm_xor_si128(v, sum)), 63);
+						__m128i down = _mm_and_si128(wrapped, _mm_srli_epi64(v, 63));
+						carry = _mm_add_epi64(carry, _mm_sub_epi64(wrapped, _mm_add_epi64(down, down)));
+						acc = sum;
+					}
+					long lanes[2];
+					long carries[2];
+					_mm_storeu_si128((__m128i*)lanes, acc);
+					_mm_storeu_si128((__m128i*)carries, carry);
+					for (int l = 0; l < 2; l++) {
+						wraps += carries[l];
+						AddCounted(ret, lanes[l], wraps);
 					}
+#endif
+					for (; i < count; i++)
+						AddCounted(ret, dta[i], wraps);
+					overflowed = wraps != 0;
+					return ret;
+				}
 
-					ObjectData(int length) {
-						Length = length;
-						//arrdta = (T*)ObjectD::Pool.Get((size_t)length * sizeof(T));
-						arrdta = new T[length];
-					}
+				// floats are added as doubles, like Enumerable.Sum does
+				static double WideSum(float const* dta, int count) {
+					double ret = 0;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256d acc0 = _mm256_setzero_pd();
+					__m256d acc1 = _mm256_setzero_pd();
+					for (; i + 8 <= count; i += 8) {
+						acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm_loadu_ps(dta + i)));
+						acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm_loadu_ps(dta + i + 4)));
+					}
+					double lanes[4];
+					_mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+					ret = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif SYSTEM_SIMD_SSE2
+					__m128d acc0 = _mm_setzero_pd();
+					__m128d acc1 = _mm_setzero_pd();
+					for (; i + 4 <= count; i += 4) {
+						__m128 v = _mm_loadu_ps(dta + i);
+						acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(v));
+						acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+					}
+					double lanes[2];
+					_mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+					ret = lanes[0] + lanes[1];
+#endif
+					for (; i < count; i++)
+						ret += dta[i];
+					return ret;
+				}
 
-					~ObjectData() override
-					{
-						//std::cout << "destroy called in array " << std::endl;
-						if (arrdta) {
-							delete[] arrdta;
-							//	ObjectD::Pool.Put((byte*)arrdta);
-						}
-					}
+				static double WideSum(double const* dta, int count) {
+					double ret = 0;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256d acc0 = _mm256_setzero_pd();
+					__m256d acc1 = _mm256_setzero_pd();
+					for (; i + 8 <= count; i += 8) {
+						acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(dta + i));
+						acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(dta + i + 4));
+					}
+					double lanes[4];
+					_mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+					ret = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif SYSTEM_SIMD_SSE2
+					__m128d acc0 = _mm_setzero_pd();
+					__m128d acc1 = _mm_setzero_pd();
+					for (; i + 4 <= count; i += 4) {
+						acc0 = _mm_add_pd(acc0, _mm_loadu_pd(dta + i));
+						acc1 = _mm_add_pd(acc1, _mm_loadu_pd(dta + i + 2));
+					}
+					double lanes[2];
+					_mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+					ret = lanes[0] + lanes[1];
+#endif
+					for (; i < count; i++)
+						ret += dta[i];
+					return ret;
+				}
 
-					int32_t Get_Length() const {
-						return (int32_t)Length;
-					}
+				/// <summary>Sum that throws OverflowException if the result doesn't fit in an int.</summary>
+				static int Sum(int const* dta, int count) {
+					long ret = WideSum(dta, count);
+					if (ret < INT32_MIN || ret > INT32_MAX)
+						throw OverflowException();
+					return (int)ret;
+				}
+
+				/// <summary>Sum that throws OverflowException if the result doesn't fit in a long.</summary>
+				static long Sum(long const* dta, int count) {
+					bool overflowed;
+					long ret = WrappingSum(dta, count, overflowed);
+					if (overflowed)
+						throw OverflowException();
+					return ret;
+				}
+
+				static float Sum(float const* dta, int count) {
+					return (float)WideSum(dta, count);
+				}
+
+				static double Sum(double const* dta, int count) {
+					return WideSum(dta, count);
+				}
+
+				template<class T> static T Sum(T const* dta, int count) {
+					T ret{};
+					for (int i = 0; i < count; i++)
+						ret += dta[i];
+					return ret;
+				}
+
+				static int UncheckedSum(int const* dta, int count) {
+					return (int)(uint)(ulong)WideSum(dta, count);
+				}
+
+				static long UncheckedSum(long const* dta, int count) {
+					bool overflowed;
+					return WrappingSum(dta, count, overflowed);
+				}
+
+				template<class T> static T UncheckedSum(T const* dta, int count) {
+					return Sum(dta, count);
+				}
+
+				static double Average(int const* dta, int count) {
+					return (double)WideSum(dta, count) / count;
+				}
+
+				static double Average(float const* dta, int count) {
+					return WideSum(dta, count) / count;
+				}
+
+				template<class T> static double Average(T const* dta, int count) {
+					return (double)Sum(dta, count) / count;
+				}
+
+				static int Min(int const* dta, int count) {
+					int ret = dta[0];
+					int i = 1;
+#if SYSTEM_SIMD_AVX2
+					if (count >= 8) {
+						__m256i acc = _mm256_loadu_si256((__m256i const*)dta);
+						for (i = 8; i + 8 <= count; i += 8)
+							acc = _mm256_min_epi32(acc, _mm256_loadu_si256((__m256i const*)(dta + i)));
+						int lanes[8];
+						_mm256_storeu_si256((__m256i*)lanes, acc);
+						for (int l = 0; l < 8; l++)
+							if (lanes[l] < ret) ret = lanes[l];
+					}
+#elif SYSTEM_SIMD_SSE2
+					if (count >= 4) {
+						__m128i acc = _mm_loadu_si128((__m128i const*)dta);
+						for (i = 4; i + 4 <= count; i += 4) {
+							__m128i v = _mm_loadu_si128((__m128i const*)(dta + i));
+							__m128i less = _mm_cmplt_epi32(v, acc);
+							acc = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, acc));
+						}
+						int lanes[4];
+						_mm_storeu_si128((__m128i*)lanes, acc);
+						for (int l = 0; l < 4; l++)
+							if (lanes[l] < ret) ret = lanes[l];
+					}
+#endif
+					for (; i < count; i++)
+						if (dta[i] < ret) ret = dta[i];
+					return ret;
+				}
+
+				static int Max(int const* dta, int count) {
+					int ret = dta[0];
+					int i = 1;
+#if SYSTEM_SIMD_AVX2
+					if (count >= 8) {
+						__m256i acc = _mm256_loadu_si256((__m256i const*)dta);
+						for (i = 8; i + 8 <= count; i += 8)
+							acc = _mm256_max_epi32(acc, _mm256_loadu_si256((__m256i const*)(dta + i)));
+						int lanes[8];
+						_mm256_storeu_si256((__m256i*)lanes, acc);
+						for (int l = 0; l < 8; l++)
+							if (lanes[l] > ret) ret = lanes[l];
+					}
+#elif SYSTEM_SIMD_SSE2
+					if (count >= 4) {
+						__m128i acc = _mm_loadu_si128((__m128i const*)dta);
+						for (i = 4; i + 4 <= count; i += 4) {
+							__m128i v = _mm_loadu_si128((__m128i const*)(dta + i));
+							__m128i greater = _mm_cmpgt_epi32(v, acc);
+							acc = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, acc));
+						}
+						int lanes[4];
+						_mm_storeu_si128((__m128i*)lanes, acc);
+						for (int l = 0; l < 4; l++)
+							if (lanes[l] > ret) ret = lanes[l];
+					}
+#endif
+					for (; i < count; i++)
+						if (dta[i] > ret) ret = dta[i];
+					return ret;
+				}
+
+				// SSE2 has no 64 bit compare, the long kernels need AVX2
+				static long Min(long const* dta, int count) {
+					long ret = dta[0];
+					int i = 1;
+#if SYSTEM_SIMD_AVX2
+					if (count >= 4) {
+						__m256i acc = _mm256_loadu_si256((__m256i const*)dta);
+						for (i = 4; i + 4 <= count; i += 4) {
+							__m256i v = _mm256_loadu_si256((__m256i const*)(dta + i));
+							acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(acc, v));
+						}
+						long lanes[4];
+						_mm256_storeu_si256((__m256i*)lanes, acc);
+						for (int l = 0; l < 4; l++)
+							if (lanes[l] < ret) ret = lanes[l];
+					}
+#endif
+					for (; i < count; i++)
+						if (dta[i] < ret) ret = dta[i];
+					return ret;
+				}
+
+				static long Max(long const* dta, int count) {
+					long ret = dta[0];
+					int i = 1;
+#if SYSTEM_SIMD_AVX2
+					if (count >= 4) {
+						__m256i acc = _mm256_loadu_si256((__m256i const*)dta);
+						for (i = 4; i + 4 <= count; i += 4) {
+							__m256i v = _mm256_loadu_si256((__m256i const*)(dta + i));
+							acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(v, acc));
+						}
+						long lanes[4];
+						_mm256_storeu_si256((__m256i*)lanes, acc);
+						for (int l = 0; l < 4; l++)
+							if (lanes[l] > ret) ret = lanes[l];
+					}
+#endif
+					for (; i < count; i++)
+						if (dta[i] > ret) ret = dta[i];
+					return ret;
+				}
+
+				// like Enumerable.Min: NaN if any element is NaN
+				static float Min(float const* dta, int count) {
+					float ret = std::numeric_limits<float>::infinity();
+					bool nan = false;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256 acc = _mm256_set1_ps(ret);
+					__m256 unord = _mm256_setzero_ps();
+					for (; i + 8 <= count; i += 8) {
+						__m256 v = _mm256_loadu_ps(dta + i);
+						unord = _mm256_or_ps(unord, _mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+						acc = _mm256_min_ps(v, acc); // acc is kept if v is NaN
+					}
+					nan = _mm256_movemask_ps(unord) != 0;
+					float lanes[8];
+					_mm256_storeu_ps(lanes, acc);
+					for (int l = 0; l < 8; l++)
+						if (lanes[l] < ret) ret = lanes[l];
+#elif SYSTEM_SIMD_SSE2
+					__m128 acc = _mm_set1_ps(ret);
+					__m128 unord = _mm_setzero_ps();
+					for (; i + 4 <= count; i += 4) {
+						__m128 v = _mm_loadu_ps(dta + i);
+						unord = _mm_or_ps(unord, _mm_cmpunord_ps(v, v));
+						acc = _mm_min_ps(v, acc);
+					}
+					nan = _mm_movemask_ps(unord) != 0;
+					float lanes[4];
+					_mm_storeu_ps(lanes, acc);
+					for (int l = 0; l < 4; l++)
+						if (lanes[l] < ret) ret = lanes[l];
+#endif
+					for (; i < count; i++) {
+						if (dta[i] != dta[i]) nan = true;
+						else if (dta[i] < ret) ret = dta[i];
+					}
+					return nan ? std::numeric_limits<float>::quiet_NaN() : ret;
+				}
+
+				// like Enumerable.Max: NaN only if every element is NaN
+				static float Max(float const* dta, int count) {
+					float ret = -std::numeric_limits<float>::infinity();
+					bool ordered = false;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256 acc = _mm256_set1_ps(ret);
+					__m256 ord = _mm256_setzero_ps();
+					for (; i + 8 <= count; i += 8) {
+						__m256 v = _mm256_loadu_ps(dta + i);
+						ord = _mm256_or_ps(ord, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+						acc = _mm256_max_ps(v, acc);
+					}
+					ordered = _mm256_movemask_ps(ord) != 0;
+					float lanes[8];
+					_mm256_storeu_ps(lanes, acc);
+					for (int l = 0; l < 8; l++)
+						if (lanes[l] > ret) ret = lanes[l];
+#elif SYSTEM_SIMD_SSE2
+					__m128 acc = _mm_set1_ps(ret);
+					__m128 ord = _mm_setzero_ps();
+					for (; i + 4 <= count; i += 4) {
+						__m128 v = _mm_loadu_ps(dta + i);
+						ord = _mm_or_ps(ord, _mm_cmpord_ps(v, v));
+						acc = _mm_max_ps(v, acc);
+					}
+					ordered = _mm_movemask_ps(ord) != 0;
+					float lanes[4];
+					_mm_storeu_ps(lanes, acc);
+					for (int l = 0; l < 4; l++)
+						if (lanes[l] > ret) ret = lanes[l];
+#endif
+					for (; i < count; i++) {
+						if (dta[i] == dta[i]) {
+							ordered = true;
+							if (dta[i] > ret) ret = dta[i];
+						}
+					}
+					return ordered ? ret : std::numeric_limits<float>::quiet_NaN();
+				}
+
+				static double Min(double const* dta, int count) {
+					double ret = std::numeric_limits<double>::infinity();
+					bool nan = false;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256d acc = _mm256_set1_pd(ret);
+					__m256d unord = _mm256_setzero_pd();
+					for (; i + 4 <= count; i += 4) {
+						__m256d v = _mm256_loadu_pd(dta + i);
+						unord = _mm256_or_pd(unord, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+						acc = _mm256_min_pd(v, acc);
+					}
+					nan = _mm256_movemask_pd(unord) != 0;
+					double lanes[4];
+					_mm256_storeu_pd(lanes, acc);
+					for (int l = 0; l < 4; l++)
+						if (lanes[l] < ret) ret = lanes[l];
+#elif SYSTEM_SIMD_SSE2
+					__m128d acc = _mm_set1_pd(ret);
+					__m128d unord = _mm_setzero_pd();
+					for (; i + 2 <= count; i += 2) {
+						__m128d v = _mm_loadu_pd(dta + i);
+						unord = _mm_or_pd(unord, _mm_cmpunord_pd(v, v));
+						acc = _mm_min_pd(v, acc);
+					}
+					nan = _mm_movemask_pd(unord) != 0;
+					double lanes[2];
+					_mm_storeu_pd(lanes, acc);
+					for (int l = 0; l < 2; l++)
+						if (lanes[l] < ret) ret = lanes[l];
+#endif
+					for (; i < count; i++) {
+						if (dta[i] != dta[i]) nan = true;
+						else if (dta[i] < ret) ret = dta[i];
+					}
+					return nan ? std::numeric_limits<double>::quiet_NaN() : ret;
+				}
+
+				static double Max(double const* dta, int count) {
+					double ret = -std::numeric_limits<double>::infinity();
+					bool ordered = false;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					__m256d acc = _mm256_set1_pd(ret);
+					__m256d ord = _mm256_setzero_pd();
+					for (; i + 4 <= count; i += 4) {
+						__m256d v = _mm256_loadu_pd(dta + i);
+						ord = _mm256_or_pd(ord, _mm256_cmp_pd(v, v, _CMP_ORD_Q));
+						acc = _mm256_max_pd(v, acc);
+					}
+					ordered = _mm256_movemask_pd(ord) != 0;
+					double lanes[4];
+					_mm256_storeu_pd(lanes, acc);
+					for (int l = 0; l < 4; l++)
+						if (lanes[l] > ret) ret = lanes[l];
+#elif SYSTEM_SIMD_SSE2
+					__m128d acc = _mm_set1_pd(ret);
+					__m128d ord = _mm_setzero_pd();
+					for (; i + 2 <= count; i += 2) {
+						__m128d v = _mm_loadu_pd(dta + i);
+						ord = _mm_or_pd(ord, _mm_cmpord_pd(v, v));
+						acc = _mm_max_pd(v, acc);
+					}
+					ordered = _mm_movemask_pd(ord) != 0;
+					double lanes[2];
+					_mm_storeu_pd(lanes, acc);
+					for (int l = 0; l < 2; l++)
+						if (lanes[l] > ret) ret = lanes[l];
+#endif
+					for (; i < count; i++) {
+						if (dta[i] == dta[i]) {
+							ordered = true;
+							if (dta[i] > ret) ret = dta[i];
+						}
+					}
+					return ordered ? ret : std::numeric_limits<double>::quiet_NaN();
+				}
+
+				template<class T> static T Min(T const* dta, int count) {
+					T const* ret = dta;
+					for (int i = 1; i < count; i++)
+						if (dta[i] < *ret) ret = dta + i;
+					return *ret;
+				}
+
+				template<class T> static T Max(T const* dta, int count) {
+					T const* ret = dta;
+					for (int i = 1; i < count; i++)
+						if (*ret < dta[i]) ret = dta + i;
+					return *ret;
+				}
+			};
+
+			template<class T> class System_API Array : public Object
+			{
+			private:
+				int32_t Get_Length() const {
+					return (int32_t)GOD()->Length;
+				}
+
+				//void Set_Length(int value) {
+				////	((ArrayD<T>*)od)->Length = value;
+				//}
+
+			public:
+				class System_API ObjectData : public Object::ObjectData
+				{
+				public:
+					T* arrdta;
+					ulong Length;
+					void* block;         // raw storage of an aligned or uninitialized array, NULL if arrdta came from new[]
+					Action<T*> deleter;  // releases an adopted buffer instead of delete[]
+
+
+					ObjectData() {
+						Length = 0;
+						arrdta = NULL;
+						block = NULL;
+					}
+
+					ObjectData(int length) {
+						Length = length;
+						block = NULL;
+						//arrdta = (T*)ObjectD::Pool.Get((size_t)length * sizeof(T));
+						arrdta = new T[length]();
+					}
+
+					// the elements start at a multiple of alignment; trivial elements are left uninitialized unless initialize is set
+					ObjectData(int length, int alignment, bool initialize) {
+						if (length < 0 || alignment < (int)alignof(T) || (alignment & (alignment - 1)))
+							throw ArgumentOutOfRangeException();
+						Length = length;
+						block = ::operator new((size_t)length * sizeof(T) + alignment - 1);
+						arrdta = AlignUp<T>(block, alignment - 1);
+						if (initialize || !std::is_trivially_default_constructible<T>::value) {
+							for (int i = 0; i < length; i++)
+								new (&arrdta[i]) T();
+						}
+					}
+
+					~ObjectData() override
+					{
+						//std::cout << "destroy called in array " << std::endl;
+						if (deleter != null)
+							deleter(arrdta);
+						else if (block) {
+							if (!std::is_trivially_destructible<T>::value) {
+								for (ulong i = 0; i < Length; i++)
+									arrdta[i].~T();
+							}
+							::operator delete(block);
+						}
+						else if (arrdta) {
+							delete[] arrdta;
+							//	ObjectD::Pool.Put((byte*)arrdta);
+						}
+					}
+
+					int32_t Get_Length() const {
+						return (int32_t)Length;
+					}
 
 				};
 
@@ -9868,6 +10853,37 @@ namespace System {
 					this->od = dd;
 				}
 
+				/// <summary>Adopts a buffer allocated elsewhere, deleter is called with the buffer when the array is destroyed.</summary>
+				Array(T* pValue, int len, Action<T*> const& deleter) {
+					if (!pValue && len)
+						throw ArgumentNullException();
+					if (len < 0)
+						throw ArgumentOutOfRangeException();
+					ObjectData* dd = new ObjectData();
+
+					dd->Length = len;
+					dd->arrdta = pValue;
+					dd->deleter = deleter;
+
+					this->od = dd;
+				}
+
+				/// <summary>Creates an array without initializing its elements, for buffers that are overwritten right away.
+				/// Only arithmetic and other trivial types are left uninitialized, other types are default constructed.</summary>
+				static Array<T> CreateUninitialized(int length) {
+					Array<T> ret;
+					ret.od = new ObjectData(length, (int)alignof(T), false);
+					return ret;
+				}
+
+				/// <summary>Creates an array whose first element is aligned to alignment bytes (a power of two, 32 for AVX,
+				/// 64 for a cache line). The elements are initialized unless initialize is false.</summary>
+				static Array<T> CreateAligned(int length, int alignment, bool initialize = true) {
+					Array<T> ret;
+					ret.od = new ObjectData(length, alignment, initialize);
+					return ret;
+				}
+
 				Array(const std::initializer_list<T> args) : Array((int)args.size()) {
 					int ind = 0;
 					ObjectData* ad = GOD();
@@ -9902,6 +10918,58 @@ namespace System {
 					return ad->arrdta[index];
 				}
 
+				/// <summary>The elements as a Span.</summary>
+				Span<T> AsSpan() const {
+					return Span<T>(GOD()->arrdta, (int)GOD()->Length);
+				}
+
+				/// <summary>The first height * width elements as rows of width elements.</summary>
+				Span2D<T> AsSpan2D(int height, int width) const {
+					if (height < 0 || width < 0 || (ulong)height * (ulong)width > GOD()->Length)
+						throw ArgumentOutOfRangeException();
+					return Span2D<T>(GOD()->arrdta, height, width);
+				}
+
+				/// <summary>The first depth * height * width elements as depth planes of height rows of width elements.</summary>
+				Span3D<T> AsSpan3D(int depth, int height, int width) const {
+					if (depth < 0 || height < 0 || width < 0 || (ulong)depth * (ulong)height * (ulong)width > GOD()->Length)
+						throw ArgumentOutOfRangeException();
+					return Span3D<T>(GOD()->arrdta, depth, height, width);
+				}
+
+				/// <summary>Computes the sum of the elements. Throws OverflowException if the sum of int or long elements overflows.</summary>
+				T Sum() const { return Aggregates::Sum(GOD()->arrdta, (int)GOD()->Length); }
+
+				/// <summary>Computes the sum of the elements, int and long sums wrap around on overflow.</summary>
+				T UncheckedSum() const { return Aggregates::UncheckedSum(GOD()->arrdta, (int)GOD()->Length); }
+
+				/// <summary>Computes the average of the elements. Throws InvalidOperationException if there are none.</summary>
+				double Average() const {
+					int count = (int)GOD()->Length;
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Average(GOD()->arrdta, count);
+				}
+
+				/// <summary>Returns the minimum value. Throws InvalidOperationException if there are no elements.</summary>
+				T Min() const {
+					int count = (int)GOD()->Length;
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Min(GOD()->arrdta, count);
+				}
+
+				/// <summary>Returns the maximum value. Throws InvalidOperationException if there are no elements.</summary>
+				T Max() const {
+					int count = (int)GOD()->Length;
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Max(GOD()->arrdta, count);
+				}
+
+				/// <summary>Enables parallelization of a query over the array.</summary>
+				Linq::ParallelQuery<Linq::ArraySource<T>> AsParallel() const;
+
 				//operator const T* () const {
 				//	ArrayD<T>* ad = (ArrayD<T>*)od;
 				//	return ad->arrdta;
@@ -9915,6 +10983,21 @@ namespace System {
 					return this->od ? GOD()->Count : 0;
 				}
 
+				int& GetCapacity() const {
+					return GOD()->capacity;
+				}
+
+				void SetCapacity(int const& value) {
+					GOD()->SetCapacity(value);
+				}
+
+				void SetCapacity(int&& value) {
+					GOD()->SetCapacity(value);
+				}
+
+				template<class F> void SortWithComparison(F const& comparison) const;
+				template<class F> void SortWithKey(F const& keySelector) const;
+
 				//void Set_Count(int& value) {
 				//	//	((ArrayD<T>*)od)->Length = value;
 				//}
@@ -9923,9 +11006,61 @@ namespace System {
 				class System_API ObjectData : public Object::ObjectData, public IEnumerable<T>::ObjectData
 				{
 				private:
-					//void EnsureCapacity(int desired) {
-					//
-					//}
+					// moves count elements to uninitialized memory and destroys the originals, the ranges may overlap
+					static void Relocate(T* dst, T* src, int count) {
+						if (count <= 0 || dst == src)
+							return;
+						if (std::is_trivially_copyable<T>::value)
+							std::memmove((void*)dst, (void const*)src, (size_t)count * sizeof(T));
+						else if (dst < src) {
+							for (int i = 0; i < count; i++) {
+								new (&dst[i]) T(std::move(src[i]));
+								src[i].~T();
+							}
+						}
+						else {
+							for (int i = count - 1; i >= 0; i--) {
+								new (&dst[i]) T(std::move(src[i]));
+								src[i].~T();
+							}
+						}
+					}
+
+					// copies count elements to uninitialized memory
+					static void CopyConstruct(T* dst, T const* src, int count) {
+						if (std::is_trivially_copyable<T>::value) {
+							if (count > 0)
+								std::memcpy((void*)dst, (void const*)src, (size_t)count * sizeof(T));
+						}
+						else {
+							for (int i = 0; i < count; i++)
+								new (&dst[i]) T(src[i]);
+						}
+					}
+
+					bool Contains(T const* ptr) const {
+						return ptr >= this->arrdta && ptr < this->arrdta + this->capacity;
+					}
+
+					// leaves count uninitialized slots at index, growing the buffer if needed; each element is moved at most once
+					void MakeRoom(int index, int count) {
+						int needed = this->Count + count;
+						if (needed > capacity) {
+							int newcapacity = capacity ? (capacity < INT32_MAX / 2 ? capacity << 1 : INT32_MAX) : 4;
+							if (newcapacity < needed)
+								newcapacity = needed;
+							T* newarrdta = (T*) ::operator new((size_t)newcapacity * sizeof(T));
+							if (this->arrdta) {
+								Relocate(newarrdta, this->arrdta, index);
+								Relocate(newarrdta + index + count, this->arrdta + index, this->Count - index);
+								::operator delete(this->arrdta);
+							}
+							this->arrdta = newarrdta;
+							capacity = newcapacity;
+						}
+						else
+							Relocate(this->arrdta + index + count, this->arrdta + index, this->Count - index);
+					}
 
 				public:
 					T* arrdta;
@@ -9952,85 +11087,140 @@ namespace System {
 					}
 
 					void Add(T const & item) {
-						Insert(this->Count, item);
+						if (this->Count < capacity) {
+							new (&this->arrdta[this->Count]) T(item);
+							this->Count++;
+						}
+						else
+							Insert(this->Count, item);
 					}
 
 					void Add(T&& item) {
-						Insert(this->Count, std::move(item));
+						if (this->Count < capacity) {
+							new (&this->arrdta[this->Count]) T(std::move(item));
+							this->Count++;
+						}
+						else
+							Insert(this->Count, std::move(item));
 					}
 
 					void Insert(int index, T const & item) {
-						if (capacity == this->Count) {
-							int newcapacity = capacity ? (capacity << 1) : 4;
-							T* newarrdta = (T*) ::operator new(newcapacity * sizeof(T));
-							for (int i = 0; i < index; i++) {
-								new (&newarrdta[i]) T(std::move(this->arrdta[i]));
-							}
-							for (int i = index + 1; i < this->Count + 1; i++) {
-								new (&newarrdta[i]) T(std::move(this->arrdta[i - 1]));
-							}
-							//std::memcpy(newarrdta, arrdta, index * sizeof(T));
-							//std::memcpy(newarrdta + index + 1, arrdta + index, ((size_t)this->Count - index) * sizeof(T));
-							new (&newarrdta[index]) T(item);
-
-							if (this->arrdta)
-								::operator delete(this->arrdta);
-							this->arrdta = newarrdta;
-							capacity = newcapacity;
-						}
-						else
-						{
-							for (int i = this->Count; i > index; i--) {
-								this->arrdta[i] = std::move(this->arrdta[i - 1]);
-							}
-							new (&arrdta[index]) T(item);
+						if (index < 0 || index > this->Count)
+							throw ArgumentOutOfRangeException();
+						if (Contains(&item)) {
+							// an element of this list, it moves with the others
+							T copy(item);
+							Insert(index, std::move(copy));
+							return;
 						}
+						MakeRoom(index, 1);
+						new (&this->arrdta[index]) T(item);
 						this->Count++;
 					}
 
 					void Insert(int index, T&& item) {
+						if (index < 0 || index > this->Count)
+							throw ArgumentOutOfRangeException();
+						if (Contains(&item)) {
+							T moved(std::move(item));
+							Insert(index, std::move(moved));
+							return;
+						}
+						MakeRoom(index, 1);
+						new (&this->arrdta[index]) T(std::move(item));
+						this->Count++;
+					}
 
-						if (capacity == this->Count) {
-							int newcapacity = capacity ? (capacity << 1) : 4;
-							T* newarrdta = (T*) ::operator new(newcapacity * sizeof(T));
-							for (int i = 0; i < index; i++) {
-								new (&newarrdta[i]) T(std::move(this->arrdta[i]));
-							}
-							for (int i = index + 1; i < this->Count + 1; i++) {
-								new (&newarrdta[i]) T(std::move(this->arrdta[i - 1]));
-							}
-							//std::memcpy(newarrdta, arrdta, index * sizeof(T));
-							//std::memcpy(newarrdta + index + 1, arrdta + index, ((size_t)this->Count - index) * sizeof(T));
-							new (&newarrdta[index]) T(std::move(item));
+					void InsertRange(int index, T const* items, int count) {
+						if (index < 0 || index > this->Count || count < 0)
+							throw ArgumentOutOfRangeException();
+						if (!count)
+							return;
+						if (Contains(items)) {
+							// from this list (AddRange(self)), copy them before they move
+							T* copy = (T*) ::operator new((size_t)count * sizeof(T));
+							CopyConstruct(copy, items, count);
+							MakeRoom(index, count);
+							Relocate(this->arrdta + index, copy, count);
+							::operator delete(copy);
+						}
+						else {
+							MakeRoom(index, count);
+							CopyConstruct(this->arrdta + index, items, count);
+						}
+						this->Count += count;
+					}
 
-							if (this->arrdta)
-								::operator delete(this->arrdta);
-							this->arrdta = newarrdta;
-							capacity = newcapacity;
+					void AddRange(T const* items, int count) {
+						InsertRange(this->Count, items, count);
+					}
+
+					void AddRange(IEnumerable<T> const & collection) {
+						IEnumerator<T> it = collection.GetEnumerator();
+						typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = it.GetFP_MoveNextGetCurrent();
+						T* cur;
+						while ((cur = mngc(it.od)) != null)
+							Add(*cur);
+					}
+
+					void RemoveRange(int index, int count) {
+						if (index < 0 || count < 0 || count > this->Count - index)
+							throw ArgumentOutOfRangeException();
+						for (int i = index; i < index + count; i++)
+							this->arrdta[i].~T();
+						Relocate(this->arrdta + index, this->arrdta + index + count, this->Count - index - count);
+						this->Count -= count;
+					}
+
+					void CopyTo(int index, T* destination, int count) const {
+						if (index < 0 || count < 0 || count > this->Count - index)
+							throw ArgumentOutOfRangeException();
+						if (std::is_trivially_copyable<T>::value) {
+							if (count > 0)
+								std::memmove((void*)destination, (void const*)(this->arrdta + index), (size_t)count * sizeof(T));
 						}
-						else
-						{
-							for (int i = this->Count; i > index; i--) {
-								this->arrdta[i] = std::move(this->arrdta[i - 1]);
-							}
-							new (&arrdta[index]) T(std::move(item));
+						else {
+							for (int i = 0; i < count; i++)
+								destination[i] = this->arrdta[index + i];
 						}
-						this->Count++;
 					}
 
-					void AddRange(IEnumerable<T>& collection) {
-						throw NotImplementedException();
+					// reallocates the buffer to hold exactly newcapacity elements
+					void SetCapacity(int newcapacity) {
+						if (newcapacity < this->Count)
+							throw ArgumentOutOfRangeException();
+						if (newcapacity == capacity)
+							return;
+						T* newarrdta = newcapacity ? (T*) ::operator new((size_t)newcapacity * sizeof(T)) : NULL;
+						if (this->arrdta) {
+							Relocate(newarrdta, this->arrdta, this->Count);
+							::operator delete(this->arrdta);
+						}
+						this->arrdta = newarrdta;
+						capacity = newcapacity;
+					}
+
+					int EnsureCapacity(int min) {
+						if (min < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity < min) {
+							int newcapacity = capacity ? (capacity < INT32_MAX / 2 ? capacity << 1 : INT32_MAX) : 4;
+							SetCapacity(newcapacity < min ? min : newcapacity);
+						}
+						return capacity;
 					}
 
-					void AddRange(IEnumerable<T>&& collection) {
-						throw NotImplementedException();
+					void TrimExcess() {
+						// not worth a reallocation when less than 10% would be saved
+						if (this->Count < (int)(capacity * 0.9))
+							SetCapacity(this->Count);
 					}
 
 					void Clear() {
+						// the buffer is kept for reuse, like .NET's List<T>.Clear
 						for (int i = 0; i < this->Count; i++) {
 							arrdta[i].~T();
 						}
-						::operator delete(arrdta);
 						this->Count = 0;
 					}
 
@@ -10050,6 +11240,12 @@ namespace System {
 
 					List<T> ToList() const override;
 
+					Array<T> ToArray() const override {
+						Array<T> ret = Array<T>::CreateUninitialized(this->Count);
+						CopyTo(0, ret.GOD()->arrdta, this->Count);
+						return ret;
+					}
+
 					IEnumerable<T> Where(const Func<T, bool>& predicate) const override;
 
 				};
@@ -10057,6 +11253,9 @@ namespace System {
 				/// <summary>Gets the number of elements contained in the List&lt;T&gt;.</summary>
 				PropGenGet<int, List<T>, &List<T>::GetCount> Count{ this };
 
+				/// <summary>Gets or sets the total number of elements the internal data structure can hold without resizing.</summary>
+				PropGen<int, int, List<T>, &List<T>::GetCapacity, &List<T>::SetCapacity, &List<T>::SetCapacity> Capacity{ this };
+
 								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
 				List(){}
@@ -10205,10 +11404,85 @@ namespace System {
 					GOD()->Insert(index, std::move(item));
 				}
 
+				/// <summary>Adds the elements of the specified collection to the end of the List&lt;T&gt;.</summary>
 				void AddRange(IEnumerable<T> const & collection) const {
 					GOD()->AddRange(collection);
 				}
 
+				/// <summary>Adds count elements starting at items to the end of the List&lt;T&gt;. The buffer grows at most once, trivially copyable elements are copied with memcpy.</summary>
+				void AddRange(T const* items, int count) const {
+					GOD()->AddRange(items, count);
+				}
+
+				void AddRange(Array<T> const& items) const {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->AddRange(items.GOD()->arrdta, (int)items.GOD()->Length);
+				}
+
+				void AddRange(List<T> const& items) const {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->AddRange(items.GOD()->arrdta, items.GOD()->Count);
+				}
+
+				/// <summary>Inserts count elements starting at items into the List&lt;T&gt; at the specified index.</summary>
+				void InsertRange(int index, T const* items, int count) const {
+					GOD()->InsertRange(index, items, count);
+				}
+
+				void InsertRange(int index, Array<T> const& items) const {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->InsertRange(index, items.GOD()->arrdta, (int)items.GOD()->Length);
+				}
+
+				void InsertRange(int index, List<T> const& items) const {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->InsertRange(index, items.GOD()->arrdta, items.GOD()->Count);
+				}
+
+				/// <summary>Removes a range of elements from the List&lt;T&gt;.</summary>
+				/// <param name="index">The zero-based starting index of the range of elements to remove.</param>
+				/// <param name="count">The number of elements to remove.</param>
+				void RemoveRange(int index, int count) const {
+					GOD()->RemoveRange(index, count);
+				}
+
+				/// <summary>Copies count elements starting at index to destination, which must have room for them.</summary>
+				void CopyTo(int index, T* destination, int count) const {
+					GOD()->CopyTo(index, destination, count);
+				}
+
+				/// <summary>Copies a range of elements from the List&lt;T&gt; to a compatible one-dimensional array, starting at the specified index of the target array.</summary>
+				void CopyTo(int index, Array<T> const& array, int arrayIndex, int count) const {
+					if (array == null)
+						throw ArgumentNullException();
+					if (arrayIndex < 0 || count < 0 || count > (int)array.GOD()->Length - arrayIndex)
+						throw ArgumentOutOfRangeException();
+					GOD()->CopyTo(index, array.GOD()->arrdta + arrayIndex, count);
+				}
+
+				void CopyTo(Array<T> const& array, int arrayIndex) const {
+					CopyTo(0, array, arrayIndex, GetCount());
+				}
+
+				void CopyTo(Array<T> const& array) const {
+					CopyTo(0, array, 0, GetCount());
+				}
+
+				/// <summary>Ensures that the capacity of this list is at least the specified capacity, growing it to at least twice the current one.</summary>
+				/// <returns>The new capacity of this list.</returns>
+				int EnsureCapacity(int capacity) const {
+					return GOD()->EnsureCapacity(capacity);
+				}
+
+				/// <summary>Sets the capacity to the actual number of elements in the List&lt;T&gt;, if that number is less than 90 percent of the current capacity.</summary>
+				void TrimExcess() const {
+					GOD()->TrimExcess();
+				}
+
 				void Clear() const {
 					GOD()->Clear();
 				}
@@ -10218,22 +11492,74 @@ namespace System {
 				Array<T> ToArray() const { return od != nullptr ? GOD()->ToArray() : nullptr; }
 				IEnumerable<T> Where(const Func<T, bool>& predicate) const { return GOD()->Where(predicate); }
 				template<class R> IEnumerable<R> Select(const Func<T, R>& selector) const { return GOD()->Select(selector); }
-				template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
-				template<class R> IEnumerable<R> OrderBy(const Func<T, R>& keySelector) const { return GOD()->OrderBy(keySelector); }
+				template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
+				template<class R> IEnumerable<T> OrderBy(const Func<T, R>& keySelector) const { return GOD()->OrderBy(keySelector); }
 				template<class R> T Max(const Func<T, R>& selector) const { return GOD()->Max(selector); };
 				template<class R> T Min(const Func<T, R>& selector) const { return GOD()->Min(selector); };
 
-				IEnumerator<T> begin() const {
-					IEnumerator<T> ret = GetEnumerator();
-					ret.GOD()->mngc = ret.GetFP_MoveNextGetCurrent();
-					++ret;
-					return ret;
+				/// <summary>Computes the sum of the elements. Throws OverflowException if the sum of int or long elements overflows.</summary>
+				T Sum() const { return Aggregates::Sum(GOD()->arrdta, GetCount()); }
+
+				/// <summary>Computes the sum of the elements, int and long sums wrap around on overflow.</summary>
+				T UncheckedSum() const { return Aggregates::UncheckedSum(GOD()->arrdta, GetCount()); }
+
+				/// <summary>Computes the average of the elements. Throws InvalidOperationException if there are none.</summary>
+				double Average() const {
+					int count = GetCount();
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Average(GOD()->arrdta, count);
 				}
-				IEnumerator<T> end() const {
-					return GOD()->GetEnumeratorEnd();
+
+				/// <summary>Returns the minimum value. Throws InvalidOperationException if there are no elements.</summary>
+				T Min() const {
+					int count = GetCount();
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Min(GOD()->arrdta, count);
 				}
-			};
-			template<class T> List<T> IEnumerable<T>::ObjectData::ToList() const {
+
+				/// <summary>Returns the maximum value. Throws InvalidOperationException if there are no elements.</summary>
+				T Max() const {
+					int count = GetCount();
+					if (!count)
+						throw InvalidOperationException();
+					return Aggregates::Max(GOD()->arrdta, count);
+				}
+
+				/// <summary>Sorts the elements in the entire List&lt;T&gt; using the default comparer. Integral values and Strings are radix sorted, large lists are sorted in parallel.</summary>
+				void Sort() const;
+
+				/// <summary>Sorts the elements in the entire List&lt;T&gt; using the specified comparer.</summary>
+				/// <param name="comparer">The IComparer&lt;T&gt; implementation to use when comparing elements, or null to use the default comparer.</param>
+				void Sort(IComparer<T> const& comparer) const;
+
+				/// <summary>Sorts the elements in the entire List&lt;T&gt; using the specified comparison.</summary>
+				/// <param name="comparison">Called with two elements, returns less than zero, zero or greater than zero like IComparer&lt;T&gt;::Compare.</param>
+				template<class F> auto Sort(F const& comparison) const -> decltype((void)comparison(std::declval<T const&>(), std::declval<T const&>())) {
+					SortWithComparison(comparison);
+				}
+
+				/// <summary>Sorts the elements in the entire List&lt;T&gt; by the key keySelector returns for each element. The sort is stable, integral and String keys are radix sorted.</summary>
+				/// <param name="keySelector">Called with one element, returns its key.</param>
+				template<class F> auto Sort(F const& keySelector) const -> decltype((void)keySelector(std::declval<T const&>())) {
+					SortWithKey(keySelector);
+				}
+
+				/// <summary>Enables parallelization of a query over the list.</summary>
+				Linq::ParallelQuery<Linq::ListSource<T>> AsParallel() const;
+
+				IEnumerator<T> begin() const {
+					IEnumerator<T> ret = GetEnumerator();
+					ret.GOD()->mngc = ret.GetFP_MoveNextGetCurrent();
+					++ret;
+					return ret;
+				}
+				IEnumerator<T> end() const {
+					return GOD()->GetEnumeratorEnd();
+				}
+			};
+			template<class T> List<T> IEnumerable<T>::ObjectData::ToList() const {
 				List<T> ret(0);
 				IEnumerator<T> enu = this->GetEnumerator();
 				while (enu.MoveNext()) {
@@ -10306,68 +11632,6 @@ namespace System {
 
 				return ret;
 			}
-			template<class T, class R> void QSortList(T* lst, int low, int high, Func<T, R> const & keySelector, IComparer<R> const & comparer) {
-				if (high - low <= 1)
-					return;
-				int pivotindex = low + ((high - low) >> 1);
-				T pivot = lst[pivotindex];
-				R pivotkey = keySelector(pivot);
-				T tmp = lst[high - 1];
-				lst[high - 1] = pivot;
-				lst[pivotindex] = tmp;
-
-				int i = low - 1;
-				for (int j = low; j < high - 1; j++) {
-					R key = keySelector(lst[j]);
-					int cr = comparer.Compare(key, pivotkey);
-					if (cr < 0) {
-						i++;
-						if (i < j) {
-							tmp = lst[i];
-							lst[i] = lst[j];
-							lst[j] = tmp;
-							//std::swap_ranges(&lst[i], &lst[i + 1], &lst[j]);
-						}
-					}
-				}
-				i++;
-				lst[high - 1] = lst[i];
-				lst[i] = pivot;
-
-
-				QSortList(lst, low, i, keySelector, comparer);
-				QSortList(lst, i + 1, high, keySelector, comparer);
-			}
-			template<class T> template<class R> IEnumerable<R> IEnumerable<T>::ObjectData::OrderBy(Func<T, R> const & keySelector, IComparer<R> const & comparer) const {
-				struct lcl {
-					R key;
-					T* ptr;
-				};
-
-				List<lcl> arr(0);
-				IEnumerator<T> enu = this->GetEnumerator();
-				typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = enu.GetFP_MoveNextGetCurrent();
-
-				T* cur;
-				while ((cur = mngc(enu.od)) != null)
-				{
-					arr.Add({ keySelector(*cur), cur });
-				}
-				typename IComparer<R>::CompareFN* comp = comparer.GetFP_Compare();
-				//QSortList<T, R>(ret.GOD()->arrdta, 0, ret.Count, keySelector, comparer);
-				std::sort(arr->GOD()->arrdta, arr->GOD()->arrdta + ((int)arr.Count), [&comp](lcl const & a, lcl const & b) -> bool {
-					return comp(a.key, b.key) == -1;
-					});
-				List<T> ret(arr.Count);
-				for (int i = 0; i < arr.Count; i++) {
-					ret.Add(*arr[i].ptr);
-				}
-
-				return ret;
-			}
-			template<class T> template<class R> IEnumerable<R> IEnumerable<T>::ObjectData::OrderBy(const Func<T, R>& keySelector) const {
-				return this->OrderBy(keySelector, (IComparer<R>)Comparer<R>::Default);
-			}
 			template<class T> template<class R> T IEnumerable<T>::ObjectData::Max(const Func<T, R>& selector) const {
 				IEnumerator<T> enu = this->GetEnumerator();
 				typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = enu.GetFP_MoveNextGetCurrent();
@@ -10428,12 +11692,16 @@ namespace System {
 				T Value;
 				ActualLinkedListNode<T>* Next;
 				ActualLinkedListNode<T>* Previous;
+				// the LinkedListNode<T>::ObjectData wrapping this node if there is one, so every handle to the node shares it
+				Object::ObjectData* Handle;
+				// the LinkedList<T>::ObjectData whose slabs hold this node
+				Object::ObjectData* List;
 
-				ActualLinkedListNode(T const & value, ActualLinkedListNode<T>* next, ActualLinkedListNode<T>* previous) : Value(value), Next(next), Previous(previous) {
+				ActualLinkedListNode(T const & value, ActualLinkedListNode<T>* next, ActualLinkedListNode<T>* previous) : Value(value), Next(next), Previous(previous), Handle(nullptr), List(nullptr) {
 				
 				}
 
-				ActualLinkedListNode(T&& value, ActualLinkedListNode<T>* next, ActualLinkedListNode<T>* previous) : Value(std::move(value)), Next(next), Previous(previous) {
+				ActualLinkedListNode(T&& value, ActualLinkedListNode<T>* next, ActualLinkedListNode<T>* previous) : Value(std::move(value)), Next(next), Previous(previous), Handle(nullptr), List(nullptr) {
 
 				}
 			};
@@ -10450,7 +11718,10 @@ namespace System {
 				}
 
 				T& GetValue() const {
-					return GOD()->alln->Value;
+					ActualLinkedListNode<T>* alln = GOD()->alln;
+					if (!alln)
+						throw InvalidOperationException(); // removed from its list
+					return alln->Value;
 				}
 
 				//LinkedList<T> GetList() const {
@@ -10475,6 +11746,8 @@ namespace System {
 
 					~ObjectData() override {
 						//std::cout << "LinkedListNode destructor" << std::endl;
+						if (alln)
+							alln->Handle = nullptr;
 					}
 				};
 
@@ -10548,8 +11821,24 @@ namespace System {
 
 
 
+				// the handle of a node is created once and shared while it is alive, so stepping through
+				// Next/Previous or asking for First/Last again doesn't allocate
 				LinkedListNode(ActualLinkedListNode<T>* alln) {
-					od = new ObjectData(alln);
+					if (!alln)
+						return;
+					if (alln->Handle) {
+						od = alln->Handle;
+						AddRef();
+					}
+					else {
+						od = new ObjectData(alln);
+						alln->Handle = od;
+					}
+				}
+
+				/// <summary>Gets the node itself, for walking the list without handles. Null if it was removed from its list.</summary>
+				ActualLinkedListNode<T>* GetNode() const {
+					return GOD()->alln;
 				}
 
 				//LinkedListNode(T&& value) {
@@ -10572,7 +11861,75 @@ namespace System {
 					return LinkedListNode<T>(GOD()->GetLast());
 				}
 
+				// the node has to be in this list: one of another list would be unlinked into this one's free list
+				ActualLinkedListNode<T>* GetNode(LinkedListNode<T> const& node) const {
+					if (node == null)
+						throw ArgumentNullException();
+					ActualLinkedListNode<T>* alln = node.GetNode();
+					if (!alln || alln->List != this->od)
+						throw InvalidOperationException();
+					return alln;
+				}
+
 			public:
+				// walks the nodes directly, no enumerator or node handles are allocated
+				template<class R> class System_API NodeIterator
+				{
+				private:
+					ActualLinkedListNode<T>* node;
+					ActualLinkedListNode<T>* first;
+				public:
+					NodeIterator(ActualLinkedListNode<T>* first) : node(first), first(first) {
+					}
+
+					R& operator*() const {
+						return Get(identity<R>());
+					}
+
+					NodeIterator& operator++() {
+						node = node->Next;
+						if (node == first) // circular list
+							node = null;
+						return *this;
+					}
+
+					bool operator!=(NodeIterator const& other) const {
+						return node != other.node;
+					}
+
+					bool operator==(NodeIterator const& other) const {
+						return node == other.node;
+					}
+
+				private:
+					T& Get(identity<T>) const {
+						return node->Value;
+					}
+
+					ActualLinkedListNode<T>& Get(identity<ActualLinkedListNode<T>>) const {
+						return *node;
+					}
+				};
+
+				typedef NodeIterator<T> Iterator;
+
+				class System_API NodeRange
+				{
+				private:
+					ActualLinkedListNode<T>* first;
+				public:
+					NodeRange(ActualLinkedListNode<T>* first) : first(first) {
+					}
+
+					NodeIterator<ActualLinkedListNode<T>> begin() const {
+						return NodeIterator<ActualLinkedListNode<T>>(first);
+					}
+
+					NodeIterator<ActualLinkedListNode<T>> end() const {
+						return NodeIterator<ActualLinkedListNode<T>>(null);
+					}
+				};
+
 				class System_API Enumerator : public Object
 				{
 				public:
@@ -10733,10 +12090,45 @@ namespace System {
 				private:
 					ActualLinkedListNode<T>* head;
 					ActualLinkedListNode<T>* tail;
+
+					// nodes are carved out of slabs owned by the list, removed nodes go on a free list and are reused
+					struct FreeNode {
+						FreeNode* next;
+					};
+					static const int MaxSlabSize = 1024;
+					std::vector<void*> slabs;
+					FreeNode* freenodes;
+					int slabsize;
+
+					template<class U> ActualLinkedListNode<T>* NewNode(U&& value, ActualLinkedListNode<T>* next, ActualLinkedListNode<T>* previous) {
+						if (!freenodes) {
+							// the slabs double in size, small lists stay small
+							byte* slab = (byte*) ::operator new((size_t)slabsize * sizeof(ActualLinkedListNode<T>));
+							slabs.push_back(slab);
+							for (int i = slabsize - 1; i >= 0; i--)
+								freenodes = new (slab + (size_t)i * sizeof(ActualLinkedListNode<T>)) FreeNode{ freenodes };
+							if (slabsize < MaxSlabSize)
+								slabsize <<= 1;
+						}
+						void* mem = freenodes;
+						freenodes = freenodes->next;
+						ActualLinkedListNode<T>* node = new (mem) ActualLinkedListNode<T>(std::forward<U>(value), next, previous);
+						node->List = this;
+						return node;
+					}
+
+					void DeleteNode(ActualLinkedListNode<T>* node) {
+						// handles to the node outlive it, they throw InvalidOperationException from now on
+						if (node->Handle)
+							static_cast<typename LinkedListNode<T>::ObjectData*>(node->Handle)->alln = nullptr;
+						node->~ActualLinkedListNode<T>();
+						freenodes = new (node) FreeNode{ freenodes };
+					}
+
 				public:
 					int Count;
 
-					ObjectData() : Count(0), head(null) , tail(null) {
+					ObjectData() : head(null), tail(null), freenodes(null), slabsize(8), Count(0) {
 					}
 
 					~ObjectData() override
@@ -10752,14 +12144,24 @@ namespace System {
 						return LinkedListNode<T>(tail);
 					}
 
+					ActualLinkedListNode<T>* GetFirstNode() const {
+						return head;
+					}
+
+					ActualLinkedListNode<T>* GetLastNode() const {
+						return tail;
+					}
+
 					void MakeCircular() {
 						tail->Next = head;
 						head->Previous = tail;
 					}
 
-					LinkedListNode<T> AddFirst(T const & value) {
-						ActualLinkedListNode<T>* newhead = new ActualLinkedListNode<T>(value, head, null);
+					template<class U> LinkedListNode<T> AddFirst(U&& value) {
+						ActualLinkedListNode<T>* newhead = NewNode(std::forward<U>(value), head, head ? head->Previous : null);
 						if (head != null) {
+							if (head->Previous) // circular
+								head->Previous->Next = newhead;
 							head->Previous = newhead;
 							head = newhead;
 						}
@@ -10772,82 +12174,67 @@ namespace System {
 						return LinkedListNode<T>(newhead);
 					}
 
-					LinkedListNode<T> AddFirst(T&& value) {
-						ActualLinkedListNode<T>* newhead = new ActualLinkedListNode<T>(std::move(value), head, null);
-						if (head != null) {
-							head->Previous = newhead;
-							head = newhead;
-						}
-						else {
-							head = newhead;
-							tail = head;
-						}
-						Count++;
-
-						return LinkedListNode<T>(newhead);
+					template<class U> LinkedListNode<T> AddLast(U&& value) {
+						if (tail == null || head == null)
+							return AddFirst(std::forward<U>(value));
+						return AddAfter(tail, std::forward<U>(value));
 					}
 
-					LinkedListNode<T> AddAfter(LinkedListNode<T> const & llnode, T const& value) {
-						ActualLinkedListNode<T>* newnode;
-						ActualLinkedListNode<T>* node = llnode.GOD()->alln;
-
-						if (node->Next == null) {
-							newnode = new ActualLinkedListNode<T>(value, null, node);
-							node->Next = newnode;
-							tail = newnode;
-						}
-						else {
-							newnode = new ActualLinkedListNode<T>(value, node->Next, node);
+					template<class U> LinkedListNode<T> AddAfter(ActualLinkedListNode<T>* node, U&& value) {
+						ActualLinkedListNode<T>* newnode = NewNode(std::forward<U>(value), node->Next, node);
+						if (node->Next != null)
 							node->Next->Previous = newnode;
-							node->Next = newnode;
-						}
-						Count++;
-						
-						return LinkedListNode<T>(newnode);
-					}
-
-					LinkedListNode<T> AddAfter(LinkedListNode<T> const & llnode, T&& value) {
-						ActualLinkedListNode<T>* newnode;
-						ActualLinkedListNode<T>* node = llnode.GOD()->alln;
-
-						if (node->Next == null) {
-							newnode = new ActualLinkedListNode<T>(std::move(value), null, node);
-							node->Next = newnode;
+						node->Next = newnode;
+						if (node == tail)
 							tail = newnode;
-						}
-						else {
-							newnode = new ActualLinkedListNode<T>(std::move(value), node->Next, node);
-							node->Next->Previous = newnode;
-							node->Next = newnode;
-						}
 						Count++;
 
 						return LinkedListNode<T>(newnode);
 					}
 
+					template<class U> LinkedListNode<T> AddBefore(ActualLinkedListNode<T>* node, U&& value) {
+						if (node == head)
+							return AddFirst(std::forward<U>(value));
+						return AddAfter(node->Previous, std::forward<U>(value));
+					}
+
 					void Clear() {
 						ActualLinkedListNode<T>* tmp = head;
 						while (tmp) {
 							ActualLinkedListNode<T>* tmp2 = tmp;
 							tmp = tmp->Next;
-							delete tmp2;
+							DeleteNode(tmp2);
 							if (tmp == head) // in case the list is circular...
 								break;
 						}
 						head = null;
-						// tail = null; // no need to nullify tail
+						tail = null;
 						Count = 0;
+						for (void* slab : slabs)
+							::operator delete(slab);
+						slabs.clear();
+						freenodes = null;
+						slabsize = 8;
 					}
 
-					void Remove(LinkedListNode<T> const & llnode) {
-						ActualLinkedListNode<T>* node = llnode.GOD()->alln;
-						if (node->Next != null) {
-							node->Next->Previous = node->Previous;
+					void Remove(ActualLinkedListNode<T>* node) {
+						if (node == null)
+							throw InvalidOperationException();
+						if (Count == 1) {
+							head = null;
+							tail = null;
 						}
-						if (node->Previous != null) {
-							node->Previous->Next = node->Next;
+						else {
+							if (node->Next != null)
+								node->Next->Previous = node->Previous;
+							if (node->Previous != null)
+								node->Previous->Next = node->Next;
+							if (node == head)
+								head = node->Next;
+							if (node == tail)
+								tail = node->Previous;
 						}
-						delete node;
+						DeleteNode(node);
 						Count--;
 					}
 
@@ -10979,7 +12366,7 @@ namespace System {
 				/// <param name="value">The value to add to the LinkedListt&lt;T&gt;.</param>
 				/// <returns>The new LinkedListNodet&lt;T&gt; containing value.</returns>
 				LinkedListNode<T> AddAfter(LinkedListNode<T> const & node, T const& value) const {
-					return GOD()->AddAfter(node, value);
+					return GOD()->AddAfter(GetNode(node), value);
 				}
 
 				/// <summary>Adds a new node containing the specified value after the specified existing node in the LinkedListt&lt;T&gt;.</summary>
@@ -10987,13 +12374,40 @@ namespace System {
 				/// <param name="value">The value to add to the LinkedListt&lt;T&gt;.</param>
 				/// <returns>The new LinkedListNodet&lt;T&gt; containing value.</returns>
 				LinkedListNode<T> AddAfter(LinkedListNode<T> const & node, T&& value) const {
-					return GOD()->AddAfter(node, std::move(value));
+					return GOD()->AddAfter(GetNode(node), std::move(value));
+				}
+
+				/// <summary>Adds a new node containing the specified value before the specified existing node in the LinkedList&lt;T&gt;.</summary>
+				/// <param name="node">The LinkedListNode&lt;T&gt; before which to insert a new LinkedListNode&lt;T&gt; containing value.</param>
+				/// <param name="value">The value to add to the LinkedList&lt;T&gt;.</param>
+				/// <returns>The new LinkedListNode&lt;T&gt; containing value.</returns>
+				template <class U>
+				LinkedListNode<T> AddBefore(LinkedListNode<T> const & node, U&& value) const {
+					return GOD()->AddBefore(GetNode(node), std::forward<U>(value));
+				}
+
+				/// <summary>Adds a new node containing the specified value at the end of the LinkedList&lt;T&gt;.</summary>
+				/// <param name="value">The value to add at the end of the LinkedList&lt;T&gt;.</param>
+				/// <returns>The new LinkedListNode&lt;T&gt; containing value.</returns>
+				template <class U>
+				LinkedListNode<T> AddLast(U&& value) const {
+					return GOD()->AddLast(std::forward<U>(value));
 				}
 
 				/// <summary>Removes the specified node from the LinkedListt&lt;T&gt;.</summary>
 				/// <returns></returns>
 				void Remove(LinkedListNode<T> const & node) const {
-					GOD()->Remove(node);
+					GOD()->Remove(GetNode(node));
+				}
+
+				/// <summary>Removes the node at the start of the LinkedList&lt;T&gt;. Throws InvalidOperationException if the list is empty.</summary>
+				void RemoveFirst() const {
+					GOD()->Remove(GOD()->GetFirstNode());
+				}
+
+				/// <summary>Removes the node at the end of the LinkedList&lt;T&gt;. Throws InvalidOperationException if the list is empty.</summary>
+				void RemoveLast() const {
+					GOD()->Remove(GOD()->GetLastNode());
 				}
 
 				/// <summary>Removes all nodes from the LinkedListt&lt;T&gt;.</summary>
@@ -11007,144 +12421,48 @@ namespace System {
 				Array<T> ToArray() const { return od != nullptr ? GOD()->ToArray() : nullptr; }
 				IEnumerable<T> Where(Func<T, bool> const & predicate) const { return GOD()->Where(predicate); }
 				template<class R> IEnumerable<R> Select(Func<T, R> const & selector) const { return GOD()->Select(selector); }
-				template<class R> IEnumerable<R> OrderBy(Func<T, R> const & keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
-				template<class R> IEnumerable<R> OrderBy(Func<T, R> const & keySelector) const { return GOD()->OrderBy(keySelector); }
+				template<class R> IEnumerable<T> OrderBy(Func<T, R> const & keySelector, const IComparer<R>& comparer) const { return GOD()->OrderBy(keySelector, comparer); }
+				template<class R> IEnumerable<T> OrderBy(Func<T, R> const & keySelector) const { return GOD()->OrderBy(keySelector); }
 				template<class R> T Max(Func<T, R> const & selector) const { return GOD()->Max(selector); };
 				template<class R> T Min(Func<T, R> const& selector) const { return GOD()->Min(selector); };
 
-				IEnumerator<T> begin() const {
-					IEnumerator<T> ret = GetEnumerator();
-					ret.GOD()->mngc = ret.GetFP_MoveNextGetCurrent();
-					++ret;
-					return ret;
-				}
-				IEnumerator<T> end() const {
-					return GOD()->GetEnumeratorEnd();
-				}
-			};
-
-
-
-			template <class TKey, class TValue> struct DictionaryEntry {
-				int hashCode = 0;    // Lower 31 bits of hash code, -1 if unused
-				int next = 0;        // Index of next entry, -1 if last
-				TKey key{};           // Key of entry
-				TValue value{};         // Value of entry
-			};
-			template <class TKey, class TValue> class System_API KeyValuePair : public Object {
-			private:
-			public:
-
-
-				class System_API ObjectData : public Object::ObjectData {
-				public:
-					// same as in Dictionary
-
-					//TKey key;
-					//TValue value;
-					DictionaryEntry<TKey, TValue>* dta;
-				};
-
-				//KeyValuePair(TKey key, TValue value) {
-				//	ObjectData* dd = new ObjectData();
-				//	dd->key = key;
-				//	dd->value = value;
-				//	od = dd;
-				//}
-
-
-
-				TKey& Get_Key() const {
-					return GOD()->dta->key;
-				}
-
-				void Set_Key(const TKey& value) {
-					GOD()->dta->key = value;
+				/// <summary>Gets the nodes for a range-based for loop, walked without allocating handles: for (ActualLinkedListNode&lt;T&gt;&amp; node : list.Nodes()).</summary>
+				NodeRange Nodes() const {
+					return NodeRange(GOD()->GetFirstNode());
 				}
 
-				void Set_Key(TKey&& value) {
-					GOD()->dta->key = value;
+				Iterator begin() const {
+					return Iterator(GOD()->GetFirstNode());
 				}
-
-				PropGen<TKey, TKey, System::Collections::Generic::KeyValuePair<TKey, TValue>, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Get_Key, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Set_Key, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Set_Key> Key{ this };
-
-				TValue& Get_Value() const {
-					return GOD()->dta->value;
-				}
-
-				void Set_Value(const TValue& value) {
-					GOD()->dta->value = value;
-				}
-
-				void Set_Value(TValue&& value) {
-					GOD()->dta->value = value;
+				Iterator end() const {
+					return Iterator(null);
 				}
+			};
 
-				PropGen<TValue, TValue, System::Collections::Generic::KeyValuePair<TKey, TValue>, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Get_Value, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Set_Value, &System::Collections::Generic::KeyValuePair<TKey, TValue>::Set_Value> Value{ this };
 
 
-							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+			/// <summary>A key and its value, stored inline. Dictionary entries are KeyValuePairs, so enumerating a Dictionary
+			/// yields references into its storage. The public fields bind to C++17 structured bindings (auto&amp; [key, value]).</summary>
+			template <class TKey, class TValue> struct KeyValuePair {
+				TKey Key;
+				TValue Value;
 
-			KeyValuePair(){}
+				KeyValuePair() : Key(), Value() {}
 
-			KeyValuePair(std::nullptr_t const & n) : System::Object(n) {
-			}
+				KeyValuePair(TKey key, TValue value) : Key(std::move(key)), Value(std::move(value)) {}
 
-			KeyValuePair(KeyValuePair* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
-				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
+				bool operator==(KeyValuePair const& other) const {
+					return Key == other.Key && Value == other.Value;
 				}
-				delete pValue;
-			}
-
-			KeyValuePair(KeyValuePair const & other) : System::Object(other) { }
-
-			KeyValuePair(KeyValuePair&& other) noexcept : System::Object(std::move(other)) { }
-
-			KeyValuePair(Object::ObjectData* other) : System::Object(other) {
-			}
-
-			KeyValuePair& operator=(KeyValuePair const & other) {
-				System::Object::operator=(other);
-				return *this;
-			}
-
-			KeyValuePair& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
-
-			KeyValuePair& operator=(KeyValuePair&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
-
-			KeyValuePair& operator=(KeyValuePair* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
-
-			KeyValuePair* operator->() {
-				return this;
-			}
-
 
-
-					KeyValuePair(DictionaryEntry<TKey, TValue>* entry) {
-					ObjectData* dd = new ObjectData();
-					dd->dta = entry;
-					od = dd;
+				bool operator!=(KeyValuePair const& other) const {
+					return !(*this == other);
 				}
+			};
 
+			template <class TKey, class TValue> struct DictionaryEntry : KeyValuePair<TKey, TValue> {
+				int hashCode = 0;    // Lower 31 bits of hash code, -1 if unused
+				int next = 0;        // Index of next entry, -1 if last
 			};
 
 			template<class TKey, class TValue> class System_API KeyValuePairEnumerator : public Object //IEnumerator<T>
@@ -11153,8 +12471,6 @@ namespace System {
 				class System_API ObjectData : public Object::ObjectData, public IEnumerator<KeyValuePair<TKey, TValue>>::ObjectData {
 				public:
 
-					KeyValuePair<TKey, TValue>* kvp = nullptr;
-
 					DictionaryEntry<TKey, TValue>* dta;
 					DictionaryEntry<TKey, TValue>* curptr;
 					DictionaryEntry<TKey, TValue>* end;
@@ -11170,24 +12486,14 @@ namespace System {
 
 					ObjectData(Object const & enulst, DictionaryEntry<TKey, TValue>* dta, DictionaryEntry<TKey, TValue>* curptr, DictionaryEntry<TKey, TValue>* end) : dta(dta), curptr(curptr), end(end), enulst(enulst) {
 						//this->vtableptr = (typename IEnumerator<T>::ObjectData::IEnumerator_VTable*) &vtable;
-						if (curptr != end)
-							kvp = new KeyValuePair<TKey, TValue>(curptr);
-					}
-
-					~ObjectData() override
-					{
-						//	enulst.Release();
-						if (kvp != nullptr) {
-							delete kvp;
-						}
 					}
 
 					KeyValuePair<TKey, TValue>& GetCurrent() const override {
-						return *kvp;
+						return *curptr;
 					}
 
 					void SetCurrent(KeyValuePair<TKey, TValue> const& value) override {
-						kvp->Value = value.Value;
+						curptr->Value = value.Value;
 						// not safe to set key
 					}
 
@@ -11195,10 +12501,8 @@ namespace System {
 					static KeyValuePair<TKey, TValue>* MoveNextGetCurrent(void* _this) {
 						ObjectData* o = (ObjectData*)_this;
 						while (++o->curptr != o->end && o->curptr->hashCode < 0) {}
-						if (o->curptr != o->end) {
-							o->kvp->GOD()->dta = o->curptr;
-							return o->kvp;
-						}
+						if (o->curptr != o->end)
+							return o->curptr;
 						else
 							return nullptr;
 					}
@@ -11216,7 +12520,8 @@ namespace System {
 					}
 
 					bool MoveNext() override {
-						return ++this->curptr != this->end;
+						while (++this->curptr != this->end && this->curptr->hashCode < 0) {}
+						return this->curptr != this->end;
 					}
 				};
 
@@ -11343,6 +12648,7 @@ namespace System {
 						//	version = 0;
 						freeCount = 0;
 						buckets = null;
+						entries = null;
 
 						if (capacity > 0)
 							Initialize(capacity);
@@ -11379,7 +12685,7 @@ namespace System {
 						//if (forceNewHashCodes) {
 						//	for (int i = 0; i < count; i++) {
 						//		if (newEntries[i].hashCode != -1) {
-						//			newEntries[i].hashCode = (comparer.GetHashCode(newEntries[i].key) & 0x7FFFFFFF);
+						//			newEntries[i].hashCode = (comparer.GetHashCode(newEntries[i].Key) & 0x7FFFFFFF);
 						//		}
 						//	}
 						//}
@@ -11406,12 +12712,12 @@ namespace System {
 						int hashCode = comparer.GetHashCode(key) & 0x7FFFFFFF;
 						int targetBucket = hashCode % bucketsLength;
 						for (int i = buckets[targetBucket]; i >= 0; i = entries[i].next) {
-							if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].key, key)) {
+							if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].Key, key)) {
 								if (add) {
 									//ThrowHelper.ThrowArgumentException(ExceptionResource.Argument_AddingDuplicate);
 									throw Exception();
 								}
-								entries[i].value = value;
+								entries[i].Value = value;
 								//	version++;
 								return i;
 							}
@@ -11434,8 +12740,8 @@ namespace System {
 
 						entries[index].hashCode = hashCode;
 						entries[index].next = buckets[targetBucket];
-						entries[index].key = key;
-						entries[index].value = value;
+						entries[index].Key = key;
+						entries[index].Value = value;
 						buckets[targetBucket] = index;
 						//	version++;
 						return index;
@@ -11449,12 +12755,12 @@ namespace System {
 						int hashCode = comparer.GetHashCode(key) & 0x7FFFFFFF;
 						int targetBucket = hashCode % bucketsLength;
 						for (int i = buckets[targetBucket]; i >= 0; i = entries[i].next) {
-							if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].key, key)) {
+							if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].Key, key)) {
 								if (add) {
 									//ThrowHelper.ThrowArgumentException(ExceptionResource.Argument_AddingDuplicate);
 									throw Exception();
 								}
-								entries[i].value = (TValue&&)value;
+								entries[i].Value = (TValue&&)value;
 								//	version++;
 								return i;
 							}
@@ -11477,8 +12783,8 @@ namespace System {
 
 						entries[index].hashCode = hashCode;
 						entries[index].next = buckets[targetBucket];
-						entries[index].key = key;
-						entries[index].value = value;
+						entries[index].Key = key;
+						entries[index].Value = value;
 						buckets[targetBucket] = index;
 						//	version++;
 						return index;
@@ -11492,7 +12798,7 @@ namespace System {
 						if (buckets) {
 							int hashCode = comparer.GetHashCode(key) & 0x7FFFFFFF;
 							for (int i = buckets[hashCode % bucketsLength]; i >= 0; i = entries[i].next) {
-								if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].key, key)) return i;
+								if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].Key, key)) return i;
 							}
 						}
 						return -1;
@@ -11501,7 +12807,7 @@ namespace System {
 					TValue* TryGetValue(const TKey& key) {
 						int i = FindEntry(key);
 						if (i >= 0) {
-							return &(entries[i].value);
+							return &(entries[i].Value);
 							//return true;
 						}
 						//value = TValue();
@@ -11514,7 +12820,7 @@ namespace System {
 							int bucket = hashCode % bucketsLength;
 							int last = -1;
 							for (int i = buckets[bucket]; i >= 0; last = i, i = entries[i].next) {
-								if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].key, key)) {
+								if (entries[i].hashCode == hashCode && comparer.Equals(entries[i].Key, key)) {
 									if (last < 0) {
 										buckets[bucket] = entries[i].next;
 									}
@@ -11523,8 +12829,8 @@ namespace System {
 									}
 									entries[i].hashCode = -1;
 									entries[i].next = freeList;
-									entries[i].key = TKey();
-									entries[i].value = TValue();
+									entries[i].Key = TKey();
+									entries[i].Value = TValue();
 									freeList = i;
 									freeCount++;
 									//version++;
@@ -11558,6 +12864,41 @@ namespace System {
 
 
 
+				/// <summary>Walks the entries in place for a range-based for loop and yields references to them, nothing is
+				/// allocated: for (KeyValuePair&lt;TKey, TValue&gt;&amp; kvp : dic).</summary>
+				class System_API Iterator
+				{
+				private:
+					DictionaryEntry<TKey, TValue>* cur;
+					DictionaryEntry<TKey, TValue>* end;
+				public:
+					Iterator(DictionaryEntry<TKey, TValue>* cur, DictionaryEntry<TKey, TValue>* end) : cur(cur), end(end) {
+						while (this->cur != end && this->cur->hashCode < 0)
+							++this->cur;
+					}
+
+					KeyValuePair<TKey, TValue>& operator*() const {
+						return *cur;
+					}
+
+					KeyValuePair<TKey, TValue>* operator->() const {
+						return cur;
+					}
+
+					Iterator& operator++() {
+						while (++cur != end && cur->hashCode < 0) {}
+						return *this;
+					}
+
+					bool operator!=(Iterator const& other) const {
+						return cur != other.cur;
+					}
+
+					bool operator==(Iterator const& other) const {
+						return cur == other.cur;
+					}
+				};
+
 							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
 			Dictionary(){}
@@ -11669,480 +13010,4948 @@ namespace System {
 					if (val)
 						return *val;
 					int index = dd->Insert(key, TValue(), true);
-					return dd->entries[index].value;
+					return dd->entries[index].Value;
 				}
 
 				IEnumerator<KeyValuePair<TKey, TValue>> GetEnumerator() const { return GOD()->GetEnumerator(); }
 
-				IEnumerator<KeyValuePair<TKey, TValue>> begin() const {
-					IEnumerator<KeyValuePair<TKey, TValue>> ret = GetEnumerator();
-					ret.GOD()->mngc = ret.GetFP_MoveNextGetCurrent();
-					++ret;
-					return ret;
+				Iterator begin() const {
+					return Iterator(GOD()->entries, GOD()->entries + GOD()->count);
 				}
-				IEnumerator<KeyValuePair<TKey, TValue>> end() const {
-					return GOD()->GetEnumeratorEnd();
+				Iterator end() const {
+					return Iterator(GOD()->entries + GOD()->count, GOD()->entries + GOD()->count);
 				}
 
 			};
 
-			template<class T> class System_API Stack : public Object {
-			private:
-				int Get_Count() const {
-					return GOD()->Get_Count();
+			// Word-wise operations on bitmaps, used by the dense mode of HashSet<T>. AVX2 or SSE2 like Aggregates.
+			class BitmapOps {
+			public:
+				static int PopCount(ulong word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+					return (int)__popcnt64(word);
+#elif defined(__GNUC__)
+					return __builtin_popcountll(word);
+#else
+					word = word - ((word >> 1) & 0x5555555555555555ULL);
+					word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+					return (int)((((word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+#endif
 				}
 
-			public:
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					T* _array;
-					int _size;
-					int _capacity;
-					static const int _defaultCapacity = 4;
+				// word must not be 0
+				static int TrailingZeroCount(ulong word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+					unsigned long index;
+					_BitScanForward64(&index, word);
+					return (int)index;
+#elif defined(__GNUC__)
+					return __builtin_ctzll(word);
+#else
+					int ret = 0;
+					while (!(word & 1)) {
+						word >>= 1;
+						ret++;
+					}
+					return ret;
+#endif
+				}
 
-				public:
+				static int PopCount(ulong const* bits, int words) {
+					int ret = 0;
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					// nibble lookup table with pshufb, the byte counts are summed up with psadbw
+					__m256i const lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+					__m256i const low4 = _mm256_set1_epi8(0x0F);
+					__m256i acc = _mm256_setzero_si256();
+					for (; i + 4 <= words; i += 4) {
+						__m256i v = _mm256_loadu_si256((__m256i const*)(bits + i));
+						__m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low4)), _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4)));
+						acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+					}
+					long lanes[4];
+					_mm256_storeu_si256((__m256i*)lanes, acc);
+					ret = (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+					for (; i < words; i++)
+						ret += PopCount(bits[i]);
+					return ret;
+				}
 
-					int Get_Count() const {
-						return _size;
-					}
+				static void And(ulong* dst, ulong const* src, int words) {
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					for (; i + 4 <= words; i += 4)
+						_mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(_mm256_loadu_si256((__m256i const*)(dst + i)), _mm256_loadu_si256((__m256i const*)(src + i))));
+#elif SYSTEM_SIMD_SSE2
+					for (; i + 2 <= words; i += 2)
+						_mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(_mm_loadu_si128((__m128i const*)(dst + i)), _mm_loadu_si128((__m128i const*)(src + i))));
+#endif
+					for (; i < words; i++)
+						dst[i] &= src[i];
+				}
+
+				static void Or(ulong* dst, ulong const* src, int words) {
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					for (; i + 4 <= words; i += 4)
+						_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_loadu_si256((__m256i const*)(dst + i)), _mm256_loadu_si256((__m256i const*)(src + i))));
+#elif SYSTEM_SIMD_SSE2
+					for (; i + 2 <= words; i += 2)
+						_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_loadu_si128((__m128i const*)(dst + i)), _mm_loadu_si128((__m128i const*)(src + i))));
+#endif
+					for (; i < words; i++)
+						dst[i] |= src[i];
+				}
+
+				// dst &= ~src
+				static void AndNot(ulong* dst, ulong const* src, int words) {
+					int i = 0;
+#if SYSTEM_SIMD_AVX2
+					for (; i + 4 <= words; i += 4)
+						_mm256_storeu_si256((__m256i*)(dst + i), _mm256_andnot_si256(_mm256_loadu_si256((__m256i const*)(src + i)), _mm256_loadu_si256((__m256i const*)(dst + i))));
+#elif SYSTEM_SIMD_SSE2
+					for (; i + 2 <= words; i += 2)
+						_mm_storeu_si128((__m128i*)(dst + i), _mm_andnot_si128(_mm_loadu_si128((__m128i const*)(src + i)), _mm_loadu_si128((__m128i const*)(dst + i))));
+#endif
+					for (; i < words; i++)
+						dst[i] &= ~src[i];
+				}
+			};
 
-					ObjectData(int capacity) {
-						_array = (T*) ::operator new[](capacity);
-						_size = 0;
-						_capacity = capacity;
-					}
+			template <class T> struct HashSetSlot {
+				int hashCode = 0;    // Lower 31 bits of hash code, -1 if unused
+				int next = 0;        // Index of next slot, -1 if last
+				T value{};
+			};
 
-					ObjectData() {
-						_array = nullptr;
-						_size = 0;
-						_capacity = 0;
-					}
+			/// <summary>Represents a set of values. Chained hashing like Dictionary&lt;TKey, TValue&gt;, without the value slot.
+			/// An integral HashSet constructed with a minimum and a maximum value keeps its elements in a bitmap instead,
+			/// which makes UnionWith/IntersectWith/ExceptWith between such sets word-wise (vectorised) operations.
+			/// Adding a value outside of the range switches it to hashing.</summary>
+			template<class T> class System_API HashSet : public Object {
+			private:
+				int Get_Count() const {
+					return this->od ? GOD()->count : 0;
+				}
 
-					~ObjectData() override {
-						Clear();
+			public:
+				class System_API ObjectData : public Object::ObjectData, public IEnumerable<T>::ObjectData {
+				private:
+					template<class U> static int DefaultHashCode(U const& value, std::true_type) {
+						ulong v = (ulong)value;
+						return (int)v ^ (int)(v >> 32);
 					}
 
-					void Clear() {
-						if (_capacity > 0) {
-							for (int i = 0; i < _size; i++) {
-								_array[i].~T();
-							}
-							::operator delete[](_array);
-							_capacity = 0;
-							_size = 0;
-						}
+					template<class U> int DefaultHashCode(U const& value, std::false_type) const {
+						return comparer.GetHashCode(value);
 					}
 
-					void Push(T const& item) {
-						if (_size == _capacity) {
-							if (_capacity == 0) {
-								_array = (T*) ::operator new[](_defaultCapacity);
-								_capacity = _defaultCapacity;
-							}
-							else {
-								T* newArray = (T*) ::operator new[](sizeof(T)* (_capacity << 1));
-								memcpy(newArray, _array, sizeof(T) * _capacity);
-								::operator delete[](_array);
-								_array = newArray;
-								_capacity <<= 1;
-							}
-						}
-						new (_array + _size++) T(item);
+					// the dense mode only exists for integral T, these keep the other types compiling
+					template<class U> ulong BitOffset(U const& value, std::true_type) const {
+						return (ulong)value - (ulong)bitsMin;
 					}
 
-					T Pop() {
-						if (_size == 0) {
-							throw InvalidOperationException();
-						}
-						T ret = _array[--_size];
-						//_array[_size] = default<T>();
-						_array[_size].~T();
-
-						return ret;
+					template<class U> ulong BitOffset(U const& value, std::false_type) const {
+						return 0;
 					}
 
-				};
-
-				PropGenGet<int, Stack<T>, &Stack<T>::Get_Count> Count{ this };
-
-							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+					template<class U> U BitValue(int index, identity<U>, std::true_type) const {
+						return (U)((ulong)bitsMin + (ulong)index);
+					}
 
-			Stack(){}
+					template<class U> U BitValue(int index, identity<U>, std::false_type) const {
+						return U();
+					}
 
-			Stack(std::nullptr_t const & n) : System::Object(n) {
-			}
+					ulong BitOffset(T const& value) const {
+						return BitOffset(value, std::integral_constant<bool, std::is_integral<T>::value>());
+					}
 
-			Stack(Stack* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
-				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
-				}
-				delete pValue;
-			}
+					T BitValue(int index) const {
+						return BitValue(index, identity<T>(), std::integral_constant<bool, std::is_integral<T>::value>());
+					}
 
-			Stack(Stack const & other) : System::Object(other) { }
+					void Initialize(int capacity) {
+						int size = HashHelpers::GetPrime(capacity);
+						bucketsLength = size;
+						buckets = new int[size];
+						for (int i = 0; i < size; i++)
+							buckets[i] = -1;
+						slots = new HashSetSlot<T>[size];
+						freeList = -1;
+					}
 
-			Stack(Stack&& other) noexcept : System::Object(std::move(other)) { }
+					void Resize() {
+						int newSize = HashHelpers::ExpandPrime(lastIndex);
+						int* newBuckets = new int[(size_t)newSize];
+						HashSetSlot<T>* newSlots = new HashSetSlot<T>[newSize];
+						for (int i = 0; i < newSize; i++)
+							newBuckets[i] = -1;
+						for (int i = 0; i < lastIndex; i++) {
+							newSlots[i].hashCode = slots[i].hashCode;
+							newSlots[i].value = std::move(slots[i].value);
+							if (slots[i].hashCode >= 0) {
+								int bucket = slots[i].hashCode % newSize;
+								newSlots[i].next = newBuckets[bucket];
+								newBuckets[bucket] = i;
+							}
+							else
+								newSlots[i].next = slots[i].next;
+						}
+						delete[] buckets;
+						delete[] slots;
+						buckets = newBuckets;
+						slots = newSlots;
+						bucketsLength = newSize;
+					}
 
-			Stack(Object::ObjectData* other) : System::Object(other) {
-			}
+					// leaves the dense mode, the elements are moved to the hash table
+					void ToHashed() {
+						ulong* oldbits = bits;
+						int words = bitsWords;
+						bits = null;
+						Initialize(count);
+						count = 0;
+						for (int w = 0; w < words; w++) {
+							for (ulong word = oldbits[w]; word; word &= word - 1)
+								AddHashed(BitValue(w * 64 + BitmapOps::TrailingZeroCount(word)));
+						}
+						bitsWords = 0;
+						delete[] oldbits;
+					}
 
-			Stack& operator=(Stack const & other) {
-				System::Object::operator=(other);
-				return *this;
-			}
+					bool InRange(T const& value) const {
+						return BitOffset(value) < (ulong)bitsWords * 64;
+					}
 
-			Stack& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
+					bool AddHashed(T const& value) {
+						if (!buckets)
+							Initialize(0);
+						int hashCode = HashOf(value);
+						int bucket = hashCode % bucketsLength;
+						for (int i = buckets[bucket]; i >= 0; i = slots[i].next) {
+							if (slots[i].hashCode == hashCode && AreEqual(slots[i].value, value))
+								return false;
+						}
+						int index;
+						if (freeList >= 0) {
+							index = freeList;
+							freeList = slots[index].next;
+						}
+						else {
+							if (lastIndex == bucketsLength) {
+								Resize();
+								bucket = hashCode % bucketsLength;
+							}
+							index = lastIndex;
+							lastIndex++;
+						}
+						slots[index].hashCode = hashCode;
+						slots[index].value = value;
+						slots[index].next = buckets[bucket];
+						buckets[bucket] = index;
+						count++;
+						return true;
+					}
 
-			Stack& operator=(Stack&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
+					// both dense and their bits line up, offset is the word of other's first bit in this bitmap. Bitmaps
+					// too far apart to overlap or touch are not aligned, the offset would not fit in an int
+					bool Aligned(ObjectData const* other, int& offset) const {
+						if (!bits || !other->bits)
+							return false;
+						long diff = (long)BitOffset(other->bitsMin);
+						if (diff % 64)
+							return false;
+						long words = diff / 64;
+						if (words < -(long)other->bitsWords || words > (long)bitsWords)
+							return false;
+						offset = (int)words;
+						return true;
+					}
 
-			Stack& operator=(Stack* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
+				public:
+					static const int MaxBitmapBits = INT32_MAX / 64 * 64;
 
-			Stack* operator->() {
-				return this;
-			}
+					int* buckets;
+					int bucketsLength;
+					HashSetSlot<T>* slots;
+					int lastIndex;
+					int freeList;
+					int count;
+					IEqualityComparer<T> comparer;
+					bool defaultComparer;
 
+					// dense mode
+					ulong* bits;
+					int bitsWords;
+					T bitsMin;
 
+					ObjectData(int capacity, IEqualityComparer<T> comparer) : buckets(null), bucketsLength(0), slots(null), lastIndex(0), freeList(-1), count(0), bits(null), bitsWords(0), bitsMin() {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity > 0)
+							Initialize(capacity);
+						IEqualityComparer<T> def = EqualityComparer<T>::Default;
+						defaultComparer = comparer.GOD() == nullptr || comparer.GOD() == def.GOD();
+						this->comparer = defaultComparer ? def : comparer;
+					}
 
-					Stack(int capacity) {
-					this->od = new ObjectData(capacity);
-				}
+					ObjectData(int capacity) : ObjectData(capacity, null) {}
 
-				void Push(T const& item) {
-					GOD()->Push(item);
-				}
+					ObjectData() : ObjectData(0) {}
 
-				T Pop() {
-					return GOD()->Pop();
-				}
-			};
+					ObjectData(T minValue, T maxValue) : ObjectData(0) {
+						// the bits are indexed with ints, so the whole bitmap has to fit: capped in bits, not words
+						if (maxValue < minValue || (ulong)maxValue - (ulong)minValue >= (ulong)MaxBitmapBits)
+							throw ArgumentOutOfRangeException();
+						bitsMin = minValue;
+						bitsWords = (int)(((ulong)maxValue - (ulong)minValue) / 64 + 1);
+						bits = new ulong[bitsWords];
+						std::memset(bits, 0, (size_t)bitsWords * sizeof(ulong));
+					}
 
+					~ObjectData() override {
+						if (buckets) {
+							delete[] buckets;
+							delete[] slots;
+						}
+						if (bits)
+							delete[] bits;
+					}
 
-			template<class T> class System_API Queue : public Object {
-			private:
-				int Get_Count() const {
-					return GOD()->Count;
-				}
+					// the default comparer of integral types is inlined, no call through IEqualityComparer<T>
+					int HashOf(T const& value) const {
+						if (defaultComparer)
+							return DefaultHashCode(value, std::integral_constant<bool, std::is_integral<T>::value>()) & 0x7FFFFFFF;
+						return comparer.GetHashCode(value) & 0x7FFFFFFF;
+					}
 
-			public:
+					bool AreEqual(T const& x, T const& y) const {
+						return defaultComparer ? x == y : comparer.Equals(x, y);
+					}
 
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					struct node {
-						T value;
-						node(T const & value) : value(value) {
+					bool Add(T const& value) {
+						if (bits) {
+							if (InRange(value)) {
+								ulong off = BitOffset(value);
+								ulong mask = (ulong)1 << (off & 63);
+								ulong& word = bits[off >> 6];
+								if (word & mask)
+									return false;
+								word |= mask;
+								count++;
+								return true;
+							}
+							ToHashed();
 						}
+						return AddHashed(value);
+					}
 
-						node(T&& value) : value(std::move(value)) {
+					int FindSlot(T const& value) const {
+						if (buckets) {
+							int hashCode = HashOf(value);
+							for (int i = buckets[hashCode % bucketsLength]; i >= 0; i = slots[i].next) {
+								if (slots[i].hashCode == hashCode && AreEqual(slots[i].value, value))
+									return i;
+							}
 						}
-					};
-
-					static const int c = 7;
+						return -1;
+					}
 
-					node** wtbl = NULL;
-					node** rtbl = NULL;
+					bool Contains(T const& value) const {
+						if (bits) {
+							if (!InRange(value))
+								return false;
+							ulong off = BitOffset(value);
+							return (bits[off >> 6] >> (off & 63)) & 1;
+						}
+						return FindSlot(value) >= 0;
+					}
 
-					size_t fnode;
-				public:
-					int Count = 0;
+					bool Remove(T const& value) {
+						if (bits) {
+							if (!InRange(value))
+								return false;
+							ulong off = BitOffset(value);
+							ulong mask = (ulong)1 << (off & 63);
+							ulong& word = bits[off >> 6];
+							if (!(word & mask))
+								return false;
+							word &= ~mask;
+							count--;
+							return true;
+						}
+						if (buckets) {
+							int hashCode = HashOf(value);
+							int bucket = hashCode % bucketsLength;
+							int last = -1;
+							for (int i = buckets[bucket]; i >= 0; last = i, i = slots[i].next) {
+								if (slots[i].hashCode == hashCode && AreEqual(slots[i].value, value)) {
+									if (last < 0)
+										buckets[bucket] = slots[i].next;
+									else
+										slots[last].next = slots[i].next;
+									slots[i].hashCode = -1;
+									slots[i].value = T();
+									slots[i].next = freeList;
+									freeList = i;
+									count--;
+									return true;
+								}
+							}
+						}
+						return false;
+					}
 
-					ObjectData() {
-						node** nptr = new node * [c + 1];
-						memset(nptr, 0, c << ptrshifter);
-						nptr[c] = (node*)1; // sentinel
-						rtbl = wtbl = nptr;
-						fnode = (size_t)(nptr);
+					void Clear() {
+						if (bits)
+							std::memset(bits, 0, (size_t)bitsWords * sizeof(ulong));
+						if (buckets) {
+							for (int i = 0; i < bucketsLength; i++)
+								buckets[i] = -1;
+							for (int i = 0; i < lastIndex; i++)
+								slots[i] = HashSetSlot<T>();
+							lastIndex = 0;
+							freeList = -1;
+						}
+						count = 0;
 					}
 
-					~ObjectData() override {
-						while ((((size_t)*rtbl) & 1) == 0)
-						{
-							if (*rtbl)
-								delete (*rtbl);
-							rtbl++;
-						}
-						while (true) {
-							node** nexttbl = (node**)(((size_t)*rtbl) ^ 1);
-							delete[](rtbl - c);
-							if (!nexttbl)
-								break;
-							rtbl = nexttbl;
-							while ((((size_t)*rtbl) & 1) == 0)
-							{
-								if (*rtbl)
-									delete (*rtbl);
-								rtbl++;
+					// index of the next element at or after index (a slot or, in dense mode, a bit), -1 at the end
+					int NextIndex(int index) const {
+						if (bits) {
+							int w = index >> 6;
+							if (w >= bitsWords)
+								return -1;
+							ulong word = bits[w] & (~(ulong)0 << (index & 63));
+							while (!word) {
+								if (++w >= bitsWords)
+									return -1;
+								word = bits[w];
 							}
+							return w * 64 + BitmapOps::TrailingZeroCount(word);
 						}
+						for (; index < lastIndex; index++) {
+							if (slots[index].hashCode >= 0)
+								return index;
+						}
+						return -1;
 					}
 
-					void Enqueue(T const & item) {
+					T GetAt(int index) const {
+						return bits ? BitValue(index) : slots[index].value;
+					}
 
-						node* newnode = new node(item);
-						node* cur = *wtbl;
-						if (cur == 0) {
-							*wtbl = newnode;
-							wtbl++;
+					void UnionWith(ObjectData const* other) {
+						int offset;
+						if (other != this && Aligned(other, offset) && offset >= 0 && offset + other->bitsWords <= bitsWords) {
+							BitmapOps::Or(bits + offset, other->bits, other->bitsWords);
+							count = BitmapOps::PopCount(bits, bitsWords);
+							return;
 						}
-						else {
-							node** nptr = new node * [c + 1];
-							memset(nptr, 0, c << ptrshifter);
-							nptr[0] = newnode;
-							nptr[c] = (node*)1; // sentinel
-							*wtbl = (node*)((size_t)nptr | 1);
-							wtbl = nptr + 1;
+						if (other == this)
+							return;
+						for (int i = other->NextIndex(0); i >= 0; i = other->NextIndex(i + 1))
+							Add(other->GetAt(i));
+					}
+
+					void IntersectWith(ObjectData const* other) {
+						if (other == this)
+							return;
+						int offset;
+						if (Aligned(other, offset)) {
+							// the words outside of other's range are cleared
+							int begin = offset > 0 ? offset : 0;
+							int end = offset + other->bitsWords < bitsWords ? offset + other->bitsWords : bitsWords;
+							if (begin >= end)
+								begin = end = 0;
+							std::memset(bits, 0, (size_t)begin * sizeof(ulong));
+							if (end > begin)
+								BitmapOps::And(bits + begin, other->bits + (begin - offset), end - begin);
+							std::memset(bits + end, 0, (size_t)(bitsWords - end) * sizeof(ulong));
+							count = BitmapOps::PopCount(bits, bitsWords);
+							return;
+						}
+						for (int i = NextIndex(0); i >= 0; i = NextIndex(i + 1)) {
+							T value = GetAt(i);
+							if (!other->Contains(value))
+								Remove(value);
 						}
-						++Count;
 					}
 
-					T Dequeue() {
-						//Serial.println("DEQUEUE BEGIN");
-						node* n = *rtbl;
-						size_t nval = (size_t)n;
-						if (nval <= 1)
-							throw InvalidOperationException();
-						if (nval & 1) {
-							//Serial.print("DEQUEUE SENTINEL, DELETE BLOCK AT ");
-							//Serial.print((size_t)(rtbl - c));
-							//Serial.print(", FNODE = ");
-							//Serial.println(fnode);
-
-							delete[](rtbl - c);
-							rtbl = (node**)(nval ^ 1);
-						}
-						//Serial.println("DEQUEUE BEFORE NODE DELETE");
-						T ret = (*rtbl)->value;
-						delete (*rtbl);
-						rtbl++;
-						//Serial.println("DEQUEUE END");
-						--Count;
-						return ret;
+					void ExceptWith(ObjectData const* other) {
+						if (other == this) {
+							Clear();
+							return;
+						}
+						int offset;
+						if (Aligned(other, offset)) {
+							int begin = offset > 0 ? offset : 0;
+							int end = offset + other->bitsWords < bitsWords ? offset + other->bitsWords : bitsWords;
+							if (end > begin) {
+								BitmapOps::AndNot(bits + begin, other->bits + (begin - offset), end - begin);
+								count = BitmapOps::PopCount(bits, bitsWords);
+							}
+							return;
+						}
+						for (int i = other->NextIndex(0); i >= 0 && count; i = other->NextIndex(i + 1))
+							Remove(other->GetAt(i));
 					}
 
+					IEnumerator<T> GetEnumerator() const override;
 
+					IEnumerator<T> GetEnumeratorEnd() const override {
+						return null;
+					}
 				};
 
-				PropGenGet<int, Queue<T>, &Queue<T>::Get_Count> Count{ this };
+				class System_API Enumerator : public Object
+				{
+				public:
+					class System_API ObjectData : public Object::ObjectData, public IEnumerator<T>::ObjectData {
+					private:
+						HashSet<T> set;
+						int index;
+						T current;
+					public:
+						ObjectData(HashSet<T> const& set) : set(set), index(-1), current() {
+						}
 
-							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+						T& GetCurrent() const override {
+							return const_cast<T&>(current);
+						}
 
-			Queue(){}
+						void SetCurrent(T const& value) override {
+							throw InvalidOperationException(); // the elements of a set are read-only
+						}
 
-			Queue(std::nullptr_t const & n) : System::Object(n) {
-			}
+						static T* MoveNextGetCurrent(void* _this) {
+							ObjectData* o = (ObjectData*)_this;
+							if (!o->MoveNext())
+								return null;
+							return &o->current;
+						}
 
-			Queue(Queue* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
-				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
-				}
-				delete pValue;
-			}
+						T* MoveNextGetCurrent() override {
+							return MoveNextGetCurrent(this);
+						}
 
-			Queue(Queue const & other) : System::Object(other) { }
+						typename IEnumerator<T>::MoveNextGetCurrentFN* GetFP_MoveNextGetCurrent() const override {
+							return &ObjectData::MoveNextGetCurrent;
+						}
 
-			Queue(Queue&& other) noexcept : System::Object(std::move(other)) { }
+						void Reset() override {
+							index = -1;
+						}
 
-			Queue(Object::ObjectData* other) : System::Object(other) {
-			}
+						bool MoveNext() override {
+							typename HashSet<T>::ObjectData* sd = set.GOD();
+							index = sd->NextIndex(index + 1);
+							if (index < 0) {
+								index = INT32_MAX - 1;
+								return false;
+							}
+							current = sd->GetAt(index);
+							return true;
+						}
+					};
 
-			Queue& operator=(Queue const & other) {
-				System::Object::operator=(other);
-				return *this;
-			}
+					ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-			Queue& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
+					Enumerator(HashSet<T> const& set) {
+						this->od = new ObjectData(set);
+					}
 
-			Queue& operator=(Queue&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
+					operator IEnumerator<T>() const {
+						IEnumerator<T> ret(GOD(), GOD());
+						return ret;
+					}
+				};
 
-			Queue& operator=(Queue* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
+				// walks the slots or the bits directly, no enumerator is allocated
+				class System_API Iterator
+				{
+				private:
+					ObjectData const* sd;
+					int index;
+					T current;
+				public:
+					Iterator(ObjectData const* sd, int index) : sd(sd), index(index), current() {
+						if (index >= 0)
+							current = sd->GetAt(index);
+					}
 
-			Queue* operator->() {
-				return this;
-			}
+					T const& operator*() const {
+						return current;
+					}
+
+					Iterator& operator++() {
+						index = sd->NextIndex(index + 1);
+						if (index >= 0)
+							current = sd->GetAt(index);
+						return *this;
+					}
 
+					bool operator!=(Iterator const& other) const {
+						return index != other.index;
+					}
 
+					bool operator==(Iterator const& other) const {
+						return index == other.index;
+					}
+				};
 
-					void Enqueue(T const& item) {
-					GOD()->Enqueue(item);
+				/// <summary>Gets the number of elements that are contained in the set.</summary>
+				PropGenGet<int, HashSet<T>, &HashSet<T>::Get_Count> Count{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				HashSet(){}
+
+				HashSet(std::nullptr_t const & n) : System::Object(n) {
 				}
 
-				T Dequeue() {
-					return GOD()->Dequeue();
+				HashSet(HashSet* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
 				}
-			};
 
+				HashSet(HashSet const & other) : System::Object(other) { }
 
+				HashSet(HashSet&& other) noexcept : System::Object(std::move(other)) { }
 
-		}
-	}
+				HashSet(Object::ObjectData* other) : System::Object(other) {
+				}
 
-	System::Collections::Generic::Array<string> String::Split(char const c) {
-		System::Collections::Generic::List<string> lst = new System::Collections::Generic::List<string>();
-		char16_t* rawBytes = ToCharArray();
-		int startpos = 0;
-		for (int i = 0; i < Length; i++) {
-			if (rawBytes[i] == c) {
-				string str(rawBytes + startpos, i - startpos);
-				lst.Add(str);
-				startpos = i + 1;
-			}
-		}
-		string str(rawBytes + startpos, Length - startpos);
-		lst.Add(str);
+				HashSet& operator=(HashSet const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
 
-		return lst.ToArray();
-	}
+				HashSet& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
 
+				HashSet& operator=(HashSet&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
 
-	namespace Dynamic {
+				HashSet& operator=(HashSet* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
 
-		class System_API ExpandoObject : public Object
-		{
-		private:
+				HashSet* operator->() {
+					return this;
+				}
 
 
-		public:
-			class System_API ObjectData : public System::Collections::Generic::Dictionary<string, Object>::ObjectData {
-			public:
 
-			};
-						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				HashSet(int capacity) {
+					this->od = new ObjectData(capacity);
+				}
 
-			ExpandoObject(){}
+				HashSet(int capacity, IEqualityComparer<T> comparer) {
+					this->od = new ObjectData(capacity, comparer);
+				}
 
-			ExpandoObject(std::nullptr_t const & n) : System::Object(n) {
-			}
+				HashSet(IEqualityComparer<T> comparer) {
+					this->od = new ObjectData(0, comparer);
+				}
 
-			ExpandoObject(ExpandoObject* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
+				/// <summary>Creates a set of integers kept in a bitmap covering minValue to maxValue.</summary>
+				template<class U = T, typename std::enable_if<std::is_integral<U>::value, int>::type = 0>
+				HashSet(T minValue, T maxValue) {
+					this->od = new ObjectData(minValue, maxValue);
 				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
+
+				operator IEnumerable<T>() {
+					IEnumerable<T> ret(this->od, static_cast<ObjectData*>(this->od));
+					return ret;
 				}
-				delete pValue;
-			}
 
-			ExpandoObject(ExpandoObject const & other) : System::Object(other) { }
+				/// <summary>Adds the specified element to a set.</summary>
+				/// <returns>true if the element is added to the HashSet&lt;T&gt; object; false if the element is already present.</returns>
+				bool Add(T const& item) const {
+					return GOD()->Add(item);
+				}
 
-			ExpandoObject(ExpandoObject&& other) noexcept : System::Object(std::move(other)) { }
+				/// <summary>Determines whether a HashSet&lt;T&gt; object contains the specified element.</summary>
+				bool Contains(T const& item) const {
+					return GOD()->Contains(item);
+				}
 
-			ExpandoObject(Object::ObjectData* other) : System::Object(other) {
-			}
+				/// <summary>Looks up count values at once.</summary>
+				/// <param name="results">Receives for each value whether the set contains it, can be null.</param>
+				/// <returns>The number of values the set contains.</returns>
+				int Contains(T const* items, int count, bool* results) const {
+					ObjectData* sd = GOD();
+					int ret = 0;
+					for (int i = 0; i < count; i++) {
+						bool found = sd->Contains(items[i]);
+						if (results)
+							results[i] = found;
+						ret += found;
+					}
+					return ret;
+				}
 
-			ExpandoObject& operator=(ExpandoObject const & other) {
-				System::Object::operator=(other);
-				return *this;
-			}
+				/// <summary>Removes the specified element from a HashSet&lt;T&gt; object.</summary>
+				bool Remove(T const& item) const {
+					return GOD()->Remove(item);
+				}
 
-			ExpandoObject& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
+				/// <summary>Removes all elements from a HashSet&lt;T&gt; object.</summary>
+				void Clear() const {
+					GOD()->Clear();
+				}
 
-			ExpandoObject& operator=(ExpandoObject&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
+				/// <summary>Modifies the current HashSet&lt;T&gt; object to contain all elements that are present in itself, the specified collection, or both.</summary>
+				void UnionWith(HashSet<T> const& other) const {
+					if (other == null)
+						throw ArgumentNullException();
+					GOD()->UnionWith(other.GOD());
+				}
 
-			ExpandoObject& operator=(ExpandoObject* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
+				void UnionWith(T const* items, int count) const {
+					ObjectData* sd = GOD();
+					for (int i = 0; i < count; i++)
+						sd->Add(items[i]);
+				}
 
-			ExpandoObject* operator->() {
-				return this;
-			}
+				void UnionWith(IEnumerable<T> const& other) const {
+					IEnumerator<T> it = other.GetEnumerator();
+					typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = it.GetFP_MoveNextGetCurrent();
+					ObjectData* sd = GOD();
+					T* cur;
+					while ((cur = mngc(it.od)) != null)
+						sd->Add(*cur);
+				}
 
+				/// <summary>Modifies the current HashSet&lt;T&gt; object to contain only elements that are present in that object and in the specified collection.</summary>
+				void IntersectWith(HashSet<T> const& other) const {
+					if (other == null)
+						throw ArgumentNullException();
+					GOD()->IntersectWith(other.GOD());
+				}
 
+				void IntersectWith(T const* items, int count) const {
+					HashSet<T> other(count, GOD()->comparer);
+					other.UnionWith(items, count);
+					IntersectWith(other);
+				}
 
-				System::Object& operator[](string const& key)
-			{
-				ObjectData* dd = GOD();
-				System::Object* val = dd->TryGetValue(key);
-				if (val)
-					return *val;
-				int index = dd->Insert(key, System::Object(), true);
-				return dd->entries[index].value;
-			}
-		};
-	}
+				void IntersectWith(IEnumerable<T> const& other) const {
+					HashSet<T> set(0, GOD()->comparer);
+					set.UnionWith(other);
+					IntersectWith(set);
+				}
 
+				/// <summary>Removes all elements in the specified collection from the current HashSet&lt;T&gt; object.</summary>
+				void ExceptWith(HashSet<T> const& other) const {
+					if (other == null)
+						throw ArgumentNullException();
+					GOD()->ExceptWith(other.GOD());
+				}
 
-	namespace Text {
-		class UTF8Encoding;
+				void ExceptWith(T const* items, int count) const {
+					ObjectData* sd = GOD();
+					for (int i = 0; i < count; i++)
+						sd->Remove(items[i]);
+				}
 
-		class System_API Encoding : public Object
-		{
-		private:
+				void ExceptWith(IEnumerable<T> const& other) const {
+					IEnumerator<T> it = other.GetEnumerator();
+					typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = it.GetFP_MoveNextGetCurrent();
+					ObjectData* sd = GOD();
+					T* cur;
+					while ((cur = mngc(it.od)) != null)
+						sd->Remove(*cur);
+				}
 
-		public:
-			//	int tst;
+				IEnumerator<T> GetEnumerator() const { return GOD()->GetEnumerator(); }
 
-			Encoding() {
-				//	tst = 1;
+				Iterator begin() const {
+					return Iterator(GOD(), GOD()->NextIndex(0));
+				}
+				Iterator end() const {
+					return Iterator(GOD(), -1);
+				}
+			};
+
+			template<class T> IEnumerator<T> HashSet<T>::ObjectData::GetEnumerator() const {
+				typename HashSet<T>::Enumerator ret(HashSet<T>(const_cast<ObjectData*>(this)));
+				return ret;
 			}
 
-			static UTF8Encoding UTF8;
+			/// <summary>An element of a SortedDictionary&lt;TKey, TValue&gt;, refers to the key and the value stored in the tree.</summary>
+			template<class TKey, class TValue> struct SortedDictionaryEntry {
+				TKey const& Key;
+				TValue& Value;
+			};
 
-			//virtual byte* GetBytes(String* s) {
-			//	throw NotImplementedException();
-			//}
+			/// <summary>Represents a collection of key/value pairs that are sorted on the key. A B+tree: the pairs are kept in
+			/// leaves of about four cache lines of keys that are linked in key order, so ranges are enumerated without going
+			/// back up the tree. Iterators stay valid until the dictionary is modified.</summary>
+			template<class TKey, class TValue> class System_API SortedDictionary : public Object {
+			private:
+				int Get_Count() const {
+					return this->od ? GOD()->count : 0;
+				}
 
-			virtual System::Collections::Generic::Array<byte> GetBytes(String const& s) {
-				/*std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> convert;
-				auto bs = convert.to_bytes(s.ToCharArray());
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				public:
+					// node sizes, the keys of a node take about 256 bytes (an even number between 8 and 64)
+					enum {
+						Capacity = sizeof(TKey) >= 32 ? 8 : (sizeof(TKey) <= 4 ? 64 : (int)(256 / sizeof(TKey)) & ~1),
+						LeafMin = Capacity / 2,
+						InnerMin = Capacity / 2 - 1
+					};
 
-				byte* bts = new byte[(int)bs.length()];
-				const char* chr = bs.c_str();
-				while (chr) *bts++ = *chr++;
-				return bts;
-				*/
-				//typedef std::codecvt<char16_t, char, mbstate_t> Convert;
-				////std::wstring w = L"\u20ac\u20ab\u20ac";
-				//std::locale locale("en_GB.utf8");
-				//const Convert& convert = std::use_facet<Convert>(locale);
+					struct Node {
+						bool leaf;
+						int count;            // keys in the node
+					};
+
+					struct Leaf : Node {
+						Leaf* prev;
+						Leaf* next;
+						TKey keys[Capacity];
+						TValue values[Capacity];
+					};
+
+					// children[i + 1] holds the keys greater than or equal to keys[i]
+					struct Inner : Node {
+						TKey keys[Capacity];
+						Node* children[Capacity + 1];
+					};
+
+				private:
+					static Leaf* NewLeaf() {
+						Leaf* ret = new Leaf();
+						ret->leaf = true;
+						ret->count = 0;
+						ret->prev = ret->next = null;
+						return ret;
+					}
+
+					static Inner* NewInner() {
+						Inner* ret = new Inner();
+						ret->leaf = false;
+						ret->count = 0;
+						return ret;
+					}
+
+					static void DeleteNode(Node* node) {
+						if (node->leaf)
+							delete static_cast<Leaf*>(node);
+						else
+							delete static_cast<Inner*>(node);
+					}
+
+					static void FreeTree(Node* node) {
+						if (!node->leaf) {
+							Inner* in = static_cast<Inner*>(node);
+							for (int i = 0; i <= in->count; i++)
+								FreeTree(in->children[i]);
+						}
+						DeleteNode(node);
+					}
+
+					// first index whose key is not less than key, branch-free for the default ordering of arithmetic keys
+					int LowerIndex(TKey const* keys, int count, TKey const& key, std::true_type) const {
+						if (!defaultComparer)
+							return LowerIndex(keys, count, key, std::false_type());
+						int ret = 0;
+						for (int i = 0; i < count; i++)
+							ret += keys[i] < key;
+						return ret;
+					}
+
+					int LowerIndex(TKey const* keys, int count, TKey const& key, std::false_type) const {
+						int lo = 0, hi = count;
+						while (lo < hi) {
+							int mid = (lo + hi) >> 1;
+							if (Less(keys[mid], key))
+								lo = mid + 1;
+							else
+								hi = mid;
+						}
+						return lo;
+					}
+
+					// first index whose key is greater than key
+					int UpperIndex(TKey const* keys, int count, TKey const& key, std::true_type) const {
+						if (!defaultComparer)
+							return UpperIndex(keys, count, key, std::false_type());
+						int ret = 0;
+						for (int i = 0; i < count; i++)
+							ret += !(key < keys[i]);
+						return ret;
+					}
+
+					int UpperIndex(TKey const* keys, int count, TKey const& key, std::false_type) const {
+						int lo = 0, hi = count;
+						while (lo < hi) {
+							int mid = (lo + hi) >> 1;
+							if (Less(key, keys[mid]))
+								hi = mid;
+							else
+								lo = mid + 1;
+						}
+						return lo;
+					}
+
+					int LowerIndex(TKey const* keys, int count, TKey const& key) const {
+						return LowerIndex(keys, count, key, std::integral_constant<bool, std::is_arithmetic<TKey>::value>());
+					}
+
+					int UpperIndex(TKey const* keys, int count, TKey const& key) const {
+						return UpperIndex(keys, count, key, std::integral_constant<bool, std::is_arithmetic<TKey>::value>());
+					}
+
+					Leaf* FindLeaf(TKey const& key) const {
+						Node* node = root;
+						while (!node->leaf) {
+							Inner* in = static_cast<Inner*>(node);
+							node = in->children[UpperIndex(in->keys, in->count, key)];
+						}
+						return static_cast<Leaf*>(node);
+					}
+
+					// inserts key unless it is present, slot receives the location of its value;
+					// returns the new right sibling if node was split, separator receives its first key
+					Node* Insert(Node* node, TKey const& key, TValue*& slot, bool& added, TKey& separator) {
+						if (node->leaf) {
+							Leaf* lf = static_cast<Leaf*>(node);
+							int i = LowerIndex(lf->keys, lf->count, key);
+							if (i < lf->count && !Less(key, lf->keys[i])) {
+								slot = &lf->values[i];
+								added = false;
+								return null;
+							}
+							Leaf* right = null;
+							if (lf->count == Capacity) {
+								right = NewLeaf();
+								int half = Capacity / 2;
+								std::move(lf->keys + half, lf->keys + Capacity, right->keys);
+								std::move(lf->values + half, lf->values + Capacity, right->values);
+								right->count = Capacity - half;
+								lf->count = half;
+								ClearSlots(lf, half, Capacity);
+								right->next = lf->next;
+								if (right->next)
+									right->next->prev = right;
+								else
+									last = right;
+								right->prev = lf;
+								lf->next = right;
+								separator = right->keys[0];
+								if (i > half) {
+									lf = right;
+									i -= half;
+								}
+							}
+							std::move_backward(lf->keys + i, lf->keys + lf->count, lf->keys + lf->count + 1);
+							std::move_backward(lf->values + i, lf->values + lf->count, lf->values + lf->count + 1);
+							lf->keys[i] = key;
+							lf->values[i] = TValue();
+							lf->count++;
+							slot = &lf->values[i];
+							added = true;
+							return right;
+						}
+						Inner* in = static_cast<Inner*>(node);
+						int c = UpperIndex(in->keys, in->count, key);
+						TKey childSeparator;
+						Node* child = Insert(in->children[c], key, slot, added, childSeparator);
+						if (!child)
+							return null;
+						Inner* right = null;
+						if (in->count == Capacity) {
+							// the middle key moves up, the pending separator goes to the half it belongs to
+							right = NewInner();
+							int mid = Capacity / 2;
+							separator = std::move(in->keys[mid]);
+							std::move(in->keys + mid + 1, in->keys + Capacity, right->keys);
+							std::copy(in->children + mid + 1, in->children + Capacity + 1, right->children);
+							right->count = Capacity - mid - 1;
+							in->count = mid;
+							for (int i = mid; i < Capacity; i++)
+								in->keys[i] = TKey();
+							if (c > mid) {
+								in = right;
+								c -= mid + 1;
+							}
+						}
+						std::move_backward(in->keys + c, in->keys + in->count, in->keys + in->count + 1);
+						std::copy_backward(in->children + c + 1, in->children + in->count + 1, in->children + in->count + 2);
+						in->keys[c] = std::move(childSeparator);
+						in->children[c + 1] = child;
+						in->count++;
+						return right;
+					}
+
+					// releases what the vacated slots of a leaf refer to
+					static void ClearSlots(Leaf* lf, int from, int to) {
+						for (int i = from; i < to; i++) {
+							lf->keys[i] = TKey();
+							lf->values[i] = TValue();
+						}
+					}
+
+					// child c of parent has too few keys: borrow one from a sibling or merge with it
+					void Rebalance(Inner* parent, int c) {
+						Node* child = parent->children[c];
+						Node* left = c > 0 ? parent->children[c - 1] : null;
+						Node* right = c < parent->count ? parent->children[c + 1] : null;
+						if (child->leaf) {
+							Leaf* lf = static_cast<Leaf*>(child);
+							if (left && left->count > LeafMin) {
+								Leaf* l = static_cast<Leaf*>(left);
+								std::move_backward(lf->keys, lf->keys + lf->count, lf->keys + lf->count + 1);
+								std::move_backward(lf->values, lf->values + lf->count, lf->values + lf->count + 1);
+								lf->keys[0] = std::move(l->keys[l->count - 1]);
+								lf->values[0] = std::move(l->values[l->count - 1]);
+								lf->count++;
+								l->count--;
+								ClearSlots(l, l->count, l->count + 1);
+								parent->keys[c - 1] = lf->keys[0];
+							}
+							else if (right && right->count > LeafMin) {
+								Leaf* r = static_cast<Leaf*>(right);
+								lf->keys[lf->count] = std::move(r->keys[0]);
+								lf->values[lf->count] = std::move(r->values[0]);
+								lf->count++;
+								std::move(r->keys + 1, r->keys + r->count, r->keys);
+								std::move(r->values + 1, r->values + r->count, r->values);
+								r->count--;
+								ClearSlots(r, r->count, r->count + 1);
+								parent->keys[c] = r->keys[0];
+							}
+							else if (left)
+								MergeLeaves(parent, c - 1);
+							else
+								MergeLeaves(parent, c);
+							return;
+						}
+						Inner* in = static_cast<Inner*>(child);
+						if (left && left->count > InnerMin) {
+							Inner* l = static_cast<Inner*>(left);
+							std::move_backward(in->keys, in->keys + in->count, in->keys + in->count + 1);
+							std::copy_backward(in->children, in->children + in->count + 1, in->children + in->count + 2);
+							in->keys[0] = std::move(parent->keys[c - 1]);
+							in->children[0] = l->children[l->count];
+							in->count++;
+							parent->keys[c - 1] = std::move(l->keys[l->count - 1]);
+							l->count--;
+							l->keys[l->count] = TKey();
+						}
+						else if (right && right->count > InnerMin) {
+							Inner* r = static_cast<Inner*>(right);
+							in->keys[in->count] = std::move(parent->keys[c]);
+							in->children[in->count + 1] = r->children[0];
+							in->count++;
+							parent->keys[c] = std::move(r->keys[0]);
+							std::move(r->keys + 1, r->keys + r->count, r->keys);
+							std::copy(r->children + 1, r->children + r->count + 1, r->children);
+							r->count--;
+							r->keys[r->count] = TKey();
+						}
+						else if (left)
+							MergeInners(parent, c - 1);
+						else
+							MergeInners(parent, c);
+					}
+
+					// removes separator s of parent and the child to its right
+					static void RemoveSeparator(Inner* parent, int s) {
+						std::move(parent->keys + s + 1, parent->keys + parent->count, parent->keys + s);
+						std::copy(parent->children + s + 2, parent->children + parent->count + 1, parent->children + s + 1);
+						parent->count--;
+						parent->keys[parent->count] = TKey();
+					}
+
+					// appends child s + 1 of parent to child s
+					void MergeLeaves(Inner* parent, int s) {
+						Leaf* l = static_cast<Leaf*>(parent->children[s]);
+						Leaf* r = static_cast<Leaf*>(parent->children[s + 1]);
+						std::move(r->keys, r->keys + r->count, l->keys + l->count);
+						std::move(r->values, r->values + r->count, l->values + l->count);
+						l->count += r->count;
+						l->next = r->next;
+						if (l->next)
+							l->next->prev = l;
+						else
+							last = l;
+						delete r;
+						RemoveSeparator(parent, s);
+					}
+
+					void MergeInners(Inner* parent, int s) {
+						Inner* l = static_cast<Inner*>(parent->children[s]);
+						Inner* r = static_cast<Inner*>(parent->children[s + 1]);
+						l->keys[l->count] = std::move(parent->keys[s]);
+						std::move(r->keys, r->keys + r->count, l->keys + l->count + 1);
+						std::copy(r->children, r->children + r->count + 1, l->children + l->count + 1);
+						l->count += r->count + 1;
+						delete r;
+						RemoveSeparator(parent, s);
+					}
+
+					bool Remove(Node* node, TKey const& key) {
+						if (node->leaf) {
+							Leaf* lf = static_cast<Leaf*>(node);
+							int i = LowerIndex(lf->keys, lf->count, key);
+							if (i == lf->count || Less(key, lf->keys[i]))
+								return false;
+							std::move(lf->keys + i + 1, lf->keys + lf->count, lf->keys + i);
+							std::move(lf->values + i + 1, lf->values + lf->count, lf->values + i);
+							lf->count--;
+							ClearSlots(lf, lf->count, lf->count + 1);
+							return true;
+						}
+						// a removed key may stay behind as a separator, it still divides the children correctly
+						Inner* in = static_cast<Inner*>(node);
+						int c = UpperIndex(in->keys, in->count, key);
+						if (!Remove(in->children[c], key))
+							return false;
+						Node* child = in->children[c];
+						if (child->count < (child->leaf ? (int)LeafMin : (int)InnerMin))
+							Rebalance(in, c);
+						return true;
+					}
+
+				public:
+					Node* root;
+					Leaf* first;
+					Leaf* last;
+					int count;
+					IComparer<TKey> comparer;
+					bool defaultComparer;
+
+					ObjectData(IComparer<TKey> comparer) : count(0) {
+						first = last = NewLeaf();
+						root = first;
+						defaultComparer = comparer.GOD() == nullptr;
+						this->comparer = comparer;
+					}
+
+					ObjectData() : ObjectData(null) {}
+
+					~ObjectData() override {
+						FreeTree(root);
+					}
+
+					// the default ordering is inlined, no call through IComparer<TKey>
+					bool Less(TKey const& x, TKey const& y) const {
+						return defaultComparer ? x < y : comparer.Compare(x, y) < 0;
+					}
+
+					TValue* Find(TKey const& key) const {
+						Leaf* lf = FindLeaf(key);
+						int i = LowerIndex(lf->keys, lf->count, key);
+						if (i < lf->count && !Less(key, lf->keys[i]))
+							return &lf->values[i];
+						return null;
+					}
+
+					// returns the location of the value of key, added tells whether key was inserted with a default value
+					TValue* Insert(TKey const& key, bool& added) {
+						TValue* slot;
+						TKey separator;
+						Node* right = Insert(root, key, slot, added, separator);
+						if (right) {
+							Inner* in = NewInner();
+							in->keys[0] = std::move(separator);
+							in->children[0] = root;
+							in->children[1] = right;
+							in->count = 1;
+							root = in;
+						}
+						if (added)
+							count++;
+						return slot;
+					}
+
+					bool Remove(TKey const& key) {
+						if (!Remove(root, key))
+							return false;
+						count--;
+						if (!root->leaf && root->count == 0) {
+							Inner* in = static_cast<Inner*>(root);
+							root = in->children[0];
+							delete in;
+						}
+						return true;
+					}
+
+					void Clear() {
+						FreeTree(root);
+						first = last = NewLeaf();
+						root = first;
+						count = 0;
+					}
+
+					// position of the first key not less than key (upper false) or greater than key (upper true);
+					// the leaf is null at the end
+					void Bound(TKey const& key, bool upper, Leaf*& leaf, int& index) const {
+						leaf = FindLeaf(key);
+						index = upper ? UpperIndex(leaf->keys, leaf->count, key) : LowerIndex(leaf->keys, leaf->count, key);
+						if (index == leaf->count) {
+							leaf = leaf->next;
+							index = 0;
+						}
+					}
+
+					// builds the tree bottom up in O(n), every node gets an even share of its level
+					void BulkLoad(TKey const* keys, TValue const* values, int n) {
+						if (n < 0)
+							throw ArgumentOutOfRangeException();
+						for (int i = 1; i < n; i++) {
+							if (!Less(keys[i - 1], keys[i]))
+								throw Exception(); // not sorted, or a duplicate key
+						}
+						Clear();
+						if (!n)
+							return;
+						std::vector<Node*> level;
+						std::vector<TKey> lowest; // smallest key under each node of the level
+						int leaves = (n + Capacity - 1) / Capacity;
+						level.reserve((size_t)leaves);
+						lowest.reserve((size_t)leaves);
+						Leaf* prev = null;
+						for (int l = 0, pos = 0; l < leaves; l++) {
+							Leaf* lf = l ? NewLeaf() : first;
+							int take = n / leaves + (l < n % leaves);
+							std::copy(keys + pos, keys + pos + take, lf->keys);
+							std::copy(values + pos, values + pos + take, lf->values);
+							lf->count = take;
+							pos += take;
+							lf->prev = prev;
+							if (prev)
+								prev->next = lf;
+							prev = lf;
+							level.push_back(lf);
+							lowest.push_back(lf->keys[0]);
+						}
+						last = prev;
+						while (level.size() > 1) {
+							int nodes = (int)level.size();
+							int parents = (nodes + Capacity) / (Capacity + 1);
+							std::vector<Node*> up;
+							std::vector<TKey> uplowest;
+							up.reserve((size_t)parents);
+							uplowest.reserve((size_t)parents);
+							for (int p = 0, pos = 0; p < parents; p++) {
+								Inner* in = NewInner();
+								int take = nodes / parents + (p < nodes % parents);
+								for (int i = 0; i < take; i++) {
+									in->children[i] = level[(size_t)(pos + i)];
+									if (i)
+										in->keys[i - 1] = std::move(lowest[(size_t)(pos + i)]);
+								}
+								in->count = take - 1;
+								up.push_back(in);
+								uplowest.push_back(std::move(lowest[(size_t)pos]));
+								pos += take;
+							}
+							level.swap(up);
+							lowest.swap(uplowest);
+						}
+						root = level[0];
+						count = n;
+					}
+				};
+
+				/// <summary>Walks the leaves in key order.</summary>
+				class System_API Iterator
+				{
+				private:
+					typename ObjectData::Leaf* leaf;
+					int index;
+				public:
+					Iterator(typename ObjectData::Leaf* leaf, int index) : leaf(leaf), index(index) {
+						// only an empty tree has an empty leaf
+						if (leaf && index >= leaf->count) {
+							this->leaf = null;
+							this->index = 0;
+						}
+					}
+
+					SortedDictionaryEntry<TKey, TValue> operator*() const {
+						return SortedDictionaryEntry<TKey, TValue>{ leaf->keys[index], leaf->values[index] };
+					}
+
+					TKey const& Key() const {
+						return leaf->keys[index];
+					}
+
+					TValue& Value() const {
+						return leaf->values[index];
+					}
+
+					Iterator& operator++() {
+						if (++index == leaf->count) {
+							leaf = leaf->next;
+							index = 0;
+						}
+						return *this;
+					}
+
+					bool operator!=(Iterator const& other) const {
+						return leaf != other.leaf || index != other.index;
+					}
+
+					bool operator==(Iterator const& other) const {
+						return leaf == other.leaf && index == other.index;
+					}
+				};
+
+				/// <summary>The elements between two iterators, for range-based for.</summary>
+				class System_API RangeView
+				{
+				private:
+					Iterator first;
+					Iterator last;
+				public:
+					RangeView(Iterator const& first, Iterator const& last) : first(first), last(last) {}
+
+					Iterator begin() const {
+						return first;
+					}
+
+					Iterator end() const {
+						return last;
+					}
+				};
+
+				/// <summary>Gets the number of key/value pairs contained in the SortedDictionary&lt;TKey, TValue&gt;.</summary>
+				PropGenGet<int, SortedDictionary<TKey, TValue>, &SortedDictionary<TKey, TValue>::Get_Count> Count{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				SortedDictionary(){}
+
+				SortedDictionary(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				SortedDictionary(SortedDictionary* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				SortedDictionary(SortedDictionary const & other) : System::Object(other) { }
+
+				SortedDictionary(SortedDictionary&& other) noexcept : System::Object(std::move(other)) { }
+
+				SortedDictionary(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				SortedDictionary& operator=(SortedDictionary const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				SortedDictionary& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				SortedDictionary& operator=(SortedDictionary&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				SortedDictionary& operator=(SortedDictionary* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				SortedDictionary* operator->() {
+					return this;
+				}
+
+
+
+				SortedDictionary(IComparer<TKey> comparer) {
+					this->od = new ObjectData(comparer);
+				}
+
+				/// <summary>Adds an element with the specified key and value, throws if the key is already present.</summary>
+				void Add(TKey const& key, TValue const& value) const {
+					bool added;
+					TValue* slot = GOD()->Insert(key, added);
+					if (!added)
+						throw Exception();
+					*slot = value;
+				}
+
+				/// <summary>Gets the value associated with the specified key.</summary>
+				/// <returns>true if the SortedDictionary&lt;TKey, TValue&gt; contains an element with the specified key.</returns>
+				bool TryGetValue(TKey const& key, TValue& value) const {
+					TValue* ptr = GOD()->Find(key);
+					if (!ptr)
+						return false;
+					value = *ptr;
+					return true;
+				}
+
+				/// <summary>Determines whether the SortedDictionary&lt;TKey, TValue&gt; contains an element with the specified key.</summary>
+				bool ContainsKey(TKey const& key) const {
+					return GOD()->Find(key) != null;
+				}
+
+				/// <summary>Removes the element with the specified key.</summary>
+				bool Remove(TKey const& key) const {
+					return GOD()->Remove(key);
+				}
+
+				/// <summary>Removes all elements.</summary>
+				void Clear() const {
+					GOD()->Clear();
+				}
+
+				/// <summary>Gets the value of key, a missing key is added with a default value.</summary>
+				TValue& operator[](TKey const& key) const {
+					bool added;
+					return *GOD()->Insert(key, added);
+				}
+
+				/// <summary>Replaces the contents with count elements whose keys are sorted in ascending order, in O(count).
+				/// Throws if the keys are not strictly ascending.</summary>
+				void BulkLoad(TKey const* keys, TValue const* values, int count) const {
+					GOD()->BulkLoad(keys, values, count);
+				}
+
+				void BulkLoad(Array<TKey> const& keys, Array<TValue> const& values) const {
+					if (keys == null || values == null)
+						throw ArgumentNullException();
+					if (keys.GOD()->Length != values.GOD()->Length)
+						throw ArgumentOutOfRangeException();
+					GOD()->BulkLoad(keys.GOD()->arrdta, values.GOD()->arrdta, (int)keys.GOD()->Length);
+				}
+
+				/// <summary>Position of the first element whose key is not less than key.</summary>
+				Iterator LowerBound(TKey const& key) const {
+					typename ObjectData::Leaf* leaf;
+					int index;
+					GOD()->Bound(key, false, leaf, index);
+					return Iterator(leaf, index);
+				}
+
+				/// <summary>Position of the first element whose key is greater than key.</summary>
+				Iterator UpperBound(TKey const& key) const {
+					typename ObjectData::Leaf* leaf;
+					int index;
+					GOD()->Bound(key, true, leaf, index);
+					return Iterator(leaf, index);
+				}
+
+				/// <summary>The elements whose keys are between from and to, both included, in key order.</summary>
+				RangeView Range(TKey const& from, TKey const& to) const {
+					if (GOD()->Less(to, from))
+						return RangeView(end(), end());
+					return RangeView(LowerBound(from), UpperBound(to));
+				}
+
+				Iterator begin() const {
+					return Iterator(GOD()->first, 0);
+				}
+				Iterator end() const {
+					return Iterator(null, 0);
+				}
+			};
+
+			template<class T> class System_API Stack : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->Get_Count();
+				}
+
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					T* _array;
+					int _size;
+					int _capacity;
+					static const int _defaultCapacity = 4;
+
+					void SetCapacity(int newCapacity) {
+						T* newArray = (T*) ::operator new((size_t)newCapacity * sizeof(T));
+						if (_array) {
+							if (std::is_trivially_copyable<T>::value) {
+								if (_size > 0)
+									std::memcpy((void*)newArray, (void const*)_array, (size_t)_size * sizeof(T));
+							}
+							else {
+								for (int i = 0; i < _size; i++) {
+									new (&newArray[i]) T(std::move(_array[i]));
+									_array[i].~T();
+								}
+							}
+							::operator delete(_array);
+						}
+						_array = newArray;
+						_capacity = newCapacity;
+					}
+
+					// a range out of the stack's own buffer is copied before the buffer grows
+					void PushFromSelf(T const* items, int count) {
+						T* copy = (T*) ::operator new((size_t)count * sizeof(T));
+						for (int i = 0; i < count; i++)
+							new (&copy[i]) T(items[i]);
+						EnsureCapacity(_size + count);
+						for (int i = 0; i < count; i++) {
+							new (&_array[_size + i]) T(std::move(copy[i]));
+							copy[i].~T();
+						}
+						_size += count;
+						::operator delete(copy);
+					}
+
+				public:
+
+					int Get_Count() const {
+						return _size;
+					}
+
+					ObjectData(int capacity) : _array(nullptr), _size(0), _capacity(0) {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity > 0)
+							SetCapacity(capacity);
+					}
+
+					ObjectData() : ObjectData(0) {
+					}
+
+					~ObjectData() override {
+						Clear();
+						if (_array)
+							::operator delete(_array);
+					}
+
+					// keeps the buffer, like List<T>::Clear
+					void Clear() {
+						if (!std::is_trivially_destructible<T>::value) {
+							for (int i = 0; i < _size; i++)
+								_array[i].~T();
+						}
+						_size = 0;
+					}
+
+					int EnsureCapacity(int min) {
+						if (min < 0)
+							throw ArgumentOutOfRangeException();
+						if (_capacity < min) {
+							int newCapacity = _capacity ? (_capacity < INT32_MAX / 2 ? _capacity << 1 : INT32_MAX) : _defaultCapacity;
+							SetCapacity(newCapacity < min ? min : newCapacity);
+						}
+						return _capacity;
+					}
+
+					void Push(T const& item) {
+						if (_size == _capacity) {
+							// item may live in the buffer that is about to move
+							T copy(item);
+							EnsureCapacity(_size + 1);
+							new (_array + _size++) T(std::move(copy));
+							return;
+						}
+						new (_array + _size++) T(item);
+					}
+
+					void Push(T&& item) {
+						if (_size == _capacity)
+							EnsureCapacity(_size + 1);
+						new (_array + _size++) T(std::move(item));
+					}
+
+					void PushRange(T const* items, int count) {
+						if (count < 0)
+							throw ArgumentOutOfRangeException();
+						if (_size + count > _capacity) {
+							if (items >= _array && items < _array + _size) {
+								PushFromSelf(items, count);
+								return;
+							}
+							EnsureCapacity(_size + count);
+						}
+						if (std::is_trivially_copyable<T>::value) {
+							if (count > 0)
+								std::memcpy((void*)(_array + _size), (void const*)items, (size_t)count * sizeof(T));
+						}
+						else {
+							for (int i = 0; i < count; i++)
+								new (&_array[_size + i]) T(items[i]);
+						}
+						_size += count;
+					}
+
+					T Pop() {
+						if (_size == 0) {
+							throw InvalidOperationException();
+						}
+						T ret = std::move(_array[--_size]);
+						_array[_size].~T();
+
+						return ret;
+					}
+
+					bool TryPop(T& result) {
+						if (_size == 0)
+							return false;
+						result = std::move(_array[--_size]);
+						_array[_size].~T();
+						return true;
+					}
+
+					// moves up to count elements to destination, the top of the stack first
+					int PopRange(T* destination, int count) {
+						if (count < 0)
+							throw ArgumentOutOfRangeException();
+						int n = count < _size ? count : _size;
+						for (int i = 0; i < n; i++) {
+							T* slot = &_array[--_size];
+							destination[i] = std::move(*slot);
+							slot->~T();
+						}
+						return n;
+					}
+
+					T* Peek() const {
+						return _size ? &_array[_size - 1] : nullptr;
+					}
+				};
+
+				PropGenGet<int, Stack<T>, &Stack<T>::Get_Count> Count{ this };
+
+							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			Stack(){}
+
+			Stack(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			Stack(Stack* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			Stack(Stack const & other) : System::Object(other) { }
+
+			Stack(Stack&& other) noexcept : System::Object(std::move(other)) { }
+
+			Stack(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			Stack& operator=(Stack const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			Stack& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			Stack& operator=(Stack&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			Stack& operator=(Stack* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			Stack* operator->() {
+				return this;
+			}
+
+
+
+				Stack(int capacity) {
+					this->od = new ObjectData(capacity);
+				}
+
+				/// <summary>Inserts an object at the top of the Stack&lt;T&gt;.</summary>
+				void Push(T const& item) {
+					GOD()->Push(item);
+				}
+
+				void Push(T&& item) {
+					GOD()->Push(std::move(item));
+				}
+
+				/// <summary>Pushes count objects, the last one ends up on top.</summary>
+				void PushRange(T const* items, int count) {
+					GOD()->PushRange(items, count);
+				}
+
+				void PushRange(Array<T> const& items) {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->PushRange(items.GOD()->arrdta, (int)items.GOD()->Length);
+				}
+
+				/// <summary>Removes and returns the object at the top of the Stack&lt;T&gt;.</summary>
+				T Pop() {
+					return GOD()->Pop();
+				}
+
+				bool TryPop(T& result) {
+					return GOD()->TryPop(result);
+				}
+
+				/// <summary>Pops up to count objects into destination, the top first.</summary>
+				/// <returns>The number of objects popped.</returns>
+				int PopRange(T* destination, int count) {
+					return GOD()->PopRange(destination, count);
+				}
+
+				/// <summary>Returns the object at the top of the Stack&lt;T&gt; without removing it.</summary>
+				T Peek() const {
+					T* ret = GOD()->Peek();
+					if (!ret)
+						throw InvalidOperationException();
+					return *ret;
+				}
+
+				bool TryPeek(T& result) const {
+					T* ret = GOD()->Peek();
+					if (!ret)
+						return false;
+					result = *ret;
+					return true;
+				}
+
+				/// <summary>Ensures that the capacity of this Stack is at least the specified capacity.</summary>
+				/// <returns>The new capacity.</returns>
+				int EnsureCapacity(int capacity) {
+					return GOD()->EnsureCapacity(capacity);
+				}
+
+				/// <summary>Removes all objects from the Stack&lt;T&gt;, the buffer is kept.</summary>
+				void Clear() {
+					GOD()->Clear();
+				}
+			};
+
+
+			template<class T> class System_API Queue : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->Count;
+				}
+
+			public:
+
+				// Circular buffer with a power of two capacity, the elements are stored inline.
+				// Growing relocates the elements to the start of a buffer twice as large.
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					T* buffer;
+					int capacity;
+					int head;
+
+					T* Slot(int i) const {
+						return buffer + ((head + i) & (capacity - 1));
+					}
+
+					void Grow(int min) {
+						int newCapacity = capacity ? capacity : 4;
+						while (newCapacity < min) {
+							if (newCapacity > INT32_MAX / 2)
+								throw OutOfMemoryException();
+							newCapacity <<= 1;
+						}
+						if (newCapacity == capacity)
+							return;
+						T* newBuffer = (T*) ::operator new((size_t)newCapacity * sizeof(T));
+						if (buffer) {
+							// the occupied part wraps at most once: head to the end, then the start
+							int first = capacity - head < Count ? capacity - head : Count;
+							Relocate(newBuffer, buffer + head, first);
+							Relocate(newBuffer + first, buffer, Count - first);
+							::operator delete(buffer);
+						}
+						buffer = newBuffer;
+						capacity = newCapacity;
+						head = 0;
+					}
+
+					static void Relocate(T* dst, T* src, int count) {
+						if (count <= 0)
+							return;
+						if (std::is_trivially_copyable<T>::value)
+							std::memcpy((void*)dst, (void const*)src, (size_t)count * sizeof(T));
+						else {
+							for (int i = 0; i < count; i++) {
+								new (&dst[i]) T(std::move(src[i]));
+								src[i].~T();
+							}
+						}
+					}
+
+				public:
+					int Count = 0;
+
+					ObjectData() : buffer(null), capacity(0), head(0) {
+					}
+
+					ObjectData(int capacity) : ObjectData() {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity > 0)
+							Grow(capacity);
+					}
+
+					~ObjectData() override {
+						Clear();
+						if (buffer)
+							::operator delete(buffer);
+					}
+
+					void Enqueue(T const & item) {
+						if (Count == capacity)
+							Grow(Count + 1);
+						new (Slot(Count)) T(item);
+						++Count;
+					}
+
+					void Enqueue(T&& item) {
+						if (Count == capacity)
+							Grow(Count + 1);
+						new (Slot(Count)) T(std::move(item));
+						++Count;
+					}
+
+					void EnqueueRange(T const* items, int count) {
+						if (count < 0)
+							throw ArgumentOutOfRangeException();
+						if (Count + count > capacity)
+							Grow(Count + count);
+						for (int i = 0; i < count; i++)
+							new (Slot(Count + i)) T(items[i]);
+						Count += count;
+					}
+
+					bool TryDequeue(T& result) {
+						if (Count == 0)
+							return false;
+						T* slot = buffer + head;
+						result = std::move(*slot);
+						slot->~T();
+						head = (head + 1) & (capacity - 1);
+						--Count;
+						return true;
+					}
+
+					T Dequeue() {
+						if (Count == 0)
+							throw InvalidOperationException();
+						T* slot = buffer + head;
+						T ret = std::move(*slot);
+						slot->~T();
+						head = (head + 1) & (capacity - 1);
+						--Count;
+						return ret;
+					}
+
+					// moves up to count elements to destination, returns how many
+					int DequeueRange(T* destination, int count) {
+						if (count < 0)
+							throw ArgumentOutOfRangeException();
+						int n = count < Count ? count : Count;
+						for (int i = 0; i < n; i++) {
+							T* slot = Slot(i);
+							destination[i] = std::move(*slot);
+							slot->~T();
+						}
+						head = (head + n) & (capacity - 1);
+						Count -= n;
+						return n;
+					}
+
+					T* Peek() const {
+						return Count ? buffer + head : null;
+					}
+
+					void Clear() {
+						if (!std::is_trivially_destructible<T>::value) {
+							for (int i = 0; i < Count; i++)
+								Slot(i)->~T();
+						}
+						head = 0;
+						Count = 0;
+					}
+
+					void TrimExcess() {
+						int newCapacity = 4;
+						while (newCapacity < Count)
+							newCapacity <<= 1;
+						if (newCapacity >= capacity)
+							return;
+						T* newBuffer = (T*) ::operator new((size_t)newCapacity * sizeof(T));
+						int first = capacity - head < Count ? capacity - head : Count;
+						Relocate(newBuffer, buffer + head, first);
+						Relocate(newBuffer + first, buffer, Count - first);
+						::operator delete(buffer);
+						buffer = newBuffer;
+						capacity = newCapacity;
+						head = 0;
+					}
+				};
+
+				PropGenGet<int, Queue<T>, &Queue<T>::Get_Count> Count{ this };
+
+							ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			Queue(){}
+
+			Queue(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			Queue(Queue* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			Queue(Queue const & other) : System::Object(other) { }
+
+			Queue(Queue&& other) noexcept : System::Object(std::move(other)) { }
+
+			Queue(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			Queue& operator=(Queue const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			Queue& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			Queue& operator=(Queue&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			Queue& operator=(Queue* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			Queue* operator->() {
+				return this;
+			}
+
+
+
+				Queue(int capacity) {
+					this->od = new ObjectData(capacity);
+				}
+
+				/// <summary>Adds an object to the end of the Queue&lt;T&gt;.</summary>
+				void Enqueue(T const& item) {
+					GOD()->Enqueue(item);
+				}
+
+				void Enqueue(T&& item) {
+					GOD()->Enqueue(std::move(item));
+				}
+
+				/// <summary>Adds count elements to the end of the Queue&lt;T&gt;, growing the buffer at most once.</summary>
+				void EnqueueRange(T const* items, int count) {
+					GOD()->EnqueueRange(items, count);
+				}
+
+				void EnqueueRange(Array<T> const& items) {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->EnqueueRange(items.GOD()->arrdta, (int)items.GOD()->Length);
+				}
+
+				void EnqueueRange(List<T> const& items) {
+					if (items == null)
+						throw ArgumentNullException();
+					GOD()->EnqueueRange(items.GOD()->arrdta, items.GOD()->Count);
+				}
+
+				/// <summary>Removes and returns the object at the beginning of the Queue&lt;T&gt;.</summary>
+				T Dequeue() {
+					return GOD()->Dequeue();
+				}
+
+				bool TryDequeue(T& result) {
+					return GOD()->TryDequeue(result);
+				}
+
+				/// <summary>Removes up to count objects from the beginning of the Queue&lt;T&gt; into destination.</summary>
+				/// <returns>The number of objects removed.</returns>
+				int DequeueRange(T* destination, int count) {
+					return GOD()->DequeueRange(destination, count);
+				}
+
+				/// <summary>Returns the object at the beginning of the Queue&lt;T&gt; without removing it.</summary>
+				T Peek() const {
+					T* ret = GOD()->Peek();
+					if (!ret)
+						throw InvalidOperationException();
+					return *ret;
+				}
+
+				bool TryPeek(T& result) const {
+					T* ret = GOD()->Peek();
+					if (!ret)
+						return false;
+					result = *ret;
+					return true;
+				}
+
+				/// <summary>Removes all objects from the Queue&lt;T&gt;.</summary>
+				void Clear() {
+					GOD()->Clear();
+				}
+
+				/// <summary>Shrinks the buffer to the smallest power of two that holds the elements.</summary>
+				void TrimExcess() {
+					GOD()->TrimExcess();
+				}
+			};
+
+			/// <summary>Represents a collection of items that have a value and a priority. On dequeue, the item with the lowest priority value is removed.
+			/// A 4-ary min-heap: the four children of a node are adjacent, so a sift down compares one cache line of priorities per level.
+			/// The priorities are kept apart from the elements for the same reason.
+			/// Constructed updatable, Enqueue returns a handle whose priority UpdatePriority changes later (decrease/increase-key).
+			/// A handle carries the generation of its slot, so it goes stale once its item leaves the queue even if the slot is reused.
+			/// With a MaxCount the queue keeps the MaxCount items with the highest priorities (top-K): once full, an item
+			/// that does not beat the lowest priority is dropped without touching the heap.</summary>
+			template<class TElement, class TPriority> class System_API PriorityQueue : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->count;
+				}
+
+				int& Get_MaxCount() const {
+					return GOD()->maxCount;
+				}
+
+				void Set_MaxCount(int const& value) {
+					GOD()->SetMaxCount(value);
+				}
+
+				void Set_MaxCount(int&& value) {
+					GOD()->SetMaxCount(value);
+				}
+
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					static const int Arity = 4;
+
+					void Grow(int min) {
+						int newCapacity = capacity ? capacity * 2 : 4;
+						if (newCapacity < min)
+							newCapacity = min;
+						if (maxCount && newCapacity > maxCount && min <= maxCount)
+							newCapacity = maxCount;
+						TElement* newElements = new TElement[(size_t)newCapacity];
+						TPriority* newPriorities = new TPriority[(size_t)newCapacity];
+						for (int i = 0; i < count; i++) {
+							newElements[i] = std::move(elements[i]);
+							newPriorities[i] = std::move(priorities[i]);
+						}
+						if (elements) {
+							delete[] elements;
+							delete[] priorities;
+						}
+						elements = newElements;
+						priorities = newPriorities;
+						if (updatable) {
+							int* newHandles = new int[(size_t)newCapacity];
+							int* newPositions = new int[(size_t)newCapacity];
+							int* newGenerations = new int[(size_t)newCapacity]();
+							std::copy(handles, handles + count, newHandles);
+							std::copy(positions, positions + capacity, newPositions);
+							std::copy(generations, generations + capacity, newGenerations);
+							if (handles) {
+								delete[] handles;
+								delete[] positions;
+								delete[] generations;
+							}
+							handles = newHandles;
+							positions = newPositions;
+							generations = newGenerations;
+							for (int i = newCapacity - 1; i >= capacity; i--)
+								FreeHandle(i);
+						}
+						capacity = newCapacity;
+					}
+
+					// moves node from to position to, the hole at from is filled by the caller
+					void MoveNode(int to, int from) {
+						elements[to] = std::move(elements[from]);
+						priorities[to] = std::move(priorities[from]);
+						if (updatable) {
+							handles[to] = handles[from];
+							positions[handles[to]] = to;
+						}
+					}
+
+					void Place(int index, TElement&& element, TPriority&& priority, int handle) {
+						elements[index] = std::move(element);
+						priorities[index] = std::move(priority);
+						if (updatable) {
+							handles[index] = handle;
+							positions[handle] = index;
+						}
+					}
+
+					// the node at index becomes element/priority, it moves up while its parent is greater
+					void SiftUp(int index, TElement&& element, TPriority&& priority, int handle) {
+						while (index > 0) {
+							int parent = (index - 1) / Arity;
+							if (!Less(priority, priorities[parent]))
+								break;
+							MoveNode(index, parent);
+							index = parent;
+						}
+						Place(index, std::move(element), std::move(priority), handle);
+					}
+
+					// the node at index becomes element/priority, it moves down while a child is smaller
+					void SiftDown(int index, TElement&& element, TPriority&& priority, int handle) {
+						for (;;) {
+							int first = index * Arity + 1;
+							if (first >= count)
+								break;
+							int last = first + Arity < count ? first + Arity : count;
+							int best = first;
+							for (int c = first + 1; c < last; c++) {
+								if (Less(priorities[c], priorities[best]))
+									best = c;
+							}
+							if (!Less(priorities[best], priority))
+								break;
+							MoveNode(index, best);
+							index = best;
+						}
+						Place(index, std::move(element), std::move(priority), handle);
+					}
+
+					// restores the heap over the whole array, bottom up in O(n)
+					void Heapify() {
+						if (count < 2)
+							return;
+						for (int i = (count - 2) / Arity; i >= 0; i--) {
+							TElement element = std::move(elements[i]);
+							TPriority priority = std::move(priorities[i]);
+							SiftDown(i, std::move(element), std::move(priority), updatable ? handles[i] : -1);
+						}
+					}
+
+					// there is a handle for every slot of the arrays, the unused ones are linked through positions
+					int NewHandle() {
+						if (!updatable)
+							return -1;
+						int ret = freeHandle;
+						freeHandle = -2 - positions[ret];
+						return ret;
+					}
+
+					// a freed slot gets a new generation, the handles given out for it before no longer match
+					void FreeHandle(int handle) {
+						positions[handle] = -2 - freeHandle;
+						generations[handle] = (generations[handle] + 1) & INT32_MAX;
+						freeHandle = handle;
+					}
+
+					// the public handle: the generation of the slot in the high half, the slot in the low half
+					long HandleOf(int handle) const {
+						return handle < 0 ? -1 : ((long)generations[handle] << 32) | handle;
+					}
+
+					// the slot of a handle of an item still in the queue, otherwise -1
+					int SlotOf(long handle) const {
+						if (!updatable || handle < 0)
+							return -1;
+						int slot = (int)(handle & INT32_MAX);
+						if (slot >= capacity || positions[slot] < 0 || HandleOf(slot) != handle)
+							return -1;
+						return slot;
+					}
+
+					// appends without restoring the heap
+					long Append(TElement const& element, TPriority const& priority) {
+						if (count == capacity)
+							Grow(count + 1);
+						int handle = NewHandle();
+						elements[count] = element;
+						priorities[count] = priority;
+						if (updatable) {
+							handles[count] = handle;
+							positions[handle] = count;
+						}
+						count++;
+						return HandleOf(handle);
+					}
+
+					void RemoveRoot() {
+						if (updatable)
+							FreeHandle(handles[0]);
+						count--;
+						if (count > 0) {
+							TElement element = std::move(elements[count]);
+							TPriority priority = std::move(priorities[count]);
+							int handle = updatable ? handles[count] : -1;
+							elements[count] = TElement();
+							priorities[count] = TPriority();
+							SiftDown(0, std::move(element), std::move(priority), handle);
+						}
+						else {
+							elements[0] = TElement();
+							priorities[0] = TPriority();
+						}
+					}
+
+				public:
+					TElement* elements;
+					TPriority* priorities;
+					int* handles;         // handle of each heap node
+					int* positions;       // heap position of each handle, a free handle holds -2 - the next free one
+					int* generations;     // generation of each handle, bumped when it is freed
+					int freeHandle;
+					int count;
+					int capacity;
+					int maxCount;
+					bool updatable;
+					IComparer<TPriority> comparer;
+					bool defaultComparer;
+
+					ObjectData(int capacity, bool updatable, IComparer<TPriority> comparer) : elements(null), priorities(null), handles(null), positions(null), generations(null), freeHandle(-1), count(0), capacity(0), maxCount(0), updatable(updatable) {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						defaultComparer = comparer.GOD() == nullptr;
+						this->comparer = comparer;
+						if (capacity > 0)
+							Grow(capacity);
+					}
+
+					ObjectData() : ObjectData(0, false, null) {}
+
+					~ObjectData() override {
+						if (elements) {
+							delete[] elements;
+							delete[] priorities;
+						}
+						if (handles) {
+							delete[] handles;
+							delete[] positions;
+							delete[] generations;
+						}
+					}
+
+					// the default ordering is inlined, no call through IComparer<TPriority>
+					bool Less(TPriority const& x, TPriority const& y) const {
+						return defaultComparer ? x < y : comparer.Compare(x, y) < 0;
+					}
+
+					void SetMaxCount(int value) {
+						if (value < 0)
+							throw ArgumentOutOfRangeException();
+						maxCount = value;
+						while (maxCount && count > maxCount)
+							RemoveRoot();
+					}
+
+					// -1 if the item is dropped (bounded and not among the top) or the queue is not updatable
+					long Enqueue(TElement const& element, TPriority const& priority) {
+						if (maxCount && count == maxCount) {
+							if (!Less(priorities[0], priority))
+								return -1;
+							int handle = -1;
+							if (updatable) {
+								FreeHandle(handles[0]);
+								handle = NewHandle();
+							}
+							SiftDown(0, TElement(element), TPriority(priority), handle);
+							return HandleOf(handle);
+						}
+						if (count == capacity)
+							Grow(count + 1);
+						int handle = NewHandle();
+						count++;
+						SiftUp(count - 1, TElement(element), TPriority(priority), handle);
+						return HandleOf(handle);
+					}
+
+					void EnqueueRange(TElement const* items, TPriority const* itemPriorities, int n) {
+						if (n < 0)
+							throw ArgumentOutOfRangeException();
+						int i = 0;
+						// a batch that is large compared to the heap is appended and the heap is rebuilt once
+						if (n >= count) {
+							int room = maxCount ? maxCount - count : n;
+							int take = n < room ? n : room;
+							if (count + take > capacity)
+								Grow(count + take);
+							for (; i < take; i++)
+								Append(items[i], itemPriorities[i]);
+							Heapify();
+						}
+						for (; i < n; i++)
+							Enqueue(items[i], itemPriorities[i]);
+					}
+
+					TElement Dequeue(TPriority* priority) {
+						if (!count)
+							throw InvalidOperationException();
+						TElement ret = std::move(elements[0]);
+						if (priority)
+							*priority = std::move(priorities[0]);
+						RemoveRoot();
+						return ret;
+					}
+
+					// same as Enqueue followed by Dequeue, but the item is returned right away when it would be the minimum
+					TElement EnqueueDequeue(TElement const& element, TPriority const& priority) {
+						if (!count || !Less(priorities[0], priority))
+							return element;
+						TElement ret = std::move(elements[0]);
+						int handle = -1;
+						if (updatable) {
+							FreeHandle(handles[0]);
+							handle = NewHandle();
+						}
+						SiftDown(0, TElement(element), TPriority(priority), handle);
+						return ret;
+					}
+
+					// same as Dequeue followed by Enqueue, with a single sift
+					TElement DequeueEnqueue(TElement const& element, TPriority const& priority) {
+						if (!count)
+							throw InvalidOperationException();
+						TElement ret = std::move(elements[0]);
+						int handle = -1;
+						if (updatable) {
+							FreeHandle(handles[0]);
+							handle = NewHandle();
+						}
+						SiftDown(0, TElement(element), TPriority(priority), handle);
+						return ret;
+					}
+
+					void UpdatePriority(long handle, TPriority const& priority) {
+						int slot = SlotOf(handle);
+						if (slot < 0)
+							throw ArgumentOutOfRangeException();
+						int index = positions[slot];
+						TElement element = std::move(elements[index]);
+						bool up = Less(priority, priorities[index]);
+						if (up)
+							SiftUp(index, std::move(element), TPriority(priority), slot);
+						else
+							SiftDown(index, std::move(element), TPriority(priority), slot);
+					}
+
+					bool Contains(long handle) const {
+						return SlotOf(handle) >= 0;
+					}
+
+					void Clear() {
+						for (int i = 0; i < count; i++) {
+							elements[i] = TElement();
+							priorities[i] = TPriority();
+						}
+						if (updatable) {
+							freeHandle = -1;
+							for (int i = capacity - 1; i >= 0; i--)
+								FreeHandle(i);
+						}
+						count = 0;
+					}
+				};
+
+				/// <summary>Gets the number of elements contained in the PriorityQueue&lt;TElement, TPriority&gt;.</summary>
+				PropGenGet<int, PriorityQueue<TElement, TPriority>, &PriorityQueue<TElement, TPriority>::Get_Count> Count{ this };
+
+				/// <summary>Gets or sets the maximum number of items kept, 0 for no limit. Lowering it dequeues the surplus.</summary>
+				PropGen<int, int, PriorityQueue<TElement, TPriority>, &PriorityQueue<TElement, TPriority>::Get_MaxCount, &PriorityQueue<TElement, TPriority>::Set_MaxCount, &PriorityQueue<TElement, TPriority>::Set_MaxCount> MaxCount{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				PriorityQueue(){}
+
+				PriorityQueue(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				PriorityQueue(PriorityQueue* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				PriorityQueue(PriorityQueue const & other) : System::Object(other) { }
+
+				PriorityQueue(PriorityQueue&& other) noexcept : System::Object(std::move(other)) { }
+
+				PriorityQueue(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				PriorityQueue& operator=(PriorityQueue const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				PriorityQueue& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				PriorityQueue& operator=(PriorityQueue&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				PriorityQueue& operator=(PriorityQueue* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				PriorityQueue* operator->() {
+					return this;
+				}
+
+
+
+				PriorityQueue(int initialCapacity) {
+					this->od = new ObjectData(initialCapacity, false, null);
+				}
+
+				PriorityQueue(IComparer<TPriority> comparer) {
+					this->od = new ObjectData(0, false, comparer);
+				}
+
+				/// <param name="updatable">Whether Enqueue hands out handles for UpdatePriority.</param>
+				PriorityQueue(int initialCapacity, bool updatable, IComparer<TPriority> comparer = null) {
+					this->od = new ObjectData(initialCapacity, updatable, comparer);
+				}
+
+				/// <summary>Adds the specified element with associated priority.</summary>
+				/// <returns>The handle of the item if the queue is updatable, otherwise or if a bounded queue dropped the item -1.</returns>
+				long Enqueue(TElement const& element, TPriority const& priority) const {
+					return GOD()->Enqueue(element, priority);
+				}
+
+				/// <summary>Enqueues count elements, a batch at least as large as the queue is heapified in O(n).</summary>
+				void EnqueueRange(TElement const* elements, TPriority const* priorities, int count) const {
+					GOD()->EnqueueRange(elements, priorities, count);
+				}
+
+				void EnqueueRange(Array<TElement> const& elements, Array<TPriority> const& priorities) const {
+					if (elements == null || priorities == null)
+						throw ArgumentNullException();
+					if (elements.GOD()->Length != priorities.GOD()->Length)
+						throw ArgumentOutOfRangeException();
+					GOD()->EnqueueRange(elements.GOD()->arrdta, priorities.GOD()->arrdta, (int)elements.GOD()->Length);
+				}
+
+				/// <summary>Removes and returns the minimal element.</summary>
+				TElement Dequeue() const {
+					return GOD()->Dequeue(null);
+				}
+
+				/// <summary>Removes the minimal element and copies it and its priority to the arguments.</summary>
+				bool TryDequeue(TElement& element, TPriority& priority) const {
+					if (!GOD()->count)
+						return false;
+					element = GOD()->Dequeue(&priority);
+					return true;
+				}
+
+				/// <summary>Returns the minimal element without removing it.</summary>
+				TElement Peek() const {
+					if (!GOD()->count)
+						throw InvalidOperationException();
+					return GOD()->elements[0];
+				}
+
+				bool TryPeek(TElement& element, TPriority& priority) const {
+					ObjectData* qd = GOD();
+					if (!qd->count)
+						return false;
+					element = qd->elements[0];
+					priority = qd->priorities[0];
+					return true;
+				}
+
+				/// <summary>Adds the specified element with associated priority, and immediately removes the minimal element, returning the result.</summary>
+				TElement EnqueueDequeue(TElement const& element, TPriority const& priority) const {
+					return GOD()->EnqueueDequeue(element, priority);
+				}
+
+				/// <summary>Removes the minimal element and then immediately adds the specified element with associated priority.</summary>
+				TElement DequeueEnqueue(TElement const& element, TPriority const& priority) const {
+					return GOD()->DequeueEnqueue(element, priority);
+				}
+
+				/// <summary>Changes the priority of the item with the given handle, as returned by Enqueue of an updatable queue.
+				/// Throws ArgumentOutOfRangeException if the item is no longer in the queue.</summary>
+				void UpdatePriority(long handle, TPriority const& priority) const {
+					GOD()->UpdatePriority(handle, priority);
+				}
+
+				/// <summary>Whether the item with the given handle is still in the queue.</summary>
+				bool Contains(long handle) const {
+					return GOD()->Contains(handle);
+				}
+
+				/// <summary>Removes all items.</summary>
+				void Clear() const {
+					GOD()->Clear();
+				}
+			};
+
+			/// <summary>A list of records stored column by column (structure of arrays): every field has its own
+			/// contiguous buffer, so a scan over one field reads only that field, and numeric columns can be handed to
+			/// the vector kernels of Aggregates. Rows are read and written through a Row proxy.
+			///
+			///    ColumnList&lt;int, double, String&gt; trades(0);
+			///    trades.Add(17, 99.5, "ABC");
+			///    double total = trades.Sum&lt;1&gt;();
+			///    auto big = trades.Where&lt;1&gt;([](double price) { return price &gt; 50; });</summary>
+			template<class... Fields> class System_API ColumnList : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->count;
+				}
+
+			public:
+				template<std::size_t I> using FieldType = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					typedef std::index_sequence_for<Fields...> Indexes;
+
+					template<class T> static void Relocate(T*& column, int count, int newCapacity) {
+						T* newColumn = newCapacity ? (T*) ::operator new((size_t)newCapacity * sizeof(T)) : NULL;
+						if (std::is_trivially_copyable<T>::value) {
+							if (count > 0)
+								std::memcpy((void*)newColumn, (void const*)column, (size_t)count * sizeof(T));
+						}
+						else {
+							for (int i = 0; i < count; i++) {
+								new (&newColumn[i]) T(std::move(column[i]));
+								column[i].~T();
+							}
+						}
+						if (column)
+							::operator delete(column);
+						column = newColumn;
+					}
+
+					template<class T> static void Destroy(T* column, int from, int to) {
+						if (!std::is_trivially_destructible<T>::value) {
+							for (int i = from; i < to; i++)
+								column[i].~T();
+						}
+					}
+
+					template<class T> static void RemoveAt(T* column, int index, int count) {
+						for (int i = index; i < count - 1; i++)
+							column[i] = std::move(column[i + 1]);
+						column[count - 1].~T();
+					}
+
+					template<class T> static void Gather(T* dst, T const* src, int const* rows, int n) {
+						for (int i = 0; i < n; i++)
+							new (&dst[i]) T(src[rows[i]]);
+					}
+
+					template<std::size_t... I> void SetCapacity(int newCapacity, std::index_sequence<I...>) {
+						int expand[] = { 0, (Relocate(std::get<I>(columns), count, newCapacity), 0)... };
+						(void)expand;
+					}
+
+					template<std::size_t... I> void Add(std::index_sequence<I...>, Fields const&... values) {
+						int expand[] = { 0, (new (std::get<I>(columns) + count) Fields(values), 0)... };
+						(void)expand;
+					}
+
+					template<std::size_t... I> void Add(std::index_sequence<I...>, std::tuple<Fields...>& values) {
+						int expand[] = { 0, (new (std::get<I>(columns) + count) Fields(std::move(std::get<I>(values))), 0)... };
+						(void)expand;
+					}
+
+					template<std::size_t... I> void Destroy(int from, int to, std::index_sequence<I...>) {
+						int expand[] = { 0, (Destroy(std::get<I>(columns), from, to), 0)... };
+						(void)expand;
+					}
+
+					template<std::size_t... I> void RemoveAt(int index, std::index_sequence<I...>) {
+						int expand[] = { 0, (RemoveAt(std::get<I>(columns), index, count), 0)... };
+						(void)expand;
+					}
+
+					template<std::size_t... I> void Gather(ObjectData const* src, int const* rows, int n, std::index_sequence<I...>) {
+						int expand[] = { 0, (Gather(std::get<I>(columns) + count, std::get<I>(src->columns), rows, n), 0)... };
+						(void)expand;
+					}
+
+				public:
+					std::tuple<Fields*...> columns;
+					int count;
+					int capacity;
+
+					ObjectData(int capacity) : count(0), capacity(0) {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity > 0)
+							SetCapacity(capacity);
+					}
+
+					ObjectData() : ObjectData(0) {}
+
+					~ObjectData() override {
+						Destroy(0, count, Indexes());
+						count = 0;
+						SetCapacity(0, Indexes());
+					}
+
+					void SetCapacity(int newCapacity) {
+						if (newCapacity < count)
+							throw ArgumentOutOfRangeException();
+						if (newCapacity == capacity)
+							return;
+						SetCapacity(newCapacity, Indexes());
+						capacity = newCapacity;
+					}
+
+					int EnsureCapacity(int min) {
+						if (min < 0)
+							throw ArgumentOutOfRangeException();
+						if (capacity < min) {
+							int newCapacity = capacity ? (capacity < INT32_MAX / 2 ? capacity << 1 : INT32_MAX) : 4;
+							SetCapacity(newCapacity < min ? min : newCapacity);
+						}
+						return capacity;
+					}
+
+					void Add(Fields const&... values) {
+						if (count == capacity) {
+							// the values may live in the columns that are about to move
+							std::tuple<Fields...> copy(values...);
+							EnsureCapacity(count + 1);
+							Add(Indexes(), copy);
+							count++;
+							return;
+						}
+						Add(Indexes(), values...);
+						count++;
+					}
+
+					void RemoveAt(int index) {
+						if (index < 0 || index >= count)
+							throw ArgumentOutOfRangeException();
+						RemoveAt(index, Indexes());
+						count--;
+					}
+
+					void Clear() {
+						Destroy(0, count, Indexes());
+						count = 0;
+					}
+
+					// appends the given rows of src, every column in one pass
+					void AppendRows(ObjectData const* src, int const* rows, int n) {
+						EnsureCapacity(count + n);
+						Gather(src, rows, n, Indexes());
+						count += n;
+					}
+				};
+
+				/// <summary>A row of a ColumnList, reads and writes its fields in place.</summary>
+				class System_API Row
+				{
+				private:
+					ObjectData* cd;
+					int index;
+				public:
+					Row(ObjectData* cd, int index) : cd(cd), index(index) {}
+
+					/// <summary>The field I of the row.</summary>
+					template<std::size_t I> FieldType<I>& Get() const {
+						return std::get<I>(cd->columns)[index];
+					}
+
+					int GetIndex() const {
+						return index;
+					}
+
+					std::tuple<Fields...> ToTuple() const {
+						return ToTuple(std::index_sequence_for<Fields...>());
+					}
+
+				private:
+					template<std::size_t... I> std::tuple<Fields...> ToTuple(std::index_sequence<I...>) const {
+						return std::tuple<Fields...>(std::get<I>(cd->columns)[index]...);
+					}
+				};
+
+				class System_API Iterator
+				{
+				private:
+					ObjectData* cd;
+					int index;
+				public:
+					Iterator(ObjectData* cd, int index) : cd(cd), index(index) {}
+
+					Row operator*() const {
+						return Row(cd, index);
+					}
+
+					Iterator& operator++() {
+						++index;
+						return *this;
+					}
+
+					bool operator!=(Iterator const& other) const {
+						return index != other.index;
+					}
+
+					bool operator==(Iterator const& other) const {
+						return index == other.index;
+					}
+				};
+
+				/// <summary>Gets the number of rows.</summary>
+				PropGenGet<int, ColumnList<Fields...>, &ColumnList<Fields...>::Get_Count> Count{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				ColumnList(){}
+
+				ColumnList(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				ColumnList(ColumnList* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				ColumnList(ColumnList const & other) : System::Object(other) { }
+
+				ColumnList(ColumnList&& other) noexcept : System::Object(std::move(other)) { }
+
+				ColumnList(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				ColumnList& operator=(ColumnList const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ColumnList& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ColumnList& operator=(ColumnList&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ColumnList& operator=(ColumnList* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ColumnList* operator->() {
+					return this;
+				}
+
+
+
+				ColumnList(int capacity) {
+					this->od = new ObjectData(capacity);
+				}
+
+				/// <summary>Adds a row.</summary>
+				void Add(Fields const&... values) const {
+					GOD()->Add(values...);
+				}
+
+				/// <summary>Removes the row at the specified index, the rows after it move up.</summary>
+				void RemoveAt(int index) const {
+					GOD()->RemoveAt(index);
+				}
+
+				/// <summary>Removes all rows, the buffers are kept.</summary>
+				void Clear() const {
+					GOD()->Clear();
+				}
+
+				/// <summary>Ensures that every column can hold at least capacity rows.</summary>
+				int EnsureCapacity(int capacity) const {
+					return GOD()->EnsureCapacity(capacity);
+				}
+
+				Row operator[](int index) const {
+					if (index < 0 || index >= GOD()->count)
+						throw ArgumentOutOfRangeException();
+					return Row(GOD(), index);
+				}
+
+				/// <summary>The values of field I as one contiguous span, valid until the next row is added.</summary>
+				template<std::size_t I> Span<FieldType<I>> Column() const {
+					return Span<FieldType<I>>(std::get<I>(GOD()->columns), GOD()->count);
+				}
+
+				/// <summary>The rows whose field I satisfies the predicate. Only column I is scanned, the other columns are
+				/// gathered for the selected rows afterwards.</summary>
+				template<std::size_t I, class F> ColumnList<Fields...> Where(F const& predicate) const {
+					ObjectData* cd = GOD();
+					FieldType<I> const* column = std::get<I>(cd->columns);
+					int n = cd->count;
+					List<int> rows(0);
+					for (int i = 0; i < n; i++) {
+						if (predicate(column[i]))
+							rows.Add(i);
+					}
+					ColumnList<Fields...> ret(rows.GOD()->Count);
+					ret.GOD()->AppendRows(cd, rows.GOD()->arrdta, rows.GOD()->Count);
+					return ret;
+				}
+
+				/// <summary>Projects field I of every row into a List.</summary>
+				template<std::size_t I, class F> auto Select(F const& selector) const -> List<typename std::decay<decltype(selector(std::declval<FieldType<I> const&>()))>::type> {
+					typedef typename std::decay<decltype(selector(std::declval<FieldType<I> const&>()))>::type R;
+					ObjectData* cd = GOD();
+					FieldType<I> const* column = std::get<I>(cd->columns);
+					int n = cd->count;
+					List<R> ret(n);
+					typename List<R>::ObjectData* ld = ret.GOD();
+					for (int i = 0; i < n; i++)
+						ld->Add(selector(column[i]));
+					return ret;
+				}
+
+				/// <summary>The number of rows whose field I satisfies the predicate.</summary>
+				template<std::size_t I, class F> int CountWhere(F const& predicate) const {
+					ObjectData* cd = GOD();
+					FieldType<I> const* column = std::get<I>(cd->columns);
+					int n = cd->count;
+					int ret = 0;
+					for (int i = 0; i < n; i++)
+						ret += predicate(column[i]) ? 1 : 0;
+					return ret;
+				}
+
+				/// <summary>Computes the sum of field I, vectorised for int, long, float and double.</summary>
+				template<std::size_t I> FieldType<I> Sum() const {
+					return Aggregates::Sum(std::get<I>(GOD()->columns), GOD()->count);
+				}
+
+				/// <summary>Average, minimum and maximum of field I. Throw InvalidOperationException if there are no rows.</summary>
+				template<std::size_t I> double Average() const {
+					if (!GOD()->count)
+						throw InvalidOperationException();
+					return Aggregates::Average(std::get<I>(GOD()->columns), GOD()->count);
+				}
+
+				template<std::size_t I> FieldType<I> Min() const {
+					if (!GOD()->count)
+						throw InvalidOperationException();
+					return Aggregates::Min(std::get<I>(GOD()->columns), GOD()->count);
+				}
+
+				template<std::size_t I> FieldType<I> Max() const {
+					if (!GOD()->count)
+						throw InvalidOperationException();
+					return Aggregates::Max(std::get<I>(GOD()->columns), GOD()->count);
+				}
+
+				Iterator begin() const {
+					return Iterator(GOD(), 0);
+				}
+				Iterator end() const {
+					return Iterator(GOD(), GOD()->count);
+				}
+			};
+
+
+
+		}
+
+		namespace Immutable {
+
+			/// <summary>A list that never changes once created. Add, SetItem, Insert and RemoveAt return a new list that
+			/// shares all but O(log n) nodes with the old one, so every version stays valid and any thread can read or
+			/// enumerate it without locks. The elements live in a relaxed radix balanced tree (RRB tree) of 32-way nodes:
+			/// an index walks at most 7 levels, and Insert, RemoveAt, GetRange and AddRange split and join trees in O(log n).
+			///
+			///    ImmutableList&lt;int&gt; v1 = new ImmutableList&lt;int&gt;();
+			///    ImmutableList&lt;int&gt; v2 = v1.Add(37);   // v1 is still empty</summary>
+			template<class T> class System_API ImmutableList : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->tree.count;
+				}
+
+			public:
+				enum { Bits = 5, Width = 1 << Bits, Extra = 2 };
+
+				class System_API Leaf : public Object::ObjectData {
+				public:
+					int count;
+					T items[Width];
+
+					Leaf() : count(0) {}
+
+					Leaf(Leaf const& other) : Object::ObjectData(), count(other.count) {
+						for (int i = 0; i < count; i++)
+							items[i] = other.items[i];
+					}
+				};
+
+				// a node at shift s has children at shift s - Bits holding at most 1 << s elements each; sizes[i] counts
+				// the elements of children 0..i. Unless relaxed, every child but the last is full and the child holding
+				// an index is found by shifting alone
+				class System_API Inner : public Object::ObjectData {
+				public:
+					int count;
+					bool relaxed;
+					int sizes[Width];
+					Object children[Width];
+
+					Inner() : count(0), relaxed(false) {}
+
+					Inner(Inner const& other) : Object::ObjectData(), count(other.count), relaxed(other.relaxed) {
+						for (int i = 0; i < count; i++) {
+							sizes[i] = other.sizes[i];
+							children[i] = other.children[i];
+						}
+					}
+				};
+
+				// the root of one version, the list and its Builder share the operations. Nodes are copied before they
+				// change unless inPlace is set and the node is referenced only from the path being edited
+				struct Tree {
+					Object root;
+					int shift;
+					int count;
+
+					Tree() : shift(0), count(0) {}
+
+					static Leaf* AsLeaf(Object const& node) {
+						return static_cast<Leaf*>(node.od);
+					}
+
+					static Inner* AsInner(Object const& node) {
+						return static_cast<Inner*>(node.od);
+					}
+
+					// a handle that takes over the reference of a new node
+					static Object Adopt(Object::ObjectData* node) {
+						Object ret;
+						ret.od = node;
+						return ret;
+					}
+
+					static Leaf* EditLeaf(Object& slot, bool inPlace) {
+						if (inPlace && slot.GetRef() == 1)
+							return AsLeaf(slot);
+						Leaf* copy = new Leaf(*AsLeaf(slot));
+						slot = Adopt(copy);
+						return copy;
+					}
+
+					static Inner* EditInner(Object& slot, bool inPlace) {
+						if (inPlace && slot.GetRef() == 1)
+							return AsInner(slot);
+						Inner* copy = new Inner(*AsInner(slot));
+						slot = Adopt(copy);
+						return copy;
+					}
+
+					static int SizeOf(Object const& node, int shift) {
+						if (!shift)
+							return AsLeaf(node)->count;
+						Inner* in = AsInner(node);
+						return in->sizes[in->count - 1];
+					}
+
+					static int SlotsOf(Object const& node, int shift) {
+						return shift ? AsInner(node)->count : AsLeaf(node)->count;
+					}
+
+					static void Update(Inner* in, int shift) {
+						int total = 0;
+						in->relaxed = false;
+						for (int i = 0; i < in->count; i++) {
+							int size = SizeOf(in->children[i], shift - Bits);
+							if (i < in->count - 1 && size != (1 << shift))
+								in->relaxed = true;
+							total += size;
+							in->sizes[i] = total;
+						}
+					}
+
+					// the child holding index, index becomes the position in that child
+					static int Slot(Inner* in, int shift, int& index) {
+						int slot = index >> shift;
+						if (in->relaxed) {
+							while (in->sizes[slot] <= index)
+								slot++;
+						}
+						if (slot)
+							index -= in->sizes[slot - 1];
+						return slot;
+					}
+
+					static Leaf* FindLeaf(Object const& root, int shift, int& index) {
+						Object const* node = &root;
+						while (shift) {
+							Inner* in = AsInner(*node);
+							node = &in->children[Slot(in, shift, index)];
+							shift -= Bits;
+						}
+						return AsLeaf(*node);
+					}
+
+					static bool HasRoom(Object const& node, int shift) {
+						if (!shift)
+							return AsLeaf(node)->count < Width;
+						Inner* in = AsInner(node);
+						return in->count < Width || HasRoom(in->children[in->count - 1], shift - Bits);
+					}
+
+					// single-child nodes from shift down to a leaf holding value
+					static Object NewPath(int shift, T const& value) {
+						if (!shift) {
+							Leaf* leaf = new Leaf();
+							leaf->items[0] = value;
+							leaf->count = 1;
+							return Adopt(leaf);
+						}
+						Inner* in = new Inner();
+						in->children[0] = NewPath(shift - Bits, value);
+						in->sizes[0] = 1;
+						in->count = 1;
+						return Adopt(in);
+					}
+
+					// slot has room for one more element (HasRoom)
+					static void Push(Object& slot, int shift, T const& value, bool inPlace) {
+						if (!shift) {
+							Leaf* leaf = EditLeaf(slot, inPlace);
+							leaf->items[leaf->count++] = value;
+							return;
+						}
+						Inner* in = EditInner(slot, inPlace);
+						int last = in->count - 1;
+						if (HasRoom(in->children[last], shift - Bits)) {
+							Push(in->children[last], shift - Bits, value, inPlace);
+							in->sizes[last]++;
+						}
+						else {
+							// the last child is out of slots, with fewer than 1 << shift elements if it is relaxed
+							if (in->sizes[last] - (last ? in->sizes[last - 1] : 0) != (1 << shift))
+								in->relaxed = true;
+							in->children[last + 1] = NewPath(shift - Bits, value);
+							in->sizes[last + 1] = in->sizes[last] + 1;
+							in->count++;
+						}
+					}
+
+					static void Assign(Object& slot, int shift, int index, T const& value, bool inPlace) {
+						if (!shift) {
+							EditLeaf(slot, inPlace)->items[index] = value;
+							return;
+						}
+						Inner* in = EditInner(slot, inPlace);
+						int child = Slot(in, shift, index);
+						Assign(in->children[child], shift - Bits, index, value, inPlace);
+					}
+
+					// the first n elements, 0 &lt; n &lt;= SizeOf(node)
+					static Object Take(Object const& node, int shift, int n) {
+						if (n == SizeOf(node, shift))
+							return node;
+						if (!shift) {
+							Leaf* src = AsLeaf(node);
+							Leaf* leaf = new Leaf();
+							for (int i = 0; i < n; i++)
+								leaf->items[i] = src->items[i];
+							leaf->count = n;
+							return Adopt(leaf);
+						}
+						Inner* src = AsInner(node);
+						int index = n - 1;
+						int slot = Slot(src, shift, index);
+						Inner* in = new Inner();
+						for (int i = 0; i < slot; i++)
+							in->children[i] = src->children[i];
+						in->children[slot] = Take(src->children[slot], shift - Bits, index + 1);
+						in->count = slot + 1;
+						Update(in, shift);
+						return Adopt(in);
+					}
+
+					// all but the first n elements, 0 &lt;= n &lt; SizeOf(node)
+					static Object Drop(Object const& node, int shift, int n) {
+						if (!n)
+							return node;
+						if (!shift) {
+							Leaf* src = AsLeaf(node);
+							Leaf* leaf = new Leaf();
+							for (int i = n; i < src->count; i++)
+								leaf->items[i - n] = src->items[i];
+							leaf->count = src->count - n;
+							return Adopt(leaf);
+						}
+						Inner* src = AsInner(node);
+						int index = n;
+						int slot = Slot(src, shift, index);
+						Inner* in = new Inner();
+						in->children[0] = Drop(src->children[slot], shift - Bits, index);
+						for (int i = slot + 1; i < src->count; i++)
+							in->children[i - slot] = src->children[i];
+						in->count = src->count - slot;
+						Update(in, shift);
+						return Adopt(in);
+					}
+
+					// packs the slots of undersized nodes into their neighbours until there are at most Extra nodes more
+					// than the minimum, which bounds the extra steps Slot takes in a relaxed node. Returns the new count
+					static int Redistribute(Object* nodes, int n, int shift) {
+						int plan[2 * Width];
+						int total = 0;
+						for (int i = 0; i < n; i++) {
+							plan[i] = SlotsOf(nodes[i], shift);
+							total += plan[i];
+						}
+						int optimal = (total + Width - 1) / Width;
+						if (n <= optimal + Extra)
+							return n;
+						int count = n;
+						for (int i = 0; count > optimal + Extra; ) {
+							while (plan[i] == Width)
+								i++;
+							int remaining = plan[i];
+							while (remaining > 0) {
+								int size = remaining + plan[i + 1] < Width ? remaining + plan[i + 1] : (int)Width;
+								remaining += plan[i + 1] - size;
+								plan[i++] = size;
+							}
+							for (int j = i; j < count - 1; j++)
+								plan[j] = plan[j + 1];
+							count--;
+							i--;
+						}
+
+						// refill in order, nodes that keep their size and position are shared
+						Object result[2 * Width];
+						int src = 0;
+						int offset = 0;
+						for (int k = 0; k < count; k++) {
+							if (!offset && SlotsOf(nodes[src], shift) == plan[k]) {
+								result[k] = nodes[src++];
+								continue;
+							}
+							if (!shift) {
+								Leaf* leaf = new Leaf();
+								while (leaf->count < plan[k]) {
+									Leaf* from = AsLeaf(nodes[src]);
+									leaf->items[leaf->count++] = from->items[offset++];
+									if (offset == from->count) {
+										src++;
+										offset = 0;
+									}
+								}
+								result[k] = Adopt(leaf);
+							}
+							else {
+								Inner* in = new Inner();
+								while (in->count < plan[k]) {
+									Inner* from = AsInner(nodes[src]);
+									in->children[in->count++] = from->children[offset++];
+									if (offset == from->count) {
+										src++;
+										offset = 0;
+									}
+								}
+								Update(in, shift);
+								result[k] = Adopt(in);
+							}
+						}
+						for (int k = 0; k < n; k++)
+							nodes[k] = k < count ? std::move(result[k]) : null;
+						return count;
+					}
+
+					// the children of left but its last, of middle and of right but its first, rebalanced into one or two
+					// nodes at shift under a new node at shift + Bits
+					static Object Rebalance(Inner* left, Object const& middle, Inner* right, int shift) {
+						Object all[2 * Width];
+						int n = 0;
+						if (left) {
+							for (int i = 0; i < left->count - 1; i++)
+								all[n++] = left->children[i];
+						}
+						Inner* mid = AsInner(middle);
+						for (int i = 0; i < mid->count; i++)
+							all[n++] = mid->children[i];
+						if (right) {
+							for (int i = 1; i < right->count; i++)
+								all[n++] = right->children[i];
+						}
+						n = Redistribute(all, n, shift - Bits);
+
+						Inner* top = new Inner();
+						for (int start = 0; start < n; start += Width) {
+							Inner* in = new Inner();
+							for (int i = start; i < n && i < start + Width; i++)
+								in->children[in->count++] = all[i];
+							Update(in, shift);
+							top->children[top->count++] = Adopt(in);
+						}
+						Update(top, shift + Bits);
+						return Adopt(top);
+					}
+
+					// joins two subtrees into a node one level above the taller one, holding one or two children
+					static Object Join(Object const& left, int leftShift, Object const& right, int rightShift) {
+						if (leftShift > rightShift) {
+							Inner* l = AsInner(left);
+							Object middle = Join(l->children[l->count - 1], leftShift - Bits, right, rightShift);
+							return Rebalance(l, middle, nullptr, leftShift);
+						}
+						if (leftShift < rightShift) {
+							Inner* r = AsInner(right);
+							Object middle = Join(left, leftShift, r->children[0], rightShift - Bits);
+							return Rebalance(nullptr, middle, r, rightShift);
+						}
+						if (leftShift) {
+							Inner* l = AsInner(left);
+							Inner* r = AsInner(right);
+							Object middle = Join(l->children[l->count - 1], leftShift - Bits, r->children[0], rightShift - Bits);
+							return Rebalance(l, middle, r, leftShift);
+						}
+
+						// two leaves: the left one is filled up, the rest stays on the right
+						Leaf* l = AsLeaf(left);
+						Leaf* r = AsLeaf(right);
+						Inner* in = new Inner();
+						if (l->count == Width) {
+							in->children[0] = left;
+							in->children[1] = right;
+							in->count = 2;
+						}
+						else {
+							Leaf* a = new Leaf(*l);
+							int i = 0;
+							while (a->count < Width && i < r->count)
+								a->items[a->count++] = r->items[i++];
+							in->children[in->count++] = Adopt(a);
+							if (i < r->count) {
+								Leaf* b = new Leaf();
+								while (i < r->count)
+									b->items[b->count++] = r->items[i++];
+								in->children[in->count++] = Adopt(b);
+							}
+						}
+						Update(in, Bits);
+						return Adopt(in);
+					}
+
+					// removes root levels with a single child
+					void Shrink() {
+						while (shift && AsInner(root)->count == 1) {
+							Object child = AsInner(root)->children[0];
+							root = std::move(child);
+							shift -= Bits;
+						}
+					}
+
+					T const& Get(int index) const {
+						if (index < 0 || index >= count)
+							throw ArgumentOutOfRangeException();
+						Leaf* leaf = FindLeaf(root, shift, index);
+						return leaf->items[index];
+					}
+
+					void Add(T const& value, bool inPlace) {
+						if (!root.od) {
+							root = NewPath(0, value);
+							shift = 0;
+						}
+						else if (HasRoom(root, shift))
+							Push(root, shift, value, inPlace);
+						else {
+							Inner* in = new Inner();
+							in->children[0] = root;
+							in->children[1] = NewPath(shift, value);
+							in->count = 2;
+							Update(in, shift + Bits);
+							root = Adopt(in);
+							shift += Bits;
+						}
+						count++;
+					}
+
+					void SetItem(int index, T const& value, bool inPlace) {
+						if (index < 0 || index >= count)
+							throw ArgumentOutOfRangeException();
+						Assign(root, shift, index, value, inPlace);
+					}
+
+					Tree Take(int n) const {
+						Tree ret;
+						if (n > 0) {
+							ret.root = Take(root, shift, n);
+							ret.shift = shift;
+							ret.count = n;
+							ret.Shrink();
+						}
+						return ret;
+					}
+
+					Tree Drop(int n) const {
+						Tree ret;
+						if (n < count) {
+							ret.root = Drop(root, shift, n);
+							ret.shift = shift;
+							ret.count = count - n;
+							ret.Shrink();
+						}
+						return ret;
+					}
+
+					static Tree Join(Tree const& left, Tree const& right) {
+						if (!left.count)
+							return right;
+						if (!right.count)
+							return left;
+						Tree ret;
+						ret.root = Join(left.root, left.shift, right.root, right.shift);
+						ret.shift = (left.shift > right.shift ? left.shift : right.shift) + Bits;
+						ret.count = left.count + right.count;
+						ret.Shrink();
+						return ret;
+					}
+
+					void Insert(int index, T const& value, bool inPlace) {
+						if (index < 0 || index > count)
+							throw ArgumentOutOfRangeException();
+						if (index == count) {
+							Add(value, inPlace);
+							return;
+						}
+						Tree single;
+						single.Add(value, true);
+						*this = Join(Join(Take(index), single), Drop(index));
+					}
+
+					void RemoveRange(int index, int n) {
+						if (index < 0 || n < 0 || n > count - index)
+							throw ArgumentOutOfRangeException();
+						if (n)
+							*this = Join(Take(index), Drop(index + n));
+					}
+				};
+
+				class System_API ObjectData : public Object::ObjectData {
+				public:
+					Tree tree;
+
+					ObjectData() {}
+
+					ObjectData(Tree const& tree) : tree(tree) {}
+				};
+
+				class System_API Iterator
+				{
+				private:
+					Tree const* tree;
+					int index;
+					T const* cur;
+					T const* leafEnd;
+
+					void Seek() {
+						if (index < tree->count) {
+							int offset = index;
+							Leaf* leaf = Tree::FindLeaf(tree->root, tree->shift, offset);
+							cur = leaf->items + offset;
+							leafEnd = leaf->items + leaf->count;
+						}
+					}
+
+				public:
+					Iterator(Tree const* tree, int index) : tree(tree), index(index), cur(nullptr), leafEnd(nullptr) {
+						Seek();
+					}
+
+					T const& operator*() const {
+						return *cur;
+					}
+
+					Iterator& operator++() {
+						index++;
+						if (++cur == leafEnd)
+							Seek();
+						return *this;
+					}
+
+					bool operator!=(Iterator const& other) const {
+						return index != other.index;
+					}
+
+					bool operator==(Iterator const& other) const {
+						return index == other.index;
+					}
+				};
+
+				/// <summary>Collects many changes to a list without a new version per change: the nodes it copied are
+				/// its own and change in place. ToImmutable returns the current contents as an ImmutableList.</summary>
+				class System_API Builder : public Object {
+				private:
+					int Get_Count() const {
+						return GOD()->tree.count;
+					}
+
+				public:
+					class System_API ObjectData : public Object::ObjectData {
+					public:
+						Tree tree;
+
+						ObjectData() {}
+
+						ObjectData(Tree const& tree) : tree(tree) {}
+					};
+
+					/// <summary>Gets the number of elements.</summary>
+					PropGenGet<int, Builder, &Builder::Get_Count> Count{ this };
+
+					ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+					Builder(){}
+
+					Builder(std::nullptr_t const & n) : System::Object(n) {
+					}
+
+					Builder(Builder* pValue) {
+						if (!pValue->od) {
+							ObjectData* dd = new ObjectData();
+							od = dd;
+						}
+						else {
+							od = pValue->od;
+							pValue->od = nullptr;
+						}
+						delete pValue;
+					}
+
+					Builder(Builder const & other) : System::Object(other) { }
+
+					Builder(Builder&& other) noexcept : System::Object(std::move(other)) { }
+
+					Builder(Object::ObjectData* other) : System::Object(other) {
+					}
+
+					Builder& operator=(Builder const & other) {
+						System::Object::operator=(other);
+						return *this;
+					}
+
+					Builder& operator=(std::nullptr_t const & n) {
+						System::Object::operator=(n);
+						return *this;
+					}
+
+					Builder& operator=(Builder&& other) noexcept {
+						System::Object::operator=(std::move(other));
+						return *this;
+					}
+
+					Builder& operator=(Builder* other) {
+						if (od == other->od)
+							return *this;
+						Release();
+						od = other->od;
+						::operator delete((void*)other);
+						return *this;
+					}
+
+					Builder* operator->() {
+						return this;
+					}
+
+
+
+					T const& operator[](int index) const {
+						return GOD()->tree.Get(index);
+					}
+
+					void Add(T const& value) const {
+						GOD()->tree.Add(value, true);
+					}
+
+					void SetItem(int index, T const& value) const {
+						GOD()->tree.SetItem(index, value, true);
+					}
+
+					void Insert(int index, T const& value) const {
+						GOD()->tree.Insert(index, value, true);
+					}
+
+					void RemoveAt(int index) const {
+						GOD()->tree.RemoveRange(index, 1);
+					}
+
+					void Clear() const {
+						GOD()->tree = Tree();
+					}
+
+					/// <summary>The current contents as an ImmutableList, later changes to the builder do not affect it.</summary>
+					ImmutableList<T> ToImmutable() const {
+						return ImmutableList<T>::FromTree(GOD()->tree);
+					}
+
+					Iterator begin() const {
+						return Iterator(&GOD()->tree, 0);
+					}
+					Iterator end() const {
+						return Iterator(&GOD()->tree, GOD()->tree.count);
+					}
+				};
+
+			private:
+				static ImmutableList<T> FromTree(Tree const& tree) {
+					ImmutableList<T> ret;
+					ret.od = new ObjectData(tree);
+					return ret;
+				}
+
+			public:
+				/// <summary>Gets the number of elements.</summary>
+				PropGenGet<int, ImmutableList<T>, &ImmutableList<T>::Get_Count> Count{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				ImmutableList(){}
+
+				ImmutableList(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				ImmutableList(ImmutableList* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				ImmutableList(ImmutableList const & other) : System::Object(other) { }
+
+				ImmutableList(ImmutableList&& other) noexcept : System::Object(std::move(other)) { }
+
+				ImmutableList(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				ImmutableList& operator=(ImmutableList const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ImmutableList& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ImmutableList& operator=(ImmutableList&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ImmutableList& operator=(ImmutableList* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ImmutableList* operator->() {
+					return this;
+				}
+
+
+
+				/// <summary>Gets the element at the specified index. Throws ArgumentOutOfRangeException if there is none.</summary>
+				T const& operator[](int index) const {
+					return GOD()->tree.Get(index);
+				}
+
+				bool IsEmpty() const {
+					return GOD()->tree.count == 0;
+				}
+
+				/// <summary>A new list with value added at the end.</summary>
+				ImmutableList<T> Add(T const& value) const {
+					Tree tree = GOD()->tree;
+					tree.Add(value, false);
+					return FromTree(tree);
+				}
+
+				/// <summary>A new list with the elements of items added at the end, the nodes of both lists are shared.</summary>
+				ImmutableList<T> AddRange(ImmutableList<T> const& items) const {
+					return FromTree(Tree::Join(GOD()->tree, items.GOD()->tree));
+				}
+
+				/// <summary>A new list with the element at index replaced by value.</summary>
+				ImmutableList<T> SetItem(int index, T const& value) const {
+					Tree tree = GOD()->tree;
+					tree.SetItem(index, value, false);
+					return FromTree(tree);
+				}
+
+				/// <summary>A new list with value inserted at index.</summary>
+				ImmutableList<T> Insert(int index, T const& value) const {
+					Tree tree = GOD()->tree;
+					tree.Insert(index, value, false);
+					return FromTree(tree);
+				}
+
+				/// <summary>A new list without the element at index.</summary>
+				ImmutableList<T> RemoveAt(int index) const {
+					return RemoveRange(index, 1);
+				}
+
+				/// <summary>A new list without count elements from index on.</summary>
+				ImmutableList<T> RemoveRange(int index, int count) const {
+					Tree tree = GOD()->tree;
+					tree.RemoveRange(index, count);
+					return FromTree(tree);
+				}
+
+				/// <summary>A new list with count elements from index on.</summary>
+				ImmutableList<T> GetRange(int index, int count) const {
+					Tree const& tree = GOD()->tree;
+					if (index < 0 || count < 0 || count > tree.count - index)
+						throw ArgumentOutOfRangeException();
+					return FromTree(tree.Drop(index).Take(count));
+				}
+
+				/// <summary>An empty list.</summary>
+				ImmutableList<T> Clear() const {
+					return FromTree(Tree());
+				}
+
+				/// <summary>A builder starting with the elements of this list, it shares the nodes until it changes them.</summary>
+				Builder ToBuilder() const {
+					Builder ret;
+					ret.od = new typename Builder::ObjectData(GOD()->tree);
+					return ret;
+				}
+
+				Iterator begin() const {
+					return Iterator(&GOD()->tree, 0);
+				}
+				Iterator end() const {
+					return Iterator(&GOD()->tree, GOD()->tree.count);
+				}
+			};
+
+			/// <summary>A dictionary that never changes once created. SetItem, Add and Remove return a new dictionary that
+			/// shares all but O(log n) nodes with the old one, so every version stays valid and any thread can read or
+			/// enumerate it without locks. The entries live in a hash array mapped trie (HAMT): 5 bits of the hash code
+			/// select one of 32 slots per level, and a bitmap per node keeps only the slots in use.
+			///
+			///    ImmutableDictionary&lt;string, int&gt; v1 = new ImmutableDictionary&lt;string, int&gt;();
+			///    ImmutableDictionary&lt;string, int&gt; v2 = v1.SetItem("port", 8080);   // v1 is still empty</summary>
+			template<class TKey, class TValue> class System_API ImmutableDictionary : public Object {
+			private:
+				int Get_Count() const {
+					return GOD()->trie.count;
+				}
+
+			public:
+				typedef System::Collections::Generic::KeyValuePair<TKey, TValue> Entry;
+
+				enum { Bits = 5, Mask = (1 << Bits) - 1, HashBits = 32 };
+
+				// at shift s the hash bits s..s+4 select a slot: dataMap marks the slots holding an entry and nodeMap those
+				// holding a child. Keys whose hash codes are equal end up in a collision node, a plain array of entries
+				class System_API Node : public Object::ObjectData {
+				public:
+					uint dataMap;
+					uint nodeMap;
+					int entryCount;
+					int childCount;
+					bool collision;
+					Entry* entries;
+					Object* children;
+
+					Node() : dataMap(0), nodeMap(0), entryCount(0), childCount(0), collision(false), entries(NULL), children(NULL) {}
+
+					Node(Node const& other) : Object::ObjectData(), dataMap(other.dataMap), nodeMap(other.nodeMap), entryCount(other.entryCount), childCount(other.childCount), collision(other.collision), entries(NULL), children(NULL) {
+						if (entryCount) {
+							entries = new Entry[entryCount];
+							for (int i = 0; i < entryCount; i++)
+								entries[i] = other.entries[i];
+						}
+						if (childCount) {
+							children = new Object[childCount];
+							for (int i = 0; i < childCount; i++)
+								children[i] = other.children[i];
+						}
+					}
+
+					~Node() override {
+						if (entries)
+							delete[] entries;
+						if (children)
+							delete[] children;
+					}
+
+					void InsertEntry(int index, Entry const& entry) {
+						Entry* grown = new Entry[entryCount + 1];
+						for (int i = 0; i < index; i++)
+							grown[i] = std::move(entries[i]);
+						grown[index] = entry;
+						for (int i = index; i < entryCount; i++)
+							grown[i + 1] = std::move(entries[i]);
+						if (entries)
+							delete[] entries;
+						entries = grown;
+						entryCount++;
+					}
+
+					void RemoveEntry(int index) {
+						Entry* shrunk = entryCount > 1 ? new Entry[entryCount - 1] : NULL;
+						for (int i = 0; i < index; i++)
+							shrunk[i] = std::move(entries[i]);
+						for (int i = index + 1; i < entryCount; i++)
+							shrunk[i - 1] = std::move(entries[i]);
+						delete[] entries;
+						entries = shrunk;
+						entryCount--;
+					}
+
+					void InsertChild(int index, Object&& child) {
+						Object* grown = new Object[childCount + 1];
+						for (int i = 0; i < index; i++)
+							grown[i] = std::move(children[i]);
+						grown[index] = std::move(child);
+						for (int i = index; i < childCount; i++)
+							grown[i + 1] = std::move(children[i]);
+						if (children)
+							delete[] children;
+						children = grown;
+						childCount++;
+					}
+
+					void RemoveChild(int index) {
+						Object* shrunk = childCount > 1 ? new Object[childCount - 1] : NULL;
+						for (int i = 0; i < index; i++)
+							shrunk[i] = std::move(children[i]);
+						for (int i = index + 1; i < childCount; i++)
+							shrunk[i - 1] = std::move(children[i]);
+						delete[] children;
+						children = shrunk;
+						childCount--;
+					}
+				};
+
+				// the root of one version, the dictionary and its Builder share the operations. Nodes are copied before
+				// they change unless inPlace is set and the node is referenced only from the path being edited
+				struct Trie {
+					Object root;
+					int count;
+					Generic::IEqualityComparer<TKey> comparer;
+					bool defaultComparer;
+
+					Trie(Generic::IEqualityComparer<TKey> const& comparer) : count(0) {
+						Generic::IEqualityComparer<TKey> def = Generic::EqualityComparer<TKey>::Default;
+						defaultComparer = comparer.GOD() == nullptr || comparer.GOD() == def.GOD();
+						this->comparer = defaultComparer ? def : comparer;
+					}
+
+					static Node* AsNode(Object const& node) {
+						return static_cast<Node*>(node.od);
+					}
+
+					static Object Adopt(Node* node) {
+						Object ret;
+						ret.od = node;
+						return ret;
+					}
+
+					static Node* Edit(Object& slot, bool inPlace) {
+						if (inPlace && slot.GetRef() == 1)
+							return AsNode(slot);
+						Node* copy = new Node(*AsNode(slot));
+						slot = Adopt(copy);
+						return copy;
+					}
+
+					static int Index(uint map, uint bit) {
+						return System::Collections::Generic::BitmapOps::PopCount(map & (bit - 1));
+					}
+
+					template<class U> static uint DefaultHashCode(U const& value, std::true_type) {
+						ulong v = (ulong)value;
+						return (uint)v ^ (uint)(v >> 32);
+					}
+
+					template<class U> uint DefaultHashCode(U const& value, std::false_type) const {
+						return (uint)comparer.GetHashCode(value);
+					}
+
+					// the default comparer of integral types is inlined, no call through IEqualityComparer<TKey>
+					uint HashOf(TKey const& key) const {
+						if (defaultComparer)
+							return DefaultHashCode(key, std::integral_constant<bool, std::is_integral<TKey>::value>());
+						return (uint)comparer.GetHashCode(key);
+					}
+
+					bool AreEqual(TKey const& x, TKey const& y) const {
+						return defaultComparer ? x == y : comparer.Equals(x, y);
+					}
+
+					TValue* Find(TKey const& key) const {
+						if (!root.od)
+							return NULL;
+						uint hash = HashOf(key);
+						Node* node = AsNode(root);
+						for (int shift = 0; ; shift += Bits) {
+							if (node->collision) {
+								for (int i = 0; i < node->entryCount; i++) {
+									if (AreEqual(node->entries[i].Key, key))
+										return &node->entries[i].Value;
+								}
+								return NULL;
+							}
+							uint bit = 1u << ((hash >> shift) & Mask);
+							if (node->dataMap & bit) {
+								Entry& entry = node->entries[Index(node->dataMap, bit)];
+								return AreEqual(entry.Key, key) ? &entry.Value : NULL;
+							}
+							if (!(node->nodeMap & bit))
+								return NULL;
+							node = AsNode(node->children[Index(node->nodeMap, bit)]);
+						}
+					}
+
+					// a node at shift holding two entries whose keys differ
+					Object Pair(Entry const& a, uint hashA, Entry const& b, uint hashB, int shift) const {
+						Node* node = new Node();
+						if (shift >= HashBits) {
+							node->collision = true;
+							node->InsertEntry(0, a);
+							node->InsertEntry(1, b);
+							return Adopt(node);
+						}
+						uint slotA = (hashA >> shift) & Mask;
+						uint slotB = (hashB >> shift) & Mask;
+						if (slotA == slotB) {
+							node->nodeMap = 1u << slotA;
+							node->InsertChild(0, Pair(a, hashA, b, hashB, shift + Bits));
+						}
+						else {
+							node->dataMap = (1u << slotA) | (1u << slotB);
+							node->InsertEntry(0, slotA < slotB ? a : b);
+							node->InsertEntry(1, slotA < slotB ? b : a);
+						}
+						return Adopt(node);
+					}
+
+					// returns true if an entry was added, false if the value of the key was replaced
+					bool Set(Object& slot, Entry const& entry, uint hash, int shift, bool inPlace) const {
+						Node* node = AsNode(slot);
+						if (node->collision) {
+							for (int i = 0; i < node->entryCount; i++) {
+								if (AreEqual(node->entries[i].Key, entry.Key)) {
+									Edit(slot, inPlace)->entries[i].Value = entry.Value;
+									return false;
+								}
+							}
+							node = Edit(slot, inPlace);
+							node->InsertEntry(node->entryCount, entry);
+							return true;
+						}
+						uint bit = 1u << ((hash >> shift) & Mask);
+						if (node->dataMap & bit) {
+							int index = Index(node->dataMap, bit);
+							if (AreEqual(node->entries[index].Key, entry.Key)) {
+								Edit(slot, inPlace)->entries[index].Value = entry.Value;
+								return false;
+							}
+							// two keys for one slot, both move to a new child
+							Object child = Pair(node->entries[index], HashOf(node->entries[index].Key), entry, hash, shift + Bits);
+							node = Edit(slot, inPlace);
+							node->RemoveEntry(index);
+							node->dataMap ^= bit;
+							node->nodeMap |= bit;
+							node->InsertChild(Index(node->nodeMap, bit), std::move(child));
+							return true;
+						}
+						node = Edit(slot, inPlace);
+						if (node->nodeMap & bit)
+							return Set(node->children[Index(node->nodeMap, bit)], entry, hash, shift + Bits, inPlace);
+						node->dataMap |= bit;
+						node->InsertEntry(Index(node->dataMap, bit), entry);
+						return true;
+					}
+
+					// key is known to be present
+					void Remove(Object& slot, TKey const& key, uint hash, int shift, bool inPlace) const {
+						Node* node = Edit(slot, inPlace);
+						if (node->collision) {
+							for (int i = 0; i < node->entryCount; i++) {
+								if (AreEqual(node->entries[i].Key, key)) {
+									node->RemoveEntry(i);
+									return;
+								}
+							}
+							return;
+						}
+						uint bit = 1u << ((hash >> shift) & Mask);
+						if (node->dataMap & bit) {
+							node->RemoveEntry(Index(node->dataMap, bit));
+							node->dataMap ^= bit;
+							return;
+						}
+						int index = Index(node->nodeMap, bit);
+						Remove(node->children[index], key, hash, shift + Bits, inPlace);
+						Node* child = AsNode(node->children[index]);
+						if (!child->childCount && child->entryCount == 1) {
+							// a child with a single entry is folded into this node, so equal contents have equal shapes
+							Entry last = child->entries[0];
+							node->RemoveChild(index);
+							node->nodeMap ^= bit;
+							node->dataMap |= bit;
+							node->InsertEntry(Index(node->dataMap, bit), last);
+						}
+					}
+
+					void SetItem(TKey const& key, TValue const& value, bool inPlace) {
+						if (!root.od)
+							root = Adopt(new Node());
+						if (Set(root, Entry(key, value), HashOf(key), 0, inPlace))
+							count++;
+					}
+
+					void Add(TKey const& key, TValue const& value, bool inPlace) {
+						if (Find(key))
+							throw Exception();
+						SetItem(key, value, inPlace);
+					}
+
+					bool Remove(TKey const& key, bool inPlace) {
+						if (!Find(key))
+							return false;
+						Remove(root, key, HashOf(key), 0, inPlace);
+						count--;
+						return true;
+					}
+				};
+
+				class System_API ObjectData : public Object::ObjectData {
+				public:
+					Trie trie;
+
+					ObjectData() : trie(null) {}
+
+					ObjectData(Trie const& trie) : trie(trie) {}
+				};
+
+				/// <summary>Enumerates the entries of one version: entries of a node first, then its children.</summary>
+				class System_API Iterator
+				{
+				private:
+					// a node per level plus a collision node
+					Node* nodes[HashBits / Bits + 2];
+					int next[HashBits / Bits + 2];
+					int depth;
+					Entry const* cur;
+
+					void Advance() {
+						while (depth >= 0) {
+							Node* node = nodes[depth];
+							int pos = next[depth]++;
+							if (pos < node->entryCount) {
+								cur = &node->entries[pos];
+								return;
+							}
+							pos -= node->entryCount;
+							if (pos < node->childCount) {
+								depth++;
+								nodes[depth] = Trie::AsNode(node->children[pos]);
+								next[depth] = 0;
+							}
+							else
+								depth--;
+						}
+						cur = nullptr;
+					}
+
+				public:
+					Iterator(Object const& root) : depth(-1), cur(nullptr) {
+						if (root.od) {
+							nodes[0] = Trie::AsNode(root);
+							next[0] = 0;
+							depth = 0;
+							Advance();
+						}
+					}
+
+					Entry const& operator*() const {
+						return *cur;
+					}
+
+					Entry const* operator->() const {
+						return cur;
+					}
+
+					Iterator& operator++() {
+						Advance();
+						return *this;
+					}
+
+					bool operator!=(Iterator const& other) const {
+						return cur != other.cur;
+					}
+
+					bool operator==(Iterator const& other) const {
+						return cur == other.cur;
+					}
+				};
+
+				/// <summary>Collects many changes to a dictionary without a new version per change: the nodes it copied
+				/// are its own and change in place. ToImmutable returns the current contents as an ImmutableDictionary.</summary>
+				class System_API Builder : public Object {
+				private:
+					int Get_Count() const {
+						return GOD()->trie.count;
+					}
+
+				public:
+					class System_API ObjectData : public Object::ObjectData {
+					public:
+						Trie trie;
+
+						ObjectData() : trie(null) {}
+
+						ObjectData(Trie const& trie) : trie(trie) {}
+					};
+
+					/// <summary>Gets the number of entries.</summary>
+					PropGenGet<int, Builder, &Builder::Get_Count> Count{ this };
+
+					ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+					Builder(){}
+
+					Builder(std::nullptr_t const & n) : System::Object(n) {
+					}
+
+					Builder(Builder* pValue) {
+						if (!pValue->od) {
+							ObjectData* dd = new ObjectData();
+							od = dd;
+						}
+						else {
+							od = pValue->od;
+							pValue->od = nullptr;
+						}
+						delete pValue;
+					}
+
+					Builder(Builder const & other) : System::Object(other) { }
+
+					Builder(Builder&& other) noexcept : System::Object(std::move(other)) { }
+
+					Builder(Object::ObjectData* other) : System::Object(other) {
+					}
+
+					Builder& operator=(Builder const & other) {
+						System::Object::operator=(other);
+						return *this;
+					}
+
+					Builder& operator=(std::nullptr_t const & n) {
+						System::Object::operator=(n);
+						return *this;
+					}
+
+					Builder& operator=(Builder&& other) noexcept {
+						System::Object::operator=(std::move(other));
+						return *this;
+					}
+
+					Builder& operator=(Builder* other) {
+						if (od == other->od)
+							return *this;
+						Release();
+						od = other->od;
+						::operator delete((void*)other);
+						return *this;
+					}
+
+					Builder* operator->() {
+						return this;
+					}
+
+
+
+					bool TryGetValue(TKey const& key, TValue& value) const {
+						TValue* found = GOD()->trie.Find(key);
+						if (!found)
+							return false;
+						value = *found;
+						return true;
+					}
+
+					bool ContainsKey(TKey const& key) const {
+						return GOD()->trie.Find(key) != NULL;
+					}
+
+					/// <summary>Adds an entry. Throws Exception if the key is already present.</summary>
+					void Add(TKey const& key, TValue const& value) const {
+						GOD()->trie.Add(key, value, true);
+					}
+
+					/// <summary>Adds an entry or replaces the value of the key.</summary>
+					void SetItem(TKey const& key, TValue const& value) const {
+						GOD()->trie.SetItem(key, value, true);
+					}
+
+					bool Remove(TKey const& key) const {
+						return GOD()->trie.Remove(key, true);
+					}
+
+					void Clear() const {
+						Trie& trie = GOD()->trie;
+						trie.root = null;
+						trie.count = 0;
+					}
+
+					/// <summary>The current contents as an ImmutableDictionary, later changes to the builder do not affect it.</summary>
+					ImmutableDictionary<TKey, TValue> ToImmutable() const {
+						return ImmutableDictionary<TKey, TValue>::FromTrie(GOD()->trie);
+					}
+
+					Iterator begin() const {
+						return Iterator(GOD()->trie.root);
+					}
+					Iterator end() const {
+						return Iterator(null);
+					}
+				};
+
+			private:
+				static ImmutableDictionary<TKey, TValue> FromTrie(Trie const& trie) {
+					ImmutableDictionary<TKey, TValue> ret;
+					ret.od = new ObjectData(trie);
+					return ret;
+				}
+
+			public:
+				/// <summary>Gets the number of entries.</summary>
+				PropGenGet<int, ImmutableDictionary<TKey, TValue>, &ImmutableDictionary<TKey, TValue>::Get_Count> Count{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				ImmutableDictionary(){}
+
+				ImmutableDictionary(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				ImmutableDictionary(ImmutableDictionary* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				ImmutableDictionary(ImmutableDictionary const & other) : System::Object(other) { }
+
+				ImmutableDictionary(ImmutableDictionary&& other) noexcept : System::Object(std::move(other)) { }
+
+				ImmutableDictionary(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				ImmutableDictionary& operator=(ImmutableDictionary const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ImmutableDictionary& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ImmutableDictionary& operator=(ImmutableDictionary&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ImmutableDictionary& operator=(ImmutableDictionary* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ImmutableDictionary* operator->() {
+					return this;
+				}
+
+
+
+				/// <summary>An empty dictionary that compares keys with comparer.</summary>
+				ImmutableDictionary(Generic::IEqualityComparer<TKey> const& comparer) {
+					this->od = new ObjectData(Trie(comparer));
+				}
+
+				/// <summary>Gets the value of the key. Throws ArgumentOutOfRangeException if the key is not present.</summary>
+				TValue const& operator[](TKey const& key) const {
+					TValue* found = GOD()->trie.Find(key);
+					if (!found)
+						throw ArgumentOutOfRangeException();
+					return *found;
+				}
+
+				bool TryGetValue(TKey const& key, TValue& value) const {
+					TValue* found = GOD()->trie.Find(key);
+					if (!found)
+						return false;
+					value = *found;
+					return true;
+				}
+
+				bool ContainsKey(TKey const& key) const {
+					return GOD()->trie.Find(key) != NULL;
+				}
+
+				bool IsEmpty() const {
+					return GOD()->trie.count == 0;
+				}
+
+				/// <summary>A new dictionary with the entry added. Throws Exception if the key is already present.</summary>
+				ImmutableDictionary<TKey, TValue> Add(TKey const& key, TValue const& value) const {
+					Trie trie = GOD()->trie;
+					trie.Add(key, value, false);
+					return FromTrie(trie);
+				}
+
+				/// <summary>A new dictionary with the entry added or the value of the key replaced.</summary>
+				ImmutableDictionary<TKey, TValue> SetItem(TKey const& key, TValue const& value) const {
+					Trie trie = GOD()->trie;
+					trie.SetItem(key, value, false);
+					return FromTrie(trie);
+				}
+
+				/// <summary>A new dictionary without the key, or this one if the key is not present.</summary>
+				ImmutableDictionary<TKey, TValue> Remove(TKey const& key) const {
+					Trie trie = GOD()->trie;
+					if (!trie.Remove(key, false))
+						return *this;
+					return FromTrie(trie);
+				}
+
+				/// <summary>An empty dictionary with the same comparer.</summary>
+				ImmutableDictionary<TKey, TValue> Clear() const {
+					return FromTrie(Trie(GOD()->trie.comparer));
+				}
+
+				/// <summary>A builder starting with the entries of this dictionary, it shares the nodes until it changes them.</summary>
+				Builder ToBuilder() const {
+					Builder ret;
+					ret.od = new typename Builder::ObjectData(GOD()->trie);
+					return ret;
+				}
+
+				Iterator begin() const {
+					return Iterator(GOD()->trie.root);
+				}
+				Iterator end() const {
+					return Iterator(null);
+				}
+			};
+		}
+	}
+
+	System::Collections::Generic::Array<string> String::Split(char const c) {
+		System::Collections::Generic::List<string> lst = new System::Collections::Generic::List<string>();
+		char16_t* rawBytes = ToCharArray();
+		int startpos = 0;
+		for (int i = 0; i < Length; i++) {
+			if (rawBytes[i] == c) {
+				string str(rawBytes + startpos, i - startpos);
+				lst.Add(str);
+				startpos = i + 1;
+			}
+		}
+		string str(rawBytes + startpos, Length - startpos);
+		lst.Add(str);
+
+		return lst.ToArray();
+	}
+
+	namespace Linq {
+
+		// Compile-time LINQ. Every query stage is a template expression type that keeps the type of the
+		// user's lambda, so unlike the Func<T, R> based IEnumerable<T> operators the whole chain can be
+		// inlined (and auto-vectorised) by the compiler. Stages push their elements into a sink, the sink
+		// returns false to stop the enumeration early. Conversion to the runtime List<T>/IEnumerable<T>
+		// only happens at the boundary (ToList, ToArray, ToEnumerable).
+		// Contiguous sources and the Where/Select stages can also enumerate an index range, which is what
+		// ParallelQuery (AsParallel) uses to partition the source over the thread pool.
+		//
+		//    int sum = Linq::From(lst).Where([](int x) { return x > 500; }).Select([](int x) { return x * 2; }).Sum();
+
+		template<class T> class ListSource {
+		private:
+			System::Collections::Generic::List<T> lst;
+		public:
+			typedef T value_type;
+
+			ListSource(System::Collections::Generic::List<T> const& lst) : lst(lst) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				// read the buffer when the query executes, not when it is composed (deferred execution)
+				return ForEachRange(0, lst.GOD()->Count, sink);
+			}
+
+			template<class Sink> bool ForEachRange(int begin, int end, Sink& sink) const {
+				T const* dta = lst.GOD()->arrdta;
+				for (int i = begin; i < end; i++) {
+					if (!sink(dta[i]))
+						return false;
+				}
+				return true;
+			}
+
+			int GetCountHint() const {
+				return lst.GOD()->Count;
+			}
+		};
+
+		template<class T> class ArraySource {
+		private:
+			System::Collections::Generic::Array<T> arr;
+		public:
+			typedef T value_type;
+
+			ArraySource(System::Collections::Generic::Array<T> const& arr) : arr(arr) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				return ForEachRange(0, (int)arr.GOD()->Length, sink);
+			}
+
+			template<class Sink> bool ForEachRange(int begin, int end, Sink& sink) const {
+				T const* dta = arr.GOD()->arrdta;
+				for (int i = begin; i < end; i++) {
+					if (!sink(dta[i]))
+						return false;
+				}
+				return true;
+			}
+
+			int GetCountHint() const {
+				return (int)arr.GOD()->Length;
+			}
+		};
+
+		// no ownership, the caller keeps the buffer alive for the lifetime of the query
+		template<class T> class PointerSource {
+		private:
+			T const* dta;
+			int count;
+		public:
+			typedef T value_type;
+
+			PointerSource(T const* dta, int count) : dta(dta), count(count) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				return ForEachRange(0, count, sink);
+			}
+
+			template<class Sink> bool ForEachRange(int begin, int end, Sink& sink) const {
+				for (int i = begin; i < end; i++) {
+					if (!sink(dta[i]))
+						return false;
+				}
+				return true;
+			}
+
+			int GetCountHint() const {
+				return count;
+			}
+		};
+
+		// any runtime IEnumerable<T>, walked through the MoveNextGetCurrent function pointer
+		template<class T> class EnumerableSource {
+		private:
+			System::Collections::Generic::IEnumerable<T> enu;
+		public:
+			typedef T value_type;
+
+			EnumerableSource(System::Collections::Generic::IEnumerable<T> const& enu) : enu(enu) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				System::Collections::Generic::IEnumerator<T> it = enu.GetEnumerator();
+				typename System::Collections::Generic::IEnumerator<T>::MoveNextGetCurrentFN* mngc = it.GetFP_MoveNextGetCurrent();
+				T* cur;
+				while ((cur = mngc(it.od)) != null) {
+					if (!sink(*cur))
+						return false;
+				}
+				return true;
+			}
+
+			int GetCountHint() const {
+				return 0;
+			}
+		};
+
+		template<class Src, class F> class WhereExpr {
+		private:
+			Src src;
+			F predicate;
+		public:
+			typedef typename Src::value_type value_type;
+
+			WhereExpr(Src const& src, F const& predicate) : src(src), predicate(predicate) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				F const& pred = predicate;
+				auto stage = [&pred, &sink](value_type const& value) -> bool {
+					return pred(value) ? sink(value) : true;
+				};
+				return src.ForEach(stage);
+			}
+
+			template<class Sink> bool ForEachRange(int begin, int end, Sink& sink) const {
+				F const& pred = predicate;
+				auto stage = [&pred, &sink](value_type const& value) -> bool {
+					return pred(value) ? sink(value) : true;
+				};
+				return src.ForEachRange(begin, end, stage);
+			}
+
+			int GetCountHint() const {
+				return src.GetCountHint();
+			}
+		};
+
+		template<class Src, class F> class SelectExpr {
+		private:
+			Src src;
+			F selector;
+		public:
+			typedef typename std::decay<decltype(std::declval<F const&>()(std::declval<typename Src::value_type const&>()))>::type value_type;
+
+			SelectExpr(Src const& src, F const& selector) : src(src), selector(selector) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				F const& sel = selector;
+				auto stage = [&sel, &sink](typename Src::value_type const& value) -> bool {
+					return sink(sel(value));
+				};
+				return src.ForEach(stage);
+			}
+
+			template<class Sink> bool ForEachRange(int begin, int end, Sink& sink) const {
+				F const& sel = selector;
+				auto stage = [&sel, &sink](typename Src::value_type const& value) -> bool {
+					return sink(sel(value));
+				};
+				return src.ForEachRange(begin, end, stage);
+			}
+
+			int GetCountHint() const {
+				return src.GetCountHint();
+			}
+		};
+
+		template<class Src> class TakeExpr {
+		private:
+			Src src;
+			int count;
+		public:
+			typedef typename Src::value_type value_type;
+
+			TakeExpr(Src const& src, int count) : src(src), count(count) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				int remaining = count;
+				if (remaining <= 0)
+					return true;
+				bool stopped = false;
+				auto stage = [&remaining, &stopped, &sink](value_type const& value) -> bool {
+					if (!sink(value)) {
+						stopped = true;
+						return false;
+					}
+					return --remaining > 0;
+				};
+				src.ForEach(stage);
+				return !stopped;
+			}
+
+			int GetCountHint() const {
+				int hint = src.GetCountHint();
+				return hint < count ? hint : count;
+			}
+		};
+
+		template<class Src> class SkipExpr {
+		private:
+			Src src;
+			int count;
+		public:
+			typedef typename Src::value_type value_type;
+
+			SkipExpr(Src const& src, int count) : src(src), count(count) {}
+
+			template<class Sink> bool ForEach(Sink& sink) const {
+				int toskip = count;
+				auto stage = [&toskip, &sink](value_type const& value) -> bool {
+					if (toskip > 0) {
+						--toskip;
+						return true;
+					}
+					return sink(value);
+				};
+				return src.ForEach(stage);
+			}
+
+			int GetCountHint() const {
+				int hint = src.GetCountHint() - count;
+				return hint > 0 ? hint : 0;
+			}
+		};
+
+		template<class F> class KeyCompare;
+		template<class Src, class Cmp> class OrderedQuery;
+
+		template<class Expr> class Query {
+		protected:
+			Expr expr;
+		public:
+			typedef typename Expr::value_type value_type;
+
+			explicit Query(Expr const& expr) : expr(expr) {}
+
+			/// <summary>Filters a sequence of values based on a predicate.</summary>
+			template<class F> Query<WhereExpr<Expr, F>> Where(F const& predicate) const {
+				return Query<WhereExpr<Expr, F>>(WhereExpr<Expr, F>(expr, predicate));
+			}
+
+			/// <summary>Projects each element of a sequence into a new form.</summary>
+			template<class F> Query<SelectExpr<Expr, F>> Select(F const& selector) const {
+				return Query<SelectExpr<Expr, F>>(SelectExpr<Expr, F>(expr, selector));
+			}
+
+			/// <summary>Returns a specified number of contiguous elements from the start of a sequence.</summary>
+			Query<TakeExpr<Expr>> Take(int count) const {
+				return Query<TakeExpr<Expr>>(TakeExpr<Expr>(expr, count));
+			}
+
+			/// <summary>Bypasses a specified number of elements in a sequence and then returns the remaining elements.</summary>
+			Query<SkipExpr<Expr>> Skip(int count) const {
+				return Query<SkipExpr<Expr>>(SkipExpr<Expr>(expr, count));
+			}
+
+			/// <summary>Sorts the elements of a sequence in ascending order according to a key. The sort is stable.</summary>
+			template<class F> OrderedQuery<Expr, KeyCompare<F>> OrderBy(F const& keySelector) const;
+
+			/// <summary>Sorts the elements of a sequence in descending order according to a key. The sort is stable.</summary>
+			template<class F> OrderedQuery<Expr, KeyCompare<F>> OrderByDescending(F const& keySelector) const;
+
+			/// <summary>Performs the specified action on each element of the sequence.</summary>
+			template<class F> void ForEach(F const& action) const {
+				auto sink = [&action](value_type const& value) -> bool {
+					action(value);
+					return true;
+				};
+				expr.ForEach(sink);
+			}
+
+			int Count() const {
+				int ret = 0;
+				auto sink = [&ret](value_type const&) -> bool {
+					ret++;
+					return true;
+				};
+				expr.ForEach(sink);
+				return ret;
+			}
+
+			template<class F> int Count(F const& predicate) const {
+				return Where(predicate).Count();
+			}
+
+			bool Any() const {
+				bool ret = false;
+				auto sink = [&ret](value_type const&) -> bool {
+					ret = true;
+					return false;
+				};
+				expr.ForEach(sink);
+				return ret;
+			}
+
+			template<class F> bool Any(F const& predicate) const {
+				return Where(predicate).Any();
+			}
+
+			template<class F> bool All(F const& predicate) const {
+				auto sink = [&predicate](value_type const& value) -> bool {
+					return predicate(value);
+				};
+				return expr.ForEach(sink);
+			}
+
+			value_type First() const {
+				bool gotone = false;
+				value_type ret{};
+				auto sink = [&ret, &gotone](value_type const& value) -> bool {
+					ret = value;
+					gotone = true;
+					return false;
+				};
+				expr.ForEach(sink);
+				if (!gotone)
+					throw InvalidOperationException();
+				return ret;
+			}
+
+			value_type FirstOrDefault() const {
+				value_type ret{};
+				auto sink = [&ret](value_type const& value) -> bool {
+					ret = value;
+					return false;
+				};
+				expr.ForEach(sink);
+				return ret;
+			}
+
+			value_type Sum() const {
+				value_type ret{};
+				auto sink = [&ret](value_type const& value) -> bool {
+					ret += value;
+					return true;
+				};
+				expr.ForEach(sink);
+				return ret;
+			}
+
+			double Average() const {
+				value_type sum{};
+				int count = 0;
+				auto sink = [&sum, &count](value_type const& value) -> bool {
+					sum += value;
+					count++;
+					return true;
+				};
+				expr.ForEach(sink);
+				if (!count)
+					throw InvalidOperationException();
+				return (double)sum / count;
+			}
+
+			value_type Max() const {
+				bool gotone = false;
+				value_type ret{};
+				auto sink = [&ret, &gotone](value_type const& value) -> bool {
+					if (!gotone || ret < value) {
+						ret = value;
+						gotone = true;
+					}
+					return true;
+				};
+				expr.ForEach(sink);
+				if (!gotone)
+					throw InvalidOperationException();
+				return ret;
+			}
+
+			value_type Min() const {
+				bool gotone = false;
+				value_type ret{};
+				auto sink = [&ret, &gotone](value_type const& value) -> bool {
+					if (!gotone || value < ret) {
+						ret = value;
+						gotone = true;
+					}
+					return true;
+				};
+				expr.ForEach(sink);
+				if (!gotone)
+					throw InvalidOperationException();
+				return ret;
+			}
+
+			template<class TAccumulate, class F> TAccumulate Aggregate(TAccumulate seed, F const& func) const {
+				auto sink = [&seed, &func](value_type const& value) -> bool {
+					seed = func(seed, value);
+					return true;
+				};
+				expr.ForEach(sink);
+				return seed;
+			}
+
+			System::Collections::Generic::List<value_type> ToList() const {
+				System::Collections::Generic::List<value_type> ret(expr.GetCountHint());
+				typename System::Collections::Generic::List<value_type>::ObjectData* ld = ret.GOD();
+				auto sink = [ld](value_type const& value) -> bool {
+					ld->Add(value);
+					return true;
+				};
+				expr.ForEach(sink);
+				return ret;
+			}
+
+			System::Collections::Generic::Array<value_type> ToArray() const {
+				return ToList().ToArray();
+			}
+
+			System::Collections::Generic::IEnumerable<value_type> ToEnumerable() const {
+				return ToList();
+			}
+
+			operator System::Collections::Generic::List<value_type>() const {
+				return ToList();
+			}
+
+			/// <summary>Enables parallelization of the query. Only queries over a List, Array or pointer source made of Where and Select stages can run in parallel.</summary>
+			ParallelQuery<Expr> AsParallel() const;
+		};
+
+		template<class T> Query<ListSource<T>> From(System::Collections::Generic::List<T> const& lst) {
+			return Query<ListSource<T>>(ListSource<T>(lst));
+		}
+
+		template<class T> Query<ArraySource<T>> From(System::Collections::Generic::Array<T> const& arr) {
+			return Query<ArraySource<T>>(ArraySource<T>(arr));
+		}
+
+		template<class T> Query<PointerSource<T>> From(T const* dta, int count) {
+			return Query<PointerSource<T>>(PointerSource<T>(dta, count));
+		}
+
+		template<class T> Query<EnumerableSource<T>> From(System::Collections::Generic::IEnumerable<T> const& enu) {
+			return Query<EnumerableSource<T>>(EnumerableSource<T>(enu));
+		}
+	}
+
+
+	namespace Dynamic {
+
+		class System_API ExpandoObject : public Object
+		{
+		private:
+
+
+		public:
+			class System_API ObjectData : public System::Collections::Generic::Dictionary<string, Object>::ObjectData {
+			public:
+
+			};
+						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			ExpandoObject(){}
+
+			ExpandoObject(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			ExpandoObject(ExpandoObject* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			ExpandoObject(ExpandoObject const & other) : System::Object(other) { }
+
+			ExpandoObject(ExpandoObject&& other) noexcept : System::Object(std::move(other)) { }
+
+			ExpandoObject(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			ExpandoObject& operator=(ExpandoObject const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			ExpandoObject& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			ExpandoObject& operator=(ExpandoObject&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			ExpandoObject& operator=(ExpandoObject* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			ExpandoObject* operator->() {
+				return this;
+			}
+
+
+
+				System::Object& operator[](string const& key)
+			{
+				ObjectData* dd = GOD();
+				System::Object* val = dd->TryGetValue(key);
+				if (val)
+					return *val;
+				int index = dd->Insert(key, System::Object(), true);
+				return dd->entries[index].Value;
+			}
+		};
+	}
+
+
+	namespace Text {
+		class UTF8Encoding;
+
+		class System_API Encoding : public Object
+		{
+		private:
+
+		public:
+			//	int tst;
+
+			Encoding() {
+				//	tst = 1;
+			}
+
+			static UTF8Encoding UTF8;
+
+			//virtual byte* GetBytes(String* s) {
+			//	throw NotImplementedException();
+			//}
+
+			virtual System::Collections::Generic::Array<byte> GetBytes(String const& s) {
+				/*std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> convert;
+				auto bs = convert.to_bytes(s.ToCharArray());
+
+				byte* bts = new byte[(int)bs.length()];
+				const char* chr = bs.c_str();
+				while (chr) *bts++ = *chr++;
+				return bts;
+				*/
+				//typedef std::codecvt<char16_t, char, mbstate_t> Convert;
+				////std::wstring w = L"\u20ac\u20ab\u20ac";
+				//std::locale locale("en_GB.utf8");
+				//const Convert& convert = std::use_facet<Convert>(locale);
 
 				//std::mbstate_t state;
 				//const char16_t* from_ptr;
@@ -12152,370 +17961,3374 @@ namespace System {
 				//	s.ToCharArray(), s.ToCharArray() + s.Length, from_ptr,
 				//	result.data(), result.data() + result.size(), to_ptr);
 
-				//if (convert_result == Convert::ok)
-				//	std::cout << result.data() << std::endl;
-				//else std::cout << "Failure: " << convert_result << std::endl;
+				//if (convert_result == Convert::ok)
+				//	std::cout << result.data() << std::endl;
+				//else std::cout << "Failure: " << convert_result << std::endl;
+
+				//byte* bts = new byte[strlen(to_ptr)];
+
+				//while (to_ptr) *bts++ = *to_ptr++;
+				//return bts;
+				throw NotImplementedException();
+			}
+
+			virtual String GetString(byte const* bytes, int index, int count) {
+				throw NotImplementedException();
+			}
+
+		};
+
+		class System_API UTF8Encoding : public Encoding
+		{
+		private:
+
+		public:
+			UTF8Encoding() {
+			}
+
+			System::Collections::Generic::Array<byte> GetBytes(String const& s) override {
+				//std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
+				System::Collections::Generic::Array<byte> ret = System::Collections::Generic::Array<byte>::CreateUninitialized((s.Length << 2) + 1);
+				char16_t* chrs = s.ToCharArray();
+				int len = String::utf16_to_utf8(chrs, s.Length, (char*)ret.GOD()->arrdta);
+				ret.GOD()->arrdta[len] = 0;
+				ret.GOD()->Length = len;
+
+				return ret;
+			}
+
+			String GetString(byte const* bytes, int index, int count) override {
+				return String((char const*)(bytes + index), count);
+			}
+
+		};
+
+#ifndef SYSTEM_EXPORTS
+		UTF8Encoding Encoding::UTF8;
+#endif
+
+
+
+
+		namespace RegularExpressions {
+
+			enum class RegexOptions {
+				None = 0x0000,
+				IgnoreCase = 0x0001,
+				Multiline = 0x0002,
+				ExplicitCapture = 0x0004,
+				Compiled = 0x0008,
+				SingleLine = 0x0010,
+				IgnorePatternWhitespace = 0x0020,
+				RightToLeft = 0x0040,
+				ECMAScript = 0x0100,
+				CultureInvariant = 0x0200,
+			};
+
+
+			class System_API Regex : public Object {
+			private:
+			public:
+
+
+
+
+
+
+			};
+
+
+
+		}
+	}
+
+	class System_API Console
+	{
+	private:
+	public:
+
+		static void Write(String const& value) {
+#if _MSC_VER
+			wchar_t* wchrs = (wchar_t*)value.ToCharArray();
+			WriteConsoleW(GetStdHandle(STD_OUTPUT_HANDLE), wchrs, (DWORD)std::wcslen(wchrs), NULL, NULL);
+#elif defined ESP32
+			Serial.print((char const*)(uint8_t const*)System::Text::Encoding::UTF8.GetBytes(value));
+#else	
+
+
+			//std::cout << (int)value.Length << std::endl;
+			System::Collections::Generic::Array<byte> arr = System::Text::Encoding::UTF8.GetBytes(value);
+			byte const* chrs = arr;
+			//for (int i = 0; i < value.Length; i++)
+			//	std::cout << (int)chrs[i] << std::endl;
+			std::cout.write((char const*)chrs, arr.Length);
+			std::cout.flush();
+#endif
+		}
+
+		static void WriteLine(String const& value)
+		{
+			Write(value + u"\r\n");
+			//std::cout << std::endl;
+		}
+
+	};
+
+	namespace Threading {
+		//typedef void(*cfnoparam)(void);
+
+		enum class ApartmentState {
+			STA = 0,
+			MTA = 1,
+			Unknown = 2
+		};
+
+
+
+
+
+		class System_API Thread : public Object
+		{
+		private:
+			bool& Get_IsBackground() const {
+				return GOD()->IsBackground;
+			}
+
+			void Set_IsBackground(const bool& value) {
+				GOD()->IsBackground = value;
+			}
+
+			void Set_IsBackground(bool&& value) {
+				GOD()->IsBackground = value;
+			}
+
+		public:
+			class System_API ObjectData : public Object::ObjectData {
+			public:
+				std::thread* t = nullptr;
+				Action<> act;
+				ApartmentState apstate;
+				bool IsBackground = false;
+
+				ObjectData() : apstate(ApartmentState::MTA) {
+				}
+
+				~ObjectData() override {
+					if (t) {
+						if (IsBackground) {
+							t->detach();
+							delete t; // Yes, you have to delete it by yourself.Once you called std::thread::detach, the thread will be separated from the thread object and allowed execution to continue independently, and then the thread object will no longer own any thread.
+							t = nullptr;
+						}
+						else {
+							if (t->get_id() != std::this_thread::get_id()) {
+								t->join();
+								delete t;
+								t = nullptr;
+							}
+							else {
+								// we're on the t thread trying to delete ourselves, this happens for threads that aren't referenced anymore by anything but itself
+								// not sure if this is the correct/best way to handle this but it seems to work at least on MVC
+								// we skip calling the std::thread destructor and just release the memory:
+								::operator delete(t);
+							}
+
+						}
+					}
+				}
+			};
+
+
+						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			Thread(){}
+
+			Thread(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			Thread(Thread* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			Thread(Thread const & other) : System::Object(other) { }
+
+			Thread(Thread&& other) noexcept : System::Object(std::move(other)) { }
+
+			Thread(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			Thread& operator=(Thread const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			Thread& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			Thread& operator=(Thread&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			Thread& operator=(Thread* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			Thread* operator->() {
+				return this;
+			}
+
+
+
+			Thread(Action<> const & act)
+			{
+				ObjectData* dd = new ObjectData();
+				dd->act = act;
+				od = dd;
+			}
+
+			Thread(Action<>&& act)
+			{
+				ObjectData* dd = new ObjectData();
+				dd->act = std::move(act);
+				od = dd;
+			}
+
+
+			static void Sleep(int millisecondsTimeout)
+			{
+				std::chrono::milliseconds dura(millisecondsTimeout);
+				std::this_thread::sleep_for(dura);
+			}
+
+			static void Yield() {
+				std::this_thread::yield();
+			}
+
+			static void SpinWait(int iterations) {
+				for (int i = 0; i < iterations; i++) {
+					PAUSE();
+				}
+			}
+
+			//Thread(int id)
+			//{
+			//	ManagedThreadId = id;
+			//}
+
+			static Thread _CurrentThread;
+
+			void Start() {
+				ObjectData* td = GOD();
+				Thread& t = *this;
+				//ApartmentState apstate = td->apstate;
+				td->t = new std::thread([t]() {
+
+					ObjectData* td = t.GOD();
+					//#if _MSC_VER
+#ifdef _MSC_VER
+					HRESULT comhandle = CoInitializeEx(0, td->apstate == ApartmentState::STA ? COINIT_APARTMENTTHREADED : COINIT_MULTITHREADED);
+#endif
+					try {
+						td->act();
+					}
+					catch (...) {
+						//#if _MSC_VER
+#ifdef _MSC_VER
+						CoUninitialize();
+#endif
+						throw;
+					}
+					//#if _MSC_VER
+#ifdef _MSC_VER
+					CoUninitialize();
+#endif
+					});
+			}
+
+			//void Start(Object parameter)
+			//{
+			//	t = std::thread(func, parameter);
+			//}
+
+			void Join() {
+				ObjectData* td = GOD();
+				td->t->join();
+				delete td->t;
+				td->t = nullptr;
+			}
+
+			void SetApartmentState(ApartmentState state) {
+				GOD()->apstate = state;
+			}
+
+
+
+			PropGen<bool, bool, System::Threading::Thread, &System::Threading::Thread::Get_IsBackground, &System::Threading::Thread::Set_IsBackground, &System::Threading::Thread::Set_IsBackground> IsBackground{ this };// = PropGen<bool&, bool, System::Threading::Thread, &System::Threading::Thread::Get_IsBackground, &System::Threading::Thread::Set_IsBackground>(this);
+		};
+
+		class System_API Timeout {
+		public:
+			static const int Infinite = -1;
+			static const uint UnsignedInfinite = (uint)-1;
+
+		};
+
+
+		class System_API SpinWait : System::Object {
+		private:
+			static const int YIELD_THRESHOLD = 10;
+			static const int SLEEP_0_EVERY_HOW_MANY_TIMES = 5;
+			static const int SLEEP_1_EVERY_HOW_MANY_TIMES = 20;
+
+			int Get_Count() const {
+				return GOD()->m_count;
+			}
+
+			bool Get_NextSpinWillYield() const {
+				return GOD()->NextSpinWillYield();
+			}
+
+		public:
+			class System_API ObjectData : System::Object::ObjectData {
+			private:
+				int m_count = 0;
+
+				friend class SpinWait;
+			public:
+				ObjectData() : System::Object::ObjectData(0) {}
+
+				Object::ObjectData* DeepCopy() override {
+					ObjectData* ret = new ObjectData();
+					ret->m_count = m_count;
+
+					return ret;
+				}
+
+				bool NextSpinWillYield() {
+					return SpinWait::WillYield(m_count);
+				}
+
+				void SpinOnce() {
+					SpinWait::SpinOnce(ref(m_count));
+				}
+
+				void Reset() {
+					m_count = 0;
+				}
+
+
+
+			};
+			PropGenGet<int, SpinWait, &SpinWait::Get_Count> Count{ this };
+			PropGenGet<bool, SpinWait, &SpinWait::Get_NextSpinWillYield> NextSpinWillYield{ this };
+
+						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			SpinWait(){}
+
+			SpinWait(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			SpinWait(SpinWait* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			SpinWait(SpinWait const & other) : System::Object(other) { }
+
+			SpinWait(SpinWait&& other) noexcept : System::Object(std::move(other)) { }
+
+			SpinWait(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			SpinWait& operator=(SpinWait const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			SpinWait& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			SpinWait& operator=(SpinWait&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			SpinWait& operator=(SpinWait* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			SpinWait* operator->() {
+				return this;
+			}
+
+
+
+				void SpinOnce() {
+				GOD()->SpinOnce();
+			}
+
+			void Reset() {
+				GOD()->Reset();
+			}
+
+			// The spin/yield cadence on a counter the caller keeps, for loops that can't afford an object per wait.
+			static bool WillYield(int count) {
+				// hardware_concurrency is a syscall on some platforms, so look it up once
+				static const bool singleCore = Environment::ProcessorCount <= 1;
+				return count > YIELD_THRESHOLD || singleCore;
+			}
+
+			static void SpinOnce(Ref<int> count) {
+				int current = count;
+				if (WillYield(current)) {
+					int yieldsSoFar = current >= YIELD_THRESHOLD ? current - YIELD_THRESHOLD : current;
+					if ((yieldsSoFar % SLEEP_1_EVERY_HOW_MANY_TIMES) == SLEEP_1_EVERY_HOW_MANY_TIMES - 1) {
+						Thread::Sleep(1);
+					}
+					else if ((yieldsSoFar % SLEEP_0_EVERY_HOW_MANY_TIMES) == SLEEP_0_EVERY_HOW_MANY_TIMES - 1) {
+						Thread::Sleep(0);
+					}
+					else {
+						Thread::Yield();
+					}
+				}
+				else {
+					Thread::SpinWait(4 << current);
+				}
+
+				count = current == Int32::MaxValue ? YIELD_THRESHOLD : current + 1;
+			}
+
+			static bool SpinUntil(const Func<bool>& condition, int millisecondsTimeout) {
+				if (millisecondsTimeout < Timeout::Infinite)
+					throw ArgumentOutOfRangeException();
+				if (condition == null)
+					throw ArgumentNullException();
+				uint startTime = 0;
+				if (millisecondsTimeout != 0 && millisecondsTimeout != Timeout::Infinite) {
+					startTime = (uint)Environment::TickCount;
+				}
+				int count = 0;
+				while (!condition()) {
+					if (millisecondsTimeout == 0)
+						return false;
+					SpinOnce(ref(count));
+					if (millisecondsTimeout != Timeout::Infinite && WillYield(count)) {
+						if (millisecondsTimeout <= (Environment::TickCount - (int)startTime))
+							return false;
+					}
+				}
+
+				return true;
+			}
+
+
+
+
+		};
+
+
+		class System_API SpinLock : public System::Object {
+		private:
+			bool Get_IsHeld() const {
+				return GOD()->IsHeld();
+			}
+
+			bool Get_IsHeldByCurrentThread() const {
+				return GOD()->IsHeldByCurrentThread();
+			}
+
+			bool Get_IsThreadOwnerTrackingEnabled() const {
+				return GOD()->trackOwner;
+			}
+
+		public:
+			// Test-and-test-and-set with exponential backoff, parking on the lock word once spinning stops paying off.
+			// state is 0 when free, 1 when held and 2 when held with (possibly) parked waiters, so an uncontended Exit
+			// is a single exchange and only wakes somebody when a waiter announced itself.
+			class ObjectData : public System::Object::ObjectData {
+			private:
+				static const int SpinLimit = 7;
+
+				std::atomic<int> state;
+				std::atomic<uintptr_t> owner;
+				bool trackOwner;
+
+				friend class SpinLock;
+
+				static uintptr_t Self() {
+					static tlocal char token;
+					return (uintptr_t)&token;
+				}
+
+				bool TryAcquire() {
+					int expected = 0;
+					return state.load(std::memory_order_relaxed) == 0 && state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+				}
+
+				void Park() {
+#if defined(__cpp_lib_atomic_wait)
+					state.wait(2, std::memory_order_relaxed);
+#else
+					Thread::Yield();
+#endif
+				}
+
+				void Unpark() {
+#if defined(__cpp_lib_atomic_wait)
+					state.notify_one();
+#endif
+				}
+
+				void EnterContended() {
+					// spin only while SpinWait would still pause (never on a single core, where the holder needs our cpu),
+					// and stop early once somebody parked so new arrivals queue behind it
+					int spins = 0;
+					while (spins < SpinLimit && !SpinWait::WillYield(spins)) {
+						int current = state.load(std::memory_order_relaxed);
+						if (current == 0) {
+							if (state.compare_exchange_weak(current, 1, std::memory_order_acquire, std::memory_order_relaxed))
+								return;
+						}
+						else if (current == 2)
+							break;
+						SpinWait::SpinOnce(ref(spins));
+					}
+					// we don't know if others are still parked, so whoever wins from here on leaves the lock marked as contended
+					while (state.exchange(2, std::memory_order_acquire) != 0)
+						Park();
+				}
+
+			public:
+
+				ObjectData(bool enableThreadOwnerTracking = true) : state(0), owner(0), trackOwner(enableThreadOwnerTracking) {
+				}
+
+				void Enter(Ref<bool> lockTaken) {
+					if (trackOwner && owner.load(std::memory_order_relaxed) == Self())
+						throw InvalidOperationException();
+					if (!TryAcquire())
+						EnterContended();
+					if (trackOwner)
+						owner.store(Self(), std::memory_order_relaxed);
+
+					lockTaken = true;
+				}
+
+				void Exit() {
+					if (trackOwner) {
+						if (owner.load(std::memory_order_relaxed) != Self())
+							throw InvalidOperationException();
+						owner.store(0, std::memory_order_relaxed);
+					}
+					if (state.exchange(0, std::memory_order_release) == 2)
+						Unpark();
+				}
+
+				void TryEnter(Ref<bool> lockTaken) {
+					if (trackOwner && owner.load(std::memory_order_relaxed) == Self())
+						throw InvalidOperationException();
+					bool taken = TryAcquire();
+					if (taken && trackOwner)
+						owner.store(Self(), std::memory_order_relaxed);
+
+					lockTaken = taken;
+				}
+
+				bool IsHeld() const {
+					return state.load(std::memory_order_relaxed) != 0;
+				}
+
+				bool IsHeldByCurrentThread() const {
+					if (!trackOwner)
+						throw InvalidOperationException();
+					return owner.load(std::memory_order_relaxed) == Self();
+				}
+			};
+
+			PropGenGet<bool, SpinLock, &SpinLock::Get_IsHeld> IsHeld{ this };
+			PropGenGet<bool, SpinLock, &SpinLock::Get_IsHeldByCurrentThread> IsHeldByCurrentThread{ this };
+			PropGenGet<bool, SpinLock, &SpinLock::Get_IsThreadOwnerTrackingEnabled> IsThreadOwnerTrackingEnabled{ this };
+
+			// Holds the lock for its lifetime.
+			class Guard {
+			private:
+				ObjectData* lock;
+
+			public:
+				Guard(SpinLock const& spinLock) : lock(spinLock.GOD()) {
+					bool taken = false;
+					lock->Enter(ref(taken));
+				}
+
+				~Guard() {
+					lock->Exit();
+				}
+
+				Guard(Guard const&) = delete;
+				Guard& operator=(Guard const&) = delete;
+			};
+
+						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			SpinLock(){}
+
+			SpinLock(bool enableThreadOwnerTracking) {
+				this->od = new ObjectData(enableThreadOwnerTracking);
+			}
+
+			SpinLock(std::nullptr_t const & n) : System::Object(n) {
+			}
+
+			SpinLock(SpinLock* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
+
+			SpinLock(SpinLock const & other) : System::Object(other) { }
+
+			SpinLock(SpinLock&& other) noexcept : System::Object(std::move(other)) { }
+
+			SpinLock(Object::ObjectData* other) : System::Object(other) {
+			}
+
+			SpinLock& operator=(SpinLock const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			SpinLock& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
+
+			SpinLock& operator=(SpinLock&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
+
+			SpinLock& operator=(SpinLock* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
+
+			SpinLock* operator->() {
+				return this;
+			}
+
+
+
+				void Enter(Ref<bool> lockTaken) {
+				GOD()->Enter(lockTaken);
+			}
+
+			void Exit() {
+				GOD()->Exit();
+			}
+
+			void TryEnter(Ref<bool> lockTaken) {
+				GOD()->TryEnter(lockTaken);
+			}
+		};
+
+
+		class System_API WaitHandle : public Object
+		{
+		private:
+			//bool Get_IsCompleted() const { return GOD()->Get_IsCompleted(); }
+			//bool Get_CompletedSynchronously() const { return GOD()->Get_CompletedSynchronously(); };
+			//Object Get_AsyncState() const { return GOD()->Get_AsyncState(); };
+			//System::Threading::WaitHandle Get_AsyncWaitHandle() const { return GOD()->Get_AsyncWaitHandle(); };
+
+		public:
+			class System_API ObjectData {
+			public:
+				ObjectData() {
+				}
+
+				~ObjectData() {
+				}
+
+				//virtual bool Get_IsCompleted() const = 0;
+				//virtual bool Get_CompletedSynchronously() const = 0;
+				//virtual Object Get_AsyncState() const = 0;
+				//virtual System::Threading::WaitHandle Get_AsyncWaitHandle() const = 0;
+			};
+
+					ObjectData* id = nullptr;
+
+		ObjectData* GOD() const { return this->id; };
+
+		WaitHandle(){}
+
+		WaitHandle(std::nullptr_t const & n) : System::Object (nullptr), id(nullptr) {
+		}
+
+		WaitHandle(WaitHandle const & other) : System::Object(other) { this->id = other.id; }
+
+		WaitHandle(WaitHandle&& other) noexcept : System::Object(std::move(other)) { this->id = other.id; other.id = nullptr;  }
+
+		WaitHandle(System::Object::ObjectData* baseod, ObjectData* other) : System::Object(baseod), id(other) {
+		}
+
+		WaitHandle& operator=(WaitHandle const & other) {
+			System::Object::operator=(other);
+			id = other.id;
+			return *this;
+		}
+
+		WaitHandle& operator=(WaitHandle&& other) noexcept {
+			System::Object::operator=(std::move(other));
+			id = other.id;
+			return *this;
+		}
+
+		WaitHandle* operator->() {
+			return this;
+		}
+
+
+
+
+
+		};
+
+		// A pointer and a tag that are compared and swapped as one value. Every successful CompareExchange bumps the tag,
+		// so a node that was popped and pushed again comes back with another tag and a stale compare-and-swap fails (ABA).
+		template<class T> struct TaggedPointer {
+			T* pointer;
+			uintptr_t tag;
+		};
+
+		// The pair is swapped with a double-width compare-and-swap where the target has one (see SYSTEM_DWCAS_*), else the
+		// tag is kept in the top 16 bits of the pointer, which user space addresses leave unused on 64-bit targets.
+		// With the double-width swap the pair must be 2 * ptrsize aligned, which new and the memory pool guarantee.
+		template<class T> class AtomicTaggedPointer {
+		private:
+#if defined(SYSTEM_DWCAS_MSVC) || defined(SYSTEM_DWCAS_X64) || defined(SYSTEM_DWCAS_ARM64) || defined(SYSTEM_DWCAS_64BIT)
+			alignas(2 * sizeof(void*)) std::atomic<uintptr_t> words[2]; // pointer, tag
+
+			// compares the pair with expected and stores desired if they are equal, else loads the pair into expected
+			bool CompareExchangePair(uintptr_t* expected, uintptr_t const* desired) {
+#if defined(SYSTEM_DWCAS_MSVC)
+				return _InterlockedCompareExchange128((__int64 volatile*)words, (__int64)desired[1], (__int64)desired[0], (__int64*)expected) != 0;
+#elif defined(SYSTEM_DWCAS_X64)
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) || defined(__SANITIZE_THREAD__)
+				// -mcx16, the compiler emits cmpxchg16b itself (and the thread sanitizer sees it)
+				unsigned __int128 e, d;
+				memcpy(&e, expected, sizeof(e));
+				memcpy(&d, desired, sizeof(d));
+				unsigned __int128 old = __sync_val_compare_and_swap((unsigned __int128*)words, e, d);
+				if (old == e)
+					return true;
+				memcpy(expected, &old, sizeof(old));
+				return false;
+#else
+				bool ok;
+				__asm__ __volatile__("lock cmpxchg16b %1\n\tsete %0"
+					: "=q"(ok), "+m"(*(unsigned __int128*)words), "+a"(expected[0]), "+d"(expected[1])
+					: "b"(desired[0]), "c"(desired[1])
+					: "cc", "memory");
+				return ok;
+#endif
+#elif defined(SYSTEM_DWCAS_ARM64)
+				uintptr_t e0 = expected[0], e1 = expected[1];
+#if defined(__ARM_FEATURE_ATOMICS)
+				// ARMv8.1 LSE, casp wants its operands in even/odd register pairs
+				register uintptr_t x0 __asm__("x0") = e0;
+				register uintptr_t x1 __asm__("x1") = e1;
+				register uintptr_t x2 __asm__("x2") = desired[0];
+				register uintptr_t x3 __asm__("x3") = desired[1];
+				__asm__ __volatile__("caspal x0, x1, x2, x3, [%[p]]"
+					: "+r"(x0), "+r"(x1)
+					: "r"(x2), "r"(x3), [p] "r"(words)
+					: "memory");
+				expected[0] = x0;
+				expected[1] = x1;
+#else
+				// ARMv8.0, a failed comparison stores the pair back so that the pair it read is one atomic read
+				uintptr_t lo, hi;
+				uint32_t status;
+				__asm__ __volatile__(
+					"1:	ldaxp	%0, %1, [%3]\n"
+					"	cmp	%0, %4\n"
+					"	ccmp	%1, %5, #0, eq\n"
+					"	b.ne	2f\n"
+					"	stlxp	%w2, %6, %7, [%3]\n"
+					"	cbnz	%w2, 1b\n"
+					"	b	3f\n"
+					"2:	stlxp	%w2, %0, %1, [%3]\n"
+					"	cbnz	%w2, 1b\n"
+					"3:\n"
+					: "=&r"(lo), "=&r"(hi), "=&r"(status)
+					: "r"(words), "r"(e0), "r"(e1), "r"(desired[0]), "r"(desired[1])
+					: "cc", "memory");
+				expected[0] = lo;
+				expected[1] = hi;
+#endif
+				return expected[0] == e0 && expected[1] == e1;
+#else
+				// 32-bit target: the pair is one 64-bit word
+				uint64_t e, d;
+				memcpy(&e, expected, sizeof(e));
+				memcpy(&d, desired, sizeof(d));
+#if defined(_MSC_VER)
+				uint64_t old = (uint64_t)_InterlockedCompareExchange64((__int64 volatile*)words, (__int64)d, (__int64)e);
+				bool ok = old == e;
+#else
+				uint64_t old = e;
+				bool ok = __atomic_compare_exchange_n((uint64_t*)words, &old, d, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+				if (!ok)
+					memcpy(expected, &old, sizeof(old));
+				return ok;
+#endif
+			}
+
+		public:
+			static const bool IsDoubleWidth = true;
+
+			AtomicTaggedPointer(T* pointer = nullptr) {
+				words[0].store((uintptr_t)pointer, std::memory_order_relaxed);
+				words[1].store(0, std::memory_order_relaxed);
+			}
+
+			/// <summary>Reads the halves one by one: a torn pair has a pointer that never went with that tag, so the
+			/// CompareExchange it is passed to fails.</summary>
+			TaggedPointer<T> Load() const {
+				uintptr_t tag = words[1].load(std::memory_order_acquire);
+				T* pointer = (T*)words[0].load(std::memory_order_acquire);
+				return TaggedPointer<T>{ pointer, tag };
+			}
+
+			/// <summary>Stores pointer with the tag of expected plus one if the pair still equals expected, else loads
+			/// the current pair into expected.</summary>
+			bool CompareExchange(TaggedPointer<T>& expected, T* pointer) {
+				uintptr_t e[2] = { (uintptr_t)expected.pointer, expected.tag };
+				uintptr_t d[2] = { (uintptr_t)pointer, expected.tag + 1 };
+				if (CompareExchangePair(e, d))
+					return true;
+				expected.pointer = (T*)e[0];
+				expected.tag = e[1];
+				return false;
+			}
+#else
+			static const int TagShift = 48;
+			static const uintptr_t PointerMask = ((uintptr_t)1 << TagShift) - 1;
+
+			std::atomic<uintptr_t> word;
+
+		public:
+			static const bool IsDoubleWidth = false;
+
+			AtomicTaggedPointer(T* pointer = nullptr) : word((uintptr_t)pointer) {
+			}
+
+			TaggedPointer<T> Load() const {
+				uintptr_t w = word.load(std::memory_order_acquire);
+				return TaggedPointer<T>{ (T*)(w & PointerMask), w >> TagShift };
+			}
+
+			bool CompareExchange(TaggedPointer<T>& expected, T* pointer) {
+				uintptr_t e = (uintptr_t)expected.pointer | (expected.tag << TagShift);
+				uintptr_t d = (uintptr_t)pointer | ((expected.tag + 1) << TagShift);
+				if (word.compare_exchange_weak(e, d, std::memory_order_acq_rel, std::memory_order_acquire))
+					return true;
+				expected.pointer = (T*)(e & PointerMask);
+				expected.tag = e >> TagShift;
+				return false;
+			}
+#endif
+		};
+
+
+		// Safe memory reclamation for the lock-free containers: a node that was unlinked from a structure is retired
+		// instead of deleted, and only goes once no thread can still be reading it. Both schemes have the same shape:
+		//
+		//   Scheme::Guard guard;                   makes the reads of the calling thread safe while the guard lives
+		//   T* p = guard.Protect(source, slot);    loads a shared pointer so that it can be dereferenced
+		//   Scheme::Retire(p);                     deletes p once that is safe, p must already be unreachable
+		//   Scheme::Collect();                     deletes what the calling thread retired and is safe by now, returns
+		//                                          how many of its nodes still wait
+		//
+		// Epoch protects everything that was reachable while the guard lives, so a guard may walk whole chains, but a
+		// single stalled thread holds back all reclamation. HazardPointers protects no more than Slots pointers per
+		// thread, a structure can only be walked hand over hand, in exchange the memory waiting to be deleted stays
+		// bounded whatever the other threads do.
+		namespace Reclamation {
+
+			// nodes a thread retired and did not delete yet
+			struct RetiredList {
+				struct Item {
+					void* p;
+					void (*deleter)(void*);
+					ulong epoch;
+				};
+
+				Item* items = nullptr;
+				int count = 0;
+				int capacity = 0;
+
+				void Add(void* p, void (*deleter)(void*), ulong epoch) {
+					if (count == capacity) {
+						capacity = capacity ? capacity * 2 : 64;
+						items = (Item*)realloc(items, capacity * sizeof(Item));
+					}
+					items[count++] = Item{ p, deleter, epoch };
+				}
+
+				// deletes the items safe accepts, the others keep their order
+				template<class F> void DeleteIf(F const& safe) {
+					Item* done = nullptr;
+					int ndone = 0;
+					int kept = 0;
+					for (int i = 0; i < count; i++) {
+						if (safe(items[i])) {
+							if (!done)
+								done = (Item*)malloc((count - i) * sizeof(Item));
+							done[ndone++] = items[i];
+						}
+						else
+							items[kept++] = items[i];
+					}
+					count = kept;
+					// a deleter may retire nodes itself
+					for (int i = 0; i < ndone; i++)
+						done[i].deleter(done[i].p);
+					free(done);
+				}
+			};
+
+			// The per-thread records of a scheme, in a list that only grows. When a thread ends its record is handed back
+			// and the next thread that needs one takes it over, together with the nodes it still had to delete. Records
+			// and retired lists live outside the memory pool: they outlast their threads and would otherwise show up in
+			// the GC::Collect count of whichever thread touched them first
+			template<class Record> class ThreadRecords {
+			private:
+				struct Owner {
+					Record* record = nullptr;
+
+					~Owner() {
+						if (record) {
+							Current() = nullptr;
+							record->Release();
+							record->inUse.store(false, std::memory_order_release);
+						}
+					}
+				};
+
+				static Record*& Current() {
+					static tlocal Record* current = nullptr;
+					return current;
+				}
+
+			public:
+				static std::atomic<Record*>& Head() {
+					static std::atomic<Record*> head{ nullptr };
+					return head;
+				}
+
+				static Record* Get() {
+					Record* r = Current();
+					if (r)
+						return r;
+					for (r = Head().load(std::memory_order_acquire); r; r = r->next) {
+						bool expected = false;
+						if (!r->inUse.load(std::memory_order_relaxed) && r->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+							break;
+					}
+					if (!r) {
+						r = new (malloc(sizeof(Record))) Record();
+						Record* head = Head().load(std::memory_order_relaxed);
+						do {
+							r->next = head;
+						} while (!Head().compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+					}
+					// __declspec(thread) has no destructors, the owner needs a real thread_local
+					static thread_local Owner owner;
+					owner.record = r;
+					Current() = r;
+					return r;
+				}
+			};
+
+			// Epoch based reclamation. A guard announces the global epoch its thread saw, a node is retired together with
+			// the epoch of that moment and deleted once the global epoch moved on twice: the epoch only advances when
+			// every thread inside a guard announced the current one, so by then no thread can still hold the node.
+			class System_API Epoch {
+			private:
+				// a thread inside a guard tries to delete its retired nodes once it holds this many
+				static const int CollectThreshold = 64;
+
+				struct Record {
+					// (epoch << 1) | 1 inside a guard, 0 outside
+					std::atomic<ulong> announced{ 0 };
+					std::atomic<bool> inUse{ true };
+					Record* next = nullptr;
+					int depth = 0;
+					// retired count at which the next collection is tried, it doubles while a stalled region holds
+					// nodes back so that every retire does not walk all records and the whole list again
+					int collectAt = 1;
+					RetiredList retired;
+
+					void Release() {
+						announced.store(0, std::memory_order_release);
+					}
+				};
+
+				using Records = ThreadRecords<Record>;
+
+				static std::atomic<ulong>& Global() {
+					static std::atomic<ulong> global{ 1 };
+					return global;
+				}
+
+				static bool TryAdvance(ulong epoch) {
+					for (Record* r = Records::Head().load(std::memory_order_acquire); r; r = r->next) {
+						ulong a = r->announced.load(std::memory_order_seq_cst);
+						if ((a & 1) && (a >> 1) != epoch)
+							return false;
+					}
+					return Global().compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+				}
+
+				static void Collect(Record* r) {
+					// with every other thread outside a guard both advances succeed and everything goes at once
+					ulong epoch = Global().load(std::memory_order_seq_cst);
+					for (int i = 0; i < 2 && TryAdvance(epoch); i++)
+						epoch++;
+					r->retired.DeleteIf([epoch](RetiredList::Item const& item) { return item.epoch + 2 <= epoch; });
+					r->collectAt = r->retired.count ? r->retired.count * 2 : 1;
+				}
+
+			public:
+				/// <summary>Starts a region in which shared nodes may be read. Regions nest.</summary>
+				static void Enter() {
+					Record* r = Records::Get();
+					if (r->depth++ > 0)
+						return;
+					// announce, then check the epoch did not move on in between, an advance that missed the announcement
+					// could otherwise free what this region is about to read
+					ulong epoch = Global().load(std::memory_order_seq_cst);
+					for (;;) {
+						r->announced.store((epoch << 1) | 1, std::memory_order_seq_cst);
+						ulong now = Global().load(std::memory_order_seq_cst);
+						if (now == epoch)
+							break;
+						epoch = now;
+					}
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+
+				/// <summary>Ends the region started by the matching Enter.</summary>
+				static void Exit() {
+					Record* r = Records::Get();
+					if (--r->depth > 0)
+						return;
+					r->announced.store(0, std::memory_order_release);
+					if (r->retired.count >= r->collectAt)
+						Collect(r);
+				}
+
+				// Keeps the calling thread inside an epoch region for its lifetime.
+				class Guard {
+				public:
+					Guard() {
+						Enter();
+					}
+
+					~Guard() {
+						Exit();
+					}
+
+					Guard(Guard const&) = delete;
+					Guard& operator=(Guard const&) = delete;
+
+					template<class T> T* Protect(std::atomic<T*> const& source, int slot = 0) const {
+						return source.load(std::memory_order_acquire);
+					}
+
+					void Clear(int slot) const {
+					}
+				};
+
+				/// <summary>Deletes p with deleter once no thread can still be reading it. p must already be unreachable.</summary>
+				static void Retire(void* p, void (*deleter)(void*)) {
+					Record* r = Records::Get();
+					r->retired.Add(p, deleter, Global().load(std::memory_order_seq_cst));
+					if (r->depth == 0 || (r->retired.count >= CollectThreshold && r->retired.count >= r->collectAt))
+						Collect(r);
+				}
+
+				template<class T> static void Retire(T* p) {
+					Retire((void*)p, [](void* q) { delete (T*)q; });
+				}
+
+				/// <summary>Deletes what the calling thread retired and no region can still see, outside of a region.
+				/// Returns the number of nodes of the calling thread that still wait.</summary>
+				static int Collect() {
+					Record* r = Records::Get();
+					if (r->depth == 0)
+						Collect(r);
+					return r->retired.count;
+				}
+			};
+
+			// Hazard pointers. A guard publishes every pointer it protects in one of the Slots hazard slots of its thread
+			// and checks it is still in place afterwards; a retired node is deleted once it is in no slot. Slots belong to
+			// the thread, guards that are alive at the same time must use different ones.
+			class System_API HazardPointers {
+			public:
+				static const int Slots = 4;
+
+			private:
+				// retired nodes a thread holds before it scans the hazards
+				static const int CollectThreshold = 64;
+
+				struct Record {
+					std::atomic<void*> hazards[Slots];
+					std::atomic<bool> inUse{ true };
+					Record* next = nullptr;
+					RetiredList retired;
+
+					Record() {
+						Release();
+					}
+
+					void Release() {
+						for (int i = 0; i < Slots; i++)
+							hazards[i].store(nullptr, std::memory_order_release);
+					}
+				};
+
+				using Records = ThreadRecords<Record>;
+
+				// deletes the retired nodes of r that are in no hazard slot
+				static void Scan(Record* r) {
+					int size = 0;
+					int capacity = 64;
+					void** hazards = (void**)malloc(capacity * sizeof(void*));
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					for (Record* o = Records::Head().load(std::memory_order_acquire); o; o = o->next) {
+						for (int i = 0; i < Slots; i++) {
+							void* h = o->hazards[i].load(std::memory_order_seq_cst);
+							if (!h)
+								continue;
+							if (size == capacity) {
+								capacity *= 2;
+								hazards = (void**)realloc(hazards, capacity * sizeof(void*));
+							}
+							hazards[size++] = h;
+						}
+					}
+					std::sort(hazards, hazards + size);
+					r->retired.DeleteIf([hazards, size](RetiredList::Item const& item) { return !std::binary_search(hazards, hazards + size, item.p); });
+					free(hazards);
+				}
+
+			public:
+				// Clears the slots it used when it goes.
+				class Guard {
+				private:
+					Record* record;
+					int used = 0;
+
+				public:
+					Guard() : record(Records::Get()) {
+					}
+
+					~Guard() {
+						for (int i = 0; i < Slots; i++) {
+							if (used & (1 << i))
+								record->hazards[i].store(nullptr, std::memory_order_release);
+						}
+					}
+
+					Guard(Guard const&) = delete;
+					Guard& operator=(Guard const&) = delete;
+
+					/// <summary>Loads source into slot until the value stays put, the node it points to is not deleted
+					/// before the slot is cleared or reused.</summary>
+					template<class T> T* Protect(std::atomic<T*> const& source, int slot = 0) {
+						used |= 1 << slot;
+						T* p = source.load(std::memory_order_relaxed);
+						for (;;) {
+							record->hazards[slot].store(p, std::memory_order_seq_cst);
+							T* now = source.load(std::memory_order_seq_cst);
+							if (now == p)
+								return p;
+							p = now;
+						}
+					}
+
+					void Clear(int slot) {
+						record->hazards[slot].store(nullptr, std::memory_order_release);
+					}
+				};
+
+				/// <summary>Deletes p with deleter once no hazard slot holds it. p must already be unreachable.</summary>
+				static void Retire(void* p, void (*deleter)(void*)) {
+					Record* r = Records::Get();
+					r->retired.Add(p, deleter, 0);
+					if (r->retired.count >= CollectThreshold)
+						Scan(r);
+				}
+
+				template<class T> static void Retire(T* p) {
+					Retire((void*)p, [](void* q) { delete (T*)q; });
+				}
+
+				/// <summary>Deletes what the calling thread retired and no hazard slot holds. Returns the number of nodes
+				/// of the calling thread that still wait.</summary>
+				static int Collect() {
+					Record* r = Records::Get();
+					Scan(r);
+					return r->retired.count;
+				}
+			};
+		}
+
+	}
+
+	namespace Collections {
+		namespace Concurrent {
+
+			template<class T> class System_API LockingStack : public Object {
+			private:
+			public:
+
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					System::Collections::Generic::Stack<T> s = new System::Collections::Generic::Stack<T>{};
+					std::mutex mut;
+
+
+				public:
+
+					ObjectData() {
+					}
+
+					~ObjectData() override {
+
+					}
+
+					void Push(T const& item) {
+
+						//mut.lock();
+						std::lock_guard<std::mutex> mlock(mut);
+						s.Push(item);
+						//mut.unlock();
+					}
+
+					void Push(T&& item) {
+						std::lock_guard<std::mutex> mlock(mut);
+						//mut.lock();
+						s.Push(std::forward<T>(item));
+						//mut.unlock();
+					}
+
+					bool TryPop(Out<T> result) {
+						std::lock_guard<std::mutex> mlock(mut);
+						//mut.lock();
+						if (s.Count == 0) {
+							//mut.unlock();
+							return false;
+						}
+						result = s.Pop();
+
+						//mut.unlock();
+						return true;
+					}
+
+					T Pop() {
+						std::lock_guard<std::mutex> mlock(mut);
+						return s.Pop();
+					}
+
+				};
+
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				LockingStack(){}
+
+				LockingStack(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				LockingStack(LockingStack* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				LockingStack(LockingStack const & other) : System::Object(other) { }
+
+				LockingStack(LockingStack&& other) noexcept : System::Object(std::move(other)) { }
+
+				LockingStack(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				LockingStack& operator=(LockingStack const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				LockingStack& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				LockingStack& operator=(LockingStack&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				LockingStack& operator=(LockingStack* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				LockingStack* operator->() {
+					return this;
+				}
+
+
+
+					void Push(const T& item) {
+					GOD()->Push(item);
+				}
+
+				void Push(T&& item) {
+					GOD()->Push(std::forward<T>(item));
+				}
+
+				bool TryPop(Out<T> result) {
+					return GOD()->TryPop(result);
+				}
+
+				T Pop() {
+					return GOD()->Pop();
+				}
+
+			};
+
+
+			// Treiber stack whose popped nodes are retired through a Threading::Reclamation scheme. A pop protects the
+			// head before it reads head->next, so it can neither read a node that was deleted nor be fooled by one that
+			// was popped and pushed again in the meantime (ABA): that node cannot be deleted and reused while protected.
+			template<class T, class Reclaimer = Threading::Reclamation::HazardPointers> class System_API KConcurrentStack2 : public Object {
+			private:
+				int Get_Count() const { return GOD()->Get_Count(); }
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					// popped nodes are deleted by whichever thread collects them, possibly after the pusher ended
+					struct Node : Unpooled {
+						T value;
+						Node* next = nullptr;
+
+						Node(T const& value) : value(value) {}
+					};
+
+					std::atomic<Node*> head{ nullptr };
+					std::atomic<int> count{ 0 };
+
+				public:
+					~ObjectData() override {
+						Node* node = head.load(std::memory_order_acquire);
+						while (node) {
+							Node* next = node->next;
+							delete node;
+							node = next;
+						}
+					}
+
+					void Push(T const& item) {
+						Node* node = new Node(item);
+						Node* top = head.load(std::memory_order_relaxed);
+						do {
+							node->next = top;
+						} while (!head.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+						count.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					int Get_Count() {
+						return count.load(std::memory_order_relaxed);
+					}
+
+					bool TryPop(Out<T> result) {
+						typename Reclaimer::Guard guard;
+						for (;;) {
+							Node* top = guard.Protect(head);
+							if (!top)
+								return false;
+							if (head.compare_exchange_weak(top, top->next, std::memory_order_acquire, std::memory_order_relaxed)) {
+								// popped, no other thread reads the value any more
+								result = std::move(top->value);
+								guard.Clear(0);
+								count.fetch_sub(1, std::memory_order_relaxed);
+								Reclaimer::Retire(top);
+								return true;
+							}
+						}
+					}
+				};
+
+				/// <summary>A snapshot of the number of items, it may be stale by the time it is read.</summary>
+				PropGenGet<int, KConcurrentStack2, &KConcurrentStack2::Get_Count> Count{ this };
+
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				KConcurrentStack2(){}
+
+				KConcurrentStack2(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				KConcurrentStack2(KConcurrentStack2* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				KConcurrentStack2(KConcurrentStack2 const & other) : System::Object(other) { }
+
+				KConcurrentStack2(KConcurrentStack2&& other) noexcept : System::Object(std::move(other)) { }
+
+				KConcurrentStack2(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				KConcurrentStack2& operator=(KConcurrentStack2 const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				KConcurrentStack2& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				KConcurrentStack2& operator=(KConcurrentStack2&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				KConcurrentStack2& operator=(KConcurrentStack2* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				KConcurrentStack2* operator->() {
+					return this;
+				}
+
+
+
+				void Push(T const& item) {
+					return GOD()->Push(item);
+				}
+
+				bool TryPop(Out<T> result) {
+					return GOD()->TryPop(result);
+				}
+			};
+
+			// Lock-free stack on a counted head (Threading::AtomicTaggedPointer) with elimination backoff. Popped nodes go
+			// to a free list of the stack that later pushes take from, a node is only deleted with the stack: a pop that
+			// reads next of a node another thread popped in the meantime still reads valid memory, and the tag that changed
+			// makes its swap fail. A push whose swap on the head failed offers its node in a random slot of the elimination
+			// array for a moment, a pop whose swap failed looks into one: a push and a pop that meet there cancel out without
+			// touching the head, which is what keeps the stack from serializing on one cache line under contention.
+			template<class T> class System_API ConcurrentStack : public Object {
+			private:
+				int Get_Count() const { return GOD()->Get_Count(); }
+				bool Get_IsEmpty() const { return GOD()->Get_IsEmpty(); }
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					static const int CacheLine = 64;
+					static const int EliminationSlots = 8;
+					static const int EliminationWait = 64; // pause iterations a push keeps its node on offer
+
+					// nodes move between threads through the pool and the elimination slots
+					struct Node : Unpooled {
+						std::atomic<Node*> next{ nullptr };
+						alignas(T) byte storage[sizeof(T)];
+
+						T* Value() { return reinterpret_cast<T*>(storage); }
+					};
+
+					struct Slot {
+						std::atomic<Node*> offer{ nullptr };
+						char pad[CacheLine - sizeof(std::atomic<Node*>)];
+					};
+
+					char pad0[CacheLine];
+					Threading::AtomicTaggedPointer<Node> head;
+					std::atomic<int> count{ 0 };
+					char pad1[CacheLine];
+					Threading::AtomicTaggedPointer<Node> pool;
+					char pad2[CacheLine];
+					Slot slots[EliminationSlots];
+
+					// a pop that took an offered node leaves this in the slot until the push clears it, so the push can tell
+					// taken from withdrawn and no node can be offered in that slot before
+					static Node* Taken() { return reinterpret_cast<Node*>((uintptr_t)1); }
+
+					static int RandomSlot() {
+						static tlocal uint seed = 0;
+						if (!seed)
+							seed = (uint)(uintptr_t)&seed | 1;
+						seed ^= seed << 13;
+						seed ^= seed >> 17;
+						seed ^= seed << 5;
+						return (int)(seed % EliminationSlots);
+					}
+
+					static void Backoff(int spins) {
+						if (spins < 10)
+							Threading::Thread::SpinWait(4 << spins);
+						else
+							Threading::Thread::Yield();
+					}
+
+					// links the chain first..last on top of the stack at to
+					static void PushChain(Threading::AtomicTaggedPointer<Node>& to, Node* first, Node* last) {
+						Threading::TaggedPointer<Node> top = to.Load();
+						do {
+							last->next.store(top.pointer, std::memory_order_relaxed);
+						} while (!to.CompareExchange(top, first));
+					}
+
+					Node* Allocate() {
+						Threading::TaggedPointer<Node> top = pool.Load();
+						while (top.pointer) {
+							if (pool.CompareExchange(top, top.pointer->next.load(std::memory_order_relaxed)))
+								return top.pointer;
+						}
+						return new Node();
+					}
+
+					bool TryOffer(Node* node) {
+						Slot& slot = slots[RandomSlot()];
+						Node* empty = nullptr;
+						if (!slot.offer.compare_exchange_strong(empty, node, std::memory_order_release, std::memory_order_relaxed))
+							return false;
+						for (int i = 0; i < EliminationWait && slot.offer.load(std::memory_order_relaxed) == node; i++)
+							Threading::Thread::SpinWait(1);
+						Node* offered = node;
+						if (slot.offer.compare_exchange_strong(offered, nullptr, std::memory_order_relaxed))
+							return false;
+						// a pop took it
+						slot.offer.store(nullptr, std::memory_order_relaxed);
+						return true;
+					}
+
+					Node* TryTake() {
+						Slot& slot = slots[RandomSlot()];
+						Node* node = slot.offer.load(std::memory_order_relaxed);
+						if (!node || node == Taken())
+							return nullptr;
+						if (slot.offer.compare_exchange_strong(node, Taken(), std::memory_order_acquire, std::memory_order_relaxed))
+							return node;
+						return nullptr;
+					}
+
+					void PushNode(Node* node) {
+						// counted before it is visible, so that Count never drops below the number of items
+						count.fetch_add(1, std::memory_order_relaxed);
+						Threading::TaggedPointer<Node> top = head.Load();
+						for (;;) {
+							node->next.store(top.pointer, std::memory_order_relaxed);
+							if (head.CompareExchange(top, node))
+								return;
+							if (TryOffer(node)) {
+								count.fetch_sub(1, std::memory_order_relaxed);
+								return;
+							}
+							top = head.Load();
+						}
+					}
+
+					Node* PopNode() {
+						Threading::TaggedPointer<Node> top = head.Load();
+						for (;;) {
+							if (!top.pointer)
+								return nullptr;
+							if (head.CompareExchange(top, top.pointer->next.load(std::memory_order_relaxed))) {
+								count.fetch_sub(1, std::memory_order_relaxed);
+								return top.pointer;
+							}
+							Node* node = TryTake();
+							if (node)
+								return node;
+							top = head.Load();
+						}
+					}
+
+					// moves the value out of a node this thread owns and puts the node in the pool
+					void Take(Node* node, T& result) {
+						result = std::move(*node->Value());
+						node->Value()->~T();
+						PushChain(pool, node, node);
+					}
+
+					static void DeleteChain(Node* node, bool values) {
+						while (node) {
+							Node* next = node->next.load(std::memory_order_relaxed);
+							if (values)
+								node->Value()->~T();
+							delete node;
+							node = next;
+						}
+					}
+
+				public:
+					~ObjectData() override {
+						DeleteChain(head.Load().pointer, true);
+						DeleteChain(pool.Load().pointer, false);
+					}
+
+					int Get_Count() const {
+						return count.load(std::memory_order_relaxed);
+					}
+
+					bool Get_IsEmpty() const {
+						return head.Load().pointer == nullptr;
+					}
+
+					template<class U> void Push(U&& item) {
+						Node* node = Allocate();
+						new (node->storage) T(std::forward<U>(item));
+						PushNode(node);
+					}
+
+					void PushRange(T const* items, int n) {
+						if (n <= 0)
+							return;
+						// items[n - 1] ends up on top, as if they were pushed one by one
+						Node* last = nullptr;
+						Node* first = nullptr;
+						for (int i = 0; i < n; i++) {
+							Node* node = Allocate();
+							new (node->storage) T(items[i]);
+							node->next.store(first, std::memory_order_relaxed);
+							first = node;
+							if (!last)
+								last = node;
+						}
+						count.fetch_add(n, std::memory_order_relaxed);
+						Threading::TaggedPointer<Node> top = head.Load();
+						for (int spins = 0;; spins++) {
+							last->next.store(top.pointer, std::memory_order_relaxed);
+							if (head.CompareExchange(top, first))
+								return;
+							Backoff(spins);
+							top = head.Load();
+						}
+					}
+
+					bool TryPop(Out<T> result) {
+						Node* node = PopNode();
+						if (!node)
+							return false;
+						Take(node, *result);
+						return true;
+					}
+
+					int TryPopRange(T* items, int n) {
+						if (n <= 0)
+							return 0;
+						Threading::TaggedPointer<Node> top = head.Load();
+						for (int spins = 0;; spins++) {
+							if (!top.pointer)
+								return 0;
+							// nodes in the stack only change once they were popped, which changes the head, so the chain
+							// walked here is the one that is unlinked if the swap succeeds
+							Node* last = top.pointer;
+							int k = 1;
+							for (Node* next; k < n && (next = last->next.load(std::memory_order_relaxed)) != nullptr; k++)
+								last = next;
+							if (head.CompareExchange(top, last->next.load(std::memory_order_relaxed))) {
+								count.fetch_sub(k, std::memory_order_relaxed);
+								Node* node = top.pointer;
+								for (int i = 0; i < k; i++) {
+									Node* next = node->next.load(std::memory_order_relaxed);
+									items[i] = std::move(*node->Value());
+									node->Value()->~T();
+									node = next;
+								}
+								PushChain(pool, top.pointer, last);
+								return k;
+							}
+							Backoff(spins);
+							top = head.Load();
+						}
+					}
+
+					void Clear() {
+						Threading::TaggedPointer<Node> top = head.Load();
+						while (top.pointer && !head.CompareExchange(top, nullptr)) {
+						}
+						if (!top.pointer)
+							return;
+						Node* last = top.pointer;
+						int k = 1;
+						last->Value()->~T();
+						for (Node* next; (next = last->next.load(std::memory_order_relaxed)) != nullptr; k++) {
+							next->Value()->~T();
+							last = next;
+						}
+						count.fetch_sub(k, std::memory_order_relaxed);
+						PushChain(pool, top.pointer, last);
+					}
+				};
+
+				/// <summary>A snapshot of the number of items, it may be stale by the time it is read.</summary>
+				PropGenGet<int, ConcurrentStack, &ConcurrentStack::Get_Count> Count{ this };
+				PropGenGet<bool, ConcurrentStack, &ConcurrentStack::Get_IsEmpty> IsEmpty{ this };
+
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				ConcurrentStack(){}
+
+				ConcurrentStack(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				ConcurrentStack(ConcurrentStack* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				ConcurrentStack(ConcurrentStack const & other) : System::Object(other) { }
+
+				ConcurrentStack(ConcurrentStack&& other) noexcept : System::Object(std::move(other)) { }
+
+				ConcurrentStack(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				ConcurrentStack& operator=(ConcurrentStack const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ConcurrentStack& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ConcurrentStack& operator=(ConcurrentStack&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ConcurrentStack& operator=(ConcurrentStack* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ConcurrentStack* operator->() {
+					return this;
+				}
+
+
+
+				void Push(T const& item) {
+					GOD()->Push(item);
+				}
+
+				void Push(T&& item) {
+					GOD()->Push(std::move(item));
+				}
+
+				/// <summary>Pushes items[0] to items[count - 1] as one atomic operation, items[count - 1] ends up on top.</summary>
+				void PushRange(T const* items, int count) {
+					GOD()->PushRange(items, count);
+				}
+
+				bool TryPop(Out<T> result) {
+					return GOD()->TryPop(result);
+				}
+
+				/// <summary>Pops up to count items as one atomic operation into items, the top first, returns how many.</summary>
+				int TryPopRange(T* items, int count) {
+					return GOD()->TryPopRange(items, count);
+				}
+
+				void Clear() {
+					GOD()->Clear();
+				}
+			};
+
+
+			template<class T> class System_API LockingQueue : public Object {
+			private:
+			public:
+
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					System::Collections::Generic::Queue<T> q = new System::Collections::Generic::Queue<T>{};
+					std::mutex mut;
+
+
+				public:
+
+					ObjectData() {
+					}
+
+					~ObjectData() override {
+
+					}
+
+					void Enqueue(T const & item) {
+						std::lock_guard<std::mutex> mlock(mut);
+						q.Enqueue(item);
+					}
+
+					void Enqueue(T&& item) {
+						std::lock_guard<std::mutex> mlock(mut);
+						q.Enqueue(std::forward<T>(item));
+					}
+
+					bool TryDequeue(Out<T> result) {
+						std::lock_guard<std::mutex> mlock(mut);
+
+						if (q.Count == 0)
+							return false;
+
+						result = q.Dequeue();
+
+
+						return true;
+					}
+
+					int Get_Count() {
+						std::lock_guard<std::mutex> mlock(mut);
+						return q.Count;
+					}
+				};
+
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				LockingQueue(){}
+
+				LockingQueue(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				LockingQueue(LockingQueue* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				LockingQueue(LockingQueue const & other) : System::Object(other) { }
+
+				LockingQueue(LockingQueue&& other) noexcept : System::Object(std::move(other)) { }
+
+				LockingQueue(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				LockingQueue& operator=(LockingQueue const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				LockingQueue& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				LockingQueue& operator=(LockingQueue&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				LockingQueue& operator=(LockingQueue* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				LockingQueue* operator->() {
+					return this;
+				}
+
+
+
+				int Get_Count() const {
+					return GOD()->Get_Count();
+				}
+
+				bool Get_IsEmpty() const {
+					return Get_Count() == 0;
+				}
+
+				PropGenGet<int, LockingQueue, &LockingQueue::Get_Count> Count{ this };
+				PropGenGet<bool, LockingQueue, &LockingQueue::Get_IsEmpty> IsEmpty{ this };
+
+				void Enqueue(T const& item) {
+					GOD()->Enqueue(item);
+				}
+
+				void Enqueue(T&& item) {
+					GOD()->Enqueue(std::forward<T>(item));
+				}
+
+				bool TryDequeue(Out<T> result) {
+					return GOD()->TryDequeue(result);
+				}
+			};
+
+			// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's ring). Every cell carries a sequence number:
+			// a producer that claimed position pos may write the cell once its sequence is pos, and publishes the item
+			// by setting it to pos + 1; a consumer reads at pos once the sequence is pos + 1 and hands the cell to the
+			// next lap with pos + capacity. Producers and consumers only meet on their own position counter, which are
+			// padded onto separate cache lines. The batch variants claim a run of ready cells with a single CAS.
+			template<class T> class System_API MPMCBoundedQueue : public Object {
+			private:
+
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					static const int CacheLine = 64;
+
+					struct Cell {
+						std::atomic<ulong> sequence;
+						T data;
+					};
+
+					char pad0[CacheLine];
+					Cell* buffer;
+					ulong mask;
+					char pad1[CacheLine];
+					std::atomic<ulong> enqueuePos{ 0 };
+					char pad2[CacheLine];
+					std::atomic<ulong> dequeuePos{ 0 };
+					char pad3[CacheLine];
+
+					// number of consecutive cells from pos on whose sequence is pos + i + offset, at most count
+					int Ready(ulong pos, int count, ulong offset) const {
+						int n = 0;
+						while (n < count && buffer[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n + offset)
+							n++;
+						return n;
+					}
+
+					// claims up to count cells at the position counter at, 0 if none of them is ready
+					int Claim(std::atomic<ulong>& at, int count, ulong offset, ulong& pos) {
+						pos = at.load(std::memory_order_relaxed);
+						for (;;) {
+							int n = Ready(pos, count, offset);
+							if (n == 0) {
+								// behind: another thread moved the counter on since we read it, else full or empty
+								ulong now = at.load(std::memory_order_relaxed);
+								if (now == pos)
+									return 0;
+								pos = now;
+								continue;
+							}
+							if (at.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+								return n;
+						}
+					}
+
+				public:
+					static const int DefaultCapacity = 1024;
+
+					ObjectData() : ObjectData(DefaultCapacity) {}
+
+					ObjectData(int capacity) {
+						if (capacity < 1)
+							throw ArgumentOutOfRangeException();
+						ulong size = 2;
+						while (size < (ulong)capacity)
+							size <<= 1;
+						buffer = new Cell[size]();
+						mask = size - 1;
+						for (ulong i = 0; i < size; i++)
+							buffer[i].sequence.store(i, std::memory_order_relaxed);
+					}
+
+					~ObjectData() override {
+						delete[] buffer;
+					}
+
+					int Get_Capacity() const {
+						return (int)(mask + 1);
+					}
+
+					int Get_Count() const {
+						ulong r = dequeuePos.load(std::memory_order_acquire);
+						ulong w = enqueuePos.load(std::memory_order_acquire);
+						return w > r ? (int)(w - r) : 0;
+					}
+
+					template<class U> bool TryEnqueue(U&& item) {
+						ulong pos;
+						if (!Claim(enqueuePos, 1, 0, pos))
+							return false;
+						Cell& cell = buffer[pos & mask];
+						cell.data = std::forward<U>(item);
+						cell.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+
+					bool TryDequeue(Out<T> result) {
+						ulong pos;
+						if (!Claim(dequeuePos, 1, 1, pos))
+							return false;
+						Cell& cell = buffer[pos & mask];
+						result = std::move(cell.data);
+						cell.data = T();
+						cell.sequence.store(pos + mask + 1, std::memory_order_release);
+						return true;
+					}
+
+					int TryEnqueue(T const* items, int count) {
+						ulong pos;
+						int n = count > 0 ? Claim(enqueuePos, count, 0, pos) : 0;
+						for (int i = 0; i < n; i++) {
+							Cell& cell = buffer[(pos + i) & mask];
+							cell.data = items[i];
+							cell.sequence.store(pos + i + 1, std::memory_order_release);
+						}
+						return n;
+					}
+
+					int TryDequeue(T* items, int count) {
+						ulong pos;
+						int n = count > 0 ? Claim(dequeuePos, count, 1, pos) : 0;
+						for (int i = 0; i < n; i++) {
+							Cell& cell = buffer[(pos + i) & mask];
+							items[i] = std::move(cell.data);
+							cell.data = T();
+							cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+						}
+						return n;
+					}
+				};
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				MPMCBoundedQueue(){}
+
+				MPMCBoundedQueue(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				MPMCBoundedQueue(MPMCBoundedQueue* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				MPMCBoundedQueue(MPMCBoundedQueue const & other) : System::Object(other) { }
+
+				MPMCBoundedQueue(MPMCBoundedQueue&& other) noexcept : System::Object(std::move(other)) { }
+
+				MPMCBoundedQueue(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				MPMCBoundedQueue& operator=(MPMCBoundedQueue const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				MPMCBoundedQueue& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				MPMCBoundedQueue& operator=(MPMCBoundedQueue&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				MPMCBoundedQueue& operator=(MPMCBoundedQueue* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				MPMCBoundedQueue* operator->() {
+					return this;
+				}
+
+
+
+				/// <summary>Creates a queue that holds at least capacity items, the capacity is rounded up to a power of two.</summary>
+				MPMCBoundedQueue(int capacity) {
+					od = new ObjectData(capacity);
+				}
+
+				int Get_Capacity() const {
+					return GOD()->Get_Capacity();
+				}
+
+				int Get_Count() const {
+					return GOD()->Get_Count();
+				}
+
+				bool Get_IsEmpty() const {
+					return Get_Count() == 0;
+				}
+
+				PropGenGet<int, MPMCBoundedQueue, &MPMCBoundedQueue::Get_Capacity> Capacity{ this };
+				/// <summary>A snapshot of the number of items, it may be stale by the time it is read.</summary>
+				PropGenGet<int, MPMCBoundedQueue, &MPMCBoundedQueue::Get_Count> Count{ this };
+				PropGenGet<bool, MPMCBoundedQueue, &MPMCBoundedQueue::Get_IsEmpty> IsEmpty{ this };
+
+				/// <summary>Adds item to the queue, false if the queue is full.</summary>
+				bool TryEnqueue(T const& item) {
+					return GOD()->TryEnqueue(item);
+				}
+
+				bool TryEnqueue(T&& item) {
+					return GOD()->TryEnqueue(std::move(item));
+				}
+
+				/// <summary>Adds item to the queue, waits while the queue is full.</summary>
+				void Enqueue(T const& item) {
+					for (int spins = 0; !GOD()->TryEnqueue(item); spins++)
+						Backoff(spins);
+				}
+
+				/// <summary>Removes the oldest item, false if the queue is empty.</summary>
+				bool TryDequeue(Out<T> result) {
+					return GOD()->TryDequeue(result);
+				}
+
+				/// <summary>Removes the oldest item, waits while the queue is empty.</summary>
+				T Dequeue() {
+					T ret;
+					for (int spins = 0; !GOD()->TryDequeue(out(ret)); spins++)
+						Backoff(spins);
+					return ret;
+				}
+
+				/// <summary>Adds up to count items in order, as many as there are free cells. Returns the number added.</summary>
+				int TryEnqueue(T const* items, int count) {
+					return GOD()->TryEnqueue(items, count);
+				}
+
+				/// <summary>Removes up to count items into items, oldest first. Returns the number removed.</summary>
+				int TryDequeue(T* items, int count) {
+					return GOD()->TryDequeue(items, count);
+				}
+
+				/// <summary>Adds all count items, waits while the queue is full.</summary>
+				void Enqueue(T const* items, int count) {
+					for (int spins = 0; count > 0; spins++) {
+						int n = GOD()->TryEnqueue(items, count);
+						if (n) {
+							items += n;
+							count -= n;
+							spins = 0;
+						}
+						else
+							Backoff(spins);
+					}
+				}
+
+			private:
+				static void Backoff(int spins) {
+					if (spins < 10)
+						Threading::Thread::SpinWait(4 << spins);
+					else
+						Threading::Thread::Yield();
+				}
+			};
+
+
+
+			// Unbounded multi-producer multi-consumer queue, a linked list of bounded segments as in .NET. A segment is a
+			// ring of cells with sequence numbers like MPMCBoundedQueue; the enqueuer that finds it full freezes it, after
+			// which no enqueue into it can succeed, and links a segment twice its size (or of the initial size if a peek
+			// froze it before it filled). Dequeuers drain the head segment
+			// and move on once it is frozen, empty and has a successor. Unlinked segments are retired through
+			// Threading::Reclamation::Epoch, every operation runs inside an epoch region.
+			template<class T> class System_API ConcurrentQueue : public Object {
+			private:
+
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					static const int CacheLine = 64;
+					static const int InitialSegmentLength = 32;
+					static const int MaxSegmentLength = 1024 * 1024;
+
+					// segments and their cells outlive the producers that allocated them
+					struct Cell : Unpooled {
+						std::atomic<ulong> sequence;
+						T data;
+					};
+
+					class Segment : public Unpooled {
+					public:
+						// set in tail once the segment is frozen for enqueues
+						static const ulong Frozen = 1ULL << 62;
+
+						Cell* slots;
+						ulong mask;
+						// once TryPeek looked into the segment, dequeues copy their items and leave the cells alone so
+						// a peek never reads an item that is being moved out. The segment is frozen by then, the cells
+						// are not needed again
+						std::atomic<bool> preserved{ false };
+						std::atomic<Segment*> next{ nullptr };
+						char pad0[CacheLine];
+						std::atomic<ulong> head{ 0 };
+						char pad1[CacheLine];
+						std::atomic<ulong> tail{ 0 };
+						char pad2[CacheLine];
+
+						Segment(int length) : slots(new Cell[length]()), mask((ulong)length - 1) {
+							for (int i = 0; i < length; i++)
+								slots[i].sequence.store((ulong)i, std::memory_order_relaxed);
+						}
+
+						~Segment() {
+							delete[] slots;
+						}
+
+						int Length() const {
+							return (int)(mask + 1);
+						}
+
+						int Count() const {
+							ulong h = head.load(std::memory_order_acquire);
+							ulong t = tail.load(std::memory_order_acquire) & ~Frozen;
+							return t > h ? (int)(t - h) : 0;
+						}
+
+						void Freeze() {
+							if (!(tail.load(std::memory_order_relaxed) & Frozen))
+								tail.fetch_or(Frozen, std::memory_order_seq_cst);
+						}
+
+						// claims up to count free cells from pos on, 0 if the segment is full or frozen
+						int ClaimEnqueue(int count, ulong& pos) {
+							pos = tail.load(std::memory_order_relaxed);
+							for (;;) {
+								if (pos & Frozen)
+									return 0;
+								int n = 0;
+								while (n < count && slots[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n)
+									n++;
+								if (n == 0) {
+									// behind: another enqueuer moved the tail on since we read it, else full
+									ulong now = tail.load(std::memory_order_relaxed);
+									if (now == pos)
+										return 0;
+									pos = now;
+									continue;
+								}
+								if (tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+									return n;
+							}
+						}
+
+						// claims up to count published items from pos on, 0 if the segment is empty. Waits for an
+						// enqueuer that claimed the first cell but did not publish it yet
+						int ClaimDequeue(int count, ulong& pos) {
+							pos = head.load(std::memory_order_relaxed);
+							for (;;) {
+								int n = 0;
+								while (n < count && slots[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n + 1)
+									n++;
+								if (n == 0) {
+									ulong now = head.load(std::memory_order_relaxed);
+									if (now != pos) {
+										pos = now;
+										continue;
+									}
+									if ((tail.load(std::memory_order_acquire) & ~Frozen) <= pos)
+										return 0;
+									Threading::Thread::SpinWait(4);
+									continue;
+								}
+								// seq_cst against the preserved flag, see TryPeek
+								if (head.compare_exchange_weak(pos, pos + n, std::memory_order_seq_cst, std::memory_order_relaxed))
+									return n;
+							}
+						}
+
+						template<class U> void Put(ulong pos, U&& item) {
+							Cell& cell = slots[pos & mask];
+							cell.data = std::forward<U>(item);
+							cell.sequence.store(pos + 1, std::memory_order_release);
+						}
+
+						void Take(ulong pos, int count, T* items) {
+							bool keep = preserved.load(std::memory_order_seq_cst);
+							for (int i = 0; i < count; i++) {
+								Cell& cell = slots[(pos + i) & mask];
+								if (keep)
+									items[i] = cell.data;
+								else {
+									items[i] = std::move(cell.data);
+									cell.data = T();
+									cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+								}
+							}
+						}
+
+						bool TryPeek(T* item) {
+							if ((tail.load(std::memory_order_acquire) & ~Frozen) <= head.load(std::memory_order_acquire))
+								return false;
+							// a dequeue that claimed its cell before this store sees preserved false and moves the item
+							// out, but then this thread reads the head after that claim and looks at the next cell
+							preserved.store(true, std::memory_order_seq_cst);
+							Freeze();
+							for (;;) {
+								ulong pos = head.load(std::memory_order_seq_cst);
+								Cell& cell = slots[pos & mask];
+								ulong sequence = cell.sequence.load(std::memory_order_acquire);
+								if (sequence == pos + 1) {
+									*item = cell.data;
+									return true;
+								}
+								if (sequence < pos + 1 && (tail.load(std::memory_order_acquire) & ~Frozen) <= pos)
+									return false;
+								if (sequence < pos + 1)
+									Threading::Thread::SpinWait(4);
+							}
+						}
+					};
+
+					std::atomic<Segment*> head;
+					char pad0[CacheLine];
+					std::atomic<Segment*> tail;
+					char pad1[CacheLine];
+
+					// s is full or frozen: link the segment after it if nobody did yet and move the tail on. Only a segment
+					// that filled up doubles, one frozen by TryPeek may hold a single item
+					Segment* Grow(Segment* s) {
+						Segment* next = s->next.load(std::memory_order_acquire);
+						if (!next) {
+							s->Freeze();
+							int length = s->preserved.load(std::memory_order_relaxed) ? InitialSegmentLength : s->Length() < MaxSegmentLength ? s->Length() * 2 : MaxSegmentLength;
+							Segment* fresh = new Segment(length);
+							if (s->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+								next = fresh;
+							else
+								delete fresh;
+						}
+						tail.compare_exchange_strong(s, next, std::memory_order_release, std::memory_order_relaxed);
+						return next;
+					}
+
+					// s is frozen and drained: move the head past it and retire it
+					void Unlink(Segment* s, Segment* next) {
+						Segment* expected = s;
+						if (head.compare_exchange_strong(expected, next, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+							// the enqueuer that linked next may not have moved the tail on yet
+							expected = s;
+							tail.compare_exchange_strong(expected, next, std::memory_order_seq_cst, std::memory_order_relaxed);
+							Threading::Reclamation::Epoch::Retire(s);
+						}
+					}
+
+				public:
+					ObjectData() {
+						Segment* s = new Segment(InitialSegmentLength);
+						head.store(s, std::memory_order_relaxed);
+						tail.store(s, std::memory_order_relaxed);
+					}
+
+					~ObjectData() override {
+						Segment* s = head.load(std::memory_order_acquire);
+						while (s) {
+							Segment* next = s->next.load(std::memory_order_relaxed);
+							delete s;
+							s = next;
+						}
+					}
+
+					template<class U> void Enqueue(U&& item) {
+						Threading::Reclamation::Epoch::Guard guard;
+						for (Segment* s = tail.load(std::memory_order_acquire);; s = Grow(s)) {
+							ulong pos;
+							if (s->ClaimEnqueue(1, pos)) {
+								s->Put(pos, std::forward<U>(item));
+								return;
+							}
+						}
+					}
+
+					void Enqueue(T const* items, int count) {
+						Threading::Reclamation::Epoch::Guard guard;
+						Segment* s = tail.load(std::memory_order_acquire);
+						while (count > 0) {
+							ulong pos;
+							int n = s->ClaimEnqueue(count, pos);
+							if (n == 0) {
+								s = Grow(s);
+								continue;
+							}
+							for (int i = 0; i < n; i++)
+								s->Put(pos + i, items[i]);
+							items += n;
+							count -= n;
+						}
+					}
+
+					int TryDequeue(T* items, int count) {
+						Threading::Reclamation::Epoch::Guard guard;
+						int taken = 0;
+						while (taken < count) {
+							Segment* s = head.load(std::memory_order_acquire);
+							ulong pos;
+							int n = s->ClaimDequeue(count - taken, pos);
+							if (n == 0) {
+								Segment* next = s->next.load(std::memory_order_acquire);
+								if (!next)
+									break;
+								// s is frozen, look once more for items that went in before that
+								n = s->ClaimDequeue(count - taken, pos);
+								if (n == 0) {
+									Unlink(s, next);
+									continue;
+								}
+							}
+							s->Take(pos, n, items + taken);
+							taken += n;
+						}
+						return taken;
+					}
+
+					bool TryPeek(T* item) {
+						Threading::Reclamation::Epoch::Guard guard;
+						for (;;) {
+							Segment* s = head.load(std::memory_order_acquire);
+							if (s->TryPeek(item))
+								return true;
+							Segment* next = s->next.load(std::memory_order_acquire);
+							if (!next)
+								return false;
+							if (s->TryPeek(item))
+								return true;
+							Unlink(s, next);
+						}
+					}
+
+					int Get_Count() {
+						Threading::Reclamation::Epoch::Guard guard;
+						int count = 0;
+						for (Segment* s = head.load(std::memory_order_acquire); s; s = s->next.load(std::memory_order_acquire))
+							count += s->Count();
+						return count;
+					}
+
+					bool Get_IsEmpty() {
+						Threading::Reclamation::Epoch::Guard guard;
+						for (Segment* s = head.load(std::memory_order_acquire); s; s = s->next.load(std::memory_order_acquire)) {
+							if (s->Count() > 0)
+								return false;
+						}
+						return true;
+					}
+
+					// cells allocated over all linked segments
+					int Get_Capacity() {
+						Threading::Reclamation::Epoch::Guard guard;
+						int capacity = 0;
+						for (Segment* s = head.load(std::memory_order_acquire); s; s = s->next.load(std::memory_order_acquire))
+							capacity += s->Length();
+						return capacity;
+					}
+				};
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				ConcurrentQueue(){}
+
+				ConcurrentQueue(std::nullptr_t const & n) : System::Object(n) {
+				}
+
+				ConcurrentQueue(ConcurrentQueue* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
+
+				ConcurrentQueue(ConcurrentQueue const & other) : System::Object(other) { }
+
+				ConcurrentQueue(ConcurrentQueue&& other) noexcept : System::Object(std::move(other)) { }
+
+				ConcurrentQueue(Object::ObjectData* other) : System::Object(other) {
+				}
+
+				ConcurrentQueue& operator=(ConcurrentQueue const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ConcurrentQueue& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ConcurrentQueue& operator=(ConcurrentQueue&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ConcurrentQueue& operator=(ConcurrentQueue* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ConcurrentQueue* operator->() {
+					return this;
+				}
+
+
+
+				int Get_Count() const {
+					return GOD()->Get_Count();
+				}
+
+				bool Get_IsEmpty() const {
+					return GOD()->Get_IsEmpty();
+				}
+
+				/// <summary>A snapshot of the number of items, it may be stale by the time it is read.</summary>
+				PropGenGet<int, ConcurrentQueue, &ConcurrentQueue::Get_Count> Count{ this };
+				PropGenGet<bool, ConcurrentQueue, &ConcurrentQueue::Get_IsEmpty> IsEmpty{ this };
+
+				void Enqueue(T const& item) {
+					GOD()->Enqueue(item);
+				}
+
+				void Enqueue(T&& item) {
+					GOD()->Enqueue(std::move(item));
+				}
+
+				/// <summary>Adds count items in order. Items of other threads may end up in between.</summary>
+				void Enqueue(T const* items, int count) {
+					GOD()->Enqueue(items, count);
+				}
+
+				bool TryDequeue(Out<T> result) {
+					return GOD()->TryDequeue(&*result, 1) == 1;
+				}
+
+				/// <summary>Removes up to count items into items, oldest first. Returns the number removed.</summary>
+				int TryDequeue(T* items, int count) {
+					return GOD()->TryDequeue(items, count);
+				}
+
+				/// <summary>Returns the oldest item without removing it, false if the queue is empty.</summary>
+				bool TryPeek(Out<T> result) {
+					return GOD()->TryPeek(&*result);
+				}
+			};
+
+
+			// A ConcurrentDictionary and Wait-Free Queue from Compare and Swap   William Morriss 2015/05/09
+			//
+			// A trie of tables: a table has n rows of one cache line, slot 0 of a row points to the table hung below it and
+			// the other c slots hold the entries whose hash has that row's nibble at that depth. Once the hash bits ran out
+			// (8 levels for 32-bit hashes) the tables below a row only continue it: all their entries collide on the whole
+			// hash and they are chained through row 0.
+			// Reads take no lock: they walk down while slot 0 holds a table, scan the row and check nothing was hung below
+			// it meanwhile, in which case its entries moved down and they walk on. A write locks its row through the low
+			// bit of slot 0; a full row gets a table below that takes its entries over and unlocks the row in the same store.
+			// Entries are immutable, an update stores a new one and retires the old one through Threading::Reclamation::Epoch,
+			// so a read under an epoch guard never sees one deleted. Count is kept per stripe, a thread always counts on
+			// its own stripe, so writers on different cores do not contend on one counter.
+			template<class TKey, class TValue> class System_API ConcurrentDictionary : public Object {
+			private:
+				int Get_Count() const { return GOD()->Get_Count(); }
+				bool Get_IsEmpty() const { return GOD()->Get_Count() == 0; }
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				private:
+					// entries and tables are retired through Epoch and deleted by whichever thread collects them, possibly
+					// after the thread that allocated them ended
+					struct node : Unpooled {
+						TKey key;
+						TValue value;
+						int hash;
+					};
+
+					static const int b = 4;
+					static const int n = 1 << b;
+					static const int c = 7; // cache lines are usually 64 bytes, optimizing this for 64-bit architectures that's 8 64-bit pointers, 7 for entries, 1 for the pointer to the next table
+					static const int cshift = 3;
+					static const int bmask = n - 1;
+					static const int HashBits = 32;
+					static const int CacheLine = 64;
+					static const int MaxStripes = 64;
+
+					struct table_t : Unpooled {
+						std::atomic<void*> entries[n * (c + 1)];
+					};
 
-				//byte* bts = new byte[strlen(to_ptr)];
+					struct Stripe {
+						std::atomic<long> count{ 0 };
+						char pad[CacheLine - sizeof(std::atomic<long>)];
+					};
 
-				//while (to_ptr) *bts++ = *to_ptr++;
-				//return bts;
-				throw NotImplementedException();
-			}
+					System::Collections::Generic::IEqualityComparer<TKey> comparer;
+					bool defaultComparer;
 
-			virtual String GetString(byte const* bytes, int index, int count) {
-				throw NotImplementedException();
-			}
+					table_t* MainTable;
+					Stripe* stripes;
+					int stripeMask;
 
-		};
+					template<class U> static int DefaultHashCode(U const& value, std::true_type) {
+						ulong v = (ulong)value;
+						return (int)((uint)v ^ (uint)(v >> 32));
+					}
 
-		class System_API UTF8Encoding : public Encoding
-		{
-		private:
+					template<class U> int DefaultHashCode(U const& value, std::false_type) const {
+						return comparer.GetHashCode(value);
+					}
 
-		public:
-			UTF8Encoding() {
-			}
+					// the default comparer of integral types is inlined, no call through IEqualityComparer<TKey>
+					int HashOf(TKey const& key) const {
+						if (defaultComparer)
+							return DefaultHashCode(key, std::integral_constant<bool, std::is_integral<TKey>::value>());
+						return comparer.GetHashCode(key);
+					}
 
-			System::Collections::Generic::Array<byte> GetBytes(String const& s) override {
-				//std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
-				byte* dst = new byte[(s.Length << 2) + 1];
-				char16_t* chrs = s.ToCharArray();
-				int len = String::utf16_to_utf8(chrs, s.Length, (char*)dst);
+					bool AreEqual(TKey const& x, TKey const& y) const {
+						return defaultComparer ? x == y : comparer.Equals(x, y);
+					}
 
-				return System::Collections::Generic::Array<byte>(dst, len);
-			}
+					static int RowPos(int hash, int bshift) {
+						return bshift < HashBits ? (int)(((uint)hash >> bshift) & bmask) << cshift : 0;
+					}
 
-			String GetString(byte const* bytes, int index, int count) override {
-				return String((char const*)(bytes + index), count);
-			}
+					// slot 0 of a row: the table below, the low bit is the lock of the row
+					static table_t* Below(void* down) {
+						return reinterpret_cast<table_t*>((uintptr_t)down & ~(uintptr_t)1);
+					}
 
-		};
+					static bool IsLocked(void* down) {
+						return ((uintptr_t)down & 1) != 0;
+					}
 
-#ifndef SYSTEM_EXPORTS
-		UTF8Encoding Encoding::UTF8;
-#endif
+					static void* Locked(void* down) {
+						return reinterpret_cast<void*>((uintptr_t)down | 1);
+					}
 
+					static void Backoff(int spins) {
+						if (spins < 10)
+							Threading::Thread::SpinWait(4 << spins);
+						else
+							Threading::Thread::Yield();
+					}
 
+					std::atomic<long>& Counter() {
+						static tlocal int stripe = -1;
+						if (stripe < 0) {
+							static std::atomic<int> next{ 0 };
+							stripe = next.fetch_add(1, std::memory_order_relaxed) & (MaxStripes - 1);
+						}
+						return stripes[stripe & stripeMask].count;
+					}
 
+					// the entry of key, nullptr if there is none; call inside an epoch guard
+					node* Find(TKey const& key, int hash) {
+						table_t* tbl = MainTable;
+						int bshift = 0;
+						for (;;) {
+							int rowpos = RowPos(hash, bshift);
+							table_t* below = Below(tbl->entries[rowpos].load(std::memory_order_acquire));
+							if (below && bshift < HashBits) {
+								tbl = below;
+								bshift += b;
+								continue;
+							}
+							node* found = nullptr;
+							for (int i = 1; i <= c; i++) {
+								node* e = (node*)tbl->entries[rowpos + i].load(std::memory_order_acquire);
+								if (e && e->hash == hash && AreEqual(key, e->key)) {
+									found = e;
+									break;
+								}
+							}
+							below = Below(tbl->entries[rowpos].load(std::memory_order_acquire));
+							if (bshift < HashBits) {
+								// else the row was split while it was scanned, newer entries may be below
+								if (!below)
+									return found;
+								continue;
+							}
+							if (found || !below)
+								return found;
+							tbl = below;
+							bshift += b;
+						}
+					}
 
-		namespace RegularExpressions {
+					// locks the row key belongs in: the last row on its path, or the first one once the hash bits ran out
+					table_t* LockRow(int hash, int& rowpos, int& bshift) {
+						table_t* tbl = MainTable;
+						bshift = 0;
+						for (int spins = 0;;) {
+							rowpos = RowPos(hash, bshift);
+							void* down = tbl->entries[rowpos].load(std::memory_order_acquire);
+							if (Below(down) && bshift < HashBits) {
+								tbl = Below(down);
+								bshift += b;
+								spins = 0;
+								continue;
+							}
+							if (!IsLocked(down) && tbl->entries[rowpos].compare_exchange_weak(down, Locked(down), std::memory_order_acquire, std::memory_order_relaxed))
+								return tbl;
+							Backoff(spins++);
+						}
+					}
 
-			enum class RegexOptions {
-				None = 0x0000,
-				IgnoreCase = 0x0001,
-				Multiline = 0x0002,
-				ExplicitCapture = 0x0004,
-				Compiled = 0x0008,
-				SingleLine = 0x0010,
-				IgnorePatternWhitespace = 0x0020,
-				RightToLeft = 0x0040,
-				ECMAScript = 0x0100,
-				CultureInvariant = 0x0200,
-			};
+					static void UnlockRow(table_t* tbl, int rowpos) {
+						void* down = tbl->entries[rowpos].load(std::memory_order_relaxed);
+						tbl->entries[rowpos].store(Below(down), std::memory_order_release);
+					}
+
+					// the slot of key in the locked row and the rows chained to it, nullptr if it is not there; free gets an
+					// empty slot, nullptr if they are full
+					std::atomic<void*>* Scan(table_t* tbl, int rowpos, int bshift, TKey const& key, int hash, std::atomic<void*>*& free) {
+						free = nullptr;
+						for (;;) {
+							for (int i = 1; i <= c; i++) {
+								std::atomic<void*>& slot = tbl->entries[rowpos + i];
+								node* e = (node*)slot.load(std::memory_order_relaxed);
+								if (!e) {
+									if (!free)
+										free = &slot;
+								}
+								else if (e->hash == hash && AreEqual(key, e->key))
+									return &slot;
+							}
+							table_t* below = Below(tbl->entries[rowpos].load(std::memory_order_relaxed));
+							if (bshift < HashBits || !below)
+								return nullptr;
+							tbl = below;
+						}
+					}
 
+					// hangs a table below the locked full row that takes its entries over, returns it with the row of hash
+					// locked; the row itself is unlocked by the same store that publishes the table
+					table_t* Split(table_t* tbl, int rowpos, int bshift, int hash) {
+						table_t* child = new table_t();
+						int shift = bshift + b;
+						for (int i = 1; i <= c; i++) {
+							node* e = (node*)tbl->entries[rowpos + i].load(std::memory_order_relaxed);
+							int pos = RowPos(e->hash, shift) + 1;
+							while (child->entries[pos].load(std::memory_order_relaxed))
+								pos++;
+							child->entries[pos].store(e, std::memory_order_relaxed);
+						}
+						child->entries[RowPos(hash, shift)].store(Locked(nullptr), std::memory_order_relaxed);
+						tbl->entries[rowpos].store(child, std::memory_order_release);
+						return child;
+					}
+
+					// chains a table to the full rows of colliding hashes that start at the locked row, returns its first slot
+					static std::atomic<void*>* Append(table_t* tbl) {
+						while (table_t* below = Below(tbl->entries[0].load(std::memory_order_relaxed)))
+							tbl = below;
+						table_t* next = new table_t();
+						void* down = tbl->entries[0].load(std::memory_order_relaxed);
+						tbl->entries[0].store(IsLocked(down) ? Locked(next) : next, std::memory_order_release);
+						return &next->entries[1];
+					}
+
+					// With the row of key locked: if the entry of key is still expected (nullptr: key absent), stores
+					// desired in its place (nullptr: removes it) and retires expected. Else returns false, current gets the
+					// entry there is. Call inside an epoch guard.
+					bool Exchange(TKey const& key, int hash, node* expected, node* desired, node*& current) {
+						int rowpos;
+						int bshift;
+						table_t* tbl = LockRow(hash, rowpos, bshift);
+						for (;;) {
+							std::atomic<void*>* free;
+							std::atomic<void*>* slot = Scan(tbl, rowpos, bshift, key, hash, free);
+							current = slot ? (node*)slot->load(std::memory_order_relaxed) : nullptr;
+							if (current != expected) {
+								UnlockRow(tbl, rowpos);
+								return false;
+							}
+							if (slot) {
+								slot->store(desired, std::memory_order_release);
+								if (!desired)
+									Counter().fetch_sub(1, std::memory_order_relaxed);
+							}
+							else if (desired) {
+								if (!free) {
+									if (bshift < HashBits) {
+										tbl = Split(tbl, rowpos, bshift, hash);
+										bshift += b;
+										rowpos = RowPos(hash, bshift);
+										continue;
+									}
+									free = Append(tbl);
+								}
+								free->store(desired, std::memory_order_release);
+								Counter().fetch_add(1, std::memory_order_relaxed);
+							}
+							UnlockRow(tbl, rowpos);
+							if (expected)
+								Threading::Reclamation::Epoch::Retire(expected);
+							return true;
+						}
+					}
 
-			class System_API Regex : public Object {
-			private:
-			public:
+					node* NewNode(TKey const& key, TValue const& value, int hash) {
+						node* e = new node{ {}, key, value, hash };
+						return e;
+					}
 
+					// calls f on the entries of the rows of tbl and below, a row that was split is left to the table below
+					template<class F> static void Visit(table_t* tbl, int bshift, F const& f) {
+						for (int row = 0; row < n; row++) {
+							int rowpos = row << cshift;
+							table_t* below = Below(tbl->entries[rowpos].load(std::memory_order_acquire));
+							if (!below || bshift >= HashBits) {
+								for (int i = 1; i <= c; i++) {
+									node* e = (node*)tbl->entries[rowpos + i].load(std::memory_order_acquire);
+									if (e)
+										f(e);
+								}
+							}
+							if (below)
+								Visit(below, bshift + b, f);
+						}
+					}
 
+					static void DeleteTable(table_t* tbl, int bshift) {
+						Visit(tbl, bshift, [](node* e) { delete e; });
+						DeleteTables(tbl, bshift);
+					}
 
+					static void DeleteTables(table_t* tbl, int bshift) {
+						for (int row = 0; row < n; row++) {
+							table_t* below = Below(tbl->entries[row << cshift].load(std::memory_order_relaxed));
+							if (below)
+								DeleteTables(below, bshift + b);
+						}
+						delete tbl;
+					}
 
+				public:
+					ObjectData(int capacity, System::Collections::Generic::IEqualityComparer<TKey> comparer) {
+						if (capacity < 0)
+							throw ArgumentOutOfRangeException();
+						MainTable = new table_t();
+						int numstripes = 1;
+						while (numstripes < MaxStripes && numstripes < (int)Environment::ProcessorCount)
+							numstripes <<= 1;
+						stripes = new Stripe[numstripes];
+						stripeMask = numstripes - 1;
+						System::Collections::Generic::IEqualityComparer<TKey> def = System::Collections::Generic::EqualityComparer<TKey>::Default;
+						defaultComparer = comparer.GOD() == nullptr || comparer.GOD() == def.GOD();
+						this->comparer = defaultComparer ? def : comparer;
+					}
 
+					ObjectData(int capacity) : ObjectData(capacity, null) {}
 
-			};
+					ObjectData(System::Collections::Generic::IEqualityComparer<TKey> comparer) : ObjectData(0, comparer) {}
 
+					ObjectData() : ObjectData(0) {}
 
+					~ObjectData() override {
+						DeleteTable(MainTable, 0);
+						delete[] stripes;
+					}
 
-		}
-	}
+					int Get_Count() const {
+						long sum = 0;
+						for (int i = 0; i <= stripeMask; i++)
+							sum += stripes[i].count.load(std::memory_order_relaxed);
+						// a remove may be counted on one stripe before the add it undid is seen on another
+						return sum > 0 ? (int)sum : 0;
+					}
 
-	class System_API Console
-	{
-	private:
-	public:
+					bool TryGetValue(TKey const& key, TValue& value) {
+						Threading::Reclamation::Epoch::Guard guard;
+						node* e = Find(key, HashOf(key));
+						if (!e)
+							return false;
+						value = e->value;
+						return true;
+					}
 
-		static void Write(String const& value) {
-#if _MSC_VER
-			wchar_t* wchrs = (wchar_t*)value.ToCharArray();
-			WriteConsoleW(GetStdHandle(STD_OUTPUT_HANDLE), wchrs, (DWORD)std::wcslen(wchrs), NULL, NULL);
-#elif defined ESP32
-			Serial.print((char const*)(uint8_t const*)System::Text::Encoding::UTF8.GetBytes(value));
-#else	
+					bool TryAdd(TKey const& key, TValue const& value) {
+						int hash = HashOf(key);
+						Threading::Reclamation::Epoch::Guard guard;
+						if (Find(key, hash))
+							return false;
+						node* d = NewNode(key, value, hash);
+						node* current;
+						if (Exchange(key, hash, nullptr, d, current))
+							return true;
+						delete d;
+						return false;
+					}
 
+					bool TryRemove(TKey const& key, TValue& value) {
+						int hash = HashOf(key);
+						Threading::Reclamation::Epoch::Guard guard;
+						node* e = Find(key, hash);
+						while (e) {
+							// retired but not deleted before the guard goes
+							if (Exchange(key, hash, e, nullptr, e)) {
+								value = e->value;
+								return true;
+							}
+						}
+						return false;
+					}
 
-			//std::cout << (int)value.Length << std::endl;
-			System::Collections::Generic::Array<byte> arr = System::Text::Encoding::UTF8.GetBytes(value);
-			byte const* chrs = arr;
-			//for (int i = 0; i < value.Length; i++)
-			//	std::cout << (int)chrs[i] << std::endl;
-			std::cout.write((char const*)chrs, arr.Length);
-			std::cout.flush();
-#endif
-		}
+					bool TryUpdate(TKey const& key, TValue const& newValue, TValue const& comparisonValue) {
+						int hash = HashOf(key);
+						Threading::Reclamation::Epoch::Guard guard;
+						node* e = Find(key, hash);
+						while (e && e->value == comparisonValue) {
+							node* d = NewNode(key, newValue, hash);
+							if (Exchange(key, hash, e, d, e))
+								return true;
+							delete d;
+						}
+						return false;
+					}
 
-		static void WriteLine(String const& value)
-		{
-			Write(value + u"\r\n");
-			//std::cout << std::endl;
-		}
+					template<class FAdd, class FUpdate> TValue AddOrUpdate(TKey const& key, FAdd const& add, FUpdate const& update) {
+						int hash = HashOf(key);
+						Threading::Reclamation::Epoch::Guard guard;
+						node* e = Find(key, hash);
+						for (;;) {
+							node* d = NewNode(key, e ? update(key, e->value) : add(key), hash);
+							TValue result = d->value;
+							if (Exchange(key, hash, e, d, e))
+								return result;
+							delete d;
+						}
+					}
 
-	};
+					template<class FAdd> TValue GetOrAdd(TKey const& key, FAdd const& add) {
+						int hash = HashOf(key);
+						Threading::Reclamation::Epoch::Guard guard;
+						node* e = Find(key, hash);
+						if (e)
+							return e->value;
+						node* d = NewNode(key, add(key), hash);
+						TValue result = d->value;
+						if (Exchange(key, hash, nullptr, d, e))
+							return result;
+						// added by another thread meanwhile
+						delete d;
+						return e->value;
+					}
+
+					System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>> ToList() {
+						System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>> ret = new System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>>();
+						Threading::Reclamation::Epoch::Guard guard;
+						Visit(MainTable, 0, [&ret](node* e) { ret.Add(System::Collections::Generic::KeyValuePair<TKey, TValue>(e->key, e->value)); });
+						return ret;
+					}
+				};
 
-	namespace Threading {
-		//typedef void(*cfnoparam)(void);
+				/// <summary>Walks the copy of the entries begin() takes (see ToList) for a range-based for loop:
+				/// for (auto&amp; kvp : dic). Writes during the loop do not show up in it.</summary>
+				class System_API Iterator
+				{
+				private:
+					System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>> items;
+					int index;
+					int count;
+				public:
+					Iterator(System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>> const& items) : items(items), index(0), count(items == null ? 0 : (int)items.Count) {
+					}
 
-		enum class ApartmentState {
-			STA = 0,
-			MTA = 1,
-			Unknown = 2
-		};
+					System::Collections::Generic::KeyValuePair<TKey, TValue>& operator*() {
+						return items[index];
+					}
 
+					Iterator& operator++() {
+						++index;
+						return *this;
+					}
 
+					bool operator!=(Iterator const& other) const {
+						return (index < count) != (other.index < other.count);
+					}
 
+					bool operator==(Iterator const& other) const {
+						return !(*this != other);
+					}
+				};
 
+				/// <summary>A snapshot of the number of items, it may be stale by the time it is read.</summary>
+				PropGenGet<int, ConcurrentDictionary, &ConcurrentDictionary::Get_Count> Count{ this };
+				PropGenGet<bool, ConcurrentDictionary, &ConcurrentDictionary::Get_IsEmpty> IsEmpty{ this };
 
-		class System_API Thread : public Object
-		{
-		private:
-			bool& Get_IsBackground() const {
-				return GOD()->IsBackground;
-			}
+								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-			void Set_IsBackground(const bool& value) {
-				GOD()->IsBackground = value;
-			}
+				ConcurrentDictionary(){}
 
-			void Set_IsBackground(bool&& value) {
-				GOD()->IsBackground = value;
-			}
+				ConcurrentDictionary(std::nullptr_t const & n) : System::Object(n) {
+				}
 
-		public:
-			class System_API ObjectData : public Object::ObjectData {
-			public:
-				std::thread* t = nullptr;
-				Action<> act;
-				ApartmentState apstate;
-				bool IsBackground = false;
+				ConcurrentDictionary(ConcurrentDictionary* pValue) {
+					if (!pValue->od) {
+						ObjectData* dd = new ObjectData();
+						od = dd;
+					}
+					else {
+						od = pValue->od;
+						pValue->od = nullptr;
+					}
+					delete pValue;
+				}
 
-				ObjectData() : apstate(ApartmentState::MTA) {
+				ConcurrentDictionary(ConcurrentDictionary const & other) : System::Object(other) { }
+
+				ConcurrentDictionary(ConcurrentDictionary&& other) noexcept : System::Object(std::move(other)) { }
+
+				ConcurrentDictionary(Object::ObjectData* other) : System::Object(other) {
 				}
 
-				~ObjectData() override {
-					if (t) {
-						if (IsBackground) {
-							t->detach();
-							delete t; // Yes, you have to delete it by yourself.Once you called std::thread::detach, the thread will be separated from the thread object and allowed execution to continue independently, and then the thread object will no longer own any thread.
-							t = nullptr;
-						}
-						else {
-							if (t->get_id() != std::this_thread::get_id()) {
-								t->join();
-								delete t;
-								t = nullptr;
-							}
-							else {
-								// we're on the t thread trying to delete ourselves, this happens for threads that aren't referenced anymore by anything but itself
-								// not sure if this is the correct/best way to handle this but it seems to work at least on MVC
-								// we skip calling the std::thread destructor and just release the memory:
-								::operator delete(t);
-							}
+				ConcurrentDictionary& operator=(ConcurrentDictionary const & other) {
+					System::Object::operator=(other);
+					return *this;
+				}
+
+				ConcurrentDictionary& operator=(std::nullptr_t const & n) {
+					System::Object::operator=(n);
+					return *this;
+				}
+
+				ConcurrentDictionary& operator=(ConcurrentDictionary&& other) noexcept {
+					System::Object::operator=(std::move(other));
+					return *this;
+				}
+
+				ConcurrentDictionary& operator=(ConcurrentDictionary* other) {
+					if (od == other->od)
+						return *this;
+					Release();
+					od = other->od;
+					::operator delete((void*)other);
+					return *this;
+				}
+
+				ConcurrentDictionary* operator->() {
+					return this;
+				}
+
+
+
+				ConcurrentDictionary(int capacity) {
+					od = new ObjectData(capacity);
+				}
 
-						}
-					}
+				ConcurrentDictionary(int capacity, System::Collections::Generic::IEqualityComparer<TKey> comparer) {
+					od = new ObjectData(capacity, comparer);
 				}
-			};
 
+				ConcurrentDictionary(System::Collections::Generic::IEqualityComparer<TKey> comparer) {
+					od = new ObjectData(comparer);
+				}
 
-						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				/// <summary>Adds key, throws if it is already there.</summary>
+				void Add(TKey const& key, TValue const& value) {
+					if (!GOD()->TryAdd(key, value))
+						throw Exception();
+				}
 
-			Thread(){}
+				/// <summary>Adds key if it is not there yet.</summary>
+				bool TryAdd(TKey const& key, TValue const& value) {
+					return GOD()->TryAdd(key, value);
+				}
 
-			Thread(std::nullptr_t const & n) : System::Object(n) {
-			}
+				/// <summary>Takes no lock, a read running alongside a write sees the entry either before or after it.</summary>
+				bool TryGetValue(TKey const& key, TValue& value) {
+					return GOD()->TryGetValue(key, value);
+				}
 
-			Thread(Thread* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
+				bool ContainsKey(TKey const& key) {
+					TValue value;
+					return GOD()->TryGetValue(key, value);
 				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
+
+				bool TryRemove(TKey const& key, TValue& value) {
+					return GOD()->TryRemove(key, value);
 				}
-				delete pValue;
-			}
 
-			Thread(Thread const & other) : System::Object(other) { }
+				bool Remove(TKey const& key) {
+					TValue value;
+					return GOD()->TryRemove(key, value);
+				}
 
-			Thread(Thread&& other) noexcept : System::Object(std::move(other)) { }
+				/// <summary>Sets the value of key to newValue if it is comparisonValue.</summary>
+				bool TryUpdate(TKey const& key, TValue const& newValue, TValue const& comparisonValue) {
+					return GOD()->TryUpdate(key, newValue, comparisonValue);
+				}
 
-			Thread(Object::ObjectData* other) : System::Object(other) {
-			}
+				/// <summary>Returns the value of key, adds value first if key is not there.</summary>
+				TValue GetOrAdd(TKey const& key, TValue const& value) {
+					return GOD()->GetOrAdd(key, [&value](TKey const&) { return value; });
+				}
 
-			Thread& operator=(Thread const & other) {
-				System::Object::operator=(other);
-				return *this;
-			}
+				/// <summary>Returns the value of key, adds valueFactory(key) first if key is not there. valueFactory runs
+				/// outside any lock and may run although another thread added key meanwhile.</summary>
+				TValue GetOrAdd(TKey const& key, Func<TKey, TValue> const& valueFactory) {
+					return GOD()->GetOrAdd(key, valueFactory);
+				}
 
-			Thread& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
+				/// <summary>Adds addValue for key, or sets its value to updateValueFactory(key, old value) if it is there.
+				/// Returns the value stored. The factory runs outside any lock and again if another write came first.</summary>
+				TValue AddOrUpdate(TKey const& key, TValue const& addValue, Func<TKey, TValue, TValue> const& updateValueFactory) {
+					return GOD()->AddOrUpdate(key, [&addValue](TKey const&) { return addValue; }, updateValueFactory);
+				}
 
-			Thread& operator=(Thread&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
+				TValue AddOrUpdate(TKey const& key, Func<TKey, TValue> const& addValueFactory, Func<TKey, TValue, TValue> const& updateValueFactory) {
+					return GOD()->AddOrUpdate(key, addValueFactory, updateValueFactory);
+				}
 
-			Thread& operator=(Thread* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
+				/// <summary>A copy of the entries taken without locking, an entry written meanwhile may or may not be in it.</summary>
+				System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<TKey, TValue>> ToList() {
+					return GOD()->ToList();
+				}
 
-			Thread* operator->() {
-				return this;
-			}
+				Iterator begin() const {
+					return Iterator(GOD()->ToList());
+				}
 
+				Iterator end() const {
+					return Iterator(nullptr);
+				}
+			};
 
+		}
 
-			Thread(Action<> const & act)
-			{
-				ObjectData* dd = new ObjectData();
-				dd->act = act;
-				od = dd;
-			}
 
-			Thread(Action<>&& act)
-			{
-				ObjectData* dd = new ObjectData();
-				dd->act = std::move(act);
-				od = dd;
-			}
 
+	}
 
-			static void Sleep(int millisecondsTimeout)
-			{
-				std::chrono::milliseconds dura(millisecondsTimeout);
-				std::this_thread::sleep_for(dura);
-			}
 
-			static void Yield() {
-				std::this_thread::yield();
+	class System_API IAsyncResult : public Object
+	{
+	private:
+
+
+	public:
+		bool Get_IsCompleted() const { return GOD()->Get_IsCompleted(); }
+		bool Get_CompletedSynchronously() const { return GOD()->Get_CompletedSynchronously(); };
+		Object Get_AsyncState() const { return GOD()->Get_AsyncState(); };
+		System::Threading::WaitHandle Get_AsyncWaitHandle() const { return GOD()->Get_AsyncWaitHandle(); };
+
+		class System_API ObjectData {
+		public:
+			ObjectData() {
 			}
 
-			static void SpinWait(int iterations) {
-				for (int i = 0; i < iterations; i++) {
-					PAUSE();
-				}
+			~ObjectData() {
 			}
 
-			//Thread(int id)
-			//{
-			//	ManagedThreadId = id;
-			//}
+			virtual bool Get_IsCompleted() const = 0;
+			virtual bool Get_CompletedSynchronously() const = 0;
+			virtual Object Get_AsyncState() const = 0;
+			virtual System::Threading::WaitHandle Get_AsyncWaitHandle() const = 0;
+		};
 
-			static Thread _CurrentThread;
+		PropGenGet<bool, IAsyncResult, &IAsyncResult::Get_IsCompleted> IsCompleted{ this };
+		PropGenGet<bool, IAsyncResult, &IAsyncResult::Get_CompletedSynchronously> CompletedSynchronously{ this };
+		PropGenGet<Object, IAsyncResult, &IAsyncResult::Get_AsyncState> AsyncState{ this };
+		PropGenGet<System::Threading::WaitHandle, IAsyncResult, &IAsyncResult::Get_AsyncWaitHandle> AsyncWaitHandle{ this };
 
-			void Start() {
-				ObjectData* td = GOD();
-				Thread& t = *this;
-				//ApartmentState apstate = td->apstate;
-				td->t = new std::thread([t]() {
+				ObjectData* id = nullptr;
 
-					ObjectData* td = t.GOD();
-					//#if _MSC_VER
-#ifdef _MSC_VER
-					HRESULT comhandle = CoInitializeEx(0, td->apstate == ApartmentState::STA ? COINIT_APARTMENTTHREADED : COINIT_MULTITHREADED);
-#endif
-					try {
-						td->act();
-					}
-					catch (...) {
-						//#if _MSC_VER
-#ifdef _MSC_VER
-						CoUninitialize();
-#endif
-						throw;
-					}
-					//#if _MSC_VER
-#ifdef _MSC_VER
-					CoUninitialize();
-#endif
-					});
-			}
+		ObjectData* GOD() const { return this->id; };
 
-			//void Start(Object parameter)
-			//{
-			//	t = std::thread(func, parameter);
-			//}
+		IAsyncResult(){}
 
-			void Join() {
-				ObjectData* td = GOD();
-				td->t->join();
-				delete td->t;
-				td->t = nullptr;
-			}
+		IAsyncResult(std::nullptr_t const & n) : System::Object (nullptr), id(nullptr) {
+		}
 
-			void SetApartmentState(ApartmentState state) {
-				GOD()->apstate = state;
-			}
+		IAsyncResult(IAsyncResult const & other) : System::Object(other) { this->id = other.id; }
 
+		IAsyncResult(IAsyncResult&& other) noexcept : System::Object(std::move(other)) { this->id = other.id; other.id = nullptr;  }
 
+		IAsyncResult(System::Object::ObjectData* baseod, ObjectData* other) : System::Object(baseod), id(other) {
+		}
 
-			PropGen<bool, bool, System::Threading::Thread, &System::Threading::Thread::Get_IsBackground, &System::Threading::Thread::Set_IsBackground, &System::Threading::Thread::Set_IsBackground> IsBackground{ this };// = PropGen<bool&, bool, System::Threading::Thread, &System::Threading::Thread::Get_IsBackground, &System::Threading::Thread::Set_IsBackground>(this);
-		};
+		IAsyncResult& operator=(IAsyncResult const & other) {
+			System::Object::operator=(other);
+			id = other.id;
+			return *this;
+		}
 
-		class System_API Timeout {
-		public:
-			static const int Infinite = -1;
-			static const uint UnsignedInfinite = (uint)-1;
+		IAsyncResult& operator=(IAsyncResult&& other) noexcept {
+			System::Object::operator=(std::move(other));
+			id = other.id;
+			return *this;
+		}
 
-		};
+		IAsyncResult* operator->() {
+			return this;
+		}
 
 
-		class System_API SpinLock : public System::Object {
+
+
+
+
+	};
+
+	namespace Threading {
+#if _MSC_VER || __MINGW32__
+		/// <summary>Represents a thread synchronization event that, when signaled, must be reset manually. This class cannot be inherited.</summary>
+		class System_API ManualResetEventWindows : public Object {
 		private:
 		public:
-			class ObjectData : public System::Object::ObjectData {
+			class System_API ObjectData : public Object::ObjectData {
 			private:
-				std::atomic_flag flag;
+				//		std::condition_variable condition;
+				HANDLE evnt;
 
 			public:
+				ObjectData(bool initialState) {
+					evnt = CreateEvent(NULL, true, initialState, NULL);
+				}
 
-				ObjectData() {
-					// initing the flag can't be done through the constructor in MSC so we explicitly call clear, which should be portable
-					flag.clear();
+				ObjectData() : ObjectData(false) {}
+
+				~ObjectData() override {
+					CloseHandle(evnt);
 				}
 
-				void Enter(Ref<bool> lockTaken) {
-					while (flag.test_and_set(std::memory_order_acquire));
+				bool Set() {
+					return SetEvent(evnt);
+				}
 
-					lockTaken = true;
+				bool Reset() {
+					return ResetEvent(evnt);
 				}
 
-				void Exit() {
-					flag.clear(std::memory_order_release);
+				bool WaitOne() {
+					DWORD err = WaitForSingleObject(evnt, INFINITE);
+					return err == WAIT_OBJECT_0;
 				}
 
-				void TryEnter(Ref<bool> lockTaken) {
-					lockTaken = !flag.test_and_set(std::memory_order_acquire);
+				bool WaitOne(const System::TimeSpan& timeout) {
+					return false;
+				}
+
+				bool WaitOne(int millisecondsTimeout) {
+					return false;
 				}
 			};
 
-						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-			SpinLock(){}
+			ManualResetEventWindows(){}
 
-			SpinLock(std::nullptr_t const & n) : System::Object(n) {
+			ManualResetEventWindows(std::nullptr_t const & n) : System::Object(n) {
 			}
 
-			SpinLock(SpinLock* pValue) {
+			ManualResetEventWindows(ManualResetEventWindows* pValue) {
 				if (!pValue->od) {
 					ObjectData* dd = new ObjectData();
 					od = dd;
@@ -12527,29 +21340,29 @@ namespace System {
 				delete pValue;
 			}
 
-			SpinLock(SpinLock const & other) : System::Object(other) { }
+			ManualResetEventWindows(ManualResetEventWindows const & other) : System::Object(other) { }
 
-			SpinLock(SpinLock&& other) noexcept : System::Object(std::move(other)) { }
+			ManualResetEventWindows(ManualResetEventWindows&& other) noexcept : System::Object(std::move(other)) { }
 
-			SpinLock(Object::ObjectData* other) : System::Object(other) {
+			ManualResetEventWindows(Object::ObjectData* other) : System::Object(other) {
 			}
 
-			SpinLock& operator=(SpinLock const & other) {
+			ManualResetEventWindows& operator=(ManualResetEventWindows const & other) {
 				System::Object::operator=(other);
 				return *this;
 			}
 
-			SpinLock& operator=(std::nullptr_t const & n) {
+			ManualResetEventWindows& operator=(std::nullptr_t const & n) {
 				System::Object::operator=(n);
 				return *this;
 			}
 
-			SpinLock& operator=(SpinLock&& other) noexcept {
+			ManualResetEventWindows& operator=(ManualResetEventWindows&& other) noexcept {
 				System::Object::operator=(std::move(other));
 				return *this;
 			}
 
-			SpinLock& operator=(SpinLock* other) {
+			ManualResetEventWindows& operator=(ManualResetEventWindows* other) {
 				if (od == other->od)
 					return *this;
 				Release();
@@ -12558,98 +21371,155 @@ namespace System {
 				return *this;
 			}
 
-			SpinLock* operator->() {
+			ManualResetEventWindows* operator->() {
 				return this;
 			}
 
-
-
-				void Enter(Ref<bool> lockTaken) {
-				GOD()->Enter(lockTaken);
+
+
+			/// <summary>Initializes a new instance of the ManualResetEvent class with a Boolean value indicating whether to set the initial state to signaled.</summary>
+			/// <param name="initialState">true to set the initial state signaled; false to set the initial state to nonsignaled.</param>
+			ManualResetEventWindows(bool initialState) {
+				this->od = new ObjectData(initialState);
+			}
+
+			/// <summary>Sets the state of the event to signaled, allowing one or more waiting threads to proceed.</summary>
+			/// <returns>true if the operation succeeds; otherwise, false.</returns>
+			bool Set() const {
+				return GOD()->Set();
 			}
 
-			void Exit() {
-				GOD()->Exit();
+			/// <summary>Sets the state of the event to nonsignaled, causing threads to block.</summary>
+			/// <returns>true if the operation succeeds; otherwise, false.</returns>
+			bool Reset() const {
+				return GOD()->Reset();
 			}
 
-			void TryEnter(Ref<bool> lockTaken) {
-				GOD()->TryEnter(lockTaken);
+			/// <summary>Blocks the current thread until the current instance receives a signal, using a TimeSpan to specify the time interval.</summary>
+			/// <param name="timeout">A TimeSpan that represents the number of milliseconds to wait, or a TimeSpan that represents -1 milliseconds to wait indefinitely.</param>
+			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
+			bool WaitOne(TimeSpan const & timeout) const {
+				return GOD()->WaitOne(timeout);
 			}
-		};
-
-
-		class System_API SpinWait : System::Object {
-		private:
-			static const int YIELD_THRESHOLD = 10;
-			static const int SLEEP_0_EVERY_HOW_MANY_TIMES = 5;
-			static const int SLEEP_1_EVERY_HOW_MANY_TIMES = 20;
 
-			int Get_Count() const {
-				return GOD()->m_count;
+			/// <summary>Blocks the current thread until the current WaitHandle receives a signal, using a 32-bit signed integer to specify the time interval in milliseconds.</summary>
+			/// <param name="millisecondsTimeout">The number of milliseconds to wait, or Infinite (-1) to wait indefinitely.</param>
+			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
+			bool WaitOne(int millisecondsTimeout) const {
+				return GOD()->WaitOne(millisecondsTimeout);
 			}
 
-			bool Get_NextSpinWillYield() const {
-				return GOD()->NextSpinWillYield();
+			/// <summary>Blocks the current thread until the current WaitHandle receives a signal.</summary>
+			/// <returns>true if the current instance receives a signal. If the current instance is never signaled, WaitOne() never returns.</returns>
+			bool WaitOne() const {
+				return GOD()->WaitOne();
 			}
+		};
+#endif
 
+		/// <summary>Represents a thread synchronization event that, when signaled, must be reset manually. This class cannot be inherited.</summary>
+		class System_API ManualResetEventConditionVariable : public Object {
+		private:
 		public:
-			class System_API ObjectData : System::Object::ObjectData {
+			class System_API ObjectData : public Object::ObjectData {
 			private:
-				int m_count = 0;
+				struct SetCallback {
+					SetCallback* next;
+					Action<> action;
+				};
+
+				std::condition_variable condition;
+				std::mutex mut;
+				std::atomic<bool> state;
+				SetCallback* callbacks = nullptr;
 
-				friend class SpinWait;
 			public:
-				ObjectData() : System::Object::ObjectData(0) {}
+				ObjectData(bool initialState) {
+					state.store(initialState);
+				}
 
-				Object::ObjectData* DeepCopy() override {
-					ObjectData* ret = new ObjectData();
-					ret->m_count = m_count;
+				ObjectData() : ObjectData(false) {}
 
-					return ret;
+				~ObjectData() override {
+					while (callbacks) {
+						SetCallback* next = callbacks->next;
+						delete callbacks;
+						callbacks = next;
+					}
 				}
 
-				bool NextSpinWillYield() {
-					return m_count > YIELD_THRESHOLD || Environment::ProcessorCount == 1;
-				}
+				bool Set() {
+					std::unique_lock<std::mutex> lock(mut);
+					state.store(true);
+					SetCallback* pending = callbacks;
+					callbacks = nullptr;
+					lock.unlock();
+					condition.notify_all();
 
-				void SpinOnce() {
-					if (NextSpinWillYield()) {
-						int yieldsSoFar = m_count >= YIELD_THRESHOLD ? m_count - YIELD_THRESHOLD : m_count;
-						if ((yieldsSoFar % SLEEP_1_EVERY_HOW_MANY_TIMES) == SLEEP_1_EVERY_HOW_MANY_TIMES - 1) {
-							Thread::Sleep(1);
-						}
-						else if ((yieldsSoFar % SLEEP_0_EVERY_HOW_MANY_TIMES) == SLEEP_0_EVERY_HOW_MANY_TIMES - 1) {
-							Thread::Sleep(0);
-						}
-						else {
-							Thread::Yield();
-						}
+					// oldest registration first
+					SetCallback* ordered = nullptr;
+					while (pending) {
+						SetCallback* next = pending->next;
+						pending->next = ordered;
+						ordered = pending;
+						pending = next;
 					}
-					else {
-						Thread::SpinWait(4 << m_count);
+					while (ordered) {
+						SetCallback* next = ordered->next;
+						ordered->action();
+						delete ordered;
+						ordered = next;
 					}
 
-					m_count = m_count == Int32::MaxValue ? YIELD_THRESHOLD : m_count + 1;
+					return true;
 				}
 
-				void Reset() {
-					m_count = 0;
+				void RegisterSetCallback(Action<> const& callback) {
+					std::unique_lock<std::mutex> lock(mut);
+					if (!state.load()) {
+						callbacks = new SetCallback{ callbacks, callback };
+						return;
+					}
+					lock.unlock();
+					callback();
 				}
 
+				bool Reset() {
+					std::unique_lock<std::mutex> lock(mut);
+					state.store(false);
+					return true;
+				}
+
+				bool WaitOne() {
+					std::unique_lock<std::mutex> lock(mut);
+					condition.wait(lock, [&]() {return state.load(); });
+
+					return true;
+				}
 
+				bool WaitOne(System::TimeSpan const& timeout) {
+					std::unique_lock<std::mutex> lock(mut);
+					std::chrono::duration<long, std::milli> dur(timeout.TotalMilliseconds);
+					return condition.wait_for(lock, dur, [&]() { return state.load(); });
+				}
 
+				bool WaitOne(int millisecondsTimeout) {
+					if (millisecondsTimeout == -1)
+						return WaitOne();
+					std::unique_lock<std::mutex> lock(mut);
+					std::chrono::duration<long, std::milli> dur(millisecondsTimeout);
+					return condition.wait_for(lock, dur, [&]() { return state.load(); });
+				}
 			};
-			PropGenGet<int, SpinWait, &SpinWait::Get_Count> Count{ this };
-			PropGenGet<bool, SpinWait, &SpinWait::Get_NextSpinWillYield> NextSpinWillYield{ this };
 
-						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-			SpinWait(){}
+			ManualResetEventConditionVariable(){}
 
-			SpinWait(std::nullptr_t const & n) : System::Object(n) {
+			ManualResetEventConditionVariable(std::nullptr_t const & n) : System::Object(n) {
 			}
 
-			SpinWait(SpinWait* pValue) {
+			ManualResetEventConditionVariable(ManualResetEventConditionVariable* pValue) {
 				if (!pValue->od) {
 					ObjectData* dd = new ObjectData();
 					od = dd;
@@ -12661,29 +21531,29 @@ namespace System {
 				delete pValue;
 			}
 
-			SpinWait(SpinWait const & other) : System::Object(other) { }
+			ManualResetEventConditionVariable(ManualResetEventConditionVariable const & other) : System::Object(other) { }
 
-			SpinWait(SpinWait&& other) noexcept : System::Object(std::move(other)) { }
+			ManualResetEventConditionVariable(ManualResetEventConditionVariable&& other) noexcept : System::Object(std::move(other)) { }
 
-			SpinWait(Object::ObjectData* other) : System::Object(other) {
+			ManualResetEventConditionVariable(Object::ObjectData* other) : System::Object(other) {
 			}
 
-			SpinWait& operator=(SpinWait const & other) {
+			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable const & other) {
 				System::Object::operator=(other);
 				return *this;
 			}
 
-			SpinWait& operator=(std::nullptr_t const & n) {
+			ManualResetEventConditionVariable& operator=(std::nullptr_t const & n) {
 				System::Object::operator=(n);
 				return *this;
 			}
 
-			SpinWait& operator=(SpinWait&& other) noexcept {
+			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable&& other) noexcept {
 				System::Object::operator=(std::move(other));
 				return *this;
 			}
 
-			SpinWait& operator=(SpinWait* other) {
+			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable* other) {
 				if (od == other->od)
 					return *this;
 				Release();
@@ -12692,756 +21562,969 @@ namespace System {
 				return *this;
 			}
 
-			SpinWait* operator->() {
+			ManualResetEventConditionVariable* operator->() {
 				return this;
 			}
 
 
 
-				void SpinOnce() {
-				GOD()->SpinOnce();
+			/// <summary>Initializes a new instance of the ManualResetEvent class with a Boolean value indicating whether to set the initial state to signaled.</summary>
+			/// <param name="initialState">true to set the initial state signaled; false to set the initial state to nonsignaled.</param>
+			ManualResetEventConditionVariable(bool initialState) {
+				this->od = new ObjectData(initialState);
 			}
 
-			void Reset() {
-				GOD()->Reset();
+			/// <summary>Sets the state of the event to signaled, allowing one or more waiting threads to proceed.</summary>
+			/// <returns>true if the operation succeeds; otherwise, false.</returns>
+			bool Set() const {
+				return GOD()->Set();
 			}
 
-			static bool SpinUntil(const Func<bool>& condition, int millisecondsTimeout) {
-				if (millisecondsTimeout < Timeout::Infinite)
-					throw ArgumentOutOfRangeException();
-				if (condition == null)
-					throw ArgumentNullException();
-				uint startTime = 0;
-				if (millisecondsTimeout != 0 && millisecondsTimeout != Timeout::Infinite) {
-					startTime = (uint)Environment::TickCount;
-				}
-				SpinWait spinner{};
-				while (!condition()) {
-					if (millisecondsTimeout == 0)
-						return false;
-					spinner.SpinOnce();
-					if (millisecondsTimeout != Timeout::Infinite && spinner.NextSpinWillYield) {
-						if (millisecondsTimeout <= (Environment::TickCount - (int)startTime))
-							return false;
-					}
-				}
-
-				return true;
+			/// <summary>Sets the state of the event to nonsignaled, causing threads to block.</summary>
+			/// <returns>true if the operation succeeds; otherwise, false.</returns>
+			bool Reset() const {
+				return GOD()->Reset();
 			}
 
+			/// <summary>Calls callback once, on the thread that sets the event, or right away if the event is already set.
+			/// A Reset before the Set does not cancel the registration.</summary>
+			void RegisterSetCallback(Action<> const& callback) const {
+				GOD()->RegisterSetCallback(callback);
+			}
 
+			/// <summary>Blocks the current thread until the current instance receives a signal, using a TimeSpan to specify the time interval.</summary>
+			/// <param name="timeout">A TimeSpan that represents the number of milliseconds to wait, or a TimeSpan that represents -1 milliseconds to wait indefinitely.</param>
+			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
+			bool WaitOne(TimeSpan const& timeout) const {
+				return GOD()->WaitOne(timeout);
+			}
 
+			/// <summary>Blocks the current thread until the current WaitHandle receives a signal, using a 32-bit signed integer to specify the time interval in milliseconds.</summary>
+			/// <param name="millisecondsTimeout">The number of milliseconds to wait, or Infinite (-1) to wait indefinitely.</param>
+			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
+			bool WaitOne(int millisecondsTimeout) const {
+				return GOD()->WaitOne(millisecondsTimeout);
+			}
 
+			/// <summary>Blocks the current thread until the current WaitHandle receives a signal.</summary>
+			/// <returns>true if the current instance receives a signal. If the current instance is never signaled, WaitOne() never returns.</returns>
+			bool WaitOne() const {
+				return GOD()->WaitOne();
+			}
 		};
 
-
-		class System_API WaitHandle : public Object
-		{
-		private:
-			//bool Get_IsCompleted() const { return GOD()->Get_IsCompleted(); }
-			//bool Get_CompletedSynchronously() const { return GOD()->Get_CompletedSynchronously(); };
-			//Object Get_AsyncState() const { return GOD()->Get_AsyncState(); };
-			//System::Threading::WaitHandle Get_AsyncWaitHandle() const { return GOD()->Get_AsyncWaitHandle(); };
-
-		public:
-			class System_API ObjectData {
-			public:
-				ObjectData() {
-				}
-
-				~ObjectData() {
-				}
-
-				//virtual bool Get_IsCompleted() const = 0;
-				//virtual bool Get_CompletedSynchronously() const = 0;
-				//virtual Object Get_AsyncState() const = 0;
-				//virtual System::Threading::WaitHandle Get_AsyncWaitHandle() const = 0;
-			};
-
-					ObjectData* id = nullptr;
-
-		ObjectData* GOD() const { return this->id; };
-
-		WaitHandle(){}
-
-		WaitHandle(std::nullptr_t const & n) : System::Object (nullptr), id(nullptr) {
-		}
-
-		WaitHandle(WaitHandle const & other) : System::Object(other) { this->id = other.id; }
-
-		WaitHandle(WaitHandle&& other) noexcept : System::Object(std::move(other)) { this->id = other.id; other.id = nullptr;  }
-
-		WaitHandle(System::Object::ObjectData* baseod, ObjectData* other) : System::Object(baseod), id(other) {
-		}
-
-		WaitHandle& operator=(WaitHandle const & other) {
-			System::Object::operator=(other);
-			id = other.id;
-			return *this;
-		}
-
-		WaitHandle& operator=(WaitHandle&& other) noexcept {
-			System::Object::operator=(std::move(other));
-			id = other.id;
-			return *this;
-		}
-
-		WaitHandle* operator->() {
-			return this;
-		}
-
-
-
-
-
-		};
+#if _MSC_VER || __MINGW32__
+		using ManualResetEvent = ManualResetEventConditionVariable; // ManualResetEventWindows;
+#else
+		using ManualResetEvent = ManualResetEventConditionVariable;
+#endif
 
 	}
+}
 
-	namespace Collections {
-		namespace Concurrent {
 
-			template<class T> class System_API LockingStack : public Object {
+namespace System {
+	namespace Threading {
+		class System_API SimpleThreadPool : public Object
+		{
+		private:
+			static int Get_ThreadCount() {
+				return _Instance.GetThreadCount();
+			}
+		public:
+			class System_API ObjectData : public Object::ObjectData {
 			private:
 			public:
+				std::atomic<int> NumberOfThreads{};
+				int MaxThreads = 8;
 
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					System::Collections::Generic::Stack<T> s = new System::Collections::Generic::Stack<T>{};
-					std::mutex mut;
-
+				struct WorkItem {
+					Action<> action;
 
-				public:
+					WorkItem(Action<> const& action) : action(action) {}
+				};
 
-					ObjectData() {
-					}
+				// Chase-Lev deque: the owning worker pushes and pops at the bottom, other workers steal from the top.
+				// A buffer it outgrew is retired through Reclamation::Epoch, a thief may still read from it
+				class WorkStealingDeque
+				{
+				private:
+					struct Buffer {
+						long capacity;
+						std::atomic<WorkItem*>* items;
 
-					~ObjectData() override {
+						Buffer(long capacity) : capacity(capacity), items(new std::atomic<WorkItem*>[capacity]) {}
 
-					}
+						~Buffer() {
+							delete[] items;
+						}
 
-					void Push(T const& item) {
+						WorkItem* Get(long index) const {
+							return items[index & (capacity - 1)].load(std::memory_order_relaxed);
+						}
 
-						//mut.lock();
-						std::lock_guard<std::mutex> mlock(mut);
-						s.Push(item);
-						//mut.unlock();
-					}
+						void Put(long index, WorkItem* item) {
+							items[index & (capacity - 1)].store(item, std::memory_order_relaxed);
+						}
+					};
 
-					void Push(T&& item) {
-						std::lock_guard<std::mutex> mlock(mut);
-						//mut.lock();
-						s.Push(std::forward<T>(item));
-						//mut.unlock();
-					}
+					std::atomic<long> top{ 0 };
+					std::atomic<long> bottom{ 0 };
+					std::atomic<Buffer*> buffer;
 
-					bool TryPop(Out<T> result) {
-						std::lock_guard<std::mutex> mlock(mut);
-						//mut.lock();
-						if (s.Count == 0) {
-							//mut.unlock();
-							return false;
+				public:
+					WorkStealingDeque() : buffer(new Buffer(256)) {}
+
+					~WorkStealingDeque() {
+						delete buffer.load(std::memory_order_relaxed);
+					}
+
+					// owner only
+					void Push(WorkItem* item) {
+						long b = bottom.load(std::memory_order_relaxed);
+						long t = top.load(std::memory_order_acquire);
+						Buffer* a = buffer.load(std::memory_order_relaxed);
+						if (b - t > a->capacity - 1) {
+							Buffer* grown = new Buffer(a->capacity << 1);
+							for (long i = t; i < b; i++)
+								grown->Put(i, a->Get(i));
+							buffer.store(grown, std::memory_order_release);
+							Reclamation::Epoch::Retire(a);
+							a = grown;
 						}
-						result = s.Pop();
-
-						//mut.unlock();
-						return true;
+						a->Put(b, item);
+						std::atomic_thread_fence(std::memory_order_release);
+						bottom.store(b + 1, std::memory_order_relaxed);
+					}
+
+					// owner only, the most recently pushed item
+					WorkItem* Pop() {
+						long b = bottom.load(std::memory_order_relaxed) - 1;
+						Buffer* a = buffer.load(std::memory_order_relaxed);
+						bottom.store(b, std::memory_order_relaxed);
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						long t = top.load(std::memory_order_relaxed);
+						if (t > b) {
+							bottom.store(b + 1, std::memory_order_relaxed);
+							return nullptr;
+						}
+						WorkItem* item = a->Get(b);
+						if (t == b) {
+							// the last item, a thief may be taking it as well
+							if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+								item = nullptr;
+							bottom.store(b + 1, std::memory_order_relaxed);
+						}
+						return item;
 					}
 
-					T Pop() {
-						std::lock_guard<std::mutex> mlock(mut);
-						return s.Pop();
+					// any thread, the oldest item. Returns nullptr if the deque is empty or another thread won the race
+					WorkItem* Steal() {
+						long t = top.load(std::memory_order_acquire);
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						long b = bottom.load(std::memory_order_acquire);
+						if (t >= b)
+							return nullptr;
+						Reclamation::Epoch::Guard guard;
+						WorkItem* item = guard.Protect(buffer)->Get(t);
+						if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+							return nullptr;
+						return item;
 					}
+				};
 
+				struct Worker {
+					ObjectData* pool;
+					int index;
+					uint seed;
+					WorkStealingDeque deque;
+					Thread t;
 				};
 
-								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				// items from threads outside the pool
+				System::Collections::Concurrent::ConcurrentQueue<WorkItem*> ActionQueue;
+				Worker* workers = nullptr;
+				std::once_flag started;
+
+				// items queued but not yet taken, workers looking for one and workers parked on wakeup until
+				// queued becomes positive
+				std::atomic<int> queued{ 0 };
+				std::atomic<int> searching{ 0 };
+				std::atomic<int> sleeping{ 0 };
+				std::mutex parkMutex;
+				std::condition_variable wakeup;
+
+				// work queued or running, an item counts until it is released. WaitIdle waits for 0
+				std::atomic<int> pending{ 0 };
+				std::atomic<int> idleWaiters{ 0 };
+				std::condition_variable drained;
+
+				ObjectData() : ActionQueue(new System::Collections::Concurrent::ConcurrentQueue<WorkItem*>())
+				{
 
-				LockingStack(){}
+				}
 
-				LockingStack(std::nullptr_t const & n) : System::Object(n) {
+				static Worker*& CurrentWorker() {
+					static tlocal Worker* current = nullptr;
+					return current;
 				}
 
-				LockingStack(LockingStack* pValue) {
-					if (!pValue->od) {
-						ObjectData* dd = new ObjectData();
-						od = dd;
-					}
-					else {
-						od = pValue->od;
-						pValue->od = nullptr;
+				// work done outside the pool that WaitIdle should wait for as well, such as completing a task whose
+				// continuations are queued here
+				void BeginWork() {
+					pending.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				void EndWork() {
+					// either the waiter sees pending 0 or this thread sees it waiting and wakes it
+					if (pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && idleWaiters.load(std::memory_order_seq_cst) > 0) {
+						std::lock_guard<std::mutex> lock(parkMutex);
+						drained.notify_all();
 					}
-					delete pValue;
 				}
 
-				LockingStack(LockingStack const & other) : System::Object(other) { }
+				bool WaitIdle(int millisecondsTimeout) {
+					idleWaiters.fetch_add(1, std::memory_order_seq_cst);
+					std::unique_lock<std::mutex> lock(parkMutex);
+					auto isIdle = [this]() { return pending.load(std::memory_order_seq_cst) == 0; };
+					bool ret = true;
+					if (millisecondsTimeout < 0)
+						drained.wait(lock, isIdle);
+					else
+						ret = drained.wait_for(lock, std::chrono::milliseconds(millisecondsTimeout), isIdle);
+					idleWaiters.fetch_sub(1, std::memory_order_relaxed);
+					return ret;
+				}
 
-				LockingStack(LockingStack&& other) noexcept : System::Object(std::move(other)) { }
+				void Execute(Action<> const& act)
+				{
+					std::call_once(started, [this]() { Start(); });
+					BeginWork();
+					WorkItem* item = new WorkItem(act);
+					Worker* current = CurrentWorker();
+					if (current && current->pool == this)
+						current->deque.Push(item);
+					else
+						ActionQueue.Enqueue(item);
 
-				LockingStack(Object::ObjectData* other) : System::Object(other) {
+					// either a parking worker sees the item or this thread sees it parking and wakes it. A worker that
+					// is still searching will find the item without help
+					queued.fetch_add(1, std::memory_order_seq_cst);
+					if (sleeping.load(std::memory_order_seq_cst) > 0 && searching.load(std::memory_order_seq_cst) == 0) {
+						std::lock_guard<std::mutex> lock(parkMutex);
+						wakeup.notify_one();
+					}
 				}
 
-				LockingStack& operator=(LockingStack const & other) {
-					System::Object::operator=(other);
-					return *this;
+			private:
+				void Start() {
+					workers = new Worker[MaxThreads];
+					for (int i = 0; i < MaxThreads; i++) {
+						Worker* w = &workers[i];
+						w->pool = this;
+						w->index = i;
+						w->seed = 2654435769u * (uint)(i + 1);
+						// the running threads keep the pool alive
+						SimpleThreadPool keep(this);
+						w->t = Thread([w, keep]() {
+							CurrentWorker() = w;
+							w->pool->Run(w);
+							});
+						w->t.IsBackground = true;
+					}
+					NumberOfThreads.store(MaxThreads);
+					for (int i = 0; i < MaxThreads; i++)
+						workers[i].t.Start();
+				}
+
+				WorkItem* Find(Worker* self) {
+					WorkItem* item = self->deque.Pop();
+					if (item || ActionQueue.TryDequeue(out(item)))
+						return item;
+					// steal from the others, starting at a random victim
+					self->seed ^= self->seed << 13;
+					self->seed ^= self->seed >> 17;
+					self->seed ^= self->seed << 5;
+					int start = (int)(self->seed % (uint)MaxThreads);
+					for (int i = 0; i < MaxThreads; i++) {
+						int victim = (start + i) % MaxThreads;
+						if (victim != self->index && (item = workers[victim].deque.Steal()))
+							return item;
+					}
+					return nullptr;
+				}
+
+				void Run(Worker* self) {
+					int idle = 0;
+					searching.fetch_add(1, std::memory_order_seq_cst);
+					while (true) {
+						WorkItem* item = Find(self);
+						if (item) {
+							queued.fetch_sub(1, std::memory_order_relaxed);
+							// the last searching worker to find work wakes another one for the items that are left
+							if (searching.fetch_sub(1, std::memory_order_seq_cst) == 1 && queued.load(std::memory_order_seq_cst) > 0 && sleeping.load(std::memory_order_seq_cst) > 0) {
+								std::lock_guard<std::mutex> lock(parkMutex);
+								wakeup.notify_one();
+							}
+							idle = 0;
+							item->action();
+							delete item;
+							EndWork();
+							searching.fetch_add(1, std::memory_order_seq_cst);
+							continue;
+						}
+						if (queued.load(std::memory_order_relaxed) > 0 || ++idle < 64) {
+							// another thread is between queueing and publishing, or lost a steal race
+							Thread::Yield();
+							continue;
+						}
+						idle = 0;
+						std::unique_lock<std::mutex> lock(parkMutex);
+						searching.fetch_sub(1, std::memory_order_seq_cst);
+						sleeping.fetch_add(1, std::memory_order_seq_cst);
+						wakeup.wait(lock, [this]() { return queued.load(std::memory_order_seq_cst) > 0; });
+						sleeping.fetch_sub(1, std::memory_order_relaxed);
+						searching.fetch_add(1, std::memory_order_seq_cst);
+					}
 				}
+			};
 
-				LockingStack& operator=(std::nullptr_t const & n) {
-					System::Object::operator=(n);
-					return *this;
-				}
+						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-				LockingStack& operator=(LockingStack&& other) noexcept {
-					System::Object::operator=(std::move(other));
-					return *this;
+			SimpleThreadPool(){}
+
+			SimpleThreadPool(std::nullptr_t const & n) {
+				this->od = nullptr;
+			}
+
+			SimpleThreadPool(SimpleThreadPool* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					this->od = dd;
+				}
+				else {
+					this->od = pValue->od;
+					pValue->od = nullptr;
 				}
+				delete pValue;
+			}
 
-				LockingStack& operator=(LockingStack* other) {
-					if (od == other->od)
-						return *this;
-					Release();
-					od = other->od;
-					::operator delete((void*)other);
+			SimpleThreadPool(SimpleThreadPool const & other) : System::Object(other) { }
+
+			SimpleThreadPool(SimpleThreadPool&& other) noexcept : System::Object(std::move(other)) { }
+
+			SimpleThreadPool(ObjectData* other) {
+				this->od = other;
+				if (this->od)
+					this->AddRef();
+			}
+
+			SimpleThreadPool& operator=(SimpleThreadPool const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
+
+			SimpleThreadPool& operator=(SimpleThreadPool* other) {
+				if (this->od == other->od)
 					return *this;
-				}
+				this->Release();
+				this->od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
 
-				LockingStack* operator->() {
-					return this;
-				}
+			SimpleThreadPool& operator=(SimpleThreadPool&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
 
+			SimpleThreadPool* operator->() {
+				return this;
+			}
 
 
-					void Push(const T& item) {
-					GOD()->Push(item);
-				}
 
-				void Push(T&& item) {
-					GOD()->Push(std::forward<T>(item));
-				}
+			SimpleThreadPool(int NumberOfThreads)
+			{
+				ObjectData* dd = new ObjectData();
+				dd->MaxThreads = NumberOfThreads;
+				this->od = dd;
+			}
 
-				bool TryPop(Out<T> result) {
-					return GOD()->TryPop(result);
-				}
+			static SimpleThreadPool _Instance;
+			static PropGenGetStatic<int, &SimpleThreadPool::Get_ThreadCount> ThreadCount;
 
-				T Pop() {
-					return GOD()->Pop();
-				}
+			static void QueueUserWorkItem(Action<> const & act)
+			{
+				_Instance.Execute(act);
+			}
+
+			/// <summary>Blocks until every work item queued to the pool, and every item those queued in turn, has run and been released.
+			/// Must not be called from a work item.</summary>
+			/// <param name="millisecondsTimeout">The number of milliseconds to wait, or Infinite (-1) to wait indefinitely.</param>
+			/// <returns>true if the pool became idle; otherwise, false.</returns>
+			static bool WaitForIdle(int millisecondsTimeout = -1)
+			{
+				return _Instance.GOD()->WaitIdle(millisecondsTimeout);
+			}
+
+			void Execute(Action<> const& act)
+			{
+				GOD()->Execute(act);
+			}
+
+			int GetThreadCount() {
+				return GOD()->NumberOfThreads.load(std::memory_order_relaxed);
+			}
+
+			void GetMaxThreads(Out<int> workerThreads, Out<int> completionPortThreads) {
+				workerThreads = GOD()->MaxThreads;
+				completionPortThreads = 0; // TODO?
+			}
+
+		};
+
+#ifndef SYSTEM_EXPORTS
+#if ESP32
+		SimpleThreadPool SimpleThreadPool::_Instance{ null };
+#else
+		SimpleThreadPool SimpleThreadPool::_Instance{ 8 };
+#endif
+		PropGenGetStatic<int, &SimpleThreadPool::Get_ThreadCount> SimpleThreadPool::ThreadCount{};
+#endif
+
+
+
+		using ThreadPool = SimpleThreadPool;
+	}
+}
+
+namespace System {
+	namespace Threading {
+		/// <summary>Propagates the notification that an operation should be canceled. A default (null) token is never
+		/// canceled.</summary>
+		class System_API CancellationToken : public Object {
+		private:
+			bool Get_IsCancellationRequested() const {
+				return od && GOD()->canceled.load(std::memory_order_acquire);
+			}
+
+			bool Get_CanBeCanceled() const {
+				return od != nullptr;
+			}
 
+		public:
+			class System_API ObjectData : public Object::ObjectData {
+			public:
+				std::atomic<bool> canceled{ false };
 			};
 
+			/// <summary>Gets whether cancellation has been requested for this token.</summary>
+			PropGenGet<bool, CancellationToken, &CancellationToken::Get_IsCancellationRequested> IsCancellationRequested{ this };
 
-//			class System_API Counter1ms : public Object {
-//			private:
-//			public:
-//
-//				static Counter1ms Instance;
-//
-//				volatile ulong cnt{};
-//				System::Threading::Thread t = null;
-//
-//
-//				Counter1ms() {
-//					t = new System::Threading::Thread([this]() {
-//						while (true) {
-//							cnt++;
-//							System::Threading::Thread::Sleep(1);
-//						}
-//						});
-//					t.Start();
-//				}
-//
-//				static ulong GetCount() {
-//					return Instance.cnt;
-//				}
-//
-//			};
-//
-//#ifndef SYSTEM_EXPORTS
-//			Counter1ms Counter1ms::Instance{};
-//#endif
-//
+			/// <summary>Gets whether this token belongs to a CancellationTokenSource.</summary>
+			PropGenGet<bool, CancellationToken, &CancellationToken::Get_CanBeCanceled> CanBeCanceled{ this };
+
+			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+			CancellationToken(){}
+
+			CancellationToken(std::nullptr_t const & n) : System::Object(n) {
+			}
 
+			CancellationToken(CancellationToken* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
 
+			CancellationToken(CancellationToken const & other) : System::Object(other) { }
 
+			CancellationToken(CancellationToken&& other) noexcept : System::Object(std::move(other)) { }
 
-			/*
-			template<class T> class System_API KConcurrentStack : public Object {
-			private:
-				int Get_Count() const { return (int) GOD()->Get_Count(); }
-			public:
-				class System_API ObjectData : public Object::ObjectData {
-				private:
+			CancellationToken(Object::ObjectData* other) : System::Object(other) {
+			}
 
+			CancellationToken& operator=(CancellationToken const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
 
-					//void TryShiftDelStacks() {
-					//	ulong ms = Counter1ms::GetCount();
-					//	ulong lastms = at_lastms.load(std::memory_order_relaxed);
-					//	if (ms - lastms >= 2) {
-					//		if (at_lastms.compare_exchange_strong(lastms, ms, std::memory_order_relaxed)) {
-					//			Node* purgatory_tail = lst_at_deltail[1].load(std::memory_order_relaxed);
-					//			if (purgatory_tail != nullptr) {
-					//				Node* hell_head = lst_at_deltail[2].load(std::memory_order_relaxed);
-					//				purgatory_tail->next = hell_head;
-					//				Node* purgatory_head = lst_at_delhead[1].load(std::memory_order_relaxed);
-					//				while (!lst_at_delhead[2].compare_exchange_weak(purgatory_tail->next, purgatory_head, std::memory_order_relaxed)) {}
-					//			}
-
-
-					//			Node* del_tail = lst_at_deltail[0].load(std::memory_order_relaxed);
-					//			if (del_tail != nullptr) {
-					//				while (!lst_at_deltail[0].compare_exchange_weak(del_tail, nullptr, std::memory_order_relaxed)) {}
-					//				Node* del_head = lst_at_delhead[0].load(std::memory_order_relaxed);
-					//				while (!lst_at_delhead[0].compare_exchange_weak(del_head, nullptr, std::memory_order_relaxed)) {}
-
-					//				lst_at_delhead[1].store(del_head, std::memory_order_relaxed);
-					//				lst_at_deltail[1].store(del_tail);
-					//			}
-					//			else {
-					//				lst_at_delhead[1].store(nullptr, std::memory_order_relaxed);
-					//				lst_at_deltail[1].store(nullptr);
-					//			}
-					//		}
-					//	}
-					//}
+			CancellationToken& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
 
+			CancellationToken& operator=(CancellationToken&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
 
-					//void PushDel(Node* item) {
-					//	std::atomic<Node*>* at_delhead = lst_at_delhead + 0;
+			CancellationToken& operator=(CancellationToken* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
 
-					//	Node* delhead = at_delhead->load(std::memory_order_relaxed);
-					//	item->next = delhead;
-					//	while (!at_delhead->compare_exchange_weak(item->next, item, std::memory_order_release)) {
-					//	}
-					//	if (item->next == nullptr) {
-					//		lst_at_deltail[0].store(item, std::memory_order_relaxed);
-					//	}
-					//}
-				public:
-					class Node {
-					private:
-					public:
-						T value;
-						Node* next;
+			CancellationToken* operator->() {
+				return this;
+			}
 
-						Node() {}
 
-						Node(const T& value) : value(value) {}
-					};
 
-					class TLDelRow {
-					private:
-					public:
-						Node* first = nullptr;
-						Node* last = nullptr;
-						//Node* nextlast = nullptr;
+			/// <summary>Throws OperationCanceledException if cancellation has been requested for this token.</summary>
+			void ThrowIfCancellationRequested() const {
+				if (Get_IsCancellationRequested())
+					throw OperationCanceledException();
+			}
+		};
 
-						int count = 0;
+		/// <summary>Signals to a CancellationToken that it should be canceled.</summary>
+		class System_API CancellationTokenSource : public Object {
+		private:
+			bool Get_IsCancellationRequested() const {
+				return GOD()->token.GOD()->canceled.load(std::memory_order_acquire);
+			}
 
-						TLDelRow() {
+			CancellationToken Get_Token() const {
+				return GOD()->token;
+			}
 
-						}
+		public:
+			class System_API ObjectData : public Object::ObjectData {
+			public:
+				CancellationToken token;
 
-						TLDelRow(const TLDelRow& other) : first(other.first), last(other.last), count(other.count) {
+				ObjectData() {
+					token.od = new CancellationToken::ObjectData();
+				}
+			};
 
-						}
+			/// <summary>Gets whether cancellation has been requested for this source.</summary>
+			PropGenGet<bool, CancellationTokenSource, &CancellationTokenSource::Get_IsCancellationRequested> IsCancellationRequested{ this };
 
-						~TLDelRow() {
+			/// <summary>Gets the CancellationToken associated with this source.</summary>
+			PropGenGet<CancellationToken, CancellationTokenSource, &CancellationTokenSource::Get_Token> Token{ this };
 
-						}
+			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-						int Add(Node* ptr) {
-							ptr->next = last;
-							//nextlast = last;
-							last = ptr;
-							if (first == nullptr) {
-								first = ptr;
-							}
+			CancellationTokenSource(){}
 
-							return ++count;
-						}
+			CancellationTokenSource(std::nullptr_t const & n) : System::Object(n) {
+			}
 
-						Node* TryGet() {
-							if (last != nullptr) {
-								Node* ret = last;
-								last = last->next;
-								if (last == nullptr)
-									first = nullptr;
-								--count;
+			CancellationTokenSource(CancellationTokenSource* pValue) {
+				if (!pValue->od) {
+					ObjectData* dd = new ObjectData();
+					od = dd;
+				}
+				else {
+					od = pValue->od;
+					pValue->od = nullptr;
+				}
+				delete pValue;
+			}
 
-								return ret;
-							}
+			CancellationTokenSource(CancellationTokenSource const & other) : System::Object(other) { }
 
-							return nullptr;
-						}
+			CancellationTokenSource(CancellationTokenSource&& other) noexcept : System::Object(std::move(other)) { }
 
-						void Append(TLDelRow& other) {
-							if (other.count > 0) {
-								other.first->next = last;
-								last = other.last;
-								count += other.count;
-							}
-						}
+			CancellationTokenSource(Object::ObjectData* other) : System::Object(other) {
+			}
 
-						void Clear() {
-							first = nullptr;
-							last = nullptr;
-							count = 0;
-						}
+			CancellationTokenSource& operator=(CancellationTokenSource const & other) {
+				System::Object::operator=(other);
+				return *this;
+			}
 
-						void DeleteAll() {
-							Node* ptr = last;
-							while (ptr != null) {
-								Node* tmp = ptr;
-								ptr = ptr->next;
-								delete tmp;
-							}
-							Clear();
-						}
+			CancellationTokenSource& operator=(std::nullptr_t const & n) {
+				System::Object::operator=(n);
+				return *this;
+			}
 
-						void DeleteUntil(int cnt) {
-							Node* ptr = last;
-							while (ptr != null && count > cnt) {
-								Node* tmp = ptr;
-								ptr = ptr->next;
-								delete tmp;
-								--count;
-							}
-							if (!ptr) {
-								last = first = null;
-							}
-							else
-								last = ptr;
-						}
+			CancellationTokenSource& operator=(CancellationTokenSource&& other) noexcept {
+				System::Object::operator=(std::move(other));
+				return *this;
+			}
 
-						TLDelRow& operator=(const TLDelRow& other) {
-							first = other.first;
-							last = other.last;
-							count = other.count;
+			CancellationTokenSource& operator=(CancellationTokenSource* other) {
+				if (od == other->od)
+					return *this;
+				Release();
+				od = other->od;
+				::operator delete((void*)other);
+				return *this;
+			}
 
-							return *this;
-						}
+			CancellationTokenSource* operator->() {
+				return this;
+			}
 
-					};
 
-					Node* at_head{};
-					std::atomic<ulong> at_NumPush{};
-					std::atomic<ulong> at_NumPop{};
-					std::atomic<Node*> at_delhead{}; // [3] = { }; // if there are fewer elements of the initializer list than there are members in the aggregate, then the remaining members shall be initialized from an empty initializer list. In this case, that's all members.
-					//std::atomic<Node*> lst_at_deltail[2] = { };
-
-					static tlocal ulong lastms;
-					static tlocal TLDelRow hospital;
-					static tlocal TLDelRow purgatory;
-					static tlocal TLDelRow hell;
-
-					void TryClearHospital() {
-						ulong ms = Counter1ms::GetCount();
-						if (ms - lastms >= 1) {
-							lastms = ms;
-							//if (hell.count > 0) {
-							//	Node* delhead = at_delhead.load(std::memory_order_relaxed);
-							//	hell.first->next = delhead;
-							//	while (!at_delhead.compare_exchange_weak(hell.first->next, hell.last, std::memory_order_release)) {}
-							//}
-							hell.Append(purgatory);
-							//hell.DeleteUntil(10000);
-							//hell.DeleteAll();
-							//hell = purgatory;
-							purgatory = hospital;
-							hospital.Clear();
-						}
-					}
 
-					void DeleteStack(Node* ptr) {
-						while (ptr != nullptr) {
-							Node* tmp = ptr;
-							ptr = ptr->next;
-							delete tmp;
-						}
-					}
+			/// <summary>Communicates a request for cancellation to the token.</summary>
+			void Cancel() const {
+				GOD()->token.GOD()->canceled.store(true, std::memory_order_seq_cst);
+			}
+		};
 
+		namespace Tasks {
 
-					~ObjectData() override {
-						//for (int i = 0; i < 3; i++) {
-						//	std::atomic<Node*>* at_delhead = lst_at_delhead + i;
-							//Node* ptr = at_delhead.load(std::memory_order_acquire);
-							//while (ptr != nullptr) {
-							//	Node* tmp = ptr;
-							//	ptr = ptr->next;
-							//	delete tmp;
-							//}
-						//}
-						//ptr = at_head; // .load(std::memory_order_acquire);
-						DeleteStack(at_head);
-						hospital.DeleteAll();
-						purgatory.DeleteAll();
-						hell.DeleteAll();
-					}
+			// Tasks. A Task is completed exactly once, by whoever claims it first (its body, a TaskCompletionSource or
+			// one of the combinators). Continuations are pushed on a lock-free list which the completing thread seals
+			// and runs; a continuation added after the seal runs right away. A continuation runs inline on the
+			// completing thread when that thread is a pool worker and the inline nesting is shallow, otherwise it is
+			// queued on the ThreadPool. Wait only takes a lock when the task is not complete yet.
+			//
+			//    Task<int> t = Task<>::Run([]() { return 6 * 7; });
+			//    Task<int> d = t.ContinueWith([](Task<int> const& a) { return (int)a.Result * 2; });
+
+			/// <summary>Represents the current stage in the lifecycle of a Task.</summary>
+			enum class TaskStatus {
+				Created = 0,
+				WaitingForActivation = 1,
+				WaitingToRun = 2,
+				Running = 3,
+				WaitingForChildrenToComplete = 4,
+				RanToCompletion = 5,
+				Canceled = 6,
+				Faulted = 7
+			};
 
-					void Push(const T& item) {
-						//std::atomic<Node*>* at_delhead = lst_at_delhead + 2;
-						//Node* newhead = at_delhead->load(std::memory_order_acquire);
-						//while (newhead != null) {
-						//	if (at_delhead->compare_exchange_weak(newhead, newhead->next, std::memory_order_acquire))
-						//		break;
-						//}
+			template<class TResult = void> class Task;
+			template<class TResult = void> class TaskCompletionSource;
 
-						Node* newhead = hell.TryGet();
-						//if (newhead == nullptr) {
-						//	newhead = at_delhead.load(std::memory_order_acquire);
-						//	while (newhead != null) {
-						//		if (at_delhead.compare_exchange_weak(newhead, newhead->next, std::memory_order_acquire))
-						//			break;
-						//	}
-						//}
-						if (newhead == nullptr)
-							newhead = new Node(item);
+#ifdef SYSTEM_COROUTINES
+			// base of the promise types: coroutine frames come from the size-class pools of MPool, also where the
+			// global operator new is not routed there (ESP32)
+			struct CoroutineFrame {
+				static void* operator new(size_t size) {
+					return MPool.Get(size);
+				}
 
-						//newhead->value = item;
-						//newhead->next = at_head; // .load(std::memory_order_relaxed);
-						//if (InterlockedCompareExchangePointerRelease((void**)&at_head, (void*)newhead, (void*)newhead->next) == newhead->next) {
-						//	return;
-						//}
+				static void operator delete(void* frame) {
+					MPool.Put((byte*)frame);
+				}
+			};
+#endif
 
+			/// <summary>Represents an asynchronous operation that does not return a value.</summary>
+			template<> class System_API Task<void> : public Object {
+			private:
+				TaskStatus Get_Status() const {
+					return (TaskStatus)GOD()->status.load(std::memory_order_acquire);
+				}
 
-					//	System::Threading::SpinWait spin = new System::Threading::SpinWait();
-						do {
-						//	spin.SpinOnce();
-							newhead->next = at_head;
-						} while (InterlockedCompareExchangePointerRelease((void**)&at_head, (void*)newhead, (void*)newhead->next) != newhead->next);
+				bool Get_IsCompleted() const {
+					return GOD()->IsCompleted();
+				}
 
+				bool Get_IsCompletedSuccessfully() const {
+					return Get_Status() == TaskStatus::RanToCompletion;
+				}
 
-						//void* cur;
-						//while ((cur = InterlockedCompareExchangePointerRelease((void**)&at_head, (void*)newhead, (void*)newhead->next)) != newhead->next) {
-						//	newhead->next = (Node*)cur;
-						//	//while (!at_head.compare_exchange_weak(newhead->next, newhead, std::memory_order_release)) {
-						//}
-						//if (newhead->next == nullptr) {
-						//	lst_at_deltail[0].store(newhead, std::memory_order_release);
-						//}
-					//	at_NumPush.fetch_add(1, std::memory_order_relaxed);
+				bool Get_IsFaulted() const {
+					return Get_Status() == TaskStatus::Faulted;
+				}
 
-					}
+				bool Get_IsCanceled() const {
+					return Get_Status() == TaskStatus::Canceled;
+				}
 
-					ulong Get_Count() {
-						return at_NumPush.load(std::memory_order_relaxed) - at_NumPop.load(std::memory_order_relaxed);
-					}
+				static Task<void> Get_CompletedTask() {
+					Task<void> ret;
+					ret.od = new ObjectData(TaskStatus::RanToCompletion);
+					return ret;
+				}
 
-					bool TryPop(Out<T> result) {
-						if (at_head == nullptr)
-							return false;
-						Node* head = at_head;
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				public:
+					struct Continuation {
+						Continuation* next = nullptr;
+						// runs on the completing thread whatever thread that is, only for short bookkeeping
+						bool synchronous = false;
 
-					//	void* cur;
-						while (InterlockedCompareExchangePointerAcquire((void**)&at_head, (void*)head->next, (void*)head) != head) {
-							//while (!at_head.compare_exchange_weak(head, head->next, std::memory_order_acquire)) {
-							if (at_head == nullptr)
-								return false;
-							head = at_head;
-						}
+						virtual ~Continuation() {}
+						virtual void Run(ObjectData* antecedent) = 0;
+					};
 
-						result = head->value;
+					template<class F> struct FunctionContinuation : Continuation {
+						F f;
 
-						//PushDel(head);
-						//ulong numpops = at_NumPop.fetch_add(1, std::memory_order_relaxed);
-						//if ((numpops & 4095) == 0) {
-						//	TryShiftDelStacks();
-						//}
+						FunctionContinuation(F const& f, bool synchronous) : f(f) {
+							this->synchronous = synchronous;
+						}
 
-						int cnth = hospital.Add(head);
-						if (cnth > 2000) {
-							TryClearHospital();
+						void Run(ObjectData* antecedent) override {
+							f(antecedent);
 						}
+					};
 
+					std::atomic<int> status;
+					std::atomic<bool> claimed;
+					std::atomic<Continuation*> continuations;
+					std::atomic<int> waiters;
+					std::mutex waitMutex;
+					std::condition_variable waitCondition;
+					std::exception_ptr exception;
 
-						return true;
+					ObjectData() : status((int)TaskStatus::WaitingForActivation), claimed(false), continuations(nullptr), waiters(0) {
 					}
-				};
-
-				PropGenGet<int, KConcurrentStack, &KConcurrentStack::Get_Count> Count{ this };
-
-					ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-					KConcurrentStack(){}
-
-					KConcurrentStack(std::nullptr_t const & n) : System::Object(n) {
+					// an already completed task, nothing to wait for and no continuation list
+					ObjectData(TaskStatus completed) : status((int)completed), claimed(true), continuations(Sealed()), waiters(0) {
 					}
 
-					KConcurrentStack(KConcurrentStack* pValue) {
-						if (!pValue->od) {
-							ObjectData* dd = new ObjectData();
-							od = dd;
-						}
-						else {
-							od = pValue->od;
-							pValue->od = nullptr;
+					~ObjectData() override {
+						// continuations of a task that never completed
+						Continuation* c = continuations.load(std::memory_order_relaxed);
+						while (c && c != Sealed()) {
+							Continuation* next = c->next;
+							delete c;
+							c = next;
 						}
-						delete pValue;
 					}
 
-					KConcurrentStack(KConcurrentStack const & other) : System::Object(other) { }
-
-					KConcurrentStack(KConcurrentStack&& other) noexcept : System::Object(std::move(other)) { }
-
-					KConcurrentStack(Object::ObjectData* other) : System::Object(other) {
+					static Continuation* Sealed() {
+						return (Continuation*)(uintptr_t)1;
 					}
 
-					KConcurrentStack& operator=(KConcurrentStack const & other) {
-						System::Object::operator=(other);
-						return *this;
+					static int& InlineDepth() {
+						static tlocal int depth = 0;
+						return depth;
 					}
 
-					KConcurrentStack& operator=(std::nullptr_t const & n) {
-						System::Object::operator=(n);
-						return *this;
+					template<class F> static Continuation* NewContinuation(F const& f, bool synchronous = false) {
+						return new FunctionContinuation<F>(f, synchronous);
 					}
 
-					KConcurrentStack& operator=(KConcurrentStack&& other) noexcept {
-						System::Object::operator=(std::move(other));
-						return *this;
+					bool IsCompleted() const {
+						return status.load(std::memory_order_acquire) >= (int)TaskStatus::RanToCompletion;
 					}
 
-					KConcurrentStack& operator=(KConcurrentStack* other) {
-						if (od == other->od)
-							return *this;
-						Release();
-						od = other->od;
-						::operator delete((void*)other);
-						return *this;
+					// only the thread that claims the task stores its outcome and finishes it
+					bool Claim() {
+						return !claimed.exchange(true, std::memory_order_acq_rel);
 					}
 
-					KConcurrentStack* operator->() {
-						return this;
+					void Finish(TaskStatus final) {
+						// a waiter either sees the status or is seen here and notified under the lock
+						status.store((int)final, std::memory_order_seq_cst);
+						if (waiters.load(std::memory_order_seq_cst) > 0) {
+							std::lock_guard<std::mutex> lock(waitMutex);
+							waitCondition.notify_all();
+						}
+						// the list is pushed newest first, run the continuations in the order they were added
+						Continuation* list = continuations.exchange(Sealed(), std::memory_order_acq_rel);
+						Continuation* ordered = nullptr;
+						while (list) {
+							Continuation* next = list->next;
+							list->next = ordered;
+							ordered = list;
+							list = next;
+						}
+						while (ordered) {
+							Continuation* next = ordered->next;
+							Dispatch(ordered);
+							ordered = next;
+						}
 					}
 
+					bool TrySetResult() {
+						if (!Claim())
+							return false;
+						Finish(TaskStatus::RanToCompletion);
+						return true;
+					}
 
+					bool TrySetException(std::exception_ptr ex) {
+						if (!Claim())
+							return false;
+						exception = ex;
+						Finish(TaskStatus::Faulted);
+						return true;
+					}
 
-				void Push(const T& item) {
-					return GOD()->Push(item);
-				}
-
-				//void Push(T&& item) {
-				//	return GOD()->Push(item);
-				//}
-
-				bool TryPop(Out<T> result) {
-					return GOD()->TryPop(result);
-				}
-
-			};
-
-#ifndef SYSTEM_EXPORTS
-			template<class T> tlocal ulong KConcurrentStack<T>::ObjectData::lastms{};
-			template<class T> tlocal typename KConcurrentStack<T>::ObjectData::TLDelRow KConcurrentStack<T>::ObjectData::hospital{};
-			template<class T> tlocal typename KConcurrentStack<T>::ObjectData::TLDelRow KConcurrentStack<T>::ObjectData::purgatory{};
-			template<class T> tlocal typename KConcurrentStack<T>::ObjectData::TLDelRow KConcurrentStack<T>::ObjectData::hell{};
-#endif
-			*/
-
-#if _MSC_VER
-
-			template<class T> class System_API KConcurrentStack2 : public Object {
-			private:
-				int Get_Count() const { return (int)GOD()->Get_Count(); }
-			public:
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					class Node;
-
-					class alignas(16) CountedNode {
-					private:
-					public:
-						Node* ptr = nullptr;
-						ulong external_count = 0;
+					bool TrySetCanceled() {
+						if (!Claim())
+							return false;
+						Finish(TaskStatus::Canceled);
+						return true;
+					}
 
-						CountedNode() {
+					// completes this task with the first fault among tasks, else with a cancellation if there is one
+					template<class TTask> bool TrySetFailure(Collections::Generic::Array<TTask> const& tasks) {
+						int n = tasks.Length;
+						TTask* arr = tasks.GOD()->arrdta;
+						for (int i = 0; i < n; i++) {
+							if (arr[i].GOD()->status.load(std::memory_order_acquire) == (int)TaskStatus::Faulted) {
+								TrySetException(arr[i].GOD()->exception);
+								return true;
+							}
 						}
-
-						~CountedNode() {
+						for (int i = 0; i < n; i++) {
+							if (arr[i].GOD()->status.load(std::memory_order_acquire) == (int)TaskStatus::Canceled) {
+								TrySetCanceled();
+								return true;
+							}
 						}
-					};
-
-					class Node {
-					private:
-					public:
-						T value;
-						CountedNode next;
-						std::atomic<int> internal_count;
-
-						Node() {}
-
-						Node(const T& value) : value(value), internal_count(0) {}
-					};
-
-					CountedNode head{};
-
-
-					void increase_head_count(CountedNode& old_counter) {
-						CountedNode nn;
-						do {
-							nn = old_counter;
-							++nn.external_count;
-						} while (!InterlockedCompareExchange128((long*)&head, (long)nn.external_count, (long)nn.ptr, (long*)&old_counter));
-						old_counter.external_count = nn.external_count;
+						return false;
 					}
 
-					//void fetch_add_128(long* dst, int cnt)
-					//{
-					//	
-					//}
-
-				public:
+					// false if the task is already complete, c is then left to the caller
+					bool TryAddContinuation(Continuation* c) {
+						Continuation* head = continuations.load(std::memory_order_acquire);
+						while (head != Sealed()) {
+							c->next = head;
+							if (continuations.compare_exchange_weak(head, c, std::memory_order_acq_rel, std::memory_order_acquire))
+								return true;
+						}
+						c->next = nullptr;
+						return false;
+					}
 
+					void AddContinuation(Continuation* c) {
+						if (!TryAddContinuation(c))
+							Dispatch(c);
+					}
 
+					void Dispatch(Continuation* c) {
+						if (c->synchronous || (SimpleThreadPool::ObjectData::CurrentWorker() && InlineDepth() < 16)) {
+							InlineDepth()++;
+							c->Run(this);
+							InlineDepth()--;
+							delete c;
+						}
+						else {
+							Task<void> antecedent(this);
+							ThreadPool::QueueUserWorkItem([antecedent, c]() {
+								c->Run(antecedent.GOD());
+								delete c;
+								});
+						}
+					}
 
-					~ObjectData() override {
+					// completes the task with the exception being handled, OperationCanceledException cancels it
+					void SetCurrentException() {
+						try {
+							throw;
+						}
+						catch (OperationCanceledException const&) {
+							TrySetCanceled();
+						}
+						catch (...) {
+							TrySetException(std::current_exception());
+						}
+					}
 
+					// runs the body of a task started by Run or ContinueWith and completes the task with its outcome
+					template<class G> void RunBody(G const& body) {
+						status.store((int)TaskStatus::Running, std::memory_order_relaxed);
+						try {
+							body();
+						}
+						catch (...) {
+							SetCurrentException();
+							return;
+						}
+						TrySetResult();
 					}
 
-					void Push(const T& item) {
-						CountedNode nn;
-						nn.ptr = new Node(item);
-						nn.external_count = 1;
-						nn.ptr->next = head;
-						while (!InterlockedCompareExchange128((long*)&head, (long)nn.external_count, (long)nn.ptr, (long*)(&nn.ptr->next))) {}
+					void Wait() {
+						if (IsCompleted())
+							return;
+						std::unique_lock<std::mutex> lock(waitMutex);
+						waiters.fetch_add(1, std::memory_order_seq_cst);
+						waitCondition.wait(lock, [this]() { return status.load(std::memory_order_seq_cst) >= (int)TaskStatus::RanToCompletion; });
+						waiters.fetch_sub(1, std::memory_order_relaxed);
+					}
+
+					bool Wait(int millisecondsTimeout) {
+						if (IsCompleted())
+							return true;
+						if (millisecondsTimeout < 0) {
+							Wait();
+							return true;
+						}
+						std::unique_lock<std::mutex> lock(waitMutex);
+						waiters.fetch_add(1, std::memory_order_seq_cst);
+						bool ret = waitCondition.wait_for(lock, std::chrono::milliseconds(millisecondsTimeout), [this]() { return status.load(std::memory_order_seq_cst) >= (int)TaskStatus::RanToCompletion; });
+						waiters.fetch_sub(1, std::memory_order_relaxed);
+						return ret;
 					}
 
-					ulong Get_Count() {
-						return 0;
+					void ThrowIfFailed() const {
+						int s = status.load(std::memory_order_acquire);
+						if (s == (int)TaskStatus::Faulted)
+							std::rethrow_exception(exception);
+						if (s == (int)TaskStatus::Canceled)
+							throw OperationCanceledException();
 					}
+				};
 
-					bool TryPop(Out<T> result) {
-						CountedNode old_head = head;
-						for (;;) {
-							increase_head_count(old_head);
-							Node* const ptr = old_head.ptr;
-							if (!ptr)
-								return false;
-							if (InterlockedCompareExchange128((long*)&head, (long)ptr->next.external_count, (long)ptr->next.ptr, (long*)(&old_head))) {
-								result = ptr->value;
-								int const count_increase = (int)old_head.external_count - 2;
-								if (ptr->internal_count.fetch_add(count_increase) == -count_increase) {
-									delete ptr;
-								}
-								return true;
-							}
-							else if (ptr->internal_count.fetch_sub(1) == 1) {
-								delete ptr;
+			private:
+				// calls done on the thread that completes the last of the tasks
+				template<class TTask, class G> static void OnAllCompleted(Collections::Generic::Array<TTask> const& tasks, G const& done) {
+					if (tasks == null)
+						throw ArgumentNullException();
+					int n = tasks.Length;
+					TTask* arr = tasks.GOD()->arrdta;
+					for (int i = 0; i < n; i++) {
+						if (arr[i] == null)
+							throw ArgumentNullException();
+					}
+					if (!n) {
+						done();
+						return;
+					}
+					std::atomic<int>* remaining = new std::atomic<int>(n);
+					for (int i = 0; i < n; i++) {
+						arr[i].GOD()->AddContinuation(ObjectData::NewContinuation([remaining, done](ObjectData*) {
+							if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+								delete remaining;
+								done();
 							}
-						}
+							}, true));
 					}
-				};
+				}
 
-				PropGenGet<int, KConcurrentStack2, &KConcurrentStack2::Get_Count> Count{ this };
+			public:
+				/// <summary>Gets the TaskStatus of this task.</summary>
+				PropGenGet<TaskStatus, Task<void>, &Task<void>::Get_Status> Status{ this };
 
-								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				/// <summary>Gets whether the task has completed, successfully, faulted or canceled.</summary>
+				PropGenGet<bool, Task<void>, &Task<void>::Get_IsCompleted> IsCompleted{ this };
 
-				KConcurrentStack2(){}
+				/// <summary>Gets whether the task ran to completion.</summary>
+				PropGenGet<bool, Task<void>, &Task<void>::Get_IsCompletedSuccessfully> IsCompletedSuccessfully{ this };
 
-				KConcurrentStack2(std::nullptr_t const & n) : System::Object(n) {
+				/// <summary>Gets whether the task completed due to an unhandled exception.</summary>
+				PropGenGet<bool, Task<void>, &Task<void>::Get_IsFaulted> IsFaulted{ this };
+
+				/// <summary>Gets whether the task completed due to being canceled.</summary>
+				PropGenGet<bool, Task<void>, &Task<void>::Get_IsCanceled> IsCanceled{ this };
+
+				/// <summary>Gets a task that has already completed successfully.</summary>
+				static PropGenGetStatic<Task<void>, &Task<void>::Get_CompletedTask> CompletedTask;
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+
+				Task(){}
+
+				Task(std::nullptr_t const & n) : System::Object(n) {
 				}
 
-				KConcurrentStack2(KConcurrentStack2* pValue) {
+				Task(Task* pValue) {
 					if (!pValue->od) {
 						ObjectData* dd = new ObjectData();
 						od = dd;
@@ -13453,29 +22536,29 @@ namespace System {
 					delete pValue;
 				}
 
-				KConcurrentStack2(KConcurrentStack2 const & other) : System::Object(other) { }
+				Task(Task const & other) : System::Object(other) { }
 
-				KConcurrentStack2(KConcurrentStack2&& other) noexcept : System::Object(std::move(other)) { }
+				Task(Task&& other) noexcept : System::Object(std::move(other)) { }
 
-				KConcurrentStack2(Object::ObjectData* other) : System::Object(other) {
+				Task(Object::ObjectData* other) : System::Object(other) {
 				}
 
-				KConcurrentStack2& operator=(KConcurrentStack2 const & other) {
+				Task& operator=(Task const & other) {
 					System::Object::operator=(other);
 					return *this;
 				}
 
-				KConcurrentStack2& operator=(std::nullptr_t const & n) {
+				Task& operator=(std::nullptr_t const & n) {
 					System::Object::operator=(n);
 					return *this;
 				}
 
-				KConcurrentStack2& operator=(KConcurrentStack2&& other) noexcept {
+				Task& operator=(Task&& other) noexcept {
 					System::Object::operator=(std::move(other));
 					return *this;
 				}
 
-				KConcurrentStack2& operator=(KConcurrentStack2* other) {
+				Task& operator=(Task* other) {
 					if (od == other->od)
 						return *this;
 					Release();
@@ -13484,189 +22567,259 @@ namespace System {
 					return *this;
 				}
 
-				KConcurrentStack2* operator->() {
+				Task* operator->() {
 					return this;
 				}
 
+#ifdef SYSTEM_COROUTINES
+				struct promise_type;
+				struct Awaiter;
 
+				Awaiter operator co_await() const;
+#endif
 
-				void Push(T const& item) {
-					return GOD()->Push(item);
-				}
 
-				//void Push(T&& item) {
-				//	return GOD()->Push(item);
-				//}
 
-				bool TryPop(Out<T> result) {
-					return GOD()->TryPop(result);
+				/// <summary>Waits for the task to complete. Rethrows the exception of a faulted task, throws
+				/// OperationCanceledException for a canceled one.</summary>
+				void Wait() const {
+					GOD()->Wait();
+					GOD()->ThrowIfFailed();
 				}
-			};
-#endif
 
-#if _MSC_VER
-			template<class T>
-			using ConcurrentStack = KConcurrentStack2<T>; //LockingStack<T>;
-#else
-			template<class T>
-			using ConcurrentStack = LockingStack<T>;
-#endif
+				/// <summary>Waits at most millisecondsTimeout (-1 is infinite) for the task to complete.</summary>
+				/// <returns>true if the task completed in time.</returns>
+				bool Wait(int millisecondsTimeout) const {
+					if (!GOD()->Wait(millisecondsTimeout))
+						return false;
+					GOD()->ThrowIfFailed();
+					return true;
+				}
 
+				/// <summary>Creates a task that runs continuation with this task once this task completes, whatever
+				/// its outcome. The returned task completes with the result or the exception of continuation.</summary>
+				template<class F> auto ContinueWith(F const& continuation) const -> Task<decltype(continuation(std::declval<Task<void> const&>()))> {
+					typedef decltype(continuation(std::declval<Task<void> const&>())) R;
+					Task<R> ret;
+					ret.od = new typename Task<R>::ObjectData();
+					GOD()->AddContinuation(ObjectData::NewContinuation([ret, continuation](ObjectData* antecedent) {
+						Task<void> task(antecedent);
+						ret.GOD()->RunBody([&]() { return continuation(task); });
+						}));
+					return ret;
+				}
 
-			template<class T> class System_API KConcurrentQueue : public Object {
-			private:
-			public:
+				/// <summary>Queues function on the ThreadPool and returns a task for its result.</summary>
+				template<class F> static auto Run(F const& function) -> Task<decltype(function())> {
+					typedef decltype(function()) R;
+					Task<R> ret;
+					ret.od = new typename Task<R>::ObjectData();
+					ret.GOD()->status.store((int)TaskStatus::WaitingToRun, std::memory_order_relaxed);
+					ThreadPool::QueueUserWorkItem([ret, function]() {
+						ret.GOD()->RunBody(function);
+						});
+					return ret;
+				}
 
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					static const int bitsperdim = 4;
-					static const int elsperdim = 1 << bitsperdim;
-					static const int dimmask = (1 << (bitsperdim + 1)) - 1;
+				/// <summary>Creates a task that has already completed with the specified result.</summary>
+				template<class T> static Task<T> FromResult(T const& result) {
+					Task<T> ret;
+					ret.od = new typename Task<T>::ObjectData(result);
+					return ret;
+				}
 
-					static const int maxnumdim = 2;
-					static const int bitsdimcounter = 4;
+				/// <summary>Creates a task that has already completed with the specified exception.</summary>
+				template<class T = void> static Task<T> FromException(std::exception_ptr exception) {
+					Task<T> ret;
+					ret.od = new typename Task<T>::ObjectData();
+					ret.GOD()->TrySetException(exception);
+					return ret;
+				}
 
-					struct node {
-						T* value;
-						ulong nextindex;
-					};
+				template<class T = void, class E> static Task<T> FromException(E const& exception) {
+					return FromException<T>(std::make_exception_ptr(exception));
+				}
 
-					node** root;
-					std::atomic<ulong> at_index;
-					std::atomic<ulong> at_inject;
-					//std::atomic<ulong> generationcounter = 0;
-				public:
+				/// <summary>Creates a task that has already been canceled.</summary>
+				template<class T = void> static Task<T> FromCanceled() {
+					Task<T> ret;
+					ret.od = new typename Task<T>::ObjectData();
+					ret.GOD()->TrySetCanceled();
+					return ret;
+				}
 
-					ObjectData() {
-						at_index.store(0);
-						at_inject.store(elsperdim);
-						node** arr = new node * [elsperdim];
-						for (int i = 0; i < elsperdim; i++) {
-							arr[i] = new node();
-							arr[i]->value = nullptr;
-							arr[i]->nextindex = i == elsperdim - 1 ? 0 : i + 1;
-						}
-						for (int i = 0; i < maxnumdim - 1; i++) {
-							node** tmp = new node * [elsperdim];
-							memset(tmp, 0, elsperdim * sizeof(node*));
-							tmp[0] = (node*)arr;
-							arr = tmp;
-						}
-						root = arr;
-					}
+				/// <summary>Creates a task that completes after millisecondsDelay, -1 waits indefinitely. No thread is
+				/// blocked in the meantime, continuations run on the ThreadPool.</summary>
+				static Task<void> Delay(int millisecondsDelay);
 
-					~ObjectData() override {
+				/// <summary>Creates a task that completes when all of the tasks have completed. It is faulted with the
+				/// first fault among them (in array order), else canceled if one of them was canceled.</summary>
+				static Task<void> WhenAll(Collections::Generic::Array<Task<void>> const& tasks) {
+					Task<void> ret;
+					ret.od = new ObjectData();
+					OnAllCompleted(tasks, [ret, tasks]() {
+						if (!ret.GOD()->TrySetFailure(tasks))
+							ret.GOD()->TrySetResult();
+						});
+					return ret;
+				}
+
+				/// <summary>Creates a task that completes when all of the tasks have completed, with their results in
+				/// the same order.</summary>
+				template<class T> static Task<Collections::Generic::Array<T>> WhenAll(Collections::Generic::Array<Task<T>> const& tasks) {
+					Task<Collections::Generic::Array<T>> ret;
+					ret.od = new typename Task<Collections::Generic::Array<T>>::ObjectData();
+					OnAllCompleted(tasks, [ret, tasks]() {
+						if (ret.GOD()->TrySetFailure(tasks))
+							return;
+						int n = tasks.Length;
+						Collections::Generic::Array<T> results(n);
+						for (int i = 0; i < n; i++)
+							results.GOD()->arrdta[i] = tasks.GOD()->arrdta[i].GOD()->result;
+						ret.GOD()->TrySetResult(results);
+						});
+					return ret;
+				}
 
+				/// <summary>Creates a task that completes when any of the tasks has completed. Its result is that task.</summary>
+				template<class TTask> static Task<TTask> WhenAny(Collections::Generic::Array<TTask> const& tasks) {
+					if (tasks == null)
+						throw ArgumentNullException();
+					int n = tasks.Length;
+					if (!n)
+						throw ArgumentOutOfRangeException();
+					TTask* arr = tasks.GOD()->arrdta;
+					for (int i = 0; i < n; i++) {
+						if (arr[i] == null)
+							throw ArgumentNullException();
+					}
+					Task<TTask> ret;
+					ret.od = new typename Task<TTask>::ObjectData();
+					for (int i = 0; i < n; i++) {
+						arr[i].GOD()->AddContinuation(ObjectData::NewContinuation([ret](ObjectData* antecedent) {
+							ret.GOD()->TrySetResult(TTask(antecedent));
+							}, true));
+						// no need to register on the others
+						if (ret.GOD()->IsCompleted())
+							break;
 					}
+					return ret;
+				}
+			};
 
-					ulong ComposeIndex(ulong dimcounter, ulong wi, ulong ri, ulong generation) {
-						ulong ret = dimcounter << (64 - bitsdimcounter);
-						ulong shifter = 64 - bitsdimcounter - ((bitsperdim + bitsperdim) * (dimcounter + 1));
-						ulong generationmask = (1 << shifter) - 1;
-						for (int i = 0; i <= dimcounter; i++) {
-							ret |= (wi & dimmask) << (shifter + bitsperdim);
-							wi >>= bitsperdim;
-							ret |= (ri & dimmask) << (shifter);
-							ri >>= bitsperdim;
-							shifter += (bitsperdim + bitsperdim);
-						}
-						ret |= (generation & generationmask);
+#ifdef SYSTEM_COROUTINES
+			// a coroutine returning Task starts right away on the calling thread, the task completes on co_return
+			struct Task<void>::promise_type : CoroutineFrame {
+				Task<void> task;
 
-						return ret;
-					}
+				promise_type() {
+					task.od = new ObjectData();
+					task.GOD()->status.store((int)TaskStatus::Running, std::memory_order_relaxed);
+				}
 
+				Task<void> get_return_object() {
+					return task;
+				}
 
-					int ParseDim(ulong indori, ulong dims, ulong& ind, ulong& wi, ulong& ri, node** arr, node** parr, const T& item) {
-						ulong wipart = (ind >> (64 - bitsperdim));
-						ulong ripart = (ind >> (64 - bitsperdim - bitsperdim)) & dimmask;
-						wi = (wi << bitsperdim) | wipart;
-						ri = (ri << bitsperdim) | ripart;
+				std::suspend_never initial_suspend() noexcept {
+					return {};
+				}
 
-						if (dims > 0) {
-							parr = arr;
-							arr = (node**)arr[wipart];
-							ind <<= (bitsdimcounter + bitsdimcounter);
-							return ParseDim(indori, dims - 1, ind, wi, ri, arr, parr, item);
-						}
-						else {
-							node* rarr = (node*)arr;
-							node* nod = rarr + (wi & dimmask);
+				std::suspend_never final_suspend() noexcept {
+					return {};
+				}
 
-							ulong nextwi = nod->nextindex;
-							if (nextwi != ri) {
+				void return_void() {
+					task.GOD()->TrySetResult();
+				}
 
-								ulong nextind = ComposeIndex(indori >> 64 - bitsdimcounter, nextwi, ri, indori);
-								ulong expected = indori;
-								if (at_index.compare_exchange_weak(expected, nextind)) {
-									ind = nextind;
-									std::atomic<T*>* ato = reinterpret_cast<std::atomic<T*>*>(nod);
-									T* newt = new T(item);
-									ato->store(newt);
+				void unhandled_exception() {
+					task.GOD()->SetCurrentException();
+				}
+			};
 
-									return 0;
-								}
-								else {
-									// report failure, try again
-									return -1;
-								}
-							}
-							else {
-								// uh-oh, we caught up with the read index
-								Console::WriteLine("Should increase it");
+			// the awaiting coroutine resumes on the thread that completes the task if that is a pool worker,
+			// otherwise on the ThreadPool
+			struct Task<void>::Awaiter {
+				Task<void> task;
 
-							}
-						}
+				bool await_ready() const noexcept {
+					return task.GOD()->IsCompleted();
+				}
 
-					}
+				bool await_suspend(std::coroutine_handle<> awaiting) const {
+					ObjectData::Continuation* c = ObjectData::NewContinuation([awaiting](ObjectData*) { awaiting.resume(); });
+					if (task.GOD()->TryAddContinuation(c))
+						return true;
+					delete c;
+					return false;
+				}
 
+				void await_resume() const {
+					task.GOD()->ThrowIfFailed();
+				}
+			};
 
-					void Enqueue(T const & item) {
-						ulong indori = at_index.load();
-
-						ulong dimcounter = indori >> 64 - bitsdimcounter;
-						//T** tmp = root;
-
-						ulong wi = 0;
-						ulong ri = 0;
-						node** parr = nullptr;
-						node** arr = root;
-						for (int i = 0; i < maxnumdim - dimcounter - 1; i++) {
-							parr = arr;
-							arr = (node**)arr[0];
-						}
-						ulong ind = indori << bitsdimcounter;
-						ParseDim(dimcounter, dimcounter, ind, wi, ri, arr, parr, item);
-						//ulong ind = indori;
-						//ulong shifter = 64;
-						//ulong wi = 0;
-						//ulong ri = 0;
-						//for (int i = 0; i < numdim - 1; i++) {
-						//	shifter -= (bitsperdim + bitsperdim);
-						//	int wipart = (indori >> (shifter + bitsperdim)) & dimmask;
-						//	int ripart = (indori >> shifter) & dimmask;
-						//	wi = (wi << bitsperdim) | wipart;
-						//	ri = (wi << bitsperdim) | ripart;
-						//	tmp = ((T**)tmp)[wipart];
-						//}
+			Task<void>::Awaiter Task<void>::operator co_await() const {
+				return Awaiter{ *this };
+			}
+#endif
 
+#ifndef SYSTEM_EXPORTS
+			PropGenGetStatic<Task<void>, &Task<void>::Get_CompletedTask> Task<void>::CompletedTask{};
+#endif
 
+			/// <summary>Represents an asynchronous operation that returns a value of type TResult.</summary>
+			template<class TResult> class System_API Task : public Task<void> {
+			private:
+				TResult Get_Result() const {
+					GOD()->Wait();
+					GOD()->ThrowIfFailed();
+					return GOD()->result;
+				}
 
-						//tmp[wi & dimmask] = item;
+			public:
+				class System_API ObjectData : public Task<void>::ObjectData {
+				public:
+					TResult result{};
 
+					ObjectData() {
+					}
 
+					ObjectData(TResult const& result) : Task<void>::ObjectData(TaskStatus::RanToCompletion), result(result) {
+					}
 
+					bool TrySetResult(TResult const& value) {
+						if (!Claim())
+							return false;
+						result = value;
+						Finish(TaskStatus::RanToCompletion);
+						return true;
+					}
 
+					template<class G> void RunBody(G const& body) {
+						Task<void>::ObjectData::RunBody([this, &body]() {
+							TResult value = body();
+							if (Claim()) {
+								result = std::move(value);
+								Finish(TaskStatus::RanToCompletion);
+							}
+							});
 					}
 				};
 
-								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				/// <summary>Gets the result, waits for the task to complete if necessary. Rethrows the exception of a
+				/// faulted task, throws OperationCanceledException for a canceled one.</summary>
+				PropGenGet<TResult, Task<TResult>, &Task<TResult>::Get_Result> Result{ this };
+
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-				KConcurrentQueue(){}
+				Task(){}
 
-				KConcurrentQueue(std::nullptr_t const & n) : System::Object(n) {
+				Task(std::nullptr_t const & n) : Task<void>(n) {
 				}
 
-				KConcurrentQueue(KConcurrentQueue* pValue) {
+				Task(Task* pValue) {
 					if (!pValue->od) {
 						ObjectData* dd = new ObjectData();
 						od = dd;
@@ -13678,29 +22831,29 @@ namespace System {
 					delete pValue;
 				}
 
-				KConcurrentQueue(KConcurrentQueue const & other) : System::Object(other) { }
+				Task(Task const & other) : Task<void>(other) { }
 
-				KConcurrentQueue(KConcurrentQueue&& other) noexcept : System::Object(std::move(other)) { }
+				Task(Task&& other) noexcept : Task<void>(std::move(other)) { }
 
-				KConcurrentQueue(Object::ObjectData* other) : System::Object(other) {
+				Task(Object::ObjectData* other) : Task<void>(other) {
 				}
 
-				KConcurrentQueue& operator=(KConcurrentQueue const & other) {
-					System::Object::operator=(other);
+				Task& operator=(Task const & other) {
+					Task<void>::operator=(other);
 					return *this;
 				}
 
-				KConcurrentQueue& operator=(std::nullptr_t const & n) {
-					System::Object::operator=(n);
+				Task& operator=(std::nullptr_t const & n) {
+					Task<void>::operator=(n);
 					return *this;
 				}
 
-				KConcurrentQueue& operator=(KConcurrentQueue&& other) noexcept {
-					System::Object::operator=(std::move(other));
+				Task& operator=(Task&& other) noexcept {
+					Task<void>::operator=(std::move(other));
 					return *this;
 				}
 
-				KConcurrentQueue& operator=(KConcurrentQueue* other) {
+				Task& operator=(Task* other) {
 					if (od == other->od)
 						return *this;
 					Release();
@@ -13709,75 +22862,172 @@ namespace System {
 					return *this;
 				}
 
-				KConcurrentQueue* operator->() {
+				Task* operator->() {
 					return this;
 				}
 
+#ifdef SYSTEM_COROUTINES
+				struct promise_type : CoroutineFrame {
+					Task<TResult> task;
 
+					promise_type() {
+						task.od = new ObjectData();
+						task.GOD()->status.store((int)TaskStatus::Running, std::memory_order_relaxed);
+					}
 
+					Task<TResult> get_return_object() {
+						return task;
+					}
 
-					void Enqueue(const T& item) {
-					GOD()->Enqueue(item);
-				}
-			};
+					std::suspend_never initial_suspend() noexcept {
+						return {};
+					}
 
+					std::suspend_never final_suspend() noexcept {
+						return {};
+					}
 
+					void return_value(TResult const& value) {
+						task.GOD()->TrySetResult(value);
+					}
 
-			template<class T> class System_API LockingQueue : public Object {
-			private:
-			public:
+					void unhandled_exception() {
+						task.GOD()->SetCurrentException();
+					}
+				};
 
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					System::Collections::Generic::Queue<T> q = new System::Collections::Generic::Queue<T>{};
-					std::mutex mut;
+				struct Awaiter : Task<void>::Awaiter {
+					TResult await_resume() const {
+						this->task.GOD()->ThrowIfFailed();
+						return static_cast<ObjectData*>(this->task.GOD())->result;
+					}
+				};
 
+				Awaiter operator co_await() const {
+					return Awaiter{ { *this } };
+				}
+#endif
 
-				public:
 
-					ObjectData() {
-					}
 
-					~ObjectData() override {
+				/// <summary>Creates a task that runs continuation with this task once this task completes.</summary>
+				template<class F> auto ContinueWith(F const& continuation) const -> Task<decltype(continuation(std::declval<Task<TResult> const&>()))> {
+					typedef decltype(continuation(std::declval<Task<TResult> const&>())) R;
+					Task<R> ret;
+					ret.od = new typename Task<R>::ObjectData();
+					GOD()->AddContinuation(ObjectData::NewContinuation([ret, continuation](Task<void>::ObjectData* antecedent) {
+						Task<TResult> task(antecedent);
+						ret.GOD()->RunBody([&]() { return continuation(task); });
+						}));
+					return ret;
+				}
+			};
 
-					}
+			// the timers of Task::Delay: one background thread sleeps until the earliest deadline and completes the
+			// tasks that are due. It never runs user code, the continuations of those tasks go to the ThreadPool, and
+			// it counts as pool work while it holds a completed task, so ThreadPool::WaitForIdle covers it
+			class DelayTimer {
+			private:
+				struct Entry {
+					std::chrono::steady_clock::time_point due;
+					Task<void> task;
 
-					void Enqueue(T const & item) {
-						std::lock_guard<std::mutex> mlock(mut);
-						q.Enqueue(item);
+					bool operator<(Entry const& other) const {
+						return due > other.due;
 					}
+				};
 
-					void Enqueue(T&& item) {
-						std::lock_guard<std::mutex> mlock(mut);
-						q.Enqueue(std::forward<T>(item));
+				std::mutex mut;
+				std::condition_variable changed;
+				std::priority_queue<Entry> entries;
+				Thread thread;
+
+				DelayTimer() {
+					thread = Thread([this]() { Run(); });
+					thread.IsBackground = true;
+					thread.Start();
+				}
+
+				void Run() {
+					std::unique_lock<std::mutex> lock(mut);
+					while (true) {
+						if (entries.empty()) {
+							changed.wait(lock);
+							continue;
+						}
+						if (changed.wait_until(lock, entries.top().due) == std::cv_status::no_timeout && std::chrono::steady_clock::now() < entries.top().due)
+							continue;
+						Task<void> due = entries.top().task;
+						entries.pop();
+						lock.unlock();
+						SimpleThreadPool::ObjectData* pool = ThreadPool::_Instance.GOD();
+						pool->BeginWork();
+						due.GOD()->TrySetResult();
+						due = null;
+						pool->EndWork();
+						lock.lock();
 					}
+				}
 
-					bool TryDequeue(Out<T> result) {
-						std::lock_guard<std::mutex> mlock(mut);
+			public:
+				// never destroyed, its thread runs until the process exits
+				static DelayTimer& Instance() {
+					static DelayTimer* instance = new DelayTimer();
+					return *instance;
+				}
 
-						if (q.Count == 0)
-							return false;
+				void Add(Task<void> const& task, int millisecondsDelay) {
+					std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now() + std::chrono::milliseconds(millisecondsDelay);
+					std::lock_guard<std::mutex> lock(mut);
+					bool earliest = entries.empty() || due < entries.top().due;
+					entries.push(Entry{ due, task });
+					if (earliest)
+						changed.notify_one();
+				}
+			};
 
-						result = q.Dequeue();
+			Task<void> Task<void>::Delay(int millisecondsDelay) {
+				if (millisecondsDelay < -1)
+					throw ArgumentOutOfRangeException();
+				if (millisecondsDelay == 0)
+					return Get_CompletedTask();
+				Task<void> ret;
+				ret.od = new ObjectData();
+				if (millisecondsDelay > 0)
+					DelayTimer::Instance().Add(ret, millisecondsDelay);
+				return ret;
+			}
 
+			/// <summary>The producer side of a Task that is not backed by a body: whoever holds the source completes
+			/// the task, from any thread.</summary>
+			template<> class System_API TaskCompletionSource<void> : public Object {
+			private:
+				Tasks::Task<void> Get_Task() const {
+					return GOD()->task;
+				}
 
-						return true;
+			public:
+				class System_API ObjectData : public Object::ObjectData {
+				public:
+					Tasks::Task<void> task;
+
+					ObjectData() {
+						task.od = new Tasks::Task<void>::ObjectData();
 					}
 
-					int Get_Count() {
-						std::lock_guard<std::mutex> mlock(mut);
-						return q.Count;
+					ObjectData(Tasks::Task<void>::ObjectData* td) {
+						task.od = td;
 					}
 				};
 
-								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-				LockingQueue(){}
+				TaskCompletionSource(){}
 
-				LockingQueue(std::nullptr_t const & n) : System::Object(n) {
+				TaskCompletionSource(std::nullptr_t const & n) : System::Object(n) {
 				}
 
-				LockingQueue(LockingQueue* pValue) {
+				TaskCompletionSource(TaskCompletionSource* pValue) {
 					if (!pValue->od) {
 						ObjectData* dd = new ObjectData();
 						od = dd;
@@ -13789,29 +23039,29 @@ namespace System {
 					delete pValue;
 				}
 
-				LockingQueue(LockingQueue const & other) : System::Object(other) { }
+				TaskCompletionSource(TaskCompletionSource const & other) : System::Object(other) { }
 
-				LockingQueue(LockingQueue&& other) noexcept : System::Object(std::move(other)) { }
+				TaskCompletionSource(TaskCompletionSource&& other) noexcept : System::Object(std::move(other)) { }
 
-				LockingQueue(Object::ObjectData* other) : System::Object(other) {
+				TaskCompletionSource(Object::ObjectData* other) : System::Object(other) {
 				}
 
-				LockingQueue& operator=(LockingQueue const & other) {
+				TaskCompletionSource& operator=(TaskCompletionSource const & other) {
 					System::Object::operator=(other);
 					return *this;
 				}
 
-				LockingQueue& operator=(std::nullptr_t const & n) {
+				TaskCompletionSource& operator=(std::nullptr_t const & n) {
 					System::Object::operator=(n);
 					return *this;
 				}
 
-				LockingQueue& operator=(LockingQueue&& other) noexcept {
+				TaskCompletionSource& operator=(TaskCompletionSource&& other) noexcept {
 					System::Object::operator=(std::move(other));
 					return *this;
 				}
 
-				LockingQueue& operator=(LockingQueue* other) {
+				TaskCompletionSource& operator=(TaskCompletionSource* other) {
 					if (od == other->od)
 						return *this;
 					Release();
@@ -13820,78 +23070,77 @@ namespace System {
 					return *this;
 				}
 
-				LockingQueue* operator->() {
+				TaskCompletionSource* operator->() {
 					return this;
 				}
 
 
 
-				int Get_Count() const {
-					return GOD()->Get_Count();
+				/// <summary>Completes the task successfully. TrySetResult returns false if it was already completed,
+				/// SetResult throws InvalidOperationException.</summary>
+				bool TrySetResult() const {
+					return GOD()->task.GOD()->TrySetResult();
 				}
 
-				bool Get_IsEmpty() const {
-					return Get_Count() == 0;
+				void SetResult() const {
+					if (!TrySetResult())
+						throw InvalidOperationException();
 				}
 
-				PropGenGet<int, LockingQueue, &LockingQueue::Get_Count> Count{ this };
-				PropGenGet<bool, LockingQueue, &LockingQueue::Get_IsEmpty> IsEmpty{ this };
-
-				void Enqueue(T const& item) {
-					GOD()->Enqueue(item);
+				/// <summary>Completes the task as faulted with the specified exception.</summary>
+				bool TrySetException(std::exception_ptr exception) const {
+					return GOD()->task.GOD()->TrySetException(exception);
 				}
 
-				void Enqueue(T&& item) {
-					GOD()->Enqueue(std::forward<T>(item));
+				template<class E> bool TrySetException(E const& exception) const {
+					return TrySetException(std::make_exception_ptr(exception));
 				}
 
-				bool TryDequeue(Out<T> result) {
-					return GOD()->TryDequeue(result);
+				template<class E> void SetException(E const& exception) const {
+					if (!TrySetException(exception))
+						throw InvalidOperationException();
 				}
-			};
-
-			template<class T> class System_API MPMCBoundedQueue : public Object {
-			private:
-
-			public:
-				class System_API ObjectData : public Object::ObjectData {
-				private:
-					int size;
-					std::atomic<ulong> wi = 0;
-					std::atomic<ulong> ri = 0;
-					T** data;
-
-				public:
-					ObjectData() {}
-
-					ObjectData(int size) : size(size), data(new T* [size]) {
-						memset(data, 0, size << ptrshifter);
-					}
-
-					~ObjectData() override {
-
-					}
-
-					void Enqueue(const T& item) {
 
+				/// <summary>Completes the task as canceled.</summary>
+				bool TrySetCanceled() const {
+					return GOD()->task.GOD()->TrySetCanceled();
+				}
 
+				void SetCanceled() const {
+					if (!TrySetCanceled())
+						throw InvalidOperationException();
+				}
 
+				/// <summary>Gets the task controlled by this source.</summary>
+				PropGenGet<Tasks::Task<void>, TaskCompletionSource<void>, &TaskCompletionSource<void>::Get_Task> Task{ this };
+			};
 
+			/// <summary>The producer side of a Task&lt;TResult&gt;.</summary>
+			template<class TResult> class System_API TaskCompletionSource : public TaskCompletionSource<void> {
+			private:
+				Tasks::Task<TResult> Get_Task() const {
+					return Tasks::Task<TResult>(GOD()->task.od);
+				}
 
-					}
+				typename Tasks::Task<TResult>::ObjectData* TaskData() const {
+					return static_cast<typename Tasks::Task<TResult>::ObjectData*>(GOD()->task.od);
+				}
 
-					bool TryDequeue(Out<T>& result) {
-						return true;
+			public:
+				class System_API ObjectData : public TaskCompletionSource<void>::ObjectData {
+				public:
+					ObjectData() : TaskCompletionSource<void>::ObjectData(new typename Tasks::Task<TResult>::ObjectData()) {
 					}
 				};
-								ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-				MPMCBoundedQueue(){}
+				ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
 
-				MPMCBoundedQueue(std::nullptr_t const & n) : System::Object(n) {
+				TaskCompletionSource(){}
+
+				TaskCompletionSource(std::nullptr_t const & n) : TaskCompletionSource<void>(n) {
 				}
 
-				MPMCBoundedQueue(MPMCBoundedQueue* pValue) {
+				TaskCompletionSource(TaskCompletionSource* pValue) {
 					if (!pValue->od) {
 						ObjectData* dd = new ObjectData();
 						od = dd;
@@ -13903,29 +23152,29 @@ namespace System {
 					delete pValue;
 				}
 
-				MPMCBoundedQueue(MPMCBoundedQueue const & other) : System::Object(other) { }
+				TaskCompletionSource(TaskCompletionSource const & other) : TaskCompletionSource<void>(other) { }
 
-				MPMCBoundedQueue(MPMCBoundedQueue&& other) noexcept : System::Object(std::move(other)) { }
+				TaskCompletionSource(TaskCompletionSource&& other) noexcept : TaskCompletionSource<void>(std::move(other)) { }
 
-				MPMCBoundedQueue(Object::ObjectData* other) : System::Object(other) {
+				TaskCompletionSource(Object::ObjectData* other) : TaskCompletionSource<void>(other) {
 				}
 
-				MPMCBoundedQueue& operator=(MPMCBoundedQueue const & other) {
-					System::Object::operator=(other);
+				TaskCompletionSource& operator=(TaskCompletionSource const & other) {
+					TaskCompletionSource<void>::operator=(other);
 					return *this;
 				}
 
-				MPMCBoundedQueue& operator=(std::nullptr_t const & n) {
-					System::Object::operator=(n);
+				TaskCompletionSource& operator=(std::nullptr_t const & n) {
+					TaskCompletionSource<void>::operator=(n);
 					return *this;
 				}
 
-				MPMCBoundedQueue& operator=(MPMCBoundedQueue&& other) noexcept {
-					System::Object::operator=(std::move(other));
+				TaskCompletionSource& operator=(TaskCompletionSource&& other) noexcept {
+					TaskCompletionSource<void>::operator=(std::move(other));
 					return *this;
 				}
 
-				MPMCBoundedQueue& operator=(MPMCBoundedQueue* other) {
+				TaskCompletionSource& operator=(TaskCompletionSource* other) {
 					if (od == other->od)
 						return *this;
 					Release();
@@ -13934,829 +23183,1536 @@ namespace System {
 					return *this;
 				}
 
-				MPMCBoundedQueue* operator->() {
+				TaskCompletionSource* operator->() {
 					return this;
 				}
 
 
 
-					MPMCBoundedQueue(int size) {
-					od = new ObjectData(size);
-				}
-
-				void Enqueue(const T& item) {
-					GOD()->Enqueue(item);
+				/// <summary>Completes the task with the specified result.</summary>
+				bool TrySetResult(TResult const& result) const {
+					return TaskData()->TrySetResult(result);
 				}
 
-				bool TryDequeue(Out<T>& result) {
-					return GOD()->TryDequeue(result);
+				void SetResult(TResult const& result) const {
+					if (!TrySetResult(result))
+						throw InvalidOperationException();
 				}
 
+				/// <summary>Gets the task controlled by this source.</summary>
+				PropGenGet<Tasks::Task<TResult>, TaskCompletionSource<TResult>, &TaskCompletionSource<TResult>::Get_Task> Task{ this };
 			};
 
+			/// <summary>The outcome of an operation that often completes synchronously: holds the result itself, or
+			/// the Task that produces it, so the synchronous case allocates nothing.</summary>
+			template<class TResult = void> struct ValueTask {
+				TResult result;
+				Task<TResult> task;
 
+				ValueTask() : result() {}
 
-			template<class T>
-			using ConcurrentQueue = LockingQueue<T>;
+				ValueTask(TResult const& result) : result(result) {}
 
+				ValueTask(Task<TResult> const& task) : result(), task(task) {}
 
-			// A ConcurrentDictionary and Wait-Free Queue from Compare and Swap   William Morriss 2015/05/09
-			template<class TKey, class TValue> class System_API WMorrissDictionaryD : public Object::ObjectData {
-			private:
-				struct node {
-					TKey key;
-					TValue value;
-					int hash;
-				};
+				bool IsCompleted() const {
+					return task == null || task.GOD()->IsCompleted();
+				}
 
-				static const int b = 4;
-				static const int n = 1 << b;
-				static const int c = 7; // cache lines are usually 64 bytes, optimizing this for 64-bit architectures that's 8 64-bit pointers, 7 for entries, 1 for the pointer to the next table
-				static const int cshift = 3;
-				static const int bmask = n - 1;
+				/// <summary>Gets the result, waits for the task if there is one.</summary>
+				TResult Result() const {
+					return task == null ? result : (TResult)task.Result;
+				}
 
+				Task<TResult> AsTask() const {
+					return task == null ? Task<>::FromResult(result) : task;
+				}
 
-				struct table_t {
-					std::atomic<void*> entries[n * (c + 1)];
+#ifdef SYSTEM_COROUTINES
+				// a coroutine returning ValueTask runs like one returning Task
+				struct promise_type : Task<TResult>::promise_type {
+					ValueTask get_return_object() {
+						return ValueTask(this->task);
+					}
 				};
 
-				System::Collections::Generic::IEqualityComparer<TKey> comparer;
+				struct Awaiter {
+					ValueTask value;
 
-				table_t* MainTable;
+					bool await_ready() const noexcept {
+						return value.IsCompleted();
+					}
 
-				void DeleteTable(table_t* tbl) {
-					for (int i = 0; i < n; i++) {
-						void* ptr = tbl->entries[i << cshift].load();
-						if (ptr) {
-							DeleteTable((table_t*)ptr);
-						}
-						else {
-							for (int j = 0; j < c; j++) {
-								ptr = tbl->entries[(i << cshift) + 1 + j].load();
-								if (ptr) {
-									node* nptr = (node*)ptr;
-									//		std::cout << "deletingcout " << nptr->key << std::endl;
-									//		std::cerr << "deletingcerr " << nptr->key << std::endl;
-									delete nptr;
-								}
-								else
-									break;
-							}
-						}
+					bool await_suspend(std::coroutine_handle<> awaiting) const {
+						return typename Task<TResult>::Awaiter{ { value.task } }.await_suspend(awaiting);
 					}
-					MPool.Put((byte*)tbl);
-				}
 
-			public:
-				int count;
+					TResult await_resume() const {
+						return value.task == null ? value.result : typename Task<TResult>::Awaiter{ { value.task } }.await_resume();
+					}
+				};
 
-				void Initialize(int capacity) {
-					int numbts = (n * (c + 1)) << ptrshifter;
-					MainTable = (table_t*)MPool.Get(numbts);
-					memset(MainTable, 0, numbts);
+				Awaiter operator co_await() const {
+					return Awaiter{ *this };
 				}
+#endif
+			};
 
-				WMorrissDictionaryD(int capacity, System::Collections::Generic::IEqualityComparer<TKey> comparer) {
-					//if (capacity < 0) ThrowHelper.ThrowArgumentOutOfRangeException(ExceptionArgument.capacity);
-					count = 0;
-
-					Initialize(capacity);
-					if (comparer == null)
-						this->comparer = System::Collections::Generic::EqualityComparer<TKey>::Default;
-					else
-						this->comparer = comparer;
-				}
+			template<> struct ValueTask<void> {
+				Task<void> task;
 
-				WMorrissDictionaryD(int capacity) : WMorrissDictionaryD(capacity, null) {}
+				ValueTask() {}
 
-				WMorrissDictionaryD(System::Collections::Generic::IEqualityComparer<TKey> comparer) : WMorrissDictionaryD(0, comparer) {}
+				ValueTask(Task<void> const& task) : task(task) {}
 
-				WMorrissDictionaryD() : WMorrissDictionaryD(0) {}
+				bool IsCompleted() const {
+					return task == null || task.GOD()->IsCompleted();
+				}
 
-				TValue* TryGetValue(const TKey& key) {
-					int hash = comparer.GetHashCode(key);
-					table_t* tbl = MainTable;
-					int bshift = 0;
-					int rowpos;
-					do {
-						rowpos = ((hash >> bshift) & bmask) << cshift;
-						void* ptr = tbl->entries[rowpos].load();
-						if (!ptr)
-							break;
-						bshift += b;
-						tbl = (table_t*)ptr;
-					} while (1);
-					node* newnode = NULL;
-					for (int i = 0; i < c; i++) {
-						node* ptr = (node*)tbl->entries[rowpos + 1 + i].load();
-						if (!ptr) {
-							return NULL;
-						}
-						//if (ptr == TombStone)
-						//	continue;
-						if (comparer.Equals(key, ptr->key)) {
-							return &ptr->value;
-						}
-					}
+				void Wait() const {
+					if (task != null)
+						task.Wait();
+				}
 
-					return NULL;
+				Task<void> AsTask() const {
+					return task == null ? (Task<void>)Task<void>::CompletedTask : task;
 				}
 
-				void Insert(const TKey& key, const TValue& value, bool add) {
-					int hash = comparer.GetHashCode(key);
-					table_t* tbl = MainTable;
-					int bshift = 0;
-					int rowpos;
-					do {
-						do {
-							rowpos = ((hash >> bshift) & bmask) << cshift;
-							void* ptr = tbl->entries[rowpos].load();
-							if (!ptr)
-								break;
-							bshift += b;
-							tbl = (table_t*)ptr;
-						} while (1);
-						node* newnode = NULL;
-						for (int i = 0; i < c; i++) {
-							node* ptr = (node*)tbl->entries[rowpos + 1 + i].load();
-							if (!ptr) { // || ptr == TombStone) {
-								if (!newnode) {
-									newnode = new node();
-									newnode->hash = hash;
-									newnode->key = key;
-									newnode->value = value;
-								}
-								void* expected = (void*)ptr;
-								if (tbl->entries[rowpos + 1 + i].compare_exchange_weak(expected, newnode, std::memory_order_release, std::memory_order_relaxed)) {
-									return;
-								}
-								ptr = (node*)expected;
-							}
-							if (comparer.Equals(key, ptr->key)) {
-								ptr->value = value;
-							}
-						}
+#ifdef SYSTEM_COROUTINES
+				struct promise_type : Task<void>::promise_type {
+					ValueTask get_return_object() {
+						return ValueTask(this->task);
+					}
+				};
 
-						table_t* next = static_cast<table_t*>(tbl->entries[rowpos].load());
-						bshift += b;
-						if (next) {
-							tbl = next;
-						}
-						else {
-							int numbts = (n * (c + 1)) << ptrshifter;
-							table_t* newtbl = reinterpret_cast<table_t*>(MPool.Get(numbts));
-							memset(newtbl, 0, numbts);
-							if (!tbl) // avoid C28182
-								throw NullReferenceException();
-							for (int i = 0; i < c; i++) {
-								node* nod = static_cast<node*>(tbl->entries[rowpos + 1 + i].load());
-								int newrowpos = ((nod->hash >> bshift) & bmask) << cshift;
-								newrowpos++;
-								while (newtbl->entries[newrowpos].load()) { newrowpos++; }
-								newtbl->entries[newrowpos].store(nod);
-							}
-							void* expected = NULL;
-							if (tbl->entries[rowpos].compare_exchange_strong(expected, newtbl, std::memory_order_release, std::memory_order_relaxed)) {
-								tbl = newtbl;
-							}
-							else {
-								MPool.Put((byte*)newtbl);
-								tbl = (table_t*)expected;
-							}
-						}
-					} while (1);
+				Task<void>::Awaiter operator co_await() const {
+					return AsTask().operator co_await();
 				}
+#endif
+			};
 
-				bool Remove(const TKey& key) {
-					throw NotImplementedException();
+#ifdef SYSTEM_COROUTINES
+			// the outcome of a LazyTask, kept in its promise
+			template<class TResult> struct LazyTaskResult {
+				TResult result{};
+				std::exception_ptr exception;
+
+				void return_value(TResult const& value) {
+					result = value;
 				}
 
-				~WMorrissDictionaryD() {
-					DeleteTable(MainTable);
+				TResult Get() {
+					if (exception)
+						std::rethrow_exception(exception);
+					return std::move(result);
 				}
 			};
 
-			template<class TKey, class TValue> class System_API WMorrissDictionary : public virtual Object {
-			public:
-				WMorrissDictionary() {
+			template<> struct LazyTaskResult<void> {
+				std::exception_ptr exception;
 
+				void return_void() {
 				}
 
-				WMorrissDictionary(const std::nullptr_t& n) {
-					od = null;
+				void Get() {
+					if (exception)
+						std::rethrow_exception(exception);
 				}
+			};
 
-				WMorrissDictionary(int capacity) {
-					WMorrissDictionaryD<TKey, TValue>* dd = new WMorrissDictionaryD<TKey, TValue>(capacity);
-					od = dd;
-				}
+			/// <summary>A coroutine that does not run until it is awaited or started. It then runs on the awaiting
+			/// thread and hands control straight back to the awaiter when it finishes, so nested lazy tasks cost no
+			/// queueing and no synchronisation. Owns its frame: it can be moved, not copied, and awaited once.</summary>
+			template<class TResult = void> class LazyTask {
+			public:
+				struct promise_type : CoroutineFrame, LazyTaskResult<TResult> {
+					std::coroutine_handle<> continuation;
 
-				WMorrissDictionary(int capacity, System::Collections::Generic::IEqualityComparer<TKey> comparer) {
-					WMorrissDictionaryD<TKey, TValue>* dd = new WMorrissDictionaryD<TKey, TValue>(capacity, comparer);
-					od = dd;
-				}
+					struct FinalAwaiter {
+						bool await_ready() const noexcept {
+							return false;
+						}
 
-				WMorrissDictionary(System::Collections::Generic::IEqualityComparer<TKey> comparer) {
-					WMorrissDictionaryD<TKey, TValue>* dd = new WMorrissDictionaryD<TKey, TValue>(comparer);
-					od = dd;
-				}
+						std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> finished) const noexcept {
+							std::coroutine_handle<> next = finished.promise().continuation;
+							return next ? next : std::noop_coroutine();
+						}
 
-				WMorrissDictionary(WMorrissDictionary* pValue) {
-					od = pValue->od;
-					if (!od) { // 'default explicit' construction
-						WMorrissDictionaryD<TKey, TValue>* dd = new WMorrissDictionaryD<TKey, TValue>(0);
-						od = dd;
+						void await_resume() const noexcept {
+						}
+					};
+
+					LazyTask get_return_object() {
+						return LazyTask(std::coroutine_handle<promise_type>::from_promise(*this));
 					}
-					MPool.Put((byte*)pValue);
-				}
 
+					std::suspend_always initial_suspend() noexcept {
+						return {};
+					}
 
+					FinalAwaiter final_suspend() noexcept {
+						return {};
+					}
 
-				WMorrissDictionary(const WMorrissDictionary& other) : Object(other) {}
+					void unhandled_exception() {
+						this->exception = std::current_exception();
+					}
+				};
 
-				void Add(const TKey& key, const TValue& value) {
-					WMorrissDictionaryD<TKey, TValue>* dd = (WMorrissDictionaryD<TKey, TValue>*)od;
-					dd->Insert(key, value, true);
-				}
+				struct Awaiter {
+					std::coroutine_handle<promise_type> coroutine;
 
-				bool TryGetValue(const TKey& key, TValue& value) {
-					WMorrissDictionaryD<TKey, TValue>* dd = (WMorrissDictionaryD<TKey, TValue>*)od;
-					TValue* ptr = dd->TryGetValue(key);
-					if (!ptr)
+					bool await_ready() const noexcept {
 						return false;
-					value = *ptr;
-					return true;
+					}
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept {
+						coroutine.promise().continuation = awaiting;
+						return coroutine;
+					}
+
+					TResult await_resume() const {
+						return coroutine.promise().Get();
+					}
+				};
+
+			private:
+				std::coroutine_handle<promise_type> coroutine;
+
+				explicit LazyTask(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+
+				static Task<TResult> Run(LazyTask lazy) {
+					co_return co_await lazy;
 				}
 
-				bool Contains(const TKey& key) {
-					TValue value;
-					return TryGetValue(key, value);
+			public:
+				LazyTask() : coroutine(nullptr) {}
+
+				LazyTask(LazyTask const& other) = delete;
+
+				LazyTask(LazyTask&& other) noexcept : coroutine(other.coroutine) {
+					other.coroutine = nullptr;
 				}
 
-				bool Remove(const TKey& key) {
-					WMorrissDictionaryD<TKey, TValue>* dd = (WMorrissDictionaryD<TKey, TValue>*)od;
-					return dd->Remove(key);
+				~LazyTask() {
+					if (coroutine)
+						coroutine.destroy();
 				}
 
-				TValue& operator[](const TKey& key)
-				{
-					WMorrissDictionaryD<TKey, TValue>* dd = (WMorrissDictionaryD<TKey, TValue>*)od;
-					TValue* val = dd->TryGetValue(key);
-					if (val)
-						return *val;
-					int index = dd->Insert(key, TValue(), true);
-					return dd->entries[index].value;
+				LazyTask& operator=(LazyTask const& other) = delete;
+
+				LazyTask& operator=(LazyTask&& other) noexcept {
+					if (this != &other) {
+						if (coroutine)
+							coroutine.destroy();
+						coroutine = other.coroutine;
+						other.coroutine = nullptr;
+					}
+					return *this;
 				}
 
+				Awaiter operator co_await() const {
+					if (!coroutine || coroutine.promise().continuation)
+						throw InvalidOperationException();
+					return Awaiter{ coroutine };
+				}
 
+				/// <summary>Runs the coroutine on the calling thread up to its first suspension, the returned Task
+				/// completes with its outcome.</summary>
+				Task<TResult> Start() {
+					return Run(std::move(*this));
+				}
 			};
 
+			struct ManualResetEventAwaiter {
+				ManualResetEventConditionVariable event;
 
-			template<class TKey, class TValue>
-			using ConcurrentDictionary = WMorrissDictionary<TKey, TValue>;
-
-		}
+				bool await_ready() const {
+					return event.WaitOne(0);
+				}
 
+				void await_suspend(std::coroutine_handle<> awaiting) const {
+					event.RegisterSetCallback([awaiting]() {
+						ThreadPool::QueueUserWorkItem([awaiting]() { awaiting.resume(); });
+						});
+				}
 
+				void await_resume() const noexcept {
+				}
+			};
+#endif
+		}
 
+#ifdef SYSTEM_COROUTINES
+		/// <summary>co_await on a ManualResetEvent suspends the coroutine until the event is set, without blocking a
+		/// thread. The coroutine then resumes on the ThreadPool.</summary>
+		Tasks::ManualResetEventAwaiter operator co_await(ManualResetEventConditionVariable const& event) {
+			return Tasks::ManualResetEventAwaiter{ event };
+		}
+#endif
 	}
+}
 
+namespace System {
+	namespace Threading {
+		namespace Tasks {
+
+			// Parallel loops. The calling thread and up to MaxDegreeOfParallelism - 1 work items on the ThreadPool
+			// claim chunks of the index range through one atomic counter. A claim takes a share of what is left
+			// (remaining / (2 * workers), at least one index), so the chunks are large at the start and shrink towards
+			// the end, where they even out the finishing times. IEnumerable sources are read under a lock in chunks that
+			// double per claim. Cancellation and exceptions are checked before every chunk and every 256 indexes within
+			// one. A work item that only gets to run after the loop is over finds nothing to claim and returns without
+			// touching the loop body.
+			//
+			//    Parallel::For(0, n, [&](int i) { output[i] = Compute(input[i]); });
 
-	class System_API IAsyncResult : public Object
-	{
-	private:
+			/// <summary>Options of the Parallel loops.</summary>
+			struct ParallelOptions {
+				/// <summary>The maximum number of threads working on one loop, the calling thread included. -1 is
+				/// Environment::ProcessorCount.</summary>
+				int MaxDegreeOfParallelism = -1;
 
+				/// <summary>Checked before every chunk, a canceled loop throws OperationCanceledException.</summary>
+				Threading::CancellationToken CancellationToken;
+			};
 
-	public:
-		bool Get_IsCompleted() const { return GOD()->Get_IsCompleted(); }
-		bool Get_CompletedSynchronously() const { return GOD()->Get_CompletedSynchronously(); };
-		Object Get_AsyncState() const { return GOD()->Get_AsyncState(); };
-		System::Threading::WaitHandle Get_AsyncWaitHandle() const { return GOD()->Get_AsyncWaitHandle(); };
+			class System_API Parallel {
+			private:
+				// shared by the workers of one loop, reference counted since a work item may only start after the loop
+				struct LoopState {
+					std::atomic<int> busy{ 0 };
+					std::atomic<bool> stopped{ false };
+					std::atomic<bool> canceled{ false };
+					std::mutex exlock;
+					std::exception_ptr ex;
+					CancellationToken token;
+					int workers = 1;
+
+					// false once the loop ends early, after an exception or a cancellation
+					bool Continue() {
+						if (stopped.load())
+							return false;
+						if (token.IsCancellationRequested) {
+							canceled.store(true);
+							stopped.store(true);
+							return false;
+						}
+						return true;
+					}
 
-		class System_API ObjectData {
-		public:
-			ObjectData() {
-			}
+					void Fail(std::exception_ptr e) {
+						std::lock_guard<std::mutex> lock(exlock);
+						if (!ex)
+							ex = e;
+						stopped.store(true);
+					}
+				};
 
-			~ObjectData() {
-			}
+				struct RangeState : LoopState {
+					std::atomic<long> next{ 0 };
+					long to = 0;
+
+					bool Claim(long& begin, long& end) {
+						long cur = next.load();
+						while (cur < to && Continue()) {
+							long size = (to - cur) / (2 * workers);
+							if (size < 1)
+								size = 1;
+							if (next.compare_exchange_weak(cur, cur + size, std::memory_order_relaxed)) {
+								begin = cur;
+								end = cur + size;
+								return true;
+							}
+						}
+						return false;
+					}
+				};
 
-			virtual bool Get_IsCompleted() const = 0;
-			virtual bool Get_CompletedSynchronously() const = 0;
-			virtual Object Get_AsyncState() const = 0;
-			virtual System::Threading::WaitHandle Get_AsyncWaitHandle() const = 0;
-		};
+				template<class T> struct EnumerableState : LoopState {
+					std::mutex mut;
+					Collections::Generic::IEnumerator<T> current;
+					Collections::Generic::IEnumerator<T> end;
+					bool done = false;
+
+					// size is per worker, it doubles with every claim up to 256 elements
+					bool Claim(std::vector<T>& chunk, int& size) {
+						chunk.clear();
+						if (!Continue())
+							return false;
+						std::lock_guard<std::mutex> lock(mut);
+						while (!done && (int)chunk.size() < size) {
+							if (current != end) {
+								chunk.push_back(*current);
+								++current;
+							}
+							else
+								done = true;
+						}
+						if (size < 256)
+							size <<= 1;
+						return !chunk.empty();
+					}
+				};
 
-		PropGenGet<bool, IAsyncResult, &IAsyncResult::Get_IsCompleted> IsCompleted{ this };
-		PropGenGet<bool, IAsyncResult, &IAsyncResult::Get_CompletedSynchronously> CompletedSynchronously{ this };
-		PropGenGet<Object, IAsyncResult, &IAsyncResult::Get_AsyncState> AsyncState{ this };
-		PropGenGet<System::Threading::WaitHandle, IAsyncResult, &IAsyncResult::Get_AsyncWaitHandle> AsyncWaitHandle{ this };
+				template<class Init, class Body, class Finally> struct Loop {
+					Init const& init;
+					Body const& body;
+					Finally const& localFinally;
+				};
 
-				ObjectData* id = nullptr;
+				// loop lives on the stack of the calling thread, it is only touched after a successful claim
+				template<class L> static void WorkRange(RangeState* st, L const* loop) {
+					st->busy.fetch_add(1);
+					long begin, end;
+					if (st->Claim(begin, end)) {
+						try {
+							auto local = loop->init();
+							do {
+								for (long i = begin; i < end;) {
+									long stop = end - i > 256 ? i + 256 : end;
+									for (; i < stop; i++)
+										local = loop->body(i, std::move(local));
+									if (i < end && !st->Continue())
+										break;
+								}
+							} while (st->Claim(begin, end));
+							loop->localFinally(std::move(local));
+						}
+						catch (...) {
+							st->Fail(std::current_exception());
+						}
+					}
+					st->busy.fetch_sub(1, std::memory_order_release);
+				}
 
-		ObjectData* GOD() const { return this->id; };
+				template<class T, class L> static void WorkEnumerable(EnumerableState<T>* st, L const* loop) {
+					st->busy.fetch_add(1);
+					try {
+						std::vector<T> chunk;
+						int size = 1;
+						if (st->Claim(chunk, size)) {
+							auto local = loop->init();
+							do {
+								for (T& item : chunk)
+									local = loop->body(item, std::move(local));
+							} while (st->Claim(chunk, size));
+							loop->localFinally(std::move(local));
+						}
+					}
+					catch (...) {
+						st->Fail(std::current_exception());
+					}
+					st->busy.fetch_sub(1, std::memory_order_release);
+				}
 
-		IAsyncResult(){}
+				static int Degree(ParallelOptions const& options, long count) {
+					if (options.MaxDegreeOfParallelism == 0 || options.MaxDegreeOfParallelism < -1)
+						throw ArgumentOutOfRangeException();
+					int ret = options.MaxDegreeOfParallelism > 0 ? options.MaxDegreeOfParallelism : (int)Environment::ProcessorCount;
+					if (ret < 1)
+						ret = 1;
+					if (count < ret)
+						ret = (int)count;
+					return ret;
+				}
 
-		IAsyncResult(std::nullptr_t const & n) : System::Object (nullptr), id(nullptr) {
-		}
+				// runs work on the calling thread and on workers - 1 pool items, returns once none of them is busy
+				template<class State, class W> static void RunWorkers(std::shared_ptr<State> const& st, W const& work) {
+					for (int w = 1; w < st->workers; w++) {
+						std::shared_ptr<State> keep = st;
+						ThreadPool::QueueUserWorkItem([keep, work]() {
+							work(keep.get());
+							});
+					}
+					work(st.get());
 
-		IAsyncResult(IAsyncResult const & other) : System::Object(other) { this->id = other.id; }
+					// the chunks still running are at most one per worker
+					int spins = 0;
+					while (st->busy.load() > 0) {
+						if (spins < 10)
+							Thread::SpinWait(4 << spins++);
+						else
+							Thread::Yield();
+					}
 
-		IAsyncResult(IAsyncResult&& other) noexcept : System::Object(std::move(other)) { this->id = other.id; other.id = nullptr;  }
+					if (st->ex)
+						std::rethrow_exception(st->ex);
+					if (st->canceled.load())
+						throw OperationCanceledException();
+				}
 
-		IAsyncResult(System::Object::ObjectData* baseod, ObjectData* other) : System::Object(baseod), id(other) {
-		}
+				template<class Init, class Body, class Finally> static void ForRange(long fromInclusive, long toExclusive, ParallelOptions const& options, Init const& localInit, Body const& body, Finally const& localFinally) {
+					options.CancellationToken.ThrowIfCancellationRequested();
+					if (toExclusive <= fromInclusive)
+						return;
+					Loop<Init, Body, Finally> loop{ localInit, body, localFinally };
+					Loop<Init, Body, Finally> const* lp = &loop;
+					std::shared_ptr<RangeState> st = std::make_shared<RangeState>();
+					st->next.store(fromInclusive);
+					st->to = toExclusive;
+					st->workers = Degree(options, toExclusive - fromInclusive);
+					st->token = options.CancellationToken;
+					RunWorkers(st, [lp](RangeState* s) { WorkRange(s, lp); });
+				}
+
+				template<class T, class Init, class Body, class Finally> static void ForEnumerable(Collections::Generic::IEnumerable<T> const& source, ParallelOptions const& options, Init const& localInit, Body const& body, Finally const& localFinally) {
+					if (source == null)
+						throw ArgumentNullException();
+					options.CancellationToken.ThrowIfCancellationRequested();
+					Loop<Init, Body, Finally> loop{ localInit, body, localFinally };
+					Loop<Init, Body, Finally> const* lp = &loop;
+					std::shared_ptr<EnumerableState<T>> st = std::make_shared<EnumerableState<T>>();
+					st->current = source.begin();
+					st->end = source.end();
+					st->workers = Degree(options, INT64_MAX);
+					st->token = options.CancellationToken;
+					RunWorkers(st, [lp](EnumerableState<T>* s) { WorkEnumerable(s, lp); });
+				}
+
+				static int NoLocal() {
+					return 0;
+				}
 
-		IAsyncResult& operator=(IAsyncResult const & other) {
-			System::Object::operator=(other);
-			id = other.id;
-			return *this;
-		}
+				static void NoFinally(int) {
+				}
 
-		IAsyncResult& operator=(IAsyncResult&& other) noexcept {
-			System::Object::operator=(std::move(other));
-			id = other.id;
-			return *this;
-		}
+			public:
+				/// <summary>Runs body(i) for every i in [fromInclusive, toExclusive), possibly in parallel. Returns when
+				/// all iterations are done; the first exception thrown by body is rethrown on the calling thread.</summary>
+				template<class F> static void For(int fromInclusive, int toExclusive, F const& body) {
+					For(fromInclusive, toExclusive, ParallelOptions(), body);
+				}
 
-		IAsyncResult* operator->() {
-			return this;
-		}
+				template<class F> static void For(int fromInclusive, int toExclusive, ParallelOptions const& options, F const& body) {
+					auto each = [&body](long i, int) { body((int)i); return 0; };
+					ForRange(fromInclusive, toExclusive, options, NoLocal, each, NoFinally);
+				}
 
+				template<class F> static void For(long fromInclusive, long toExclusive, F const& body) {
+					For(fromInclusive, toExclusive, ParallelOptions(), body);
+				}
 
+				template<class F> static void For(long fromInclusive, long toExclusive, ParallelOptions const& options, F const& body) {
+					auto each = [&body](long i, int) { body(i); return 0; };
+					ForRange(fromInclusive, toExclusive, options, NoLocal, each, NoFinally);
+				}
 
+				/// <summary>For with thread-local state: every worker starts from localInit(), threads it through
+				/// local = body(i, local) and hands the final value to localFinally, on that worker.</summary>
+				template<class Init, class F, class Finally> static void For(int fromInclusive, int toExclusive, Init const& localInit, F const& body, Finally const& localFinally) {
+					For(fromInclusive, toExclusive, ParallelOptions(), localInit, body, localFinally);
+				}
 
+				template<class Init, class F, class Finally> static void For(int fromInclusive, int toExclusive, ParallelOptions const& options, Init const& localInit, F const& body, Finally const& localFinally) {
+					typedef decltype(localInit()) TLocal;
+					auto each = [&body](long i, TLocal local) { return body((int)i, std::move(local)); };
+					ForRange(fromInclusive, toExclusive, options, localInit, each, localFinally);
+				}
 
+				/// <summary>Runs body(item) for every item of source, possibly in parallel.</summary>
+				template<class T, class F> static void ForEach(Collections::Generic::List<T> const& source, F const& body) {
+					ForEach(source, ParallelOptions(), body);
+				}
 
-	};
+				template<class T, class F> static void ForEach(Collections::Generic::List<T> const& source, ParallelOptions const& options, F const& body) {
+					ForEach(source, options, NoLocal, [&body](T& item, int) { body(item); return 0; }, NoFinally);
+				}
 
-	namespace Threading {
-#if _MSC_VER || __MINGW32__
-		/// <summary>Represents a thread synchronization event that, when signaled, must be reset manually. This class cannot be inherited.</summary>
-		class System_API ManualResetEventWindows : public Object {
-		private:
-		public:
-			class System_API ObjectData : public Object::ObjectData {
-			private:
-				//		std::condition_variable condition;
-				HANDLE evnt;
+				template<class T, class Init, class F, class Finally> static void ForEach(Collections::Generic::List<T> const& source, ParallelOptions const& options, Init const& localInit, F const& body, Finally const& localFinally) {
+					if (source == null)
+						throw ArgumentNullException();
+					typedef decltype(localInit()) TLocal;
+					T* arr = source.GOD()->arrdta;
+					auto each = [arr, &body](long i, TLocal local) { return body(arr[i], std::move(local)); };
+					ForRange(0, source.GOD()->Count, options, localInit, each, localFinally);
+				}
 
-			public:
-				ObjectData(bool initialState) {
-					evnt = CreateEvent(NULL, true, initialState, NULL);
+				template<class T, class F> static void ForEach(Collections::Generic::Array<T> const& source, F const& body) {
+					ForEach(source, ParallelOptions(), body);
 				}
 
-				ObjectData() : ObjectData(false) {}
+				template<class T, class F> static void ForEach(Collections::Generic::Array<T> const& source, ParallelOptions const& options, F const& body) {
+					ForEach(source, options, NoLocal, [&body](T& item, int) { body(item); return 0; }, NoFinally);
+				}
 
-				~ObjectData() override {
-					CloseHandle(evnt);
+				template<class T, class Init, class F, class Finally> static void ForEach(Collections::Generic::Array<T> const& source, ParallelOptions const& options, Init const& localInit, F const& body, Finally const& localFinally) {
+					if (source == null)
+						throw ArgumentNullException();
+					typedef decltype(localInit()) TLocal;
+					T* arr = source.GOD()->arrdta;
+					auto each = [arr, &body](long i, TLocal local) { return body(arr[i], std::move(local)); };
+					ForRange(0, (long)source.GOD()->Length, options, localInit, each, localFinally);
 				}
 
-				bool Set() {
-					return SetEvent(evnt);
+				template<class T, class F> static void ForEach(Collections::Generic::IEnumerable<T> const& source, F const& body) {
+					ForEach(source, ParallelOptions(), body);
 				}
 
-				bool Reset() {
-					return ResetEvent(evnt);
+				template<class T, class F> static void ForEach(Collections::Generic::IEnumerable<T> const& source, ParallelOptions const& options, F const& body) {
+					ForEach(source, options, NoLocal, [&body](T& item, int) { body(item); return 0; }, NoFinally);
 				}
 
-				bool WaitOne() {
-					DWORD err = WaitForSingleObject(evnt, INFINITE);
-					return err == WAIT_OBJECT_0;
+				template<class T, class Init, class F, class Finally> static void ForEach(Collections::Generic::IEnumerable<T> const& source, ParallelOptions const& options, Init const& localInit, F const& body, Finally const& localFinally) {
+					ForEnumerable(source, options, localInit, body, localFinally);
 				}
 
-				bool WaitOne(const System::TimeSpan& timeout) {
-					return false;
+				/// <summary>Runs the actions, possibly in parallel, and returns when all of them are done.</summary>
+				static void Invoke(Collections::Generic::Array<Action<>> const& actions) {
+					Invoke(ParallelOptions(), actions);
 				}
 
-				bool WaitOne(int millisecondsTimeout) {
-					return false;
+				static void Invoke(ParallelOptions const& options, Collections::Generic::Array<Action<>> const& actions) {
+					if (actions == null)
+						throw ArgumentNullException();
+					Action<>* arr = actions.GOD()->arrdta;
+					For(0, (int)actions.Length, options, [arr](int i) { arr[i](); });
 				}
 			};
+		}
+	}
+}
 
-			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+namespace System {
+	namespace Linq {
 
-			ManualResetEventWindows(){}
+		// Parallel LINQ. A ParallelQuery splits the index range of its List/Array/pointer source into chunks.
+		// The chunks are claimed through an atomic counter by the calling thread and by up to
+		// DegreeOfParallelism - 1 work items on the ThreadPool, so a slow worker never holds on to more than one
+		// chunk. Every worker keeps its own partial result (count, sum, min/max, output buffer) which are
+		// combined on the calling thread once all chunks are done.
+		//
+		//    long sum = lst.AsParallel().Where([](int x) { return x > 500; }).Select([](int x) { return (long)x; }).Sum();
 
-			ManualResetEventWindows(std::nullptr_t const & n) : System::Object(n) {
+		class ParallelWork {
+		private:
+			typedef void RunChunkFN(void const* body, int chunk, int worker);
+
+			struct State {
+				std::atomic<int> next{ 0 };
+				std::atomic<int> done{ 0 };
+				std::atomic<bool> failed{ false };
+				int chunkCount = 0;
+				void const* body = null;
+				RunChunkFN* runchunk = null;
+				std::mutex exlock;
+				std::exception_ptr ex;
+			};
+
+			template<class Body> static void RunChunk(void const* body, int chunk, int worker) {
+				(*(Body const*)body)(chunk, worker);
 			}
 
-			ManualResetEventWindows(ManualResetEventWindows* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
-				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
+			static void Work(State* st, int worker) {
+				int chunk;
+				while ((chunk = st->next.fetch_add(1, std::memory_order_relaxed)) < st->chunkCount) {
+					// after an exception the remaining chunks are only counted, not run
+					if (!st->failed.load(std::memory_order_relaxed)) {
+						try {
+							st->runchunk(st->body, chunk, worker);
+						}
+						catch (...) {
+							std::lock_guard<std::mutex> lock(st->exlock);
+							if (!st->ex)
+								st->ex = std::current_exception();
+							st->failed.store(true, std::memory_order_relaxed);
+						}
+					}
+					st->done.fetch_add(1, std::memory_order_release);
 				}
-				delete pValue;
 			}
 
-			ManualResetEventWindows(ManualResetEventWindows const & other) : System::Object(other) { }
-
-			ManualResetEventWindows(ManualResetEventWindows&& other) noexcept : System::Object(std::move(other)) { }
+		public:
+			/// <summary>Calls body(chunk, worker) for every chunk in [0, chunkCount) on workerCount threads, the calling thread being worker 0.</summary>
+			/// <returns>When all chunks are done. The first exception thrown by body is rethrown on the calling thread.</returns>
+			template<class Body> static void Run(int chunkCount, int workerCount, Body const& body) {
+				if (workerCount > chunkCount)
+					workerCount = chunkCount;
+				if (workerCount <= 1) {
+					for (int i = 0; i < chunkCount; i++)
+						body(i, 0);
+					return;
+				}
 
-			ManualResetEventWindows(Object::ObjectData* other) : System::Object(other) {
-			}
+				// pool items may only get to run after the caller already did all the work (they find no chunk
+				// left and return without touching body), so the state they share is reference counted
+				std::shared_ptr<State> st = std::make_shared<State>();
+				st->chunkCount = chunkCount;
+				st->body = &body;
+				st->runchunk = &RunChunk<Body>;
+				for (int w = 1; w < workerCount; w++) {
+					Threading::ThreadPool::QueueUserWorkItem([st, w]() {
+						Work(st.get(), w);
+						});
+				}
+				Work(st.get(), 0);
+
+				// the chunks still running are at most one per worker, spin a little before giving up the time slice
+				int spins = 0;
+				while (st->done.load(std::memory_order_acquire) < chunkCount) {
+					if (spins < 10)
+						Threading::Thread::SpinWait(4 << spins++);
+					else
+						Threading::Thread::Yield();
+				}
 
-			ManualResetEventWindows& operator=(ManualResetEventWindows const & other) {
-				System::Object::operator=(other);
-				return *this;
+				if (st->ex)
+					std::rethrow_exception(st->ex);
 			}
+		};
 
-			ManualResetEventWindows& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
-			}
+	}
 
-			ManualResetEventWindows& operator=(ManualResetEventWindows&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
-			}
+	namespace Collections {
+		namespace Generic {
 
-			ManualResetEventWindows& operator=(ManualResetEventWindows* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
-			}
+			// Sorting behind List<T>::Sort, IEnumerable<T>::OrderBy and the Linq OrderBy/ThenBy.
+			// Integral and String keys are radix sorted: stable and without a single comparison. Everything else
+			// goes through std::sort/std::stable_sort. From ParallelThreshold elements on the input is cut into one
+			// chunk per worker, the chunks are sorted on the thread pool and then merged pairwise. Every merge is
+			// cut into pieces as well, so the last rounds (few long runs) still keep all workers busy.
+			class SortHelper {
+			private:
+				template<class K> struct IsIntegralKey {
+					static const bool value = std::is_integral<K>::value && !std::is_same<K, bool>::value;
+				};
 
-			ManualResetEventWindows* operator->() {
-				return this;
-			}
+				template<class K> struct IsRadixKey {
+					static const bool value = IsIntegralKey<K>::value || std::is_same<K, String>::value;
+				};
 
+				template<class K> struct KeyIndex {
+					K key;
+					int index;
+				};
 
+				// maps a key onto an unsigned integer with the same order (or the reverse order)
+				template<class K> static typename std::make_unsigned<K>::type RadixBits(K key, bool descending) {
+					typedef typename std::make_unsigned<K>::type U;
+					U bits = (U)key;
+					if (std::is_signed<K>::value)
+						bits ^= (U)((U)1 << (sizeof(K) * 8 - 1));
+					return descending ? (U)~bits : bits;
+				}
+
+				// LSD radix sort on the bytes of an integral key
+				template<class R, class KeyOf> static void RadixSortIntegral(R* dta, int count, KeyOf const& keyOf, bool descending) {
+					typedef typename std::decay<decltype(keyOf(*dta))>::type K;
+					typedef typename std::make_unsigned<K>::type U;
+					const int passes = (int)sizeof(K);
+
+					std::vector<int> hist(passes * 256, 0);
+					for (int i = 0; i < count; i++) {
+						U bits = RadixBits<K>(keyOf(dta[i]), descending);
+						for (int p = 0; p < passes; p++)
+							hist[p * 256 + (int)((bits >> (p * 8)) & 0xFF)]++;
+					}
+
+					std::vector<R> tmp(count);
+					R* from = dta;
+					R* to = tmp.data();
+					for (int p = 0; p < passes; p++) {
+						int* h = &hist[p * 256];
+						// a byte that is the same in every key doesn't move anything
+						if (h[(int)((RadixBits<K>(keyOf(from[0]), descending) >> (p * 8)) & 0xFF)] == count)
+							continue;
+						int offset = 0;
+						for (int b = 0; b < 256; b++) {
+							int c = h[b];
+							h[b] = offset;
+							offset += c;
+						}
+						for (int i = 0; i < count; i++) {
+							U bits = RadixBits<K>(keyOf(from[i]), descending);
+							to[h[(int)((bits >> (p * 8)) & 0xFF)]++] = std::move(from[i]);
+						}
+						std::swap(from, to);
+					}
+					if (from != dta)
+						std::move(from, from + count, dta);
+				}
 
-			/// <summary>Initializes a new instance of the ManualResetEvent class with a Boolean value indicating whether to set the initial state to signaled.</summary>
-			/// <param name="initialState">true to set the initial state signaled; false to set the initial state to nonsignaled.</param>
-			ManualResetEventWindows(bool initialState) {
-				this->od = new ObjectData(initialState);
-			}
+				template<class R, class Less> static void InsertionSort(R* dta, int count, Less const& less) {
+					for (int i = 1; i < count; i++) {
+						if (!less(dta[i], dta[i - 1]))
+							continue;
+						R value = std::move(dta[i]);
+						int j = i;
+						do {
+							dta[j] = std::move(dta[j - 1]);
+							j--;
+						} while (j > 0 && less(value, dta[j - 1]));
+						dta[j] = std::move(value);
+					}
+				}
+
+				// MSD radix sort on the UTF-16 code units of a String key, high byte first. Gives the order of
+				// String::CompareOrdinal: null first, a string comes before all longer strings it is a prefix of.
+				template<class R, class KeyOf> static void RadixSortString(R* dta, R* tmp, int count, int digit, KeyOf const& keyOf) {
+					std::vector<short> buckets;
+					while (true) {
+						if (count < 32) {
+							// the keys are known to be equal on the first digit / 2 characters, insertion sort is stable
+							InsertionSort(dta, count, [&keyOf](R const& a, R const& b) -> bool {
+								return String::CompareOrdinal(keyOf(a), keyOf(b)) < 0;
+								});
+							return;
+						}
 
-			/// <summary>Sets the state of the event to signaled, allowing one or more waiting threads to proceed.</summary>
-			/// <returns>true if the operation succeeds; otherwise, false.</returns>
-			bool Set() const {
-				return GOD()->Set();
-			}
+						// bucket 0: null, 1: string ended, 2 + the byte otherwise
+						int pos = digit >> 1;
+						int shift = (digit & 1) ? 0 : 8;
+						int counts[258] = { 0 };
+						buckets.resize(count);
+						for (int i = 0; i < count; i++) {
+							String const& key = keyOf(dta[i]);
+							int b;
+							if (key.od == nullptr)
+								b = 0;
+							else if (pos >= ((String::ObjectData*)key.od)->Length)
+								b = 1;
+							else
+								b = 2 + ((key.ToCharArray()[pos] >> shift) & 0xFF);
+							buckets[i] = (short)b;
+							counts[b]++;
+						}
 
-			/// <summary>Sets the state of the event to nonsignaled, causing threads to block.</summary>
-			/// <returns>true if the operation succeeds; otherwise, false.</returns>
-			bool Reset() const {
-				return GOD()->Reset();
-			}
+						// a common prefix doesn't need any moving, go straight to the next digit
+						if (counts[buckets[0]] == count) {
+							if (buckets[0] < 2)
+								return;
+							digit++;
+							continue;
+						}
 
-			/// <summary>Blocks the current thread until the current instance receives a signal, using a TimeSpan to specify the time interval.</summary>
-			/// <param name="timeout">A TimeSpan that represents the number of milliseconds to wait, or a TimeSpan that represents -1 milliseconds to wait indefinitely.</param>
-			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
-			bool WaitOne(TimeSpan const & timeout) const {
-				return GOD()->WaitOne(timeout);
-			}
+						int starts[259];
+						starts[0] = 0;
+						for (int b = 0; b < 258; b++)
+							starts[b + 1] = starts[b] + counts[b];
+						int next[258];
+						for (int b = 0; b < 258; b++)
+							next[b] = starts[b];
+						for (int i = 0; i < count; i++)
+							tmp[next[buckets[i]]++] = std::move(dta[i]);
+						std::move(tmp, tmp + count, dta);
+
+						for (int b = 2; b < 258; b++) {
+							if (counts[b] > 1)
+								RadixSortString(dta + starts[b], tmp + starts[b], counts[b], digit + 1, keyOf);
+						}
+						return;
+					}
+				}
 
-			/// <summary>Blocks the current thread until the current WaitHandle receives a signal, using a 32-bit signed integer to specify the time interval in milliseconds.</summary>
-			/// <param name="millisecondsTimeout">The number of milliseconds to wait, or Infinite (-1) to wait indefinitely.</param>
-			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
-			bool WaitOne(int millisecondsTimeout) const {
-				return GOD()->WaitOne(millisecondsTimeout);
-			}
+				template<class R, class KeyOf> static void RadixSort(R* dta, int count, KeyOf const& keyOf, bool descending, std::true_type) {
+					RadixSortIntegral(dta, count, keyOf, descending);
+				}
 
-			/// <summary>Blocks the current thread until the current WaitHandle receives a signal.</summary>
-			/// <returns>true if the current instance receives a signal. If the current instance is never signaled, WaitOne() never returns.</returns>
-			bool WaitOne() const {
-				return GOD()->WaitOne();
-			}
-		};
-#endif
+				template<class R, class KeyOf> static void RadixSort(R* dta, int count, KeyOf const& keyOf, bool descending, std::false_type) {
+					if (descending) {
+						Sort(dta, count, [&keyOf](R const& a, R const& b) -> bool {
+							return String::CompareOrdinal(keyOf(b), keyOf(a)) < 0;
+							}, true);
+						return;
+					}
+					std::vector<R> tmp(count);
+					RadixSortString(dta, tmp.data(), count, 0, keyOf);
+				}
 
-		/// <summary>Represents a thread synchronization event that, when signaled, must be reset manually. This class cannot be inherited.</summary>
-		class System_API ManualResetEventConditionVariable : public Object {
-		private:
-		public:
-			class System_API ObjectData : public Object::ObjectData {
-			private:
-				std::condition_variable condition;
-				std::mutex mut;
-				std::atomic<bool> state;
+				template<class K, class Less> static void SortKeys(KeyIndex<K>* keys, int count, Less const& less, bool descending, std::true_type) {
+					RadixSort(keys, count, [](KeyIndex<K> const& k) -> K const& { return k.key; }, descending, std::integral_constant<bool, IsIntegralKey<K>::value>());
+				}
 
-			public:
-				ObjectData(bool initialState) {
-					state.store(initialState);
+				template<class K, class Less> static void SortKeys(KeyIndex<K>* keys, int count, Less const& less, bool descending, std::false_type) {
+					Sort(keys, count, [&less](KeyIndex<K> const& a, KeyIndex<K> const& b) -> bool {
+						return less(a.key, b.key);
+						}, true);
 				}
 
-				ObjectData() : ObjectData(false) {}
+				// sorts dta by the keys keySelector returns, every key is computed once
+				template<class T, class F, class Less, class UseRadix> static void SortByKey(T* dta, int count, F const& keySelector, Less const& less, bool descending, UseRadix useRadix) {
+					typedef typename std::decay<decltype(keySelector(std::declval<T const&>()))>::type K;
+					if (count < 2)
+						return;
 
-				bool Set() {
-					std::unique_lock<std::mutex> lock(mut);
-					state.store(true);
-					lock.unlock();
-					condition.notify_all();
+					std::vector<KeyIndex<K>> keys(count);
+					int workers = GetWorkers(count);
+					Linq::ParallelWork::Run(workers, workers, [&keys, &keySelector, dta, count, workers](int chunk, int) {
+						int end = (int)((long)count * (chunk + 1) / workers);
+						for (int i = (int)((long)count * chunk / workers); i < end; i++) {
+							keys[i].key = keySelector(dta[i]);
+							keys[i].index = i;
+						}
+						});
+
+					SortKeys(keys.data(), count, less, descending, useRadix);
+
+					T* sorted = (T*) ::operator new(count * sizeof(T));
+					Linq::ParallelWork::Run(workers, workers, [&keys, dta, sorted, count, workers](int chunk, int) {
+						int end = (int)((long)count * (chunk + 1) / workers);
+						for (int i = (int)((long)count * chunk / workers); i < end; i++)
+							new (&sorted[i]) T(std::move(dta[keys[i].index]));
+						});
+					for (int i = 0; i < count; i++) {
+						dta[i] = std::move(sorted[i]);
+						sorted[i].~T();
+					}
+					::operator delete(sorted);
+				}
+
+				static int GetWorkers(int count) {
+					int workers = (int)Environment::ProcessorCount;
+					if (count < ParallelThreshold || workers < 2)
+						return 1;
+					return workers;
+				}
+
+				// one round of merges: run 2i and 2i + 1 of from end up as run i in to
+				template<class T, class Less> static void MergeRound(T* from, T* to, std::vector<int> const& bounds, Less const& less, int workers) {
+					int runs = (int)bounds.size() - 1;
+					int pairs = (runs + 1) / 2;
+					int pieces = workers / pairs;
+					if (pieces < 1)
+						pieces = 1;
+
+					// cut the left run into equal pieces, the right run where the cuts would be inserted. The cuts are
+					// all searched before merging starts, the merges move the elements away.
+					std::vector<int> cutsa(pairs * (pieces + 1));
+					std::vector<int> cutsb(pairs * (pieces + 1));
+					for (int pair = 0; pair < pairs; pair++) {
+						int a = bounds[pair * 2];
+						int m = bounds[pair * 2 + 1];
+						int b = pair * 2 + 2 <= runs ? bounds[pair * 2 + 2] : m;
+						for (int k = 0; k <= pieces; k++) {
+							int i = a + (int)((long)(m - a) * k / pieces);
+							int j;
+							if (k == 0)
+								j = m;
+							else if (i == m)
+								j = b;
+							else
+								j = (int)(std::lower_bound(from + m, from + b, from[i], less) - from);
+							cutsa[pair * (pieces + 1) + k] = i;
+							cutsb[pair * (pieces + 1) + k] = j;
+						}
+					}
 
-					return true;
+					Linq::ParallelWork::Run(pairs * pieces, workers, [from, to, &bounds, &cutsa, &cutsb, &less, pieces](int task, int) {
+						int pair = task / pieces;
+						int m = bounds[pair * 2 + 1];
+						int c = pair * (pieces + 1) + task % pieces;
+						int i0 = cutsa[c], i1 = cutsa[c + 1];
+						int j0 = cutsb[c], j1 = cutsb[c + 1];
+						std::merge(std::make_move_iterator(from + i0), std::make_move_iterator(from + i1),
+							std::make_move_iterator(from + j0), std::make_move_iterator(from + j1), to + i0 + j0 - m, less);
+						});
 				}
 
-				bool Reset() {
-					std::unique_lock<std::mutex> lock(mut);
-					state.store(false);
-					return true;
+			public:
+				/// <summary>Inputs with fewer elements are sorted on the calling thread.</summary>
+				static const int ParallelThreshold = 1 << 15;
+
+				/// <summary>Sorts count elements with a comparison sort. Parallel merge sort from ParallelThreshold elements on.</summary>
+				/// <param name="less">Returns true if the first argument goes before the second.</param>
+				/// <param name="stable">Keep equal elements in their original order.</param>
+				template<class T, class Less> static void Sort(T* dta, int count, Less const& less, bool stable) {
+					if (count < 2)
+						return;
+					int workers = GetWorkers(count);
+					if (workers < 2) {
+						if (stable)
+							std::stable_sort(dta, dta + count, less);
+						else
+							std::sort(dta, dta + count, less);
+						return;
+					}
+
+					std::vector<int> bounds(workers + 1);
+					for (int i = 0; i <= workers; i++)
+						bounds[i] = (int)((long)count * i / workers);
+					Linq::ParallelWork::Run(workers, workers, [dta, &bounds, &less, stable](int chunk, int) {
+						if (stable)
+							std::stable_sort(dta + bounds[chunk], dta + bounds[chunk + 1], less);
+						else
+							std::sort(dta + bounds[chunk], dta + bounds[chunk + 1], less);
+						});
+
+					std::vector<T> tmp(count);
+					T* from = dta;
+					T* to = tmp.data();
+					while (bounds.size() > 2) {
+						MergeRound(from, to, bounds, less, workers);
+						std::vector<int> merged;
+						for (int i = 0; i < (int)bounds.size(); i += 2)
+							merged.push_back(bounds[i]);
+						if (merged.back() != count)
+							merged.push_back(count);
+						bounds.swap(merged);
+						std::swap(from, to);
+					}
+					if (from != dta)
+						std::move(from, from + count, dta);
+				}
+
+				/// <summary>Sorts count values in ascending order. Integral values and Strings are radix sorted.</summary>
+				template<class T> static void Sort(T* dta, int count) {
+					if (count < 2)
+						return;
+					SortValues(dta, count, std::integral_constant<bool, IsRadixKey<T>::value>());
 				}
 
-				bool WaitOne() {
-					std::unique_lock<std::mutex> lock(mut);
-					condition.wait(lock, [&]() {return state.load(); });
+				/// <summary>Stable sort by the key keySelector returns for every element, ordered by the operator&lt; of the key. Integral and String keys are radix sorted.</summary>
+				template<class T, class F> static void SortByKey(T* dta, int count, F const& keySelector, bool descending) {
+					typedef typename std::decay<decltype(keySelector(std::declval<T const&>()))>::type K;
+					if (descending) {
+						SortByKey(dta, count, keySelector, [](K const& a, K const& b) -> bool { return b < a; }, descending, std::integral_constant<bool, IsRadixKey<K>::value>());
+					}
+					else {
+						SortByKey(dta, count, keySelector, [](K const& a, K const& b) -> bool { return a < b; }, descending, std::integral_constant<bool, IsRadixKey<K>::value>());
+					}
+				}
 
-					return true;
+				/// <summary>Stable sort by the key keySelector returns for every element, ordered by less.</summary>
+				template<class T, class F, class Less> static void SortByKey(T* dta, int count, F const& keySelector, Less const& less) {
+					SortByKey(dta, count, keySelector, less, false, std::false_type());
 				}
 
-				bool WaitOne(System::TimeSpan const& timeout) {
-					std::unique_lock<std::mutex> lock(mut);
-					std::chrono::duration<long, std::milli> dur(timeout.TotalMilliseconds);
-					return condition.wait_for(lock, dur, [&]() { return state.load(); });
+			private:
+				template<class T> static void SortValues(T* dta, int count, std::true_type) {
+					RadixSort(dta, count, [](T const& value) -> T const& { return value; }, false, std::integral_constant<bool, IsIntegralKey<T>::value>());
 				}
 
-				bool WaitOne(int millisecondsTimeout) {
-					if (millisecondsTimeout == -1)
-						return WaitOne();
-					std::unique_lock<std::mutex> lock(mut);
-					std::chrono::duration<long, std::milli> dur(millisecondsTimeout);
-					return condition.wait_for(lock, dur, [&]() { return state.load(); });
+				template<class T> static void SortValues(T* dta, int count, std::false_type) {
+					Sort(dta, count, [](T const& a, T const& b) -> bool { return a < b; }, false);
 				}
 			};
 
-			ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+			template<class T> void List<T>::Sort() const {
+				SortHelper::Sort(GOD()->arrdta, GOD()->Count);
+			}
 
-			ManualResetEventConditionVariable(){}
+			template<class T> void List<T>::Sort(IComparer<T> const& comparer) const {
+				if (comparer == null) {
+					Sort();
+					return;
+				}
+				typename IComparer<T>::CompareFN* comp = comparer.GetFP_Compare();
+				SortHelper::Sort(GOD()->arrdta, GOD()->Count, [comp](T const& a, T const& b) -> bool {
+					return comp(a, b) < 0;
+					}, false);
+			}
 
-			ManualResetEventConditionVariable(std::nullptr_t const & n) : System::Object(n) {
+			template<class T> template<class F> void List<T>::SortWithComparison(F const& comparison) const {
+				SortHelper::Sort(GOD()->arrdta, GOD()->Count, [&comparison](T const& a, T const& b) -> bool {
+					return comparison(a, b) < 0;
+					}, false);
 			}
 
-			ManualResetEventConditionVariable(ManualResetEventConditionVariable* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					od = dd;
-				}
-				else {
-					od = pValue->od;
-					pValue->od = nullptr;
-				}
-				delete pValue;
+			template<class T> template<class F> void List<T>::SortWithKey(F const& keySelector) const {
+				SortHelper::SortByKey(GOD()->arrdta, GOD()->Count, keySelector, false);
 			}
 
-			ManualResetEventConditionVariable(ManualResetEventConditionVariable const & other) : System::Object(other) { }
+			template<class T> template<class R> IEnumerable<T> IEnumerable<T>::ObjectData::OrderBy(Func<T, R> const & keySelector, IComparer<R> const & comparer) const {
+				List<T> ret(0);
+				IEnumerator<T> enu = this->GetEnumerator();
+				typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = enu.GetFP_MoveNextGetCurrent();
 
-			ManualResetEventConditionVariable(ManualResetEventConditionVariable&& other) noexcept : System::Object(std::move(other)) { }
+				T* cur;
+				while ((cur = mngc(enu.od)) != null)
+				{
+					ret.Add(*cur);
+				}
+				typename IComparer<R>::CompareFN* comp = comparer.GetFP_Compare();
+				SortHelper::SortByKey(ret.GOD()->arrdta, ret.GOD()->Count, keySelector, [comp](R const& a, R const& b) -> bool {
+					return comp(a, b) < 0;
+					});
 
-			ManualResetEventConditionVariable(Object::ObjectData* other) : System::Object(other) {
+				return ret;
 			}
+			template<class T> template<class R> IEnumerable<T> IEnumerable<T>::ObjectData::OrderBy(const Func<T, R>& keySelector) const {
+				List<T> ret(0);
+				IEnumerator<T> enu = this->GetEnumerator();
+				typename IEnumerator<T>::MoveNextGetCurrentFN* mngc = enu.GetFP_MoveNextGetCurrent();
 
-			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable const & other) {
-				System::Object::operator=(other);
-				return *this;
+				T* cur;
+				while ((cur = mngc(enu.od)) != null)
+				{
+					ret.Add(*cur);
+				}
+				SortHelper::SortByKey(ret.GOD()->arrdta, ret.GOD()->Count, keySelector, false);
+
+				return ret;
 			}
+		}
+	}
+
+	namespace Linq {
+
+		// ordering of OrderBy/OrderByDescending: a single key
+		template<class F> class KeyCompare {
+		private:
+			F keySelector;
+			bool descending;
+		public:
+			KeyCompare(F const& keySelector, bool descending) : keySelector(keySelector), descending(descending) {}
 
-			ManualResetEventConditionVariable& operator=(std::nullptr_t const & n) {
-				System::Object::operator=(n);
-				return *this;
+			template<class T> int Compare(T const& a, T const& b) const {
+				auto keya = keySelector(a);
+				auto keyb = keySelector(b);
+				int ret = keya < keyb ? -1 : (keyb < keya ? 1 : 0);
+				return descending ? -ret : ret;
 			}
 
-			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
+			// a single key is computed only once per element, and radix sorted if it is integral or a String
+			template<class T> void Sort(T* dta, int count) const {
+				System::Collections::Generic::SortHelper::SortByKey(dta, count, keySelector, descending);
 			}
+		};
 
-			ManualResetEventConditionVariable& operator=(ManualResetEventConditionVariable* other) {
-				if (od == other->od)
-					return *this;
-				Release();
-				od = other->od;
-				::operator delete((void*)other);
-				return *this;
+		// ordering of ThenBy/ThenByDescending: the ordering so far, ties broken by one more key
+		template<class Prev, class F> class ThenCompare {
+		private:
+			Prev prev;
+			F keySelector;
+			bool descending;
+		public:
+			ThenCompare(Prev const& prev, F const& keySelector, bool descending) : prev(prev), keySelector(keySelector), descending(descending) {}
+
+			template<class T> int Compare(T const& a, T const& b) const {
+				int ret = prev.Compare(a, b);
+				if (ret)
+					return ret;
+				auto keya = keySelector(a);
+				auto keyb = keySelector(b);
+				ret = keya < keyb ? -1 : (keyb < keya ? 1 : 0);
+				return descending ? -ret : ret;
 			}
 
-			ManualResetEventConditionVariable* operator->() {
-				return this;
+			template<class T> void Sort(T* dta, int count) const {
+				ThenCompare const& cmp = *this;
+				System::Collections::Generic::SortHelper::Sort(dta, count, [&cmp](T const& a, T const& b) -> bool {
+					return cmp.Compare(a, b) < 0;
+					}, true);
 			}
+		};
 
+		template<class Src, class Cmp> class OrderByExpr {
+		private:
+			Src src;
+			Cmp cmp;
+		public:
+			typedef typename Src::value_type value_type;
 
+			OrderByExpr(Src const& src, Cmp const& cmp) : src(src), cmp(cmp) {}
 
-			/// <summary>Initializes a new instance of the ManualResetEvent class with a Boolean value indicating whether to set the initial state to signaled.</summary>
-			/// <param name="initialState">true to set the initial state signaled; false to set the initial state to nonsignaled.</param>
-			ManualResetEventConditionVariable(bool initialState) {
-				this->od = new ObjectData(initialState);
+			Src const& GetSource() const {
+				return src;
 			}
 
-			/// <summary>Sets the state of the event to signaled, allowing one or more waiting threads to proceed.</summary>
-			/// <returns>true if the operation succeeds; otherwise, false.</returns>
-			bool Set() const {
-				return GOD()->Set();
+			Cmp const& GetComparer() const {
+				return cmp;
 			}
 
-			/// <summary>Sets the state of the event to nonsignaled, causing threads to block.</summary>
-			/// <returns>true if the operation succeeds; otherwise, false.</returns>
-			bool Reset() const {
-				return GOD()->Reset();
+			template<class Sink> bool ForEach(Sink& sink) const {
+				// sorting needs every element, so they are buffered when the query executes
+				System::Collections::Generic::List<value_type> items = Query<Src>(src).ToList();
+				value_type* dta = items.GOD()->arrdta;
+				int count = items.GOD()->Count;
+				cmp.Sort(dta, count);
+				for (int i = 0; i < count; i++) {
+					if (!sink(dta[i]))
+						return false;
+				}
+				return true;
 			}
 
-			/// <summary>Blocks the current thread until the current instance receives a signal, using a TimeSpan to specify the time interval.</summary>
-			/// <param name="timeout">A TimeSpan that represents the number of milliseconds to wait, or a TimeSpan that represents -1 milliseconds to wait indefinitely.</param>
-			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
-			bool WaitOne(TimeSpan const& timeout) const {
-				return GOD()->WaitOne(timeout);
+			int GetCountHint() const {
+				return src.GetCountHint();
 			}
+		};
 
-			/// <summary>Blocks the current thread until the current WaitHandle receives a signal, using a 32-bit signed integer to specify the time interval in milliseconds.</summary>
-			/// <param name="millisecondsTimeout">The number of milliseconds to wait, or Infinite (-1) to wait indefinitely.</param>
-			/// <returns>true if the current instance receives a signal; otherwise, false.</returns>
-			bool WaitOne(int millisecondsTimeout) const {
-				return GOD()->WaitOne(millisecondsTimeout);
+		template<class Src, class Cmp> class OrderedQuery : public Query<OrderByExpr<Src, Cmp>> {
+		public:
+			OrderedQuery(Src const& src, Cmp const& cmp) : Query<OrderByExpr<Src, Cmp>>(OrderByExpr<Src, Cmp>(src, cmp)) {}
+
+			/// <summary>Performs a subsequent ordering of the elements in a sequence in ascending order according to a key.</summary>
+			template<class F> OrderedQuery<Src, ThenCompare<Cmp, F>> ThenBy(F const& keySelector) const {
+				return OrderedQuery<Src, ThenCompare<Cmp, F>>(this->expr.GetSource(), ThenCompare<Cmp, F>(this->expr.GetComparer(), keySelector, false));
 			}
 
-			/// <summary>Blocks the current thread until the current WaitHandle receives a signal.</summary>
-			/// <returns>true if the current instance receives a signal. If the current instance is never signaled, WaitOne() never returns.</returns>
-			bool WaitOne() const {
-				return GOD()->WaitOne();
+			/// <summary>Performs a subsequent ordering of the elements in a sequence in descending order according to a key.</summary>
+			template<class F> OrderedQuery<Src, ThenCompare<Cmp, F>> ThenByDescending(F const& keySelector) const {
+				return OrderedQuery<Src, ThenCompare<Cmp, F>>(this->expr.GetSource(), ThenCompare<Cmp, F>(this->expr.GetComparer(), keySelector, true));
 			}
 		};
 
-#if _MSC_VER || __MINGW32__
-		using ManualResetEvent = ManualResetEventConditionVariable; // ManualResetEventWindows;
-#else
-		using ManualResetEvent = ManualResetEventConditionVariable;
-#endif
-
-	}
-}
+		template<class Expr> template<class F> OrderedQuery<Expr, KeyCompare<F>> Query<Expr>::OrderBy(F const& keySelector) const {
+			return OrderedQuery<Expr, KeyCompare<F>>(expr, KeyCompare<F>(keySelector, false));
+		}
 
+		template<class Expr> template<class F> OrderedQuery<Expr, KeyCompare<F>> Query<Expr>::OrderByDescending(F const& keySelector) const {
+			return OrderedQuery<Expr, KeyCompare<F>>(expr, KeyCompare<F>(keySelector, true));
+		}
 
-namespace System {
-	namespace Threading {
-		class System_API SimpleThreadPool : public Object
-		{
-		private:
-			static int Get_ThreadCount() {
-				return _Instance.GetThreadCount();
-			}
+		template<class Expr> class ParallelQuery {
 		public:
-			class System_API ObjectData : public Object::ObjectData {
-			private:
-			public:
-				std::atomic<int> NumberOfThreads{};
-				int MaxThreads = 8;
+			typedef typename Expr::value_type value_type;
 
-				class SimpleThread
-				{
-				private:
-				public:
-					Thread t;
-					System::Collections::Concurrent::ConcurrentQueue<std::function<void()>> ActionQueue;
-
-					void Run()
-					{
-						//int lastcnt = 0;
-						std::function<void()> fptr;
-						while (true)
-						{
-							//int cnt = ActionQueue.Count;
-							//if (lastcnt != cnt) {
-							//	lastcnt = cnt;
-							//	Console::WriteLine("in thread " + string(lastcnt));
-							//}
-							if (ActionQueue.TryDequeue(out(fptr)))
-							{
-								fptr();
-							}
-							Thread::Sleep(10);
-						}
-					}
-				};
+		private:
+			Expr expr;
+			int degree;
+			bool ordered;
 
-				System::Collections::Concurrent::ConcurrentQueue<std::function<void()>> ActionQueue;
+			template<class E> friend class ParallelQuery;
 
-				ObjectData() : ActionQueue(new System::Collections::Concurrent::ConcurrentQueue<std::function<void()>>())
-				{
+			// below this many elements per chunk the work queue costs more than it saves
+			static const int MinChunkSize = 2048;
 
-				}
+			// per worker partial result, padded so that two workers never write to the same cache line
+			template<class V> struct Partial {
+				V value{};
+				bool gotone = false;
+				char pad[64];
+			};
 
-				void Execute(Action<> const& act)
-				{
-					ActionQueue.Enqueue(act);
-					int numt = NumberOfThreads.load(std::memory_order_relaxed);
-					while (numt < MaxThreads) {
-						if (NumberOfThreads.compare_exchange_weak(numt, numt + 1)) {
-							SimpleThread* nst = new SimpleThread();
-							nst->ActionQueue = ActionQueue;
-							nst->t = Thread([nst]() {
-								nst->Run();
-								});
-							nst->t.IsBackground = true;
-							nst->t.Start();
-						}
-					}
-				}
+			struct Plan {
+				int count;
+				int chunkCount;
+				int workerCount;
+			};
 
+			Plan GetPlan() const {
+				return GetPlan(expr.GetCountHint());
+			}
+
+			Plan GetPlan(int count) const {
+				Plan plan;
+				plan.count = count;
+				int workers = GetDegreeOfParallelism();
+				int chunks = plan.count / MinChunkSize;
+				if (chunks > workers * 4)
+					chunks = workers * 4;
+				if (chunks < 1)
+					chunks = 1;
+				plan.chunkCount = chunks;
+				plan.workerCount = workers < chunks ? workers : chunks;
+				return plan;
+			}
+
+			// calls body(begin, end, chunk, worker) for every chunk of the source index range
+			template<class Body> static void Run(Plan const& plan, Body const& body) {
+				int count = plan.count;
+				int chunkCount = plan.chunkCount;
+				ParallelWork::Run(chunkCount, plan.workerCount, [&body, count, chunkCount](int chunk, int worker) {
+					int begin = (int)((long)count * chunk / chunkCount);
+					int end = (int)((long)count * (chunk + 1) / chunkCount);
+					body(begin, end, chunk, worker);
+					});
+			}
 
-			};
+			// moves the parts into one list, in the order of the parts
+			static System::Collections::Generic::List<value_type> Concat(std::vector<System::Collections::Generic::List<value_type>>& parts, int workerCount) {
+				int partCount = (int)parts.size();
+				std::vector<int> offsets(partCount + 1);
+				offsets[0] = 0;
+				for (int i = 0; i < partCount; i++)
+					offsets[i + 1] = offsets[i] + (parts[i] != null ? parts[i].GOD()->Count : 0);
 
-						ObjectData* GOD() const { return static_cast<ObjectData*>(this->od); };
+				System::Collections::Generic::List<value_type> ret(offsets[partCount]);
+				value_type* dst = ret.GOD()->arrdta;
+				ParallelWork::Run(partCount, workerCount, [&parts, &offsets, dst](int part, int) {
+					if (parts[part] == null)
+						return;
+					value_type* src = parts[part].GOD()->arrdta;
+					int cnt = parts[part].GOD()->Count;
+					value_type* pdst = dst + offsets[part];
+					for (int i = 0; i < cnt; i++)
+						new (&pdst[i]) value_type(std::move(src[i]));
+					});
+				ret.GOD()->Count = offsets[partCount];
+				return ret;
+			}
 
-			SimpleThreadPool(){}
+		public:
+			ParallelQuery(Expr const& expr, int degree, bool ordered) : expr(expr), degree(degree), ordered(ordered) {}
 
-			SimpleThreadPool(std::nullptr_t const & n) {
-				this->od = nullptr;
+			/// <summary>Gets the number of threads used to run the query, Environment::ProcessorCount unless set through WithDegreeOfParallelism.</summary>
+			int GetDegreeOfParallelism() const {
+				int ret = degree ? degree : (int)Environment::ProcessorCount;
+				return ret > 0 ? ret : 1;
 			}
 
-			SimpleThreadPool(SimpleThreadPool* pValue) {
-				if (!pValue->od) {
-					ObjectData* dd = new ObjectData();
-					this->od = dd;
-				}
-				else {
-					this->od = pValue->od;
-					pValue->od = nullptr;
-				}
-				delete pValue;
+			/// <summary>Sets the degree of parallelism to use in a query.</summary>
+			/// <param name="degreeOfParallelism">The maximum number of threads that will be used to process the query.</param>
+			ParallelQuery<Expr> WithDegreeOfParallelism(int degreeOfParallelism) const {
+				if (degreeOfParallelism < 1)
+					throw ArgumentOutOfRangeException();
+				return ParallelQuery<Expr>(expr, degreeOfParallelism, ordered);
 			}
 
-			SimpleThreadPool(SimpleThreadPool const & other) : System::Object(other) { }
+			/// <summary>Enables treatment of the data source as if it were ordered: ToList and ToArray keep the order of the source.</summary>
+			ParallelQuery<Expr> AsOrdered() const {
+				return ParallelQuery<Expr>(expr, degree, true);
+			}
 
-			SimpleThreadPool(SimpleThreadPool&& other) noexcept : System::Object(std::move(other)) { }
+			/// <summary>Allows the query to merge its results in any order, which is the default.</summary>
+			ParallelQuery<Expr> AsUnordered() const {
+				return ParallelQuery<Expr>(expr, degree, false);
+			}
 
-			SimpleThreadPool(ObjectData* other) {
-				this->od = other;
-				if (this->od)
-					this->AddRef();
+			/// <summary>Converts the ParallelQuery back to a sequential query.</summary>
+			Query<Expr> AsSequential() const {
+				return Query<Expr>(expr);
 			}
 
-			SimpleThreadPool& operator=(SimpleThreadPool const & other) {
-				System::Object::operator=(other);
-				return *this;
+			/// <summary>Filters in parallel a sequence of values based on a predicate.</summary>
+			template<class F> ParallelQuery<WhereExpr<Expr, F>> Where(F const& predicate) const {
+				return ParallelQuery<WhereExpr<Expr, F>>(WhereExpr<Expr, F>(expr, predicate), degree, ordered);
 			}
 
-			SimpleThreadPool& operator=(SimpleThreadPool* other) {
-				if (this->od == other->od)
-					return *this;
-				this->Release();
-				this->od = other->od;
-				::operator delete((void*)other);
-				return *this;
+			/// <summary>Projects in parallel each element of a sequence into a new form.</summary>
+			template<class F> ParallelQuery<SelectExpr<Expr, F>> Select(F const& selector) const {
+				return ParallelQuery<SelectExpr<Expr, F>>(SelectExpr<Expr, F>(expr, selector), degree, ordered);
 			}
 
-			SimpleThreadPool& operator=(SimpleThreadPool&& other) noexcept {
-				System::Object::operator=(std::move(other));
-				return *this;
+			/// <summary>Invokes in parallel the specified action for each element, in no particular order.</summary>
+			template<class F> void ForAll(F const& action) const {
+				Expr const& e = expr;
+				Run(GetPlan(), [&e, &action](int begin, int end, int, int) {
+					auto sink = [&action](value_type const& value) -> bool {
+						action(value);
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
 			}
 
-			SimpleThreadPool* operator->() {
-				return this;
+			int Count() const {
+				Plan plan = GetPlan();
+				std::vector<Partial<int>> partials(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials](int begin, int end, int, int worker) {
+					int cnt = 0;
+					auto sink = [&cnt](value_type const&) -> bool {
+						cnt++;
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					partials[worker].value += cnt;
+					});
+				int ret = 0;
+				for (auto& p : partials)
+					ret += p.value;
+				return ret;
 			}
 
+			template<class F> int Count(F const& predicate) const {
+				return Where(predicate).Count();
+			}
 
+			template<class F> bool Any(F const& predicate) const {
+				std::atomic<bool> found{ false };
+				Expr const& e = expr;
+				Run(GetPlan(), [&e, &predicate, &found](int begin, int end, int, int) {
+					auto sink = [&predicate, &found](value_type const& value) -> bool {
+						if (found.load(std::memory_order_relaxed))
+							return false;
+						if (predicate(value)) {
+							found.store(true, std::memory_order_relaxed);
+							return false;
+						}
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
+				return found.load();
+			}
 
-			SimpleThreadPool(int NumberOfThreads)
-			{
-				ObjectData* dd = new ObjectData();
-				dd->MaxThreads = NumberOfThreads;
-				this->od = dd;
+			template<class F> bool All(F const& predicate) const {
+				return !Any([&predicate](value_type const& value) { return !predicate(value); });
 			}
 
-			static SimpleThreadPool _Instance;
-			static PropGenGetStatic<int, &SimpleThreadPool::Get_ThreadCount> ThreadCount;
+			value_type Sum() const {
+				Plan plan = GetPlan();
+				std::vector<Partial<value_type>> partials(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials](int begin, int end, int, int worker) {
+					value_type sum{};
+					auto sink = [&sum](value_type const& value) -> bool {
+						sum += value;
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					partials[worker].value += sum;
+					});
+				value_type ret{};
+				for (auto& p : partials)
+					ret += p.value;
+				return ret;
+			}
 
-			static void QueueUserWorkItem(Action<> const & act)
-			{
-				_Instance.Execute(act);
+			double Average() const {
+				Plan plan = GetPlan();
+				std::vector<Partial<value_type>> partials(plan.workerCount);
+				std::vector<Partial<int>> counts(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials, &counts](int begin, int end, int, int worker) {
+					value_type sum{};
+					int cnt = 0;
+					auto sink = [&sum, &cnt](value_type const& value) -> bool {
+						sum += value;
+						cnt++;
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					partials[worker].value += sum;
+					counts[worker].value += cnt;
+					});
+				value_type sum{};
+				int count = 0;
+				for (int i = 0; i < plan.workerCount; i++) {
+					sum += partials[i].value;
+					count += counts[i].value;
+				}
+				if (!count)
+					throw InvalidOperationException();
+				return (double)sum / count;
+			}
+
+			value_type Max() const {
+				Plan plan = GetPlan();
+				std::vector<Partial<value_type>> partials(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials](int begin, int end, int, int worker) {
+					Partial<value_type>& p = partials[worker];
+					auto sink = [&p](value_type const& value) -> bool {
+						if (!p.gotone || p.value < value) {
+							p.value = value;
+							p.gotone = true;
+						}
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
+				Partial<value_type>* ret = null;
+				for (auto& p : partials) {
+					if (p.gotone && (!ret || ret->value < p.value))
+						ret = &p;
+				}
+				if (!ret)
+					throw InvalidOperationException();
+				return ret->value;
+			}
+
+			value_type Min() const {
+				Plan plan = GetPlan();
+				std::vector<Partial<value_type>> partials(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials](int begin, int end, int, int worker) {
+					Partial<value_type>& p = partials[worker];
+					auto sink = [&p](value_type const& value) -> bool {
+						if (!p.gotone || value < p.value) {
+							p.value = value;
+							p.gotone = true;
+						}
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
+				Partial<value_type>* ret = null;
+				for (auto& p : partials) {
+					if (p.gotone && (!ret || p.value < ret->value))
+						ret = &p;
+				}
+				if (!ret)
+					throw InvalidOperationException();
+				return ret->value;
+			}
+
+			/// <summary>Applies in parallel an accumulator function over a sequence. Every worker starts from seed, the partial results are merged with combine.</summary>
+			template<class TAccumulate, class F, class C> TAccumulate Aggregate(TAccumulate const& seed, F const& func, C const& combine) const {
+				Plan plan = GetPlan();
+				std::vector<Partial<TAccumulate>> partials(plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &partials, &seed, &func](int begin, int end, int, int worker) {
+					Partial<TAccumulate>& p = partials[worker];
+					if (!p.gotone) {
+						p.value = seed;
+						p.gotone = true;
+					}
+					auto sink = [&p, &func](value_type const& value) -> bool {
+						p.value = func(p.value, value);
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
+				TAccumulate ret = seed;
+				bool first = true;
+				for (auto& p : partials) {
+					if (!p.gotone)
+						continue;
+					ret = first ? p.value : combine(ret, p.value);
+					first = false;
+				}
+				return ret;
 			}
 
-			void Execute(Action<> const& act)
-			{
-				GOD()->Execute(act);
+			/// <summary>Creates a List from the query. The order of the source is kept only if the query is AsOrdered.</summary>
+			System::Collections::Generic::List<value_type> ToList() const {
+				Plan plan = GetPlan();
+				// ordered: one buffer per chunk, concatenated in chunk order
+				// unordered: one buffer per worker, fewer and bigger buffers to concatenate
+				bool perchunk = ordered;
+				std::vector<System::Collections::Generic::List<value_type>> parts(perchunk ? plan.chunkCount : plan.workerCount);
+				Expr const& e = expr;
+				Run(plan, [&e, &parts, perchunk](int begin, int end, int chunk, int worker) {
+					System::Collections::Generic::List<value_type>& part = parts[perchunk ? chunk : worker];
+					if (part == null)
+						part = System::Collections::Generic::List<value_type>(end - begin);
+					typename System::Collections::Generic::List<value_type>::ObjectData* ld = part.GOD();
+					auto sink = [ld](value_type const& value) -> bool {
+						ld->Add(value);
+						return true;
+					};
+					e.ForEachRange(begin, end, sink);
+					});
+				return Concat(parts, plan.workerCount);
 			}
 
-			int GetThreadCount() {
-				return GOD()->NumberOfThreads.load(std::memory_order_relaxed);
+			System::Collections::Generic::Array<value_type> ToArray() const {
+				return ToList().ToArray();
 			}
 
-			void GetMaxThreads(Out<int> workerThreads, Out<int> completionPortThreads) {
-				workerThreads = GOD()->MaxThreads;
-				completionPortThreads = 0; // TODO?
+			/// <summary>Sorts in parallel the elements of a sequence in ascending order according to a key. The sort is stable, the result is an ordered query over the sorted elements.</summary>
+			template<class F> ParallelQuery<ListSource<value_type>> OrderBy(F const& keySelector) const {
+				System::Collections::Generic::List<value_type> items = AsOrdered().ToList();
+				System::Collections::Generic::SortHelper::SortByKey(items.GOD()->arrdta, items.GOD()->Count, keySelector, false);
+				return ParallelQuery<ListSource<value_type>>(ListSource<value_type>(items), degree, true);
 			}
 
+			/// <summary>Sorts in parallel the elements of a sequence in descending order according to a key. The sort is stable, the result is an ordered query over the sorted elements.</summary>
+			template<class F> ParallelQuery<ListSource<value_type>> OrderByDescending(F const& keySelector) const {
+				System::Collections::Generic::List<value_type> items = AsOrdered().ToList();
+				System::Collections::Generic::SortHelper::SortByKey(items.GOD()->arrdta, items.GOD()->Count, keySelector, true);
+				return ParallelQuery<ListSource<value_type>>(ListSource<value_type>(items), degree, true);
+			}
 		};
 
-#ifndef SYSTEM_EXPORTS
-#if _MSC_VER || __MINGW32__
-		SimpleThreadPool SimpleThreadPool::_Instance{ 8 };
-#elif ESP32
-		SimpleThreadPool SimpleThreadPool::_Instance{ null };
-#endif
-		PropGenGetStatic<int, &SimpleThreadPool::Get_ThreadCount> SimpleThreadPool::ThreadCount{};
-#endif
-
+		template<class Expr> ParallelQuery<Expr> Query<Expr>::AsParallel() const {
+			return ParallelQuery<Expr>(expr, 0, false);
+		}
+	}
 
+	namespace Collections {
+		namespace Generic {
+			template<class T> Linq::ParallelQuery<Linq::ListSource<T>> List<T>::AsParallel() const {
+				return Linq::ParallelQuery<Linq::ListSource<T>>(Linq::ListSource<T>(*this), 0, false);
+			}
 
-		using ThreadPool = SimpleThreadPool;
+			template<class T> Linq::ParallelQuery<Linq::ArraySource<T>> Array<T>::AsParallel() const {
+				return Linq::ParallelQuery<Linq::ArraySource<T>>(Linq::ArraySource<T>(*this), 0, false);
+			}
+		}
 	}
 }
 
@@ -15664,12 +25620,11 @@ namespace System {
 				file.seekg(std::ios::beg);
 				uint isize = (uint)size;
 
-				byte* memblock = new byte[isize];
+				System::Collections::Generic::Array<byte> ret = System::Collections::Generic::Array<byte>::CreateUninitialized((int)isize);
 
-				file.read((char*)memblock, size);
+				file.read((char*)ret.GOD()->arrdta, size);
 				file.close();
 
-				System::Collections::Generic::Array<byte> ret((byte*)memblock);
 				return ret;
 			}
 
@@ -18715,6 +28670,23 @@ namespace System {
 						return ret;
 					}
 
+					int EndSend(IAsyncResult const& asyncResult, Out<SocketError> errorCode) {
+						int ret = 0;
+						OverlappedAsyncResult::ObjectData* oarod = static_cast<OverlappedAsyncResult::ObjectData*>(asyncResult.GOD());
+						while (!oarod->Get_IsCompleted())
+							System::Threading::Thread::Sleep(15);
+						errorCode = (SocketError)oarod->Get_ErrorCode();
+						if (errorCode == SocketError::Success) {
+#if _MSC_VER || __MINGW32__
+							OverlappedAsyncResult oar(oarod);
+							MYOVERLAPPED* mol = oar.GetOverlapped();
+							ret = (int)mol->Overlapped.InternalHigh;
+#endif
+						}
+
+						return ret;
+					}
+
 					IAsyncResult BeginSendTo(byte const* buffer, int offset, int size, SocketFlags socketFlags, EndPoint const& remoteEP, Action<IAsyncResult&> const& callback, Object const& state) {
 						OverlappedAsyncResult asyncResult = new OverlappedAsyncResult(Socket(this), state, callback);
 						SocketError errorCode = DoBeginSendTo(buffer, offset, size, socketFlags, remoteEP, asyncResult);
@@ -18945,6 +28917,48 @@ namespace System {
 					return GOD()->EndReceive(asyncResult, errorCode);
 				}
 
+				int EndSend(IAsyncResult const& asyncResult, Out<SocketError> errorCode) const {
+					return GOD()->EndSend(asyncResult, errorCode);
+				}
+
+				/// <summary>Receives into buffer without blocking a thread. The task completes with the number of bytes
+				/// received or faults with a SocketException; it can be awaited from a coroutine.</summary>
+				System::Threading::Tasks::Task<int> ReceiveAsync(byte* buffer, int offset, int size, SocketFlags socketFlags) const {
+					System::Threading::Tasks::TaskCompletionSource<int> source = new System::Threading::Tasks::TaskCompletionSource<int>();
+					Socket self(*this);
+					SocketError errorCode;
+					GOD()->BeginReceive(buffer, offset, size, socketFlags, out(errorCode), [self, source](IAsyncResult& asyncResult) {
+						SocketError error;
+						int received = self.EndReceive(asyncResult, out(error));
+						if (error == SocketError::Success)
+							source.TrySetResult(received);
+						else
+							source.TrySetException(SocketException(error));
+						}, null);
+					if (errorCode != SocketError::Success && errorCode != SocketError::IOPending)
+						source.TrySetException(SocketException(errorCode));
+					return source.Task;
+				}
+
+				/// <summary>Sends from buffer without blocking a thread. The task completes with the number of bytes
+				/// sent or faults with a SocketException.</summary>
+				System::Threading::Tasks::Task<int> SendAsync(byte const* buffer, int offset, int size, SocketFlags socketFlags) const {
+					System::Threading::Tasks::TaskCompletionSource<int> source = new System::Threading::Tasks::TaskCompletionSource<int>();
+					Socket self(*this);
+					SocketError errorCode;
+					GOD()->BeginSend(buffer, offset, size, socketFlags, out(errorCode), [self, source](IAsyncResult& asyncResult) {
+						SocketError error;
+						int sent = self.EndSend(asyncResult, out(error));
+						if (error == SocketError::Success)
+							source.TrySetResult(sent);
+						else
+							source.TrySetException(SocketException(error));
+						}, null);
+					if (errorCode != SocketError::Success && errorCode != SocketError::IOPending)
+						source.TrySetException(SocketException(errorCode));
+					return source.Task;
+				}
+
 				IAsyncResult BeginSendTo(byte const* buffer, int offset, int size, SocketFlags socketFlags, EndPoint const& remoteEP, Action<IAsyncResult&> const& callback, Object const& state) const {
 					return GOD()->BeginSendTo(buffer, offset, size, socketFlags, remoteEP, callback, state);
 				}